@@ -14,27 +14,23 @@ def exit_handler(signum, frame):
     print("Exiting...")
     exit(0)
 
-async def async_send_request(method, path):
+async def async_send_request(conn, method, path):
     start_time = time.time()
-    conn = http.client.HTTPConnection("localhost", 8080)
     conn.request(method, path)
     response = conn.getresponse()
     data = response.read().decode("utf-8")
-    conn.close()
     end_time = time.time()
     latency = end_time - start_time
     latencies.append(latency)
     # print(path, json.dumps(data), "->", response.status, latency)
     return data
 
-async def async_send_post_request(path, data):
+async def async_send_post_request(conn, path, data):
     start_time = time.time()
-    conn = http.client.HTTPConnection("localhost", 8080)
     headers = {"Content-Type": "application/json"}
     conn.request("POST", path, json.dumps(data), headers)  # Serialize data as JSON
     response = conn.getresponse()
     out = response.read().decode("utf-8")
-    conn.close()
     end_time = time.time()
     latency = end_time - start_time
     latencies.append(latency)
@@ -43,8 +39,11 @@ async def async_send_post_request(path, data):
 
 async def async_test_function():
 
+    # One persistent (keep-alive) connection for all the requests of this client
+    conn = http.client.HTTPConnection("localhost", 8080)
+
     # Send GET request to the /movies endpoint
-    movies_data = await async_send_request("GET", "/movies")
+    movies_data = await async_send_request(conn, "GET", "/movies")
 
     # Parse the JSON data
     movies_list = json.loads(movies_data)
@@ -54,23 +53,23 @@ async def async_test_function():
     data = {"movie": selected_movie}
 
     # Send POST req: Find theaters for this movie
-    theaters = await async_send_post_request("/find", data)
+    theaters = await async_send_post_request(conn, "/find", data)
     theaters_list = json.loads(theaters)
 
     # Select a random theater
     selected_theater = random.choice(theaters_list)
 
-    # Compose a random range of numbers of seat to book
-    array_length = random.randint(0, 6)  # Adjust the range as needed
-    random_integers = [random.randint(0, 19) for _ in range(array_length)]
-    data = {"theater": selected_theater, "movie": selected_movie, "seats": random_integers}
+    # Ask the server for a random number of adjacent seats instead of guessing seat numbers
+    seat_count = random.randint(1, 6)  # Adjust the range as needed
+    data = {"theater": selected_theater, "movie": selected_movie, "count": seat_count, "contiguous": True}
 
     # Send POST req: booking 
-    book = await async_send_post_request("/seats", data)    
+    book = await async_send_post_request(conn, "/seats/auto", data)    
     data = {"theater": selected_theater, "movie": selected_movie}
 
     # Send POST req: get bookings
-    seats = await async_send_post_request("/bookings", data)
+    seats = await async_send_post_request(conn, "/bookings", data)
+    conn.close()
 
     # Calculate whole function latencies
     mean_latency = sum(latencies) / len(latencies)
@@ -0,0 +1,41 @@
+#include "binary_server.h"
+#include "binary_session.h"
+
+using asio::ip::tcp;
+
+/// Lets several acceptors listen on the same port, the kernel balances connections between them
+using reuse_port = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+///////////////////////////////////////////////////////////////////////////////
+
+BinaryServer::BinaryServer(asio::io_context &io_context, const tcp::endpoint &endpoint, ReservationSystem &reservationSystem, Logger &logger, Metrics &metrics,
+                           ShardGroup *shards, std::size_t shardIndex)
+    : acceptor_(io_context), reservationSystem_(reservationSystem), logger_(logger), metrics_(metrics), shards_(shards), shardIndex_(shardIndex)
+{
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(tcp::acceptor::reuse_address(true));
+    if (shards_)
+    {
+        acceptor_.set_option(reuse_port(true));
+    }
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+    accept();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryServer::accept()
+{
+    acceptor_.async_accept([this](asio::error_code ec, tcp::socket socket)
+                           {
+                               if (!ec)
+                               {
+                                   socket.set_option(tcp::no_delay(true), ec);
+                                   std::make_shared<BinarySession>(std::move(socket), reservationSystem_, logger_, metrics_, shards_, shardIndex_)->start();
+                               }
+                               accept(); // Accept the next connection
+                           });
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <asio.hpp>
+
+#include "logger.h"
+#include "metrics.h"
+#include "reservation_system.h"
+#include "shard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Accepts connections of the binary protocol and starts a BinarySession for each,
+/// next to the HTTP Server and sharing its reservation system and metrics
+class BinaryServer
+{
+public:
+    /// @brief Constructor
+    /// @param io_context
+    /// @param endpoint
+    /// @param reservationSystem
+    /// @param logger
+    /// @param metrics
+    /// @param shards shards of a sharded server, or nullptr when all threads share 'io_context'.
+    /// Each shard runs its own BinaryServer on the same port, like Server.
+    /// @param shardIndex shard this server accepts for
+    BinaryServer(asio::io_context &io_context, const asio::ip::tcp::endpoint &endpoint, ReservationSystem &reservationSystem, Logger &logger, Metrics &metrics,
+                 ShardGroup *shards = nullptr, std::size_t shardIndex = 0);
+
+private:
+    void accept();
+
+    asio::ip::tcp::acceptor acceptor_;
+    ReservationSystem &reservationSystem_;
+    Logger &logger_;
+    Metrics &metrics_;
+    ShardGroup *shards_;
+    std::size_t shardIndex_;
+};
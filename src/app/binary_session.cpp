@@ -0,0 +1,356 @@
+#include <cstring>
+
+#include "binary_session.h"
+
+using asio::ip::tcp;
+
+///////////////////////////////////////////////////////////////////////////////
+
+BinarySession::BinarySession(tcp::socket socket, ReservationSystem &reservationSystem, Logger &logger, Metrics &metrics,
+                             ShardGroup *shards, std::size_t shardIndex)
+    : socket_(std::move(socket)), strand_(asio::make_strand(socket_.get_executor())), readBuffer_(INITIAL_BUFFER_SIZE),
+      reservationSystem_(reservationSystem), logger_(logger), metrics_(metrics), shards_(shards), shardIndex_(shardIndex)
+{
+    metrics_.sessionOpened();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+BinarySession::~BinarySession()
+{
+    metrics_.sessionClosed();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::start()
+{
+    auto self(shared_from_this());
+    asio::dispatch(strand_, [this, self]
+                   { async_read(); });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::async_read()
+{
+    reading_ = true;
+    auto self(shared_from_this());
+    socket_.async_read_some(asio::buffer(readBuffer_.data() + readEnd_, readBuffer_.size() - readEnd_),
+                            asio::bind_executor(strand_, [this, self](asio::error_code ec, std::size_t length)
+                                                {
+                                                    reading_ = false;
+                                                    if (ec)
+                                                    {
+                                                        // Peer is done sending, answer what is in flight and close
+                                                        closing_ = true;
+                                                        start_write();
+                                                        return;
+                                                    }
+                                                    readEnd_ += length;
+                                                    process_frames();
+                                                }));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::continue_reading()
+{
+    if (reading_ || closing_)
+    {
+        return;
+    }
+    // Stop reading while bookings pile up or the client does not keep up with its responses
+    if (inFlight_ >= MAX_IN_FLIGHT || writeBuffer_.size() + outBuffer_.size() >= MAX_BUFFER_SIZE)
+    {
+        return;
+    }
+    if (!reserve_read_space())
+    {
+        closing_ = true; // Cannot happen with valid frames, parse_request rejects larger ones
+        start_write();
+        return;
+    }
+    async_read();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool BinarySession::reserve_read_space()
+{
+    if (readEnd_ < readBuffer_.size())
+    {
+        return true;
+    }
+    if (readStart_ > 0)
+    {
+        std::memmove(readBuffer_.data(), readBuffer_.data() + readStart_, readEnd_ - readStart_);
+        readEnd_ -= readStart_;
+        readStart_ = 0;
+        return true;
+    }
+    if (readBuffer_.size() >= MAX_BUFFER_SIZE)
+    {
+        return false;
+    }
+    readBuffer_.resize(std::min(readBuffer_.size() * 2, MAX_BUFFER_SIZE));
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::process_frames()
+{
+    BinaryProtocol::Request request;
+    while (!closing_ && inFlight_ < MAX_IN_FLIGHT)
+    {
+        auto result = BinaryProtocol::parseRequest(readBuffer_.data() + readStart_, readEnd_ - readStart_, request);
+        if (result == BinaryProtocol::Result::Incomplete)
+        {
+            break;
+        }
+        if (result == BinaryProtocol::Result::Invalid)
+        {
+            // The framing is lost, nothing after this can be answered
+            logger_.log(LogLevel::Warning, "Binary session: invalid frame, closing");
+            closing_ = true;
+            break;
+        }
+        handle_request(request);
+        readStart_ += request.size;
+    }
+
+    if (readStart_ == readEnd_)
+    {
+        readStart_ = readEnd_ = 0;
+    }
+
+    start_write();
+    continue_reading();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::start_write()
+{
+    if (writing_)
+    {
+        return;
+    }
+    if (writeBuffer_.empty())
+    {
+        if (closing_ && inFlight_ == 0)
+        {
+            asio::error_code ignored;
+            socket_.shutdown(tcp::socket::shutdown_both, ignored);
+            socket_.close(ignored);
+        }
+        return;
+    }
+
+    outBuffer_.swap(writeBuffer_);
+    writing_ = true;
+    auto self(shared_from_this());
+    asio::async_write(socket_, asio::buffer(outBuffer_),
+                      asio::bind_executor(strand_, [this, self](asio::error_code ec, std::size_t /*length*/)
+                                          {
+                                              writing_ = false;
+                                              outBuffer_.clear();
+                                              if (ec)
+                                              {
+                                                  closing_ = true;
+                                                  return;
+                                              }
+                                              start_write();
+                                              continue_reading();
+                                          }));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::handle_request(const BinaryProtocol::Request &request)
+{
+    auto start = std::chrono::steady_clock::now();
+    switch (request.operation)
+    {
+    case BinaryProtocol::Operation::Catalog:
+        write_catalog(request.requestId);
+        record_request(Metrics::Route::BinaryCatalog, start, BinaryProtocol::Status::Ok);
+        break;
+    case BinaryProtocol::Operation::Occupancy:
+        record_request(Metrics::Route::BinaryOccupancy, start, write_occupancy(request.requestId, request.payload));
+        break;
+    case BinaryProtocol::Operation::Book:
+        book(request.requestId, request.payload, start);
+        break;
+    default:
+        write_status(request.requestId, BinaryProtocol::Status::UnknownOperation);
+        record_request(Metrics::Route::Other, start, BinaryProtocol::Status::UnknownOperation);
+        break;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::write_catalog(std::uint32_t requestId)
+{
+    std::shared_ptr<const Catalog> catalog = reservationSystem_.getCatalog();
+    std::size_t frame = BinaryProtocol::beginResponse(writeBuffer_, requestId, BinaryProtocol::Status::Ok);
+    BinaryProtocol::writeU64(writeBuffer_, catalog->version);
+
+    BinaryProtocol::writeU32(writeBuffer_, static_cast<std::uint32_t>(catalog->theaters.size()));
+    for (const auto &theater : catalog->theaters)
+    {
+        BinaryProtocol::writeString(writeBuffer_, theater.getName());
+    }
+    BinaryProtocol::writeU32(writeBuffer_, static_cast<std::uint32_t>(catalog->movies.size()));
+    for (const auto &movie : catalog->movies)
+    {
+        BinaryProtocol::writeString(writeBuffer_, movie->getTitle());
+    }
+    BinaryProtocol::writeU32(writeBuffer_, static_cast<std::uint32_t>(catalog->roomTable.size()));
+    for (std::size_t ordinal = 0; ordinal < catalog->roomTable.size(); ++ordinal)
+    {
+        const Room &room = *catalog->roomTable[ordinal];
+        std::shared_ptr<Movie> movie = room.getPlayingMovie();
+        BinaryProtocol::writeU32(writeBuffer_, static_cast<std::uint32_t>(catalog->roomTheaters[ordinal]));
+        BinaryProtocol::writeU32(writeBuffer_, movie ? static_cast<std::uint32_t>(movie->getId()) : 0xffffffff);
+        BinaryProtocol::writeU32(writeBuffer_, static_cast<std::uint32_t>(room.getCapacity()));
+        BinaryProtocol::writeU32(writeBuffer_, static_cast<std::uint32_t>(room.getSeatsPerRow()));
+        BinaryProtocol::writeString(writeBuffer_, room.getRoomName());
+    }
+    const ShowtimeStore &showtimes = catalog->showtimes;
+    BinaryProtocol::writeU32(writeBuffer_, static_cast<std::uint32_t>(showtimes.size()));
+    for (ShowtimeId showtime = 0; showtime < showtimes.size(); ++showtime)
+    {
+        BinaryProtocol::writeU32(writeBuffer_, showtimes.getRoom(showtime));
+        BinaryProtocol::writeU32(writeBuffer_, showtimes.getMovie(showtime));
+        BinaryProtocol::writeU64(writeBuffer_, static_cast<std::uint64_t>(showtimes.getStart(showtime)));
+    }
+    BinaryProtocol::finishResponse(writeBuffer_, frame);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+BinaryProtocol::Status BinarySession::write_occupancy(std::uint32_t requestId, std::string_view payload)
+{
+    BinaryProtocol::Reader reader(payload);
+    std::uint64_t catalogVersion = 0;
+    std::uint32_t room = 0;
+    std::uint32_t showtime = 0;
+    if (!reader.readU64(catalogVersion) || !reader.readU32(room) || !reader.readU32(showtime) || !reader.atEnd())
+    {
+        write_status(requestId, BinaryProtocol::Status::BadRequest);
+        return BinaryProtocol::Status::BadRequest;
+    }
+    // Like HTTP, a replica that never got a full copy would answer with empty rooms
+    const ReplicaStatus *replica = reservationSystem_.getReplicaStatus();
+    if (replica && !replica->synced.load(std::memory_order_relaxed))
+    {
+        write_status(requestId, BinaryProtocol::Status::NotSynced);
+        return BinaryProtocol::Status::NotSynced;
+    }
+    int capacity = 0;
+    std::uint64_t version = 0;
+    RoomSnapshot result = reservationSystem_.snapshotRoomSeats(catalogVersion, room, showtime, words_, capacity, version);
+    if (result != RoomSnapshot::Copied)
+    {
+        BinaryProtocol::Status status = result == RoomSnapshot::StaleCatalog ? BinaryProtocol::Status::StaleCatalog
+                                                                              : BinaryProtocol::Status::NotFound;
+        write_status(requestId, status);
+        return status;
+    }
+    std::size_t frame = BinaryProtocol::beginResponse(writeBuffer_, requestId, BinaryProtocol::Status::Ok);
+    BinaryProtocol::writeU64(writeBuffer_, version);
+    BinaryProtocol::writeU32(writeBuffer_, static_cast<std::uint32_t>(capacity));
+    BinaryProtocol::writeBitmap(writeBuffer_, words_.data(), static_cast<std::uint32_t>(capacity));
+    BinaryProtocol::finishResponse(writeBuffer_, frame);
+    return BinaryProtocol::Status::Ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::book(std::uint32_t requestId, std::string_view payload, std::chrono::steady_clock::time_point start)
+{
+    BinaryProtocol::Reader reader(payload);
+    std::uint64_t catalogVersion = 0;
+    std::uint32_t room = 0;
+    std::uint32_t showtime = 0;
+    std::uint32_t bits = 0;
+    std::vector<int> seats;
+    if (!reader.readU64(catalogVersion) || !reader.readU32(room) || !reader.readU32(showtime) || !reader.readU32(bits) || bits > BinaryProtocol::MAX_BITS ||
+        !reader.readBitmap(bits, seats) || !reader.atEnd() || seats.empty())
+    {
+        write_status(requestId, BinaryProtocol::Status::BadRequest);
+        record_request(Metrics::Route::BinaryBook, start, BinaryProtocol::Status::BadRequest);
+        return;
+    }
+    if (reservationSystem_.getReplicaStatus())
+    {
+        write_status(requestId, BinaryProtocol::Status::ReadOnly);
+        record_request(Metrics::Route::BinaryBook, start, BinaryProtocol::Status::ReadOnly);
+        return;
+    }
+
+    ++inFlight_;
+    std::size_t owner = shards_ ? shards_->owner_of(static_cast<long>(room)) : shardIndex_;
+    auto self(shared_from_this());
+    auto run = [this, self, requestId, catalogVersion, room, showtime, seats = std::move(seats), start]
+    {
+        RoomBooking result = reservationSystem_.bookRoomSeats(catalogVersion, room, showtime, seats);
+        metrics_.recordBooking(result == RoomBooking::Booked);
+        auto respond = [this, self, requestId, result, start]
+        {
+            asio::post(strand_, [this, self, requestId, result, start]
+                       { complete_booking(requestId, result, start); });
+        };
+        if (result == RoomBooking::Booked && reservationSystem_.hasBookingLog())
+        {
+            reservationSystem_.whenDurable(respond);
+        }
+        else
+        {
+            respond();
+        }
+    };
+    if (owner == shardIndex_)
+    {
+        run();
+    }
+    else
+    {
+        shards_->at(owner).execute(std::move(run));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::complete_booking(std::uint32_t requestId, RoomBooking result, std::chrono::steady_clock::time_point start)
+{
+    --inFlight_;
+    BinaryProtocol::Status status = result == RoomBooking::Booked         ? BinaryProtocol::Status::Ok
+                                    : result == RoomBooking::Unavailable  ? BinaryProtocol::Status::Conflict
+                                    : result == RoomBooking::StaleCatalog ? BinaryProtocol::Status::StaleCatalog
+                                                                          : BinaryProtocol::Status::NotFound;
+    write_status(requestId, status);
+    record_request(Metrics::Route::BinaryBook, start, status);
+    process_frames(); // Frames held back by the in-flight limit, then write and read
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::write_status(std::uint32_t requestId, BinaryProtocol::Status status)
+{
+    std::size_t frame = BinaryProtocol::beginResponse(writeBuffer_, requestId, status);
+    BinaryProtocol::finishResponse(writeBuffer_, frame);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinarySession::record_request(Metrics::Route route, std::chrono::steady_clock::time_point start, BinaryProtocol::Status status)
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    metrics_.recordRequest(route, static_cast<std::uint64_t>(elapsed.count()), status != BinaryProtocol::Status::Ok);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <asio.hpp>
+
+#include "binary_protocol.h"
+#include "logger.h"
+#include "metrics.h"
+#include "reservation_system.h"
+#include "shard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Serves one connection of the binary protocol, see BinaryProtocol.
+/// Frames are parsed in place from a reusable read buffer like Session does for HTTP.
+/// Reads are answered right away; bookings run on the shard owning their room and are
+/// answered when they are done, and durable if there is a booking log, so responses
+/// leave in completion order. At most MAX_IN_FLIGHT bookings wait at a time, reading
+/// pauses beyond that. All handlers run on the session strand.
+class BinarySession : public std::enable_shared_from_this<BinarySession>
+{
+public:
+    /// @brief Constructor
+    /// @param socket
+    /// @param reservationSystem
+    /// @param logger request log
+    /// @param metrics request and booking counters
+    /// @param shards shards of a sharded server, nullptr if every thread may book every room
+    /// @param shardIndex shard whose thread runs this session
+    BinarySession(asio::ip::tcp::socket socket, ReservationSystem &reservationSystem, Logger &logger, Metrics &metrics,
+                  ShardGroup *shards = nullptr, std::size_t shardIndex = 0);
+
+    ~BinarySession();
+
+    /// @brief Starts reading frames
+    void start();
+
+private:
+    static constexpr std::size_t INITIAL_BUFFER_SIZE = 4096;
+    static constexpr std::size_t MAX_BUFFER_SIZE = BinaryProtocol::LENGTH_SIZE + BinaryProtocol::MAX_FRAME_SIZE;
+    static constexpr std::size_t MAX_IN_FLIGHT = 1024;
+
+    /// @brief Reads more bytes from the socket into the free end of the read buffer
+    void async_read();
+
+    /// @brief Starts a read unless one is running, the connection is closing or too much is pending
+    void continue_reading();
+
+    /// @brief Handles every complete frame in the read buffer, then writes and reads again
+    void process_frames();
+
+    /// @brief Sends the queued responses unless a write is running, closes once all is answered and sent
+    void start_write();
+
+    /// @brief Makes room at the end of the read buffer, compacting or growing it
+    /// @return false if the buffer is full and already at MAX_BUFFER_SIZE
+    bool reserve_read_space();
+
+    /// @brief Routes one request frame
+    void handle_request(const BinaryProtocol::Request &request);
+
+    /// @brief Answers a Catalog request
+    void write_catalog(std::uint32_t requestId);
+
+    /// @brief Answers an Occupancy request
+    /// @return the status sent
+    BinaryProtocol::Status write_occupancy(std::uint32_t requestId, std::string_view payload);
+
+    /// @brief Runs a Book request where its room lives, complete_booking answers it
+    void book(std::uint32_t requestId, std::string_view payload, std::chrono::steady_clock::time_point start);
+
+    /// @brief Answers a booking once it ran, on the strand
+    void complete_booking(std::uint32_t requestId, RoomBooking result, std::chrono::steady_clock::time_point start);
+
+    /// @brief Queues a response without payload
+    void write_status(std::uint32_t requestId, BinaryProtocol::Status status);
+
+    /// @brief Records a finished request
+    void record_request(Metrics::Route route, std::chrono::steady_clock::time_point start, BinaryProtocol::Status status);
+
+    asio::ip::tcp::socket socket_;
+    asio::strand<asio::ip::tcp::socket::executor_type> strand_;
+    std::vector<char> readBuffer_; // Bytes [readStart_, readEnd_) are received but not consumed
+    std::size_t readStart_ = 0;
+    std::size_t readEnd_ = 0;
+    std::string writeBuffer_; // Responses waiting for the next write, reused between writes
+    std::string outBuffer_;   // Responses being written
+    std::vector<std::uint64_t> words_; // Occupancy snapshot, reused between requests
+    std::size_t inFlight_ = 0;         // Bookings not answered yet
+    bool reading_ = false;
+    bool writing_ = false;
+    bool closing_ = false;
+    ReservationSystem &reservationSystem_;
+    Logger &logger_;
+    Metrics &metrics_;
+    ShardGroup *shards_;
+    std::size_t shardIndex_;
+};
@@ -0,0 +1,92 @@
+#include "http_responses.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+void writeHttpResponse(std::string &out, std::string_view status, std::string_view contentType, std::string_view body, bool keepAlive)
+{
+    writeHttpResponseHeader(out, status, contentType, body.size(), keepAlive);
+    out += body;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void writeHttpResponseHeader(std::string &out, std::string_view status, std::string_view contentType, std::size_t contentLength, bool keepAlive)
+{
+    out += "HTTP/1.1 ";
+    out += status;
+    out += "\r\n";
+    if (!contentType.empty())
+    {
+        out += "Content-Type: ";
+        out += contentType;
+        out += "\r\n";
+    }
+    out += "Content-Length: ";
+    out += std::to_string(contentLength);
+    out += keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void writeHttpOkResponse(std::string &out, const Json::Value &jsonData, bool keepAlive)
+{
+    Json::StreamWriterBuilder writer;
+    std::string jsonStr = Json::writeString(writer, jsonData);
+    writeHttpResponse(out, "200 OK", "application/json", jsonStr, keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void writeHttpBadRequestResponse(std::string &out, bool keepAlive)
+{
+    writeHttpResponse(out, "400 Bad Request", "", "", keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void writeHttpNotFoundResponse(std::string &out, bool keepAlive)
+{
+    writeHttpResponse(out, "404 Not Found", "", "", keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void writeHttpMethodNotAllowedResponse(std::string &out, bool keepAlive)
+{
+    writeHttpResponse(out, "405 Method Not Allowed", "", "", keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void writeHttpForbiddenResponse(std::string &out, const std::string &error, bool keepAlive)
+{
+    Json::Value jsonData;
+    jsonData["error"] = error;
+
+    Json::StreamWriterBuilder writer;
+    std::string jsonStr = Json::writeString(writer, jsonData);
+    writeHttpResponse(out, "403 Forbidden", "application/json", jsonStr, keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void writeHttpServiceUnavailableResponse(std::string &out, long retryAfterSeconds, bool keepAlive)
+{
+    out += "HTTP/1.1 503 Service Unavailable\r\nRetry-After: ";
+    out += std::to_string(retryAfterSeconds);
+    out += keepAlive ? "\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n" : "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void writeHttpErrorResponse(std::string &out, const std::string &error, bool keepAlive)
+{
+    Json::Value jsonData;
+    jsonData["error"] = error;
+
+    Json::StreamWriterBuilder writer;
+    std::string jsonStr = Json::writeString(writer, jsonData);
+    writeHttpResponse(out, "500 Internal Server Error", "application/json", jsonStr, keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <json/json.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Http responses!
+// Responses are appended to the connection's output buffer, so pipelined
+// requests are answered in order with a single socket write.
+///////////////////////////////////////////////////////////////////////////////
+
+/// @brief Append a full response with the given status line, content type and body
+/// @param out connection output buffer
+/// @param status e.g. "200 OK"
+/// @param contentType empty for responses without a body type
+/// @param body
+/// @param keepAlive whether the connection stays open after this response
+void writeHttpResponse(std::string &out, std::string_view status, std::string_view contentType, std::string_view body, bool keepAlive);
+
+/// @brief Append only the status line and headers of a response whose body is sent separately
+/// @param out connection output buffer
+/// @param status e.g. "200 OK"
+/// @param contentType empty for responses without a body type
+/// @param contentLength size of the body that follows
+/// @param keepAlive whether the connection stays open after this response
+void writeHttpResponseHeader(std::string &out, std::string_view status, std::string_view contentType, std::size_t contentLength, bool keepAlive);
+
+/// @brief Append 200 OK response with content jsonData
+/// @param out
+/// @param jsonData
+/// @param keepAlive
+void writeHttpOkResponse(std::string &out, const Json::Value &jsonData, bool keepAlive);
+
+/// @brief Append 400 Bad Request
+/// @param out
+/// @param keepAlive
+void writeHttpBadRequestResponse(std::string &out, bool keepAlive);
+
+/// @brief Append 404 Not Found
+/// @param out
+/// @param keepAlive
+void writeHttpNotFoundResponse(std::string &out, bool keepAlive);
+
+/// @brief Append 405 Not allowed
+/// @param out
+/// @param keepAlive
+void writeHttpMethodNotAllowedResponse(std::string &out, bool keepAlive);
+
+/// @brief Append 403 Forbidden with a json error
+/// @param out
+/// @param error
+/// @param keepAlive
+void writeHttpForbiddenResponse(std::string &out, const std::string &error, bool keepAlive);
+
+/// @brief Append 503 Service Unavailable with a Retry-After header
+/// @param out
+/// @param retryAfterSeconds
+/// @param keepAlive
+void writeHttpServiceUnavailableResponse(std::string &out, long retryAfterSeconds, bool keepAlive);
+
+/// @brief Append 500 Internal Error
+/// @param out
+/// @param error
+/// @param keepAlive
+void writeHttpErrorResponse(std::string &out, const std::string &error, bool keepAlive);
@@ -7,337 +7,321 @@
 #include <thread>
 #include <asio/io_context.hpp>
 #include <chrono>
+#include <cstdlib>
+#include <memory>
 #include <signal.h>
 
+#include "admission_control.h"
+#include "binary_server.h"
+#include "logger.h"
+#include "metrics.h"
+#include "replica_client.h"
+#include "replication_server.h"
 #include "reservation_system.h"
+#include "server.h"
+#include "shard.h"
 
 using asio::ip::tcp;
 
 const int number_of_threads(4);
 
 ///////////////////////////////////////////////////////////////////////////////
-// Http responses!
-///////////////////////////////////////////////////////////////////////////////
-
-/// @brief Send 200 OK response with content jsonData
-/// @param socket
-/// @param jsonData
-void sendHttpOkResponse(asio::ip::tcp::socket &socket, const Json::Value &jsonData)
-{
-    std::string response = "HTTP/1.1 200 OK\r\n";
-    response += "Content-Type: application/json\r\n";
-    Json::StreamWriterBuilder writer;
-    std::string jsonStr = Json::writeString(writer, jsonData);
-    response += "Content-Length: " + std::to_string(jsonStr.length()) + "\r\n";
-    response += "\r\n"; // Empty line to separate headers from body
-    response += jsonStr;
-    // std::cout << response << std::endl;
-    asio::write(socket, asio::buffer(response));
-}
-
-/// @brief Send 404 Not Found
-/// @param socket
-void sendHttpNotFoundResponse(asio::ip::tcp::socket &socket)
-{
-    std::string response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
-    asio::write(socket, asio::buffer(response));
+/// @brief Signal handler to stop server execution
+void signalHandler(int signum) {
+    std::cout << "Interrupt signal (" << signum << ") received.\n";
+    // Terminate program
+    exit(signum);
 }
 
-/// @brief Send 405 Not allowed
-/// @param socket
-void sendHttpMethodNotAllowedResponse(asio::ip::tcp::socket &socket)
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Reloads the catalog file on every SIGHUP, like POST /admin/reload
+void watchReloadSignal(asio::signal_set &signals, ReservationSystem &reservationSystem, Logger &logger)
 {
-    std::string response = "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n";
-    asio::write(socket, asio::buffer(response));
+    signals.async_wait([&signals, &reservationSystem, &logger](const asio::error_code &error, int)
+                       {
+                           if (error)
+                           {
+                               return;
+                           }
+                           bool started = reservationSystem.reloadCatalogAsync(reservationSystem.getCatalogPath(), [&logger](const std::string &reloadError)
+                                                                               {
+                                                                                   if (reloadError.empty())
+                                                                                   {
+                                                                                       logger.log(LogLevel::Info, "Catalog reloaded");
+                                                                                   }
+                                                                                   else
+                                                                                   {
+                                                                                       logger.log(LogLevel::Error, "Catalog reload failed: ", reloadError);
+                                                                                   }
+                                                                               });
+                           if (!started)
+                           {
+                               logger.log(LogLevel::Warning, "Catalog reload already running");
+                           }
+                           watchReloadSignal(signals, reservationSystem, logger);
+                       });
 }
 
-/// @brief Send 500 Internal Error
-/// @param socket
-/// @param error
-void sendHttpErrorResponse(asio::ip::tcp::socket &socket, const std::string &error)
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Prints the command line options
+void printUsage(const char *program)
 {
-    Json::Value jsonData;
-    jsonData["error"] = error;
-
-    Json::StreamWriterBuilder writer;
-    std::string jsonStr = Json::writeString(writer, jsonData);
-
-    std::string response = "HTTP/1.1 500 Internal Server Error\r\n";
-    response += "Content-Type: application/json\r\n";
-    response += "Content-Length: " + std::to_string(jsonStr.size()) + "\r\n\r\n";
-    response += jsonStr;
-
-    asio::write(socket, asio::buffer(response));
+    std::cout << "Usage: " << program << " <filename> [--wal <path>] [--compile-snapshot <path>] [--threads <n>] [--sharded] [--pin] [--binary-port <port>]"
+              << " [--log <path>] [--log-level <debug|info|warning|error|off>] [--log-sample <n>]"
+              << " [--max-connections <n>] [--max-in-flight <n>] [--shed-lag <ms>] [--max-body <bytes>]"
+              << " [--header-timeout <s>] [--body-timeout <s>] [--idle-timeout <s>]"
+              << " [--port <port>] [--replication-listen <port|path>] [--replica-of <port|path>]" << std::endl;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-/// @brief Session class to dipatch dispatch requests asyncronously
-class Session : public std::enable_shared_from_this<Session>
-{
-public:
-    /// @brief Constructor
-    /// @param socket 
-    /// @param reservationSystem 
-    Session(tcp::socket socket, ReservationSystem &reservationSystem)
-        : socket_(std::move(socket)), reservationSystem_(reservationSystem) {}
-
-    /// @brief Session async callback
-    void start()
+/// @brief Will initialize 'number_of_threads' to listen to requests.
+/// @param argc
+/// @param argv Need to provide at least a filename with a json theater structure or a catalog snapshot.
+/// Optional '--wal <path>' makes bookings durable in a write-ahead log at 'path'.
+/// Optional '--compile-snapshot <path>' writes the loaded catalog as a binary snapshot and exits.
+/// Optional '--threads <n>' sets the number of worker threads, 'number_of_threads' by default.
+/// Optional '--sharded' gives each thread its own event loop, acceptor and rooms instead of sharing one.
+/// Optional '--pin' pins worker thread N to CPU N.
+/// Optional '--binary-port <port>' also serves the binary protocol (see BinaryProtocol) on 'port'.
+/// Optional '--log <path>' writes the request log to 'path' instead of stdout, '--log-level <level>'
+/// sets its lowest level and '--log-sample <n>' keeps one of every 'n' request lines per thread.
+/// Optional '--max-connections <n>' caps open HTTP connections, '--max-in-flight <n>' the requests waiting
+/// on the booking log or other shards and '--shed-lag <ms>' the event loop lag; past them clients get 503.
+/// Optional '--max-body <bytes>' bounds request bodies. '--header-timeout <s>', '--body-timeout <s>' and
+/// '--idle-timeout <s>' close connections that take longer to send a request header, its body or the next request.
+/// Optional '--port <port>' serves HTTP on 'port' instead of 8080, e.g. for a replica next to its primary.
+/// Optional '--replication-listen <port|path>' streams every booking to read replicas connecting on that
+/// 127.0.0.1 port or Unix socket path; '--replica-of <port|path>' runs a read replica of such a primary,
+/// which rejects bookings and serves reads once it holds a full copy of the primary's bookings.
+/// SIGHUP reloads the catalog file without stopping the server.
+/// @return
+int main(int argc, char *argv[])
+{   
+    if (argc < 2)
     {
-        async_read();
+        printUsage(argv[0]);
+        return 1; // Return an error code
     }
 
-private:
-    /// @brief This method parses the request asyncronously
-    /// It will try to read the full message body if not already in the buffer.
-    /// Then it will handle the proper events received in the request
-    void async_read()
+    std::string walPath;
+    std::string snapshotPath;
+    int threadCount = number_of_threads;
+    bool sharded = false;
+    bool pinThreads = false;
+    std::string logPath;
+    LogLevel logLevel = LogLevel::Info;
+    int logSample = 1;
+    int binaryPort = 0;
+    int httpPort = 8080;
+    std::string replicationAddress;
+    std::string primaryAddress;
+    AdmissionControl::Limits limits;
+    for (int i = 2; i < argc; ++i)
     {
-        auto self(shared_from_this());
-        asio::async_read_until(socket_, buffer_, "\r\n\r\n",
-                               [this, self](asio::error_code ec, std::size_t length)
-                               {
-                                   if (!ec)
-                                   {
-                                       std::istream is(&buffer_);
-                                       std::string buffer_content((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
-                                       auto content_length = get_content_length(buffer_content);
-
-                                       std::size_t headers_end_pos = buffer_content.find("\r\n\r\n");
-                                       std::size_t body_length = (headers_end_pos != std::string::npos) ? buffer_content.size() - headers_end_pos - 4 : 0;
-
-                                       auto remaining = content_length - body_length;
-
-                                       if (remaining > 0)
-                                       {
-                                           asio::async_read(socket_, buffer_, asio::transfer_exactly(remaining),
-                                                            [this, self, buffer_content](asio::error_code ec2, std::size_t transferred)
-                                                            {
-                                                                // std::cout << "More data needed: async_read -> " << ec2.message() << "\n";
-                                                                // std::cout << "transferred: " << transferred << std::endl;
-                                                                // std::cout << "buffer: " << buffer_.size() << std::endl;
-
-                                                                std::istream is_more(&buffer_);
-                                                                std::string more_content((std::istreambuf_iterator<char>(is_more)), std::istreambuf_iterator<char>());
+        std::string option = argv[i];
+        if (option == "--wal" && i + 1 < argc)
+        {
+            walPath = argv[++i];
+        }
+        else if (option == "--compile-snapshot" && i + 1 < argc)
+        {
+            snapshotPath = argv[++i];
+        }
+        else if (option == "--threads" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+        {
+            threadCount = std::atoi(argv[++i]);
+        }
+        else if (option == "--sharded")
+        {
+            sharded = true;
+        }
+        else if (option == "--pin")
+        {
+            pinThreads = true;
+        }
+        else if (option == "--binary-port" && i + 1 < argc && std::atoi(argv[i + 1]) > 0 && std::atoi(argv[i + 1]) < 65536)
+        {
+            binaryPort = std::atoi(argv[++i]);
+        }
+        else if (option == "--port" && i + 1 < argc && std::atoi(argv[i + 1]) > 0 && std::atoi(argv[i + 1]) < 65536)
+        {
+            httpPort = std::atoi(argv[++i]);
+        }
+        else if (option == "--replication-listen" && i + 1 < argc)
+        {
+            replicationAddress = argv[++i];
+        }
+        else if (option == "--replica-of" && i + 1 < argc)
+        {
+            primaryAddress = argv[++i];
+        }
+        else if (option == "--log" && i + 1 < argc)
+        {
+            logPath = argv[++i];
+        }
+        else if (option == "--log-level" && i + 1 < argc && Logger::parseLevel(argv[i + 1], logLevel))
+        {
+            ++i;
+        }
+        else if (option == "--log-sample" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+        {
+            logSample = std::atoi(argv[++i]);
+        }
+        else if (option == "--max-connections" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+        {
+            limits.maxConnections = static_cast<std::size_t>(std::atoi(argv[++i]));
+        }
+        else if (option == "--max-in-flight" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+        {
+            limits.maxInFlight = static_cast<std::size_t>(std::atoi(argv[++i]));
+        }
+        else if (option == "--shed-lag" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+        {
+            limits.maxLoopLag = std::chrono::milliseconds(std::atoi(argv[++i]));
+        }
+        else if (option == "--max-body" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+        {
+            limits.maxBodySize = static_cast<std::size_t>(std::atoi(argv[++i]));
+        }
+        else if (option == "--header-timeout" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+        {
+            limits.headerTimeout = std::chrono::seconds(std::atoi(argv[++i]));
+        }
+        else if (option == "--body-timeout" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+        {
+            limits.bodyTimeout = std::chrono::seconds(std::atoi(argv[++i]));
+        }
+        else if (option == "--idle-timeout" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+        {
+            limits.idleTimeout = std::chrono::seconds(std::atoi(argv[++i]));
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
 
-                                                                handle_request(buffer_content + more_content);
-                                                                buffer_.consume(buffer_.size()); // Clear the buffer
-                                                                async_read();
-                                                            });
-                                       }
-                                       else
-                                       {
-                                           handle_request(buffer_content);
-                                           buffer_.consume(buffer_.size()); // Clear the buffer
-                                           async_read();
-                                       }
-                                   }
-                               });
+    if (!primaryAddress.empty() && (!replicationAddress.empty() || !walPath.empty()))
+    {
+        // A replica's bookings live on its primary, it neither logs nor feeds them
+        std::cerr << "Error: --replica-of cannot be combined with --wal or --replication-listen" << std::endl;
+        return 1;
     }
 
-    ///////////////////////////////////////////////////////////////////////////////
-    /// @brief This here routes requests to our APIs
-    /// @param request_data string with all request data (header + body)
+    const std::string filename = argv[1];
+    std::cout << "Reading file: " << filename << std::endl;
+    std::ifstream file(filename.c_str());
+    if (!file)
+    {
+        std::cerr << "Error: File " << filename << " does not exist or could not be opened." << std::endl;
+        return 2; // Return a different error code for file not found
+    }
+    file.close();  // Don't forget to close the file
 
-    void handle_request(const std::string &request_data)
+    if (!snapshotPath.empty())
     {
-        std::istringstream request_stream(request_data);
-        std::string request_line;
-        getline(request_stream, request_line);
-        std::istringstream request_line_stream(request_line);
-        std::string request_method, request_target;
-        request_line_stream >> request_method >> request_target;
+        try
+        {
+            ReservationSystem reservationSystem(filename);
+            if (!walPath.empty())
+            {
+                // Fold the logged bookings into the snapshot
+                std::size_t replayed = reservationSystem.enableBookingLog(walPath);
+                std::cout << "Booking log: " << walPath << ", replayed " << replayed << " records" << std::endl;
+            }
+            reservationSystem.saveSnapshot(snapshotPath);
+            std::cout << "Wrote catalog snapshot: " << snapshotPath << std::endl;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Exception: " << e.what() << std::endl;
+            return 3;
+        }
+        return 0;
+    }
 
-        // Find the end of the request headers
-        size_t pos = request_data.find("\r\n\r\n");
-        if (pos != std::string::npos)
+    if (sharded)
+    {
+        try
         {
-            std::string request_body = request_data.substr(pos + 4); // Skip "\r\n\r\n"
-            std::cout << request_target << " " << request_method << " " << request_body << std::endl;
-            if (request_method == "GET")
+            signal(SIGINT, signalHandler);
+
+            Logger logger(logPath, logLevel, logSample);
+            Metrics metrics;
+            ReservationSystem reservationSystem(filename);
+            ResponseCache responseCache;
+            IdempotencyTable idempotencyTable;
+            if (!walPath.empty())
             {
-                if (request_target == "/movies")
-                {
-                    auto response = reservationSystem_.getAllPlayingMoviesJson();
-                    sendHttpOkResponse(socket_, response);
-                }
-                else
-                {
-                    sendHttpNotFoundResponse(socket_);
-                }
+                std::size_t replayed = reservationSystem.enableBookingLog(walPath);
+                std::cout << "Booking log: " << walPath << ", replayed " << replayed << " records" << std::endl;
+            }
+            if (!replicationAddress.empty())
+            {
+                reservationSystem.enableReplicationLog();
+            }
+            if (!primaryAddress.empty())
+            {
+                reservationSystem.enableReplica();
             }
-            else if (request_method == "POST")
-            {                
-                Json::Value requestBodyJson;
-                std::istringstream iss(request_body);
-                if (!request_body.empty())
-                    iss >> requestBodyJson;
 
-                if (request_target == "/find")
-                {
-                    // ... Handle POST logic ...
-                    if (requestBodyJson.isMember("movie"))
-                    {
-                        std::string movieTitle = requestBodyJson["movie"].asString();
-                        auto response = reservationSystem_.getTheatersShowingMovieJson(movieTitle);
-                        sendHttpOkResponse(socket_, response);
-                    }
-                }
-                else if (request_target == "/bookings")
+            // One event loop and acceptor per shard, each shard books only the rooms it owns
+            ShardGroup shards(threadCount);
+            AdmissionControl admission(limits, shards.size());
+            std::vector<std::unique_ptr<Server>> servers;
+            tcp::endpoint endpoint(tcp::v4(), static_cast<unsigned short>(httpPort));
+            for (std::size_t i = 0; i < shards.size(); ++i)
+            {
+                servers.emplace_back(new Server(shards.at(i).context(), endpoint, reservationSystem, responseCache, idempotencyTable, admission, logger, metrics, &shards, i));
+            }
+            std::vector<std::unique_ptr<BinaryServer>> binaryServers;
+            if (binaryPort != 0)
+            {
+                tcp::endpoint binaryEndpoint(tcp::v4(), static_cast<unsigned short>(binaryPort));
+                for (std::size_t i = 0; i < shards.size(); ++i)
                 {
-                    // ... Handle POST logic ...
-                    if (requestBodyJson.isMember("movie") && requestBodyJson.isMember("theater"))
-                    {
-                        std::string movieTitle = requestBodyJson["movie"].asString();
-                        std::string theaterTitle = requestBodyJson["theater"].asString();
-                        auto response = reservationSystem_.getBookings(theaterTitle, movieTitle);
-                        sendHttpOkResponse(socket_, response);
-                    }
+                    binaryServers.emplace_back(new BinaryServer(shards.at(i).context(), binaryEndpoint, reservationSystem, logger, metrics, &shards, i));
                 }
-                else if (request_target == "/seats")
-                {
-                    // ... Handle POST logic ...
-                    if (requestBodyJson.isMember("movie") && requestBodyJson.isMember("theater") && requestBodyJson.isMember("seats"))
-                    {
-                        std::string movieTitle = requestBodyJson["movie"].asString();
-                        std::string theaterTitle = requestBodyJson["theater"].asString();
-                        Json::Value seatsJson = requestBodyJson["seats"];
-
-                        if (!seatsJson.isArray())
-                        {
-                            std::cout << " Handle error: 'seats' field is not an array" << std::endl;
-                        }
-
-                        std::vector<int> seats;
-                        for (Json::Value::ArrayIndex i = 0; i < seatsJson.size(); ++i)
-                        {
-                            if (seatsJson[i].isInt())
-                            {
-                                int seatNumber = seatsJson[i].asInt();
-                                seats.push_back(seatNumber);
-                            }
-                            else
-                            {
-                                std::cout << " Handle error: 'seats' not int" << std::endl;
-                            }
-                        }
-
-                        // Now 'seats' vector contains the list of seat numbers
-
-                        auto response = reservationSystem_.bookSeats(theaterTitle, movieTitle, seats);
-
-                        if (response)
-                        {
-                            sendHttpOkResponse(socket_, response);
-                        }
-                        else
-                        {
-                            sendHttpErrorResponse(socket_, "No available seats.");
-                        }
-                    }
-                }
-
-                sendHttpMethodNotAllowedResponse(socket_);
             }
-            else
+            // Replication runs on the first shard, a replica hands each record to the shard owning its room
+            std::unique_ptr<ReplicationServer> replicationServer;
+            if (!replicationAddress.empty())
             {
-                sendHttpMethodNotAllowedResponse(socket_);
+                replicationServer.reset(new ReplicationServer(shards.at(0).context(), replicationAddress, reservationSystem, logger));
             }
-        }
-    }
-
-    ///////////////////////////////////////////////////////////////////////////////
-    /// @brief Retrieves the 'Content-Length' field from the HTPP header
-    std::size_t get_content_length(const std::string &buffer_content)
-    {
-        std::string content_length_str = "Content-Length: ";
-        std::size_t pos = buffer_content.find(content_length_str);
-
-        if (pos != std::string::npos)
-        {
-            pos += content_length_str.length();
-            std::size_t end_pos = buffer_content.find("\r\n", pos);
-            if (end_pos != std::string::npos)
+            std::unique_ptr<ReplicaClient> replicaClient;
+            if (!primaryAddress.empty())
+            {
+                replicaClient.reset(new ReplicaClient(shards.at(0).context(), primaryAddress, reservationSystem, logger, &shards, 0));
+            }
+            asio::signal_set reloadSignals(shards.at(0).context(), SIGHUP);
+            watchReloadSignal(reloadSignals, reservationSystem, logger);
+            shards.start(pinThreads);
+            std::cout << "Opened server in port: " << httpPort << " with " << shards.size() << " shards" << std::endl;
+            if (binaryPort != 0)
+            {
+                std::cout << "Opened binary protocol in port: " << binaryPort << std::endl;
+            }
+            if (!replicationAddress.empty())
             {
-                return std::stoul(buffer_content.substr(pos, end_pos - pos));
+                std::cout << "Feeding replicas on: " << replicationAddress << std::endl;
             }
+            if (!primaryAddress.empty())
+            {
+                std::cout << "Read replica of: " << primaryAddress << std::endl;
+            }
+            std::cout << "Avaliable Movies: " << reservationSystem.getAllPlayingMoviesJson() << std::endl;
+
+            shards.join();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Exception: " << e.what() << std::endl;
         }
         return 0;
     }
 
-    ///////////////////////////////////////////////////////////////////////////////
-
-    tcp::socket socket_;
-    asio::streambuf buffer_;
-    ReservationSystem &reservationSystem_;
-};
-
-///////////////////////////////////////////////////////////////////////////////
-/// @brief Server class for starting async dispatchers
-class Server
-{
-public:
-    /// @brief Constructor
-    /// @param io_context 
-    /// @param endpoint 
-    /// @param reservationSystem 
-    Server(asio::io_context &io_context, const tcp::endpoint &endpoint, ReservationSystem &reservationSystem)
-        : acceptor_(io_context, endpoint), reservationSystem_(reservationSystem)
-    {
-        accept();
-    }
-
-private:
-    void accept()
-    {
-        acceptor_.async_accept([this](asio::error_code ec, tcp::socket socket)
-                               {
-                                   // std::cout << "async_accept -> " << ec.message() << "\n";
-                                   if (!ec)
-                                   {
-                                       std::make_shared<Session>(std::move(socket), reservationSystem_)->start();
-                                   }
-                                   accept(); // Accept the next connection
-                               });
-    }
-
-    tcp::acceptor acceptor_;
-    ReservationSystem &reservationSystem_;
-};
-
-
-///////////////////////////////////////////////////////////////////////////////
-/// @brief Signal handler to stop server execution
-void signalHandler(int signum) {
-    std::cout << "Interrupt signal (" << signum << ") received.\n";
-    // Terminate program
-    exit(signum);
-}
-
-
-///////////////////////////////////////////////////////////////////////////////
-/// @brief Will initialize 'number_of_threads' to listen to requests.
-/// @param argc
-/// @param argv Need to provide at least a filename with a json theater structure
-/// @return
-int main(int argc, char *argv[])
-{   
-    if (argc != 2)
-    {
-        std::cout << "Usage: " << argv[0] << " <filename>" << std::endl;
-        return 1; // Return an error code
-    }
-
-    const std::string filename = argv[1];
-    std::cout << "Reading file: " << filename << std::endl;
-    std::ifstream file(filename.c_str());
-    if (!file)
-    {
-        std::cerr << "Error: File " << filename << " does not exist or could not be opened." << std::endl;
-        return 2; // Return a different error code for file not found
-    }
-    file.close();  // Don't forget to close the file
-
     try
     {
         asio::io_context io_context;        
@@ -345,21 +329,73 @@ int main(int argc, char *argv[])
 
         // Create a thread pool with n 'number_of_threads'
         std::vector<std::thread> thread_pool;
-        for (int i = 0; i < number_of_threads; ++i)
+        for (int i = 0; i < threadCount; ++i)
         {
             std::cout << "Initialized " << i + 1 << " threads!" << std::endl;
             thread_pool.emplace_back([&io_context]
                                      { io_context.run(); });
+            if (pinThreads)
+            {
+                pin_thread(thread_pool.back(), i);
+            }
         }
 
         signal(SIGINT, signalHandler);
 
+        Logger logger(logPath, logLevel, logSample);
+        Metrics metrics;
         ReservationSystem reservationSystem(filename);
+        ResponseCache responseCache;
+        IdempotencyTable idempotencyTable;
+        AdmissionControl admission(limits);
+        if (!walPath.empty())
+        {
+            // Replay before accepting connections so restarts keep every acknowledged booking
+            std::size_t replayed = reservationSystem.enableBookingLog(walPath);
+            std::cout << "Booking log: " << walPath << ", replayed " << replayed << " records" << std::endl;
+        }
+        if (!replicationAddress.empty())
+        {
+            reservationSystem.enableReplicationLog();
+        }
+        if (!primaryAddress.empty())
+        {
+            reservationSystem.enableReplica();
+        }
 
         // Start the server
-        tcp::endpoint endpoint(tcp::v4(), 8080);
-        Server server(io_context, endpoint, reservationSystem);
-        std::cout << "Opened server in port: 8080" << std::endl;
+        tcp::endpoint endpoint(tcp::v4(), static_cast<unsigned short>(httpPort));
+        Server server(io_context, endpoint, reservationSystem, responseCache, idempotencyTable, admission, logger, metrics);
+        std::unique_ptr<BinaryServer> binaryServer;
+        if (binaryPort != 0)
+        {
+            binaryServer.reset(new BinaryServer(io_context, tcp::endpoint(tcp::v4(), static_cast<unsigned short>(binaryPort)), reservationSystem, logger, metrics));
+        }
+        std::unique_ptr<ReplicationServer> replicationServer;
+        if (!replicationAddress.empty())
+        {
+            replicationServer.reset(new ReplicationServer(io_context, replicationAddress, reservationSystem, logger));
+        }
+        std::unique_ptr<ReplicaClient> replicaClient;
+        if (!primaryAddress.empty())
+        {
+            replicaClient.reset(new ReplicaClient(io_context, primaryAddress, reservationSystem, logger));
+        }
+        asio::signal_set reloadSignals(io_context, SIGHUP);
+        watchReloadSignal(reloadSignals, reservationSystem, logger);
+        std::cout << "Opened server in port: " << httpPort << std::endl;
+        if (binaryPort != 0)
+        {
+            std::cout << "Opened binary protocol in port: " << binaryPort << std::endl;
+        }
+        if (!replicationAddress.empty())
+        {
+            std::cout << "Feeding replicas on: " << replicationAddress << std::endl;
+        }
+        if (!primaryAddress.empty())
+        {
+            std::cout << "Read replica of: " << primaryAddress << std::endl;
+        }
         std::cout << "Avaliable Movies: " << reservationSystem.getAllPlayingMoviesJson() << std::endl;
         
         // Wait for all threads in the thread pool to finish
@@ -0,0 +1,190 @@
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include "replica_client.h"
+#include "replication_server.h"
+
+namespace
+{
+    /// @brief Applies a booking or reset record to the replica and counts it
+    void apply(ReservationSystem &reservationSystem, ReplicaStatus &status, const BookingLog::Record &record, bool reset)
+    {
+        if (reset)
+        {
+            reservationSystem.applyReplicatedReset(record);
+        }
+        else
+        {
+            reservationSystem.applyReplicatedBooking(record);
+        }
+        status.appliedRecords.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ReplicaClient::ReplicaClient(asio::io_context &io_context, const std::string &address, ReservationSystem &reservationSystem, Logger &logger,
+                             ShardGroup *shards, std::size_t shardIndex)
+    : socket_(io_context), endpoint_(replicationEndpoint(address)), reconnectTimer_(io_context), reservationSystem_(reservationSystem),
+      status_(*reservationSystem.getReplicaStatus()), logger_(logger), shards_(shards), shardIndex_(shardIndex), buffer_(INITIAL_BUFFER_SIZE)
+{
+    connect();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicaClient::connect()
+{
+    used_ = 0;
+    socket_.async_connect(endpoint_, [this](const asio::error_code &ec)
+                          {
+                              if (ec)
+                              {
+                                  reconnect(ec.message());
+                                  return;
+                              }
+                              if (endpoint_.protocol().family() != AF_UNIX)
+                              {
+                                  asio::error_code ignored;
+                                  socket_.set_option(asio::ip::tcp::no_delay(true), ignored);
+                              }
+                              status_.connected.store(true, std::memory_order_relaxed);
+                              logger_.log(LogLevel::Info, "Connected to the primary");
+                              read();
+                          });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicaClient::read()
+{
+    if (used_ == buffer_.size())
+    {
+        buffer_.resize(buffer_.size() * 2); // A frame larger than the buffer, bounded by MAX_FRAME_SIZE
+    }
+    socket_.async_read_some(asio::buffer(buffer_.data() + used_, buffer_.size() - used_), [this](const asio::error_code &ec, std::size_t length)
+                            {
+                                if (ec)
+                                {
+                                    reconnect(ec.message());
+                                    return;
+                                }
+                                used_ += length;
+                                if (!apply_frames())
+                                {
+                                    reconnect("invalid replication frame");
+                                    return;
+                                }
+                                read();
+                            });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReplicaClient::apply_frames()
+{
+    std::size_t offset = 0;
+    ReplicationLog::Message message;
+    for (;;)
+    {
+        ReplicationLog::Result result = ReplicationLog::parseMessage(buffer_.data() + offset, used_ - offset, message);
+        if (result == ReplicationLog::Result::Invalid)
+        {
+            return false;
+        }
+        if (result == ReplicationLog::Result::Incomplete)
+        {
+            break;
+        }
+        if (message.type == ReplicationLog::MessageType::Record || message.type == ReplicationLog::MessageType::Reset)
+        {
+            if (!ReplicationLog::readRecord(message, record_))
+            {
+                return false;
+            }
+            apply_record(record_, message.type == ReplicationLog::MessageType::Reset);
+        }
+        else if (message.type == ReplicationLog::MessageType::Synced)
+        {
+            mark_synced();
+        }
+        // Resets of a full copy have no sequence, the Synced ending it tells where the copy is
+        if (message.type != ReplicationLog::MessageType::Reset || message.sequence != 0)
+        {
+            status_.sequence.store(message.sequence, std::memory_order_relaxed);
+        }
+        status_.primaryMicros.store(message.primaryMicros, std::memory_order_relaxed);
+        offset += message.size;
+    }
+    if (offset > 0)
+    {
+        std::memmove(buffer_.data(), buffer_.data() + offset, used_ - offset);
+        used_ -= offset;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicaClient::apply_record(const BookingLog::Record &record, bool reset)
+{
+    long roomOrdinal = shards_ ? reservationSystem_.getRecordRoomOrdinal(record) : -1;
+    std::size_t owner = roomOrdinal < 0 ? shardIndex_ : shards_->owner_of(roomOrdinal);
+    if (owner == shardIndex_)
+    {
+        apply(reservationSystem_, status_, record, reset);
+        return;
+    }
+    // The owner's inbox runs tasks in order, so the records of a room are applied in stream order
+    ReservationSystem &reservationSystem = reservationSystem_;
+    ReplicaStatus &status = status_;
+    shards_->at(owner).execute([&reservationSystem, &status, record, reset]
+                               { apply(reservationSystem, status, record, reset); });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicaClient::mark_synced()
+{
+    if (!shards_)
+    {
+        status_.synced.store(true, std::memory_order_relaxed);
+        return;
+    }
+    // Reads must not see the copy half applied, wait for the records queued on the other shards
+    auto remaining = std::make_shared<std::atomic<std::size_t>>(shards_->size());
+    ReplicaStatus &status = status_;
+    for (std::size_t i = 0; i < shards_->size(); ++i)
+    {
+        shards_->at(i).execute([&status, remaining]
+                               {
+                                   if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1)
+                                   {
+                                       status.synced.store(true, std::memory_order_relaxed);
+                                   }
+                               });
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicaClient::reconnect(const std::string &reason)
+{
+    if (status_.connected.exchange(false, std::memory_order_relaxed))
+    {
+        logger_.log(LogLevel::Warning, "Lost the primary: ", reason);
+    }
+    asio::error_code ignored;
+    socket_.close(ignored);
+    reconnectTimer_.expires_after(RECONNECT_INTERVAL);
+    reconnectTimer_.async_wait([this](const asio::error_code &ec)
+                               {
+                                   if (!ec)
+                                   {
+                                       connect();
+                                   }
+                               });
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <asio.hpp>
+
+#include "logger.h"
+#include "reservation_system.h"
+#include "shard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Keeps a read replica up to date with its primary on the same host.
+/// Connects to the primary's ReplicationServer, applies the bookings and resets it streams
+/// in order and records its progress in the system's ReplicaStatus. A lost connection is
+/// retried every RECONNECT_INTERVAL; the primary then sends a full copy again, whose resets
+/// replace the seats of every room, so seats it freed meanwhile do not stay booked here.
+class ReplicaClient
+{
+public:
+    static constexpr std::chrono::milliseconds RECONNECT_INTERVAL{1000};
+
+    /// @brief Constructor, connects right away
+    /// @param io_context
+    /// @param address port or Unix socket path of the primary, see replicationEndpoint
+    /// @param reservationSystem replica, see ReservationSystem::enableReplica
+    /// @param logger
+    /// @param shards shards of the server, each record is then applied by the shard owning its room
+    /// @param shardIndex shard whose io_context is passed
+    ReplicaClient(asio::io_context &io_context, const std::string &address, ReservationSystem &reservationSystem, Logger &logger,
+                  ShardGroup *shards = nullptr, std::size_t shardIndex = 0);
+
+private:
+    static constexpr std::size_t INITIAL_BUFFER_SIZE = 64 << 10;
+
+    void connect();
+    void read();
+
+    /// @brief Applies the complete frames at the start of the read buffer and drops them
+    /// @return false if a frame is invalid
+    bool apply_frames();
+
+    /// @brief Applies a booking record, or a reset if 'reset' is set, on the shard owning its room
+    void apply_record(const BookingLog::Record &record, bool reset);
+
+    /// @brief Marks the replica synced once every shard applied the records handed to it so far
+    void mark_synced();
+
+    /// @brief Closes the connection and retries after RECONNECT_INTERVAL
+    void reconnect(const std::string &reason);
+
+    asio::generic::stream_protocol::socket socket_;
+    asio::generic::stream_protocol::endpoint endpoint_;
+    asio::steady_timer reconnectTimer_;
+    ReservationSystem &reservationSystem_;
+    ReplicaStatus &status_;
+    Logger &logger_;
+    ShardGroup *shards_;
+    std::size_t shardIndex_;
+    std::vector<char> buffer_;
+    std::size_t used_ = 0; // Bytes of 'buffer_' read but not applied yet
+    BookingLog::Record record_;
+};
@@ -0,0 +1,214 @@
+#include <cstdio>
+#include <memory>
+
+#include "replication_server.h"
+
+namespace
+{
+    const std::size_t FEED_CHUNK_BYTES = 256 << 10; // Bookings sent per write while a replica catches up
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// @brief The stream to one replica. All handlers run on its strand, the log wakes it
+    /// from the booking thread by posting there.
+    class ReplicationFeed : public std::enable_shared_from_this<ReplicationFeed>
+    {
+    public:
+        ReplicationFeed(asio::generic::stream_protocol::socket socket, ReservationSystem &reservationSystem, ReplicationLog &log, Logger &logger)
+            : socket_(std::move(socket)), strand_(asio::make_strand(socket_.get_executor())), heartbeatTimer_(strand_),
+              reservationSystem_(reservationSystem), log_(log), logger_(logger)
+        {
+        }
+
+        void start()
+        {
+            auto self(shared_from_this());
+            asio::post(strand_, [this, self]
+                       {
+                           send_full_copy();
+                           schedule_heartbeat();
+                       });
+        }
+
+    private:
+        /// @brief Sends a reset of every room and showtime to the seats booked so far, then Synced.
+        /// The resets replace whatever the replica had, seats freed while it was away included.
+        /// Bookings appended after 'since_' was read follow from the log, whether the copy saw them or not.
+        void send_full_copy()
+        {
+            since_ = log_.getSequence();
+            std::int64_t now = ReplicationLog::nowMicros();
+            buffer_.clear();
+            reservationSystem_.visitBookings([this, now](const BookingLog::Record &record)
+                                             { ReplicationLog::writeRecord(buffer_, 0, now, record, ReplicationLog::MessageType::Reset); },
+                                             true);
+            ReplicationLog::writeMarker(buffer_, ReplicationLog::MessageType::Synced, since_, now);
+            write();
+        }
+
+        /// @brief Sends the bookings after 'since_', or waits for the next one
+        void send_next()
+        {
+            buffer_.clear();
+            if (!log_.readSince(since_, buffer_, FEED_CHUNK_BYTES))
+            {
+                logger_.log(LogLevel::Warning, "Replica fell behind the replication log, sending a full copy");
+                send_full_copy();
+                return;
+            }
+            if (!buffer_.empty())
+            {
+                write();
+                return;
+            }
+            auto self(shared_from_this());
+            waitTicket_ = log_.waitAfter(since_, [this, self]
+                                         { asio::post(strand_, [this, self]
+                                                      { wake(); }); });
+            if (waitTicket_ == 0)
+            {
+                send_next(); // Appended since readSince
+            }
+        }
+
+        void wake()
+        {
+            waitTicket_ = 0;
+            if (!writing_ && !closed_)
+            {
+                send_next();
+            }
+        }
+
+        void write()
+        {
+            writing_ = true;
+            auto self(shared_from_this());
+            asio::async_write(socket_, asio::buffer(buffer_), asio::bind_executor(strand_, [this, self](asio::error_code ec, std::size_t)
+                                                                                   {
+                                                                                       writing_ = false;
+                                                                                       if (ec)
+                                                                                       {
+                                                                                           close(ec);
+                                                                                       }
+                                                                                       else if (waitTicket_ == 0)
+                                                                                       {
+                                                                                           send_next(); // Not a heartbeat sent while waiting
+                                                                                       }
+                                                                                   }));
+        }
+
+        /// @brief Sends a heartbeat every interval the feed is idle
+        void schedule_heartbeat()
+        {
+            auto self(shared_from_this());
+            heartbeatTimer_.expires_after(ReplicationServer::HEARTBEAT_INTERVAL);
+            heartbeatTimer_.async_wait([this, self](const asio::error_code &ec)
+                                       {
+                                           if (ec || closed_)
+                                           {
+                                               return;
+                                           }
+                                           if (!writing_ && waitTicket_ != 0)
+                                           {
+                                               buffer_.clear();
+                                               ReplicationLog::writeMarker(buffer_, ReplicationLog::MessageType::Heartbeat, since_, ReplicationLog::nowMicros());
+                                               write();
+                                           }
+                                           schedule_heartbeat();
+                                       });
+        }
+
+        void close(const asio::error_code &ec)
+        {
+            if (closed_)
+            {
+                return;
+            }
+            closed_ = true;
+            logger_.log(LogLevel::Info, "Replica disconnected: ", ec.message());
+            if (waitTicket_ != 0)
+            {
+                log_.cancelWait(waitTicket_);
+                waitTicket_ = 0;
+            }
+            heartbeatTimer_.cancel();
+            asio::error_code ignored;
+            socket_.close(ignored);
+        }
+
+        asio::generic::stream_protocol::socket socket_;
+        asio::strand<asio::any_io_executor> strand_;
+        asio::steady_timer heartbeatTimer_;
+        ReservationSystem &reservationSystem_;
+        ReplicationLog &log_;
+        Logger &logger_;
+        std::string buffer_;
+        std::uint64_t since_ = 0;     // Last booking sent
+        std::uint64_t waitTicket_ = 0; // Waiting on the log for the next booking, see ReplicationLog::waitAfter
+        bool writing_ = false;
+        bool closed_ = false;
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+asio::generic::stream_protocol::endpoint replicationEndpoint(const std::string &address)
+{
+    if (!address.empty() && address.find_first_not_of("0123456789") == std::string::npos)
+    {
+        return asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), static_cast<unsigned short>(std::stoi(address)));
+    }
+    return asio::local::stream_protocol::endpoint(address);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ReplicationServer::ReplicationServer(asio::io_context &io_context, const std::string &address, ReservationSystem &reservationSystem, Logger &logger)
+    : acceptor_(io_context), reservationSystem_(reservationSystem), logger_(logger)
+{
+    auto endpoint = replicationEndpoint(address);
+    acceptor_.open(endpoint.protocol());
+    if (endpoint.protocol().family() == AF_UNIX)
+    {
+        socketPath_ = address;
+        std::remove(socketPath_.c_str()); // Left behind by an earlier run
+    }
+    else
+    {
+        acceptor_.set_option(asio::socket_base::reuse_address(true));
+    }
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+    accept();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ReplicationServer::~ReplicationServer()
+{
+    if (!socketPath_.empty())
+    {
+        std::remove(socketPath_.c_str());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicationServer::accept()
+{
+    acceptor_.async_accept([this](asio::error_code ec, asio::generic::stream_protocol::socket socket)
+                           {
+                               if (!ec)
+                               {
+                                   if (socket.local_endpoint().protocol().family() != AF_UNIX)
+                                   {
+                                       socket.set_option(asio::ip::tcp::no_delay(true), ec);
+                                   }
+                                   logger_.log(LogLevel::Info, "Replica connected");
+                                   std::make_shared<ReplicationFeed>(std::move(socket), reservationSystem_, *reservationSystem_.getReplicationLog(), logger_)->start();
+                               }
+                               accept(); // Accept the next replica
+                           });
+}
+
+///////////////////////////////////////////////////////////////////////////////
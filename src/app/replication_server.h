@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <asio.hpp>
+
+#include "logger.h"
+#include "reservation_system.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Address of the replication stream of a primary on this host: a port number
+/// on 127.0.0.1, or else the path of a Unix socket
+asio::generic::stream_protocol::endpoint replicationEndpoint(const std::string &address);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Feeds the bookings of a primary to the read replicas that connect to it.
+/// Each replica first gets a full copy of the bookings, then every booking appended to
+/// the primary's ReplicationLog in order, see ReplicationLog for the stream. A replica
+/// that falls further behind than the log keeps starts over from a full copy. Idle
+/// replicas get a heartbeat every HEARTBEAT_INTERVAL so they can tell how late they are.
+class ReplicationServer
+{
+public:
+    static constexpr std::chrono::milliseconds HEARTBEAT_INTERVAL{100};
+
+    /// @brief Constructor
+    /// @param io_context
+    /// @param address port or Unix socket path, see replicationEndpoint
+    /// @param reservationSystem primary, see ReservationSystem::enableReplicationLog
+    /// @param logger
+    ReplicationServer(asio::io_context &io_context, const std::string &address, ReservationSystem &reservationSystem, Logger &logger);
+
+    /// @brief Removes the Unix socket file, if listening on one
+    ~ReplicationServer();
+
+private:
+    void accept();
+
+    asio::basic_socket_acceptor<asio::generic::stream_protocol> acceptor_;
+    std::string socketPath_;
+    ReservationSystem &reservationSystem_;
+    Logger &logger_;
+};
@@ -0,0 +1,124 @@
+#include "server.h"
+#include "http_responses.h"
+#include "session.h"
+
+using asio::ip::tcp;
+
+/// Lets several acceptors listen on the same port, the kernel balances connections between them
+using reuse_port = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+///////////////////////////////////////////////////////////////////////////////
+
+Server::Server(asio::io_context &io_context, const tcp::endpoint &endpoint, ReservationSystem &reservationSystem, ResponseCache &responseCache, IdempotencyTable &idempotencyTable, AdmissionControl &admission, Logger &logger, Metrics &metrics,
+               ShardGroup *shards, std::size_t shardIndex)
+    : acceptor_(io_context), probeTimer_(io_context), holdTimer_(io_context), reservationSystem_(reservationSystem), responseCache_(responseCache), idempotencyTable_(idempotencyTable), admission_(admission), logger_(logger), metrics_(metrics), shards_(shards), shardIndex_(shardIndex)
+{
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(tcp::acceptor::reuse_address(true));
+    if (shards_)
+    {
+        acceptor_.set_option(reuse_port(true));
+    }
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+    accept();
+    probe();
+    if (shardIndex_ == 0)
+    {
+        expire_holds();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::accept()
+{
+    acceptor_.async_accept([this](asio::error_code ec, tcp::socket socket)
+                           {
+                               // std::cout << "async_accept -> " << ec.message() << "\n";
+                               if (!ec && !admission_.openConnection())
+                               {
+                                   reject(std::move(socket));
+                               }
+                               else if (!ec)
+                               {
+                                   // Responses are small and latency bound, don't let Nagle hold them back
+                                   socket.set_option(tcp::no_delay(true), ec);
+                                   std::make_shared<Session>(std::move(socket), reservationSystem_, responseCache_, idempotencyTable_, admission_, logger_, metrics_, shards_, shardIndex_)->start();
+                               }
+                               accept(); // Accept the next connection
+                           });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::reject(tcp::socket socket)
+{
+    metrics_.recordRejection(Metrics::Rejection::ConnectionLimit);
+    auto rejected = std::make_shared<tcp::socket>(std::move(socket));
+    auto response = std::make_shared<std::string>();
+    writeHttpServiceUnavailableResponse(*response, static_cast<long>(admission_.getLimits().retryAfter.count()), false);
+    // The request is not read, the client gets the answer as soon as it connects
+    asio::async_write(*rejected, asio::buffer(*response), [rejected, response](asio::error_code, std::size_t)
+                      {
+                          asio::error_code ignored;
+                          rejected->shutdown(tcp::socket::shutdown_both, ignored);
+                          rejected->close(ignored);
+                      });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::probe()
+{
+    probeTimer_.expires_after(PROBE_INTERVAL);
+    probeTimer_.async_wait([this](asio::error_code ec)
+                           {
+                               if (ec)
+                               {
+                                   return;
+                               }
+                               // The timer was due at its expiry, anything after that was spent waiting in the queue
+                               auto lag = std::chrono::steady_clock::now() - probeTimer_.expiry();
+                               auto lagNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(lag);
+                               metrics_.recordLoopLag(static_cast<std::uint64_t>(lagNanos.count()));
+                               admission_.recordLoopLag(shardIndex_, lagNanos);
+                               probe();
+                           });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Server::expire_holds()
+{
+    holdTimer_.expires_after(ReservationSystem::HOLD_TICK);
+    holdTimer_.async_wait([this](asio::error_code ec)
+                          {
+                              if (ec)
+                              {
+                                  return;
+                              }
+                              if (!shards_)
+                              {
+                                  reservationSystem_.expireHolds();
+                                  expire_holds();
+                                  return;
+                              }
+                              auto now = std::chrono::steady_clock::now();
+                              reservationSystem_.expireHolds(now, [this, now](std::uint64_t holdId, long roomOrdinal)
+                                                             {
+                                                                 std::size_t owner = roomOrdinal < 0 ? shardIndex_ : shards_->owner_of(roomOrdinal);
+                                                                 if (owner == shardIndex_)
+                                                                 {
+                                                                     reservationSystem_.expireHold(holdId, now);
+                                                                     return;
+                                                                 }
+                                                                 ReservationSystem &reservationSystem = reservationSystem_;
+                                                                 shards_->at(owner).execute([&reservationSystem, holdId, now]
+                                                                                            { reservationSystem.expireHold(holdId, now); });
+                                                             });
+                              expire_holds();
+                          });
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <asio.hpp>
+
+#include "admission_control.h"
+#include "idempotency_table.h"
+#include "logger.h"
+#include "metrics.h"
+#include "reservation_system.h"
+#include "response_cache.h"
+#include "shard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Server class for starting async dispatchers
+class Server
+{
+public:
+    /// @brief Constructor
+    /// @param io_context
+    /// @param endpoint
+    /// @param reservationSystem
+    /// @param responseCache
+    /// @param idempotencyTable responses of recent booking requests by idempotency key
+    /// @param admission connection and request limits, connections past its cap get 503 and are closed
+    /// @param logger
+    /// @param metrics
+    /// @param shards shards of a sharded server, or nullptr when all threads share 'io_context'.
+    /// Each shard runs its own Server, the kernel spreads connections over them with SO_REUSEPORT.
+    /// @param shardIndex shard this server accepts for
+    Server(asio::io_context &io_context, const asio::ip::tcp::endpoint &endpoint, ReservationSystem &reservationSystem, ResponseCache &responseCache, IdempotencyTable &idempotencyTable, AdmissionControl &admission, Logger &logger, Metrics &metrics,
+           ShardGroup *shards = nullptr, std::size_t shardIndex = 0);
+
+private:
+    static constexpr std::chrono::milliseconds PROBE_INTERVAL{100};
+
+    void accept();
+
+    /// @brief Answers a connection over the connection cap with 503 and closes it
+    void reject(asio::ip::tcp::socket socket);
+
+    /// @brief Measures how late the event loop runs a due timer, a proxy for its queue depth.
+    /// Requests are shed while it is past the admission threshold.
+    void probe();
+
+    /// @brief Finds expired seat holds every hold tick, run by one server only.
+    /// With shards, each hold is released on the shard owning its room.
+    void expire_holds();
+
+    asio::ip::tcp::acceptor acceptor_;
+    asio::steady_timer probeTimer_;
+    asio::steady_timer holdTimer_;
+    ReservationSystem &reservationSystem_;
+    ResponseCache &responseCache_;
+    IdempotencyTable &idempotencyTable_;
+    AdmissionControl &admission_;
+    Logger &logger_;
+    Metrics &metrics_;
+    ShardGroup *shards_;
+    std::size_t shardIndex_;
+};
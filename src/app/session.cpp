@@ -0,0 +1,1315 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+
+#include "session.h"
+#include "http_responses.h"
+#include "seat_request_decoder.h"
+
+using asio::ip::tcp;
+
+///////////////////////////////////////////////////////////////////////////////
+
+Session::Session(tcp::socket socket, ReservationSystem &reservationSystem, ResponseCache &responseCache, IdempotencyTable &idempotencyTable, AdmissionControl &admission, Logger &logger, Metrics &metrics,
+                 ShardGroup *shards, std::size_t shardIndex)
+    : socket_(std::move(socket)), strand_(asio::make_strand(socket_.get_executor())), readBuffer_(INITIAL_BUFFER_SIZE),
+      maxReadBuffer_(HttpRequestParser::MAX_HEADER_SIZE + admission.getLimits().maxBodySize), parser_(admission.getLimits().maxBodySize), readTimer_(strand_),
+      reservationSystem_(reservationSystem), responseCache_(responseCache), idempotencyTable_(idempotencyTable), admission_(admission), logger_(logger), metrics_(metrics), shards_(shards), shardIndex_(shardIndex)
+{
+    metrics_.sessionOpened();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Session::~Session()
+{
+    // Pending responses only outlive their work when it was dropped, e.g. by a shutdown. A retry
+    // of such a request must run it again instead of meeting a key that stays pending for good
+    for (const auto &deferred : deferred_)
+    {
+        if (deferred->ready)
+        {
+            continue;
+        }
+        if (!deferred->idempotencyKey.empty())
+        {
+            idempotencyTable_.abandon(deferred->idempotencyKey);
+        }
+        if (deferred->inFlight)
+        {
+            admission_.finishRequest();
+        }
+    }
+    metrics_.sessionClosed();
+    admission_.closeConnection();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::start()
+{
+    auto self(shared_from_this());
+    asio::dispatch(strand_, [this, self]
+                   {
+                       update_read_deadline();
+                       async_read();
+                   });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::async_read()
+{
+    reading_ = true;
+    auto self(shared_from_this());
+    socket_.async_read_some(asio::buffer(readBuffer_.data() + readEnd_, readBuffer_.size() - readEnd_),
+                            asio::bind_executor(strand_, [this, self](asio::error_code ec, std::size_t length)
+                                                {
+                                                    reading_ = false;
+                                                    if (ec)
+                                                    {
+                                                        // Peer is gone or done sending, finish what is queued and close
+                                                        closeAfterWrite_ = true;
+                                                        start_write();
+                                                        return;
+                                                    }
+                                                    readEnd_ += length;
+                                                    process_requests();
+                                                }));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::continue_reading()
+{
+    if (reading_ || closeAfterWrite_)
+    {
+        return;
+    }
+    // Stop reading while the client does not keep up with its responses
+    if (writeBuffer_.size() + writeSharedBytes_ + outBuffer_.size() >= MAX_BUFFER_SIZE || deferred_.size() >= MAX_DEFERRED_RESPONSES)
+    {
+        return;
+    }
+    if (!reserve_read_space())
+    {
+        // A single request does not fit in the largest buffer we accept
+        writeHttpBadRequestResponse(response_buffer(), false);
+        closeAfterWrite_ = true;
+        flush_deferred();
+        start_write();
+        return;
+    }
+    async_read();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Session::reserve_read_space()
+{
+    if (readEnd_ < readBuffer_.size())
+    {
+        return true;
+    }
+    if (readStart_ > 0)
+    {
+        // Move the partial request to the front, the parser only holds offsets
+        std::memmove(readBuffer_.data(), readBuffer_.data() + readStart_, readEnd_ - readStart_);
+        readEnd_ -= readStart_;
+        readStart_ = 0;
+        return true;
+    }
+    if (readBuffer_.size() >= maxReadBuffer_)
+    {
+        return false;
+    }
+    readBuffer_.resize(std::min(readBuffer_.size() * 2, maxReadBuffer_));
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::process_requests()
+{
+    HttpRequest request;
+    while (!closeAfterWrite_ && !forwarding_)
+    {
+        auto result = parser_.parse(readBuffer_.data() + readStart_, readEnd_ - readStart_, request);
+        if (result == HttpRequestParser::Result::Incomplete)
+        {
+            break;
+        }
+        if (result == HttpRequestParser::Result::Invalid)
+        {
+            writeHttpBadRequestResponse(response_buffer(), false);
+            closeAfterWrite_ = true;
+            break;
+        }
+        if (result == HttpRequestParser::Result::HeaderTooLarge)
+        {
+            writeHttpResponse(response_buffer(), "431 Request Header Fields Too Large", "", "", false);
+            closeAfterWrite_ = true;
+            break;
+        }
+        if (result == HttpRequestParser::Result::TooLarge)
+        {
+            // Answered from the header, the body is not waited for
+            metrics_.recordRejection(Metrics::Rejection::BodyTooLarge);
+            writeHttpResponse(response_buffer(), "413 Payload Too Large", "", "", false);
+            closeAfterWrite_ = true;
+            break;
+        }
+
+        const bool queued = !deferred_.empty();
+        std::string &out = response_buffer();
+        std::size_t mark = out.size();
+        awaitDurable_ = false;
+        requestRoute_ = Metrics::routeFor(request.target);
+        requestStart_ = std::chrono::steady_clock::now();
+        idempotencyKey_.clear();
+        // Watching the server stays possible while it sheds load
+        if (requestRoute_ == Metrics::Route::Metrics || admission_.admitRequest(shardIndex_))
+        {
+            handle_request(request, out);
+        }
+        else
+        {
+            shed_request(request, out);
+        }
+        if (forwarded_)
+        {
+            forward_booking(out, mark, queued);
+        }
+        else if (changeWait_)
+        {
+            wait_for_changes(out, mark, queued);
+        }
+        else if (awaitDurable_)
+        {
+            defer_until_durable(out, mark, queued);
+        }
+        else
+        {
+            record_request(requestRoute_, requestStart_, out, mark);
+            if (!idempotencyKey_.empty())
+            {
+                store_idempotent_response(idempotencyKey_, out, mark);
+            }
+        }
+        readStart_ += request.size;
+        closeAfterWrite_ = !request.keepAlive;
+    }
+
+    if (readStart_ == readEnd_)
+    {
+        readStart_ = readEnd_ = 0; // Everything consumed, reuse the buffer from the start
+    }
+
+    update_read_deadline();
+    start_write();
+    continue_reading();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::update_read_deadline()
+{
+    if (closeAfterWrite_)
+    {
+        return;
+    }
+    ReadPhase phase = readStart_ == readEnd_ ? ReadPhase::Idle : parser_.inBody() ? ReadPhase::Body
+                                                                                   : ReadPhase::Header;
+    if (phase == readPhase_ && phase != ReadPhase::Idle)
+    {
+        return; // A request's deadline runs from when it started, more bytes do not extend it
+    }
+    const AdmissionControl::Limits &limits = admission_.getLimits();
+    readPhase_ = phase;
+    readDeadline_ = std::chrono::steady_clock::now() + (phase == ReadPhase::Idle ? limits.idleTimeout : phase == ReadPhase::Header ? limits.headerTimeout
+                                                                                                                                    : limits.bodyTimeout);
+    if (!readTimerArmed_ || readDeadline_ < readTimer_.expiry())
+    {
+        arm_read_timer();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::arm_read_timer()
+{
+    readTimerArmed_ = true;
+    readTimer_.expires_at(readDeadline_); // Cancels the pending wait, its handler sees operation_aborted
+    auto self(shared_from_this());
+    readTimer_.async_wait([this, self](asio::error_code ec)
+                          {
+                              if (ec)
+                              {
+                                  return; // Rearmed or closed
+                              }
+                              readTimerArmed_ = false;
+                              read_deadline_passed();
+                          });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::read_deadline_passed()
+{
+    if (closeAfterWrite_ || !socket_.is_open())
+    {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now < readDeadline_)
+    {
+        arm_read_timer(); // Moved on since the timer was armed
+        return;
+    }
+    if (!reading_ || forwarding_ || !deferred_.empty())
+    {
+        // The client waits for us, not the other way round
+        readPhase_ = ReadPhase::Idle;
+        update_read_deadline();
+        return;
+    }
+
+    metrics_.recordRejection(Metrics::Rejection::Timeout);
+    closeAfterWrite_ = true;
+    if (writing_)
+    {
+        // The client does not read its responses either
+        asio::error_code ignored;
+        socket_.close(ignored);
+        return;
+    }
+    if (readPhase_ != ReadPhase::Idle)
+    {
+        writeHttpResponse(writeBuffer_, "408 Request Timeout", "", "", false);
+    }
+    start_write();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::shed_request(const HttpRequest &request, std::string &out)
+{
+    metrics_.recordRejection(Metrics::Rejection::Overload);
+    writeHttpServiceUnavailableResponse(out, static_cast<long>(admission_.getLimits().retryAfter.count()), request.keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::start_write()
+{
+    if (writing_)
+    {
+        return;
+    }
+    if (writeBuffer_.empty() && writeShared_.empty())
+    {
+        if (closeAfterWrite_ && deferred_.empty())
+        {
+            asio::error_code ignored;
+            socket_.shutdown(tcp::socket::shutdown_both, ignored);
+            socket_.close(ignored);
+            readTimer_.cancel();
+        }
+        return;
+    }
+
+    // Keep collecting responses in the other buffer while this one is sent
+    outBuffer_.swap(writeBuffer_);
+    outShared_.swap(writeShared_);
+    writeSharedBytes_ = 0;
+
+    // Buffered bytes and shared responses in queue order, in one gathered write
+    gather_.clear();
+    std::size_t from = 0;
+    for (const auto &shared : outShared_)
+    {
+        if (shared.offset > from)
+        {
+            gather_.emplace_back(outBuffer_.data() + from, shared.offset - from);
+        }
+        gather_.emplace_back(shared.bytes->data(), shared.bytes->size());
+        from = shared.offset;
+    }
+    if (outBuffer_.size() > from)
+    {
+        gather_.emplace_back(outBuffer_.data() + from, outBuffer_.size() - from);
+    }
+
+    writing_ = true;
+    auto self(shared_from_this());
+    asio::async_write(socket_, GatherBuffers{gather_.data(), gather_.data() + gather_.size()},
+                      asio::bind_executor(strand_, [this, self](asio::error_code ec, std::size_t /*length*/)
+                                          {
+                                              writing_ = false;
+                                              outBuffer_.clear(); // Keeps its capacity for the next responses
+                                              outShared_.clear();
+                                              if (ec)
+                                              {
+                                                  readTimer_.cancel();
+                                                  return;
+                                              }
+                                              start_write();
+                                              continue_reading();
+                                          }));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string &Session::response_buffer()
+{
+    if (deferred_.empty())
+    {
+        return writeBuffer_;
+    }
+    auto slot = std::make_shared<DeferredResponse>();
+    slot->ready = true;
+    deferred_.push_back(slot);
+    return slot->bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<Session::DeferredResponse> Session::defer_response(std::string &out, std::size_t mark, bool queued)
+{
+    std::shared_ptr<DeferredResponse> deferred;
+    if (queued)
+    {
+        deferred = deferred_.back();
+        deferred->ready = false;
+    }
+    else
+    {
+        deferred = std::make_shared<DeferredResponse>();
+        deferred->bytes.assign(out, mark, std::string::npos);
+        out.resize(mark);
+        deferred_.push_back(deferred);
+    }
+    deferred->route = requestRoute_;
+    deferred->start = requestStart_;
+    deferred->idempotencyKey = std::move(idempotencyKey_);
+    return deferred;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::complete_deferred(std::shared_ptr<DeferredResponse> deferred)
+{
+    auto self(shared_from_this());
+    asio::post(strand_, [this, self, deferred]
+               {
+                   finish_deferred(deferred);
+                   flush_deferred();
+                   start_write();
+                   continue_reading();
+               });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::finish_deferred(const std::shared_ptr<DeferredResponse> &deferred)
+{
+    deferred->ready = true;
+    if (deferred->inFlight)
+    {
+        deferred->inFlight = false;
+        admission_.finishRequest();
+    }
+    record_request(deferred->route, deferred->start, deferred->bytes, 0);
+    if (!deferred->idempotencyKey.empty())
+    {
+        store_idempotent_response(deferred->idempotencyKey, deferred->bytes, 0);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Session::claim_idempotency_key(const HttpRequest &request, std::string &out)
+{
+    if (request.idempotencyKey.size() > IdempotencyTable::MAX_KEY_SIZE)
+    {
+        writeHttpBadRequestResponse(out, request.keepAlive);
+        return false;
+    }
+    std::string key(request.idempotencyKey);
+    std::shared_ptr<const std::string> response;
+    switch (idempotencyTable_.claim(key, IdempotencyTable::fingerprintOf(request.target, request.body), response))
+    {
+    case IdempotencyTable::Claim::New:
+        idempotencyKey_ = std::move(key);
+        return true;
+    case IdempotencyTable::Claim::Replay:
+        queue_shared(out, std::move(response));
+        return false;
+    case IdempotencyTable::Claim::InProgress:
+        writeHttpResponse(out, "409 Conflict", "", "", request.keepAlive);
+        return false;
+    case IdempotencyTable::Claim::Mismatch:
+        writeHttpResponse(out, "422 Unprocessable Entity", "", "", request.keepAlive);
+        return false;
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::store_idempotent_response(const std::string &key, const std::string &response, std::size_t from)
+{
+    idempotencyTable_.complete(key, std::make_shared<const std::string>(response, from));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::record_request(Metrics::Route route, std::chrono::steady_clock::time_point start, const std::string &response, std::size_t from)
+{
+    // Responses start with "HTTP/1.1 " and the status code
+    const std::size_t STATUS_OFFSET = 9;
+    bool error = response.size() > from + STATUS_OFFSET && response[from + STATUS_OFFSET] >= '4';
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    metrics_.recordRequest(route, static_cast<std::uint64_t>(elapsed.count()), error);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::defer_until_durable(std::string &out, std::size_t mark, bool queued)
+{
+    auto deferred = defer_response(out, mark, queued);
+    deferred->inFlight = true;
+    admission_.startRequest();
+    auto self(shared_from_this());
+    // Runs on the booking log thread, complete_deferred hops back onto the session strand
+    reservationSystem_.whenDurable([this, self, deferred]
+                                   { complete_deferred(deferred); });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::flush_deferred()
+{
+    while (!deferred_.empty() && deferred_.front()->ready)
+    {
+        writeBuffer_ += deferred_.front()->bytes;
+        deferred_.pop_front();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t Session::owner_of(const std::string &theaterName, const std::string &movieTitle, ShowtimeId showtime) const
+{
+    if (!shards_)
+    {
+        return shardIndex_;
+    }
+    // A showtime belongs to the shard of its room, so room and showtime bookings never cross shards
+    long ordinal = reservationSystem_.getRoomOrdinal(theaterName, movieTitle, showtime);
+    return ordinal < 0 ? shardIndex_ : shards_->owner_of(ordinal);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t Session::owner_of_hold(std::uint64_t holdId) const
+{
+    if (!shards_)
+    {
+        return shardIndex_;
+    }
+    // Ending a hold changes its room's seats, so it runs where bookings of that room run
+    long ordinal = reservationSystem_.getHoldRoomOrdinal(holdId);
+    return ordinal < 0 ? shardIndex_ : shards_->owner_of(ordinal);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::submit_booking(std::string &out, BookingWork work)
+{
+    bool local = true;
+    for (const auto &part : work.parts)
+    {
+        local = local && part.first == shardIndex_;
+    }
+    if (!local)
+    {
+        forwarded_.reset(new BookingWork(std::move(work)));
+        return;
+    }
+
+    bool booked = false;
+    for (const auto &part : work.parts)
+    {
+        booked = part.second() || booked;
+    }
+    work.respond(out);
+    awaitDurable_ = booked && reservationSystem_.hasBookingLog();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /// @brief Progress of a booking spread over shards
+    struct ForwardState
+    {
+        std::atomic<std::size_t> remaining;
+        std::atomic<bool> booked{false};
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::forward_booking(std::string &out, std::size_t mark, bool queued)
+{
+    auto deferred = defer_response(out, mark, queued);
+    deferred->inFlight = true;
+    admission_.startRequest();
+    std::shared_ptr<BookingWork> work(std::move(forwarded_));
+    auto state = std::make_shared<ForwardState>();
+    state->remaining.store(work->parts.size(), std::memory_order_relaxed);
+
+    forwarding_ = true;
+    auto self(shared_from_this());
+    for (std::size_t i = 0; i < work->parts.size(); ++i)
+    {
+        shards_->at(work->parts[i].first).execute([this, self, work, state, deferred, i]
+                                                  {
+                                                      // Runs on the shard owning the rooms of this part
+                                                      if (work->parts[i].second())
+                                                      {
+                                                          state->booked.store(true, std::memory_order_relaxed);
+                                                      }
+                                                      if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                                                      {
+                                                          return;
+                                                      }
+                                                      // Last part to finish; the strand leaves the slot alone until it is ready
+                                                      work->respond(deferred->bytes);
+                                                      bool durable = state->booked.load(std::memory_order_relaxed) && reservationSystem_.hasBookingLog();
+                                                      asio::post(strand_, [this, self, deferred, durable]
+                                                                 {
+                                                                     forwarding_ = false;
+                                                                     if (!durable)
+                                                                     {
+                                                                         finish_deferred(deferred);
+                                                                     }
+                                                                     flush_deferred();
+                                                                     process_requests(); // Resume the requests behind the booking
+                                                                 });
+                                                      if (durable)
+                                                      {
+                                                          reservationSystem_.whenDurable([this, self, deferred]
+                                                                                         { complete_deferred(deferred); });
+                                                      }
+                                                  });
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::wait_for_changes(std::string &out, std::size_t mark, bool queued)
+{
+    auto deferred = defer_response(out, mark, queued);
+    std::shared_ptr<ChangeWait> wait(std::move(changeWait_));
+    auto self(shared_from_this());
+    // Runs once on the strand, woken by a change or the timer, whichever comes first
+    auto answer = [this, self, wait, deferred]
+    {
+        if (wait->done)
+        {
+            return;
+        }
+        wait->done = true;
+        wait->timer->cancel();
+        wait->feed.ring->cancelWait(wait->ticket);
+        SeatChanges changes;
+        reservationSystem_.readSeatChanges(wait->feed, wait->since, changes);
+        write_changes_response(deferred->bytes, changes, wait->keepAlive);
+        finish_deferred(deferred);
+        flush_deferred();
+        start_write();
+        continue_reading();
+    };
+
+    wait->timer.reset(new asio::steady_timer(strand_, wait->wait));
+    wait->timer->async_wait([answer](asio::error_code)
+                            { answer(); });
+    // The ring wakes us on the booking thread, hop back onto the strand
+    wait->ticket = wait->feed.ring->waitAfter(wait->since, [this, answer]
+                                              { asio::post(strand_, answer); });
+    if (wait->ticket == 0)
+    {
+        asio::post(strand_, answer); // Changed since handle_request read it
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::write_changes_response(std::string &out, const SeatChanges &changes, bool keepAlive)
+{
+    Json::Value response;
+    response["version"] = Json::UInt64(changes.version);
+    response["full"] = changes.full;
+    response["booked"] = Json::Value(Json::arrayValue);
+    for (int seatNumber : changes.booked)
+    {
+        response["booked"].append(seatNumber);
+    }
+    response["freed"] = Json::Value(Json::arrayValue);
+    for (int seatNumber : changes.freed)
+    {
+        response["freed"].append(seatNumber);
+    }
+    writeHttpOkResponse(out, response, keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Session::write_cached_response(std::string &out, const std::string &key, std::uint64_t version, bool keepAlive)
+{
+    if (!keepAlive)
+    {
+        return false;
+    }
+    auto response = responseCache_.find(key, version);
+    if (!response)
+    {
+        return false;
+    }
+    queue_shared(out, std::move(response));
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::write_and_cache_response(std::string &out, const std::string &key, std::uint64_t version, const Json::Value &jsonData, bool keepAlive)
+{
+    if (!keepAlive)
+    {
+        writeHttpOkResponse(out, jsonData, keepAlive);
+        return;
+    }
+    auto response = std::make_shared<std::string>();
+    writeHttpOkResponse(*response, jsonData, keepAlive);
+    responseCache_.store(key, version, response);
+    queue_shared(out, std::move(response));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::write_and_cache_body(std::string &out, const std::string &key, std::uint64_t version, std::string_view body, bool keepAlive)
+{
+    if (!keepAlive)
+    {
+        writeHttpResponse(out, "200 OK", "application/json", body, keepAlive);
+        return;
+    }
+    auto response = std::make_shared<std::string>();
+    response->reserve(body.size() + 128);
+    writeHttpResponse(*response, "200 OK", "application/json", body, keepAlive);
+    responseCache_.store(key, version, response);
+    queue_shared(out, std::move(response));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::queue_shared(std::string &out, std::shared_ptr<const std::string> response)
+{
+    if (&out != &writeBuffer_)
+    {
+        out += *response;
+        return;
+    }
+    writeSharedBytes_ += response->size();
+    writeShared_.push_back(SharedResponse{writeBuffer_.size(), std::move(response)});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Session::read_seats(const Json::Value &seatsJson, std::vector<int> &seats)
+{
+    if (!seatsJson.isArray())
+    {
+        logger_.log(LogLevel::Warning, "Handle error: 'seats' field is not an array");
+        return false;
+    }
+    for (Json::Value::ArrayIndex i = 0; i < seatsJson.size(); ++i)
+    {
+        if (seatsJson[i].isInt())
+        {
+            seats.push_back(seatsJson[i].asInt());
+        }
+        else
+        {
+            logger_.log(LogLevel::Warning, "Handle error: 'seats' not int");
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Session::read_showtime(const Json::Value &requestJson, ShowtimeId &showtime)
+{
+    showtime = NO_SHOWTIME;
+    if (!requestJson.isMember("showtime"))
+    {
+        return true;
+    }
+    const Json::Value &showtimeJson = requestJson["showtime"];
+    if (!showtimeJson.isUInt() || showtimeJson.asUInt() == NO_SHOWTIME)
+    {
+        logger_.log(LogLevel::Warning, "Handle error: 'showtime' is not a showtime id");
+        return false;
+    }
+    showtime = showtimeJson.asUInt();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Session::parse_json_body(std::string_view body, Json::Value &json)
+{
+    // One reader per worker thread instead of one per request
+    thread_local std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+    if (body.empty())
+    {
+        return true;
+    }
+    return reader->parse(body.data(), body.data() + body.size(), &json, nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::write_metrics_response(std::string &out, bool keepAlive)
+{
+    std::string body;
+    metrics_.render(body);
+
+    // Seat maps count their own retries, list the rooms that had any
+    body += "# TYPE reservation_room_contention_total counter\n";
+    reservationSystem_.forEachRoom([&body](const std::string &theaterName, const Room &room)
+                                   {
+                                       std::uint64_t contention = room.getSeatMap().getContentionCount();
+                                       if (contention > 0)
+                                       {
+                                           Metrics::writeSample(body, "reservation_room_contention_total",
+                                                                Metrics::label("theater", theaterName) + "," + Metrics::label("room", room.getRoomName()),
+                                                                static_cast<double>(contention));
+                                       }
+                                   });
+
+    body += "# TYPE reservation_catalog_version gauge\n";
+    Metrics::writeSample(body, "reservation_catalog_version", "", static_cast<double>(reservationSystem_.getCatalogVersion()));
+
+    body += "# TYPE reservation_holds_active gauge\n";
+    Metrics::writeSample(body, "reservation_holds_active", "", static_cast<double>(reservationSystem_.getHoldCount()));
+
+    if (const ReplicationLog *replicationLog = reservationSystem_.getReplicationLog())
+    {
+        body += "# TYPE reservation_replication_sequence gauge\n";
+        Metrics::writeSample(body, "reservation_replication_sequence", "", static_cast<double>(replicationLog->getSequence()));
+    }
+    if (const ReplicaStatus *replica = reservationSystem_.getReplicaStatus())
+    {
+        body += "# TYPE reservation_replica_connected gauge\n";
+        Metrics::writeSample(body, "reservation_replica_connected", "", replica->connected.load(std::memory_order_relaxed) ? 1 : 0);
+        body += "# TYPE reservation_replica_synced gauge\n";
+        Metrics::writeSample(body, "reservation_replica_synced", "", replica->synced.load(std::memory_order_relaxed) ? 1 : 0);
+        body += "# TYPE reservation_replica_sequence gauge\n";
+        Metrics::writeSample(body, "reservation_replica_sequence", "", static_cast<double>(replica->sequence.load(std::memory_order_relaxed)));
+        body += "# TYPE reservation_replica_lag_seconds gauge\n";
+        Metrics::writeSample(body, "reservation_replica_lag_seconds", "", replica->getLagSeconds());
+        body += "# TYPE reservation_replica_records_applied_total counter\n";
+        Metrics::writeSample(body, "reservation_replica_records_applied_total", "", static_cast<double>(replica->appliedRecords.load(std::memory_order_relaxed)));
+    }
+
+    if (shards_)
+    {
+        body += "# TYPE reservation_shard_queue_depth gauge\n";
+        for (std::size_t i = 0; i < shards_->size(); ++i)
+        {
+            Metrics::writeSample(body, "reservation_shard_queue_depth", Metrics::label("shard", std::to_string(i)),
+                                 static_cast<double>(shards_->at(i).pending()));
+        }
+    }
+    writeHttpResponse(out, "200 OK", "text/plain; version=0.0.4", body, keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::handle_seat_request(const HttpRequest &request, std::string &out)
+{
+    const bool keepAlive = request.keepAlive;
+    SeatRequestBody body;
+    if (!SeatRequestDecoder(request.body).decode(body))
+    {
+        writeHttpBadRequestResponse(out, keepAlive);
+        return;
+    }
+    if (body.skippedSeats > 0)
+    {
+        logger_.log(LogLevel::Warning, "Handle error: 'seats' not int");
+    }
+    std::string movieTitle(body.movie);
+    std::string theaterTitle(body.theater);
+    ShowtimeId showtime = body.showtime;
+
+    if (request.target == "/find")
+    {
+        if (body.hasMovie)
+        {
+            std::string key = ResponseCache::makeKey("/find", movieTitle);
+            std::uint64_t version = reservationSystem_.getCatalogVersion();
+            if (!write_cached_response(out, key, version, keepAlive))
+            {
+                auto response = reservationSystem_.getTheatersShowingMovieJson(movieTitle);
+                write_and_cache_response(out, key, version, response, keepAlive);
+            }
+            return;
+        }
+    }
+    else if (request.target == "/bookings")
+    {
+        if (body.hasMovie && body.hasTheater)
+        {
+            std::string key = showtime == NO_SHOWTIME ? ResponseCache::makeKey("/bookings", theaterTitle, movieTitle)
+                                                      : ResponseCache::makeKey("/bookings/" + std::to_string(showtime), theaterTitle, movieTitle);
+            std::uint64_t version = reservationSystem_.getBookingsVersion(theaterTitle, movieTitle, showtime);
+            if (!write_cached_response(out, key, version, keepAlive))
+            {
+                // Encoded straight from the seat maps into a buffer reused by every request of this thread
+                thread_local std::string body;
+                body.clear();
+                reservationSystem_.writeBookingsJson(body, theaterTitle, movieTitle, showtime);
+                write_and_cache_body(out, key, version, body, keepAlive);
+            }
+            return;
+        }
+    }
+    else if (request.target == "/showtimes")
+    {
+        if (body.hasMovie && body.hasTheater)
+        {
+            std::string key = ResponseCache::makeKey("/showtimes", theaterTitle, movieTitle);
+            std::uint64_t version = reservationSystem_.getCatalogVersion();
+            if (!write_cached_response(out, key, version, keepAlive))
+            {
+                auto response = reservationSystem_.getShowtimesJson(theaterTitle, movieTitle);
+                write_and_cache_response(out, key, version, response, keepAlive);
+            }
+            return;
+        }
+    }
+    else if (request.target == "/seats")
+    {
+        if (body.hasMovie && body.hasTheater && body.hasSeats)
+        {
+            std::vector<int> seats(body.seats, body.seats + body.seatCount);
+            ReservationSystem &reservationSystem = reservationSystem_;
+            Metrics &metrics = metrics_;
+            auto booked = std::make_shared<bool>(false);
+            BookingWork work;
+            work.parts.emplace_back(owner_of(theaterTitle, movieTitle, showtime), [&reservationSystem, &metrics, booked, theaterTitle, movieTitle, seats = std::move(seats), showtime]
+                                    {
+                                        *booked = reservationSystem.bookSeats(theaterTitle, movieTitle, seats, showtime);
+                                        metrics.recordBooking(*booked);
+                                        return *booked;
+                                    });
+            work.respond = [booked, keepAlive](std::string &response)
+            {
+                if (*booked)
+                {
+                    writeHttpOkResponse(response, true, keepAlive);
+                }
+                else
+                {
+                    writeHttpErrorResponse(response, "No available seats.", keepAlive);
+                }
+            };
+            submit_booking(out, std::move(work));
+            return;
+        }
+    }
+
+    // A known endpoint without the fields it needs
+    writeHttpBadRequestResponse(out, keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Session::peer_is_loopback() const
+{
+    asio::error_code error;
+    tcp::endpoint peer = socket_.remote_endpoint(error);
+    if (error)
+    {
+        return false;
+    }
+    asio::ip::address address = peer.address();
+    // An IPv4 client of a dual-stack listener shows up as a mapped IPv6 address
+    if (address.is_v6() && address.to_v6().is_v4_mapped())
+    {
+        return address.to_v6().to_v4().is_loopback();
+    }
+    return address.is_loopback();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::handle_request(const HttpRequest &request, std::string &out)
+{
+    const bool keepAlive = request.keepAlive;
+    logger_.log(LogLevel::Info, request.target, " ", request.method, " ", request.body);
+
+    // A replica that never got a full copy of the primary's bookings would answer reads with empty rooms
+    const ReplicaStatus *replica = reservationSystem_.getReplicaStatus();
+    if (replica && !replica->synced.load(std::memory_order_relaxed) && requestRoute_ != Metrics::Route::Metrics)
+    {
+        writeHttpServiceUnavailableResponse(out, static_cast<long>(admission_.getLimits().retryAfter.count()), keepAlive);
+        return;
+    }
+
+    if (request.method == "GET")
+    {
+        if (request.target == "/movies")
+        {
+            static const std::string key = ResponseCache::makeKey("/movies", "");
+            // Read the version before the data, a booking racing us then only causes a miss later
+            std::uint64_t version = reservationSystem_.getCatalogVersion();
+            if (!write_cached_response(out, key, version, keepAlive))
+            {
+                auto response = reservationSystem_.getAllPlayingMoviesJson();
+                write_and_cache_response(out, key, version, response, keepAlive);
+            }
+        }
+        else if (request.target == "/metrics")
+        {
+            write_metrics_response(out, keepAlive);
+        }
+        else
+        {
+            writeHttpNotFoundResponse(out, keepAlive);
+        }
+        return;
+    }
+
+    if (request.method != "POST")
+    {
+        writeHttpMethodNotAllowedResponse(out, keepAlive);
+        return;
+    }
+
+    // A retried booking with the key of an earlier one gets its response, without touching the room
+    const bool booking = requestRoute_ == Metrics::Route::Seats || requestRoute_ == Metrics::Route::SeatsBatch || requestRoute_ == Metrics::Route::SeatsAuto ||
+                         requestRoute_ == Metrics::Route::Holds || requestRoute_ == Metrics::Route::HoldsConfirm || requestRoute_ == Metrics::Route::HoldsRelease;
+    if (booking && replica)
+    {
+        // Bookings of a read replica only come from its primary
+        writeHttpForbiddenResponse(out, "Read-only replica, send bookings to the primary.", keepAlive);
+        return;
+    }
+    if (booking && !request.idempotencyKey.empty() && !claim_idempotency_key(request, out))
+    {
+        return;
+    }
+
+    // The seat endpoints have a fixed schema and skip the json document
+    if (request.target == "/find" || request.target == "/bookings" || request.target == "/showtimes" || request.target == "/seats")
+    {
+        handle_seat_request(request, out);
+        return;
+    }
+
+    Json::Value requestBodyJson;
+    if (!parse_json_body(request.body, requestBodyJson))
+    {
+        writeHttpBadRequestResponse(out, keepAlive);
+        return;
+    }
+
+    if (request.target == "/seats/batch")
+    {
+        // Many bookings in one request, each room is booked once for the whole batch
+        if (requestBodyJson.isMember("bookings") && requestBodyJson["bookings"].isArray())
+        {
+            const Json::Value &bookingsJson = requestBodyJson["bookings"];
+            auto requestsPtr = std::make_shared<std::vector<BookingRequest>>(bookingsJson.size());
+            std::vector<BookingRequest> &requests = *requestsPtr;
+            for (Json::Value::ArrayIndex i = 0; i < bookingsJson.size(); ++i)
+            {
+                const Json::Value &bookingJson = bookingsJson[i];
+                requests[i].movie = bookingJson["movie"].asString();
+                requests[i].theater = bookingJson["theater"].asString();
+                if (!read_showtime(bookingJson, requests[i].showtime))
+                {
+                    writeHttpBadRequestResponse(out, keepAlive);
+                    return;
+                }
+                for (const auto &seatJson : bookingJson["seats"])
+                {
+                    if (seatJson.isInt())
+                    {
+                        requests[i].seats.push_back(seatJson.asInt());
+                    }
+                    else
+                    {
+                        logger_.log(LogLevel::Warning, "Handle error: 'seats' not int");
+                    }
+                }
+            }
+
+            // One part per owning shard, each books its items as one batch
+            std::map<std::size_t, std::vector<std::size_t>> itemsByShard;
+            for (std::size_t i = 0; i < requests.size(); ++i)
+            {
+                itemsByShard[owner_of(requests[i].theater, requests[i].movie, requests[i].showtime)].push_back(i);
+            }
+
+            ReservationSystem &reservationSystem = reservationSystem_;
+            Metrics &metrics = metrics_;
+            auto results = std::make_shared<std::vector<char>>(requests.size(), 0);
+            BookingWork work;
+            for (auto &shardItems : itemsByShard)
+            {
+                work.parts.emplace_back(shardItems.first, [&reservationSystem, &metrics, requestsPtr, results, items = std::move(shardItems.second)]
+                                        {
+                                            std::vector<BookingRequest> subset;
+                                            if (items.size() < requestsPtr->size())
+                                            {
+                                                for (std::size_t i : items)
+                                                {
+                                                    subset.push_back((*requestsPtr)[i]);
+                                                }
+                                            }
+                                            auto booked = reservationSystem.bookSeatsBatch(subset.empty() ? *requestsPtr : subset);
+                                            bool any = false;
+                                            for (std::size_t n = 0; n < items.size(); ++n)
+                                            {
+                                                (*results)[items[n]] = booked[n];
+                                                metrics.recordBooking(booked[n]);
+                                                any = any || booked[n];
+                                            }
+                                            return any;
+                                        });
+            }
+            work.respond = [results, keepAlive](std::string &out)
+            {
+                Json::Value response(Json::arrayValue);
+                for (char result : *results)
+                {
+                    response.append(result != 0);
+                }
+                writeHttpOkResponse(out, response, keepAlive);
+            };
+            submit_booking(out, std::move(work));
+            return;
+        }
+    }
+    else if (request.target == "/seats/auto")
+    {
+        // Let the server pick the seats instead of the client guessing them
+        if (requestBodyJson.isMember("movie") && requestBodyJson.isMember("theater") && requestBodyJson.isMember("count"))
+        {
+            std::string movieTitle = requestBodyJson["movie"].asString();
+            std::string theaterTitle = requestBodyJson["theater"].asString();
+            int count = requestBodyJson["count"].asInt();
+            bool contiguous = requestBodyJson.get("contiguous", true).asBool();
+            ShowtimeId showtime;
+            if (!read_showtime(requestBodyJson, showtime))
+            {
+                writeHttpBadRequestResponse(out, keepAlive);
+                return;
+            }
+
+            ReservationSystem &reservationSystem = reservationSystem_;
+            Metrics &metrics = metrics_;
+            auto seats = std::make_shared<std::vector<int>>();
+            BookingWork work;
+            work.parts.emplace_back(owner_of(theaterTitle, movieTitle, showtime), [&reservationSystem, &metrics, seats, theaterTitle, movieTitle, count, contiguous, showtime]
+                                    {
+                                        *seats = reservationSystem.bookBestAvailable(theaterTitle, movieTitle, count, contiguous, showtime);
+                                        metrics.recordBooking(!seats->empty());
+                                        return !seats->empty();
+                                    });
+            work.respond = [seats, keepAlive](std::string &out)
+            {
+                if (!seats->empty())
+                {
+                    Json::Value response(Json::arrayValue);
+                    for (int seatNumber : *seats)
+                    {
+                        response.append(seatNumber);
+                    }
+                    writeHttpOkResponse(out, response, keepAlive);
+                }
+                else
+                {
+                    writeHttpErrorResponse(out, "No available seats.", keepAlive);
+                }
+            };
+            submit_booking(out, std::move(work));
+            return;
+        }
+    }
+    else if (request.target == "/holds")
+    {
+        // Seats taken for a while, e.g. during payment, then confirmed or given back
+        if (requestBodyJson.isMember("movie") && requestBodyJson.isMember("theater") && requestBodyJson.isMember("seats"))
+        {
+            std::string movieTitle = requestBodyJson["movie"].asString();
+            std::string theaterTitle = requestBodyJson["theater"].asString();
+            std::vector<int> seats;
+            ShowtimeId showtime;
+            const Json::Value &ttlJson = requestBodyJson.get("ttl", DEFAULT_HOLD_TTL_SECONDS);
+            if (!read_seats(requestBodyJson["seats"], seats) || !read_showtime(requestBodyJson, showtime) || !ttlJson.isNumeric() ||
+                ttlJson.asDouble() <= 0)
+            {
+                writeHttpBadRequestResponse(out, keepAlive);
+                return;
+            }
+            auto ttl = std::chrono::milliseconds(static_cast<std::int64_t>(ttlJson.asDouble() * 1000));
+
+            ReservationSystem &reservationSystem = reservationSystem_;
+            auto holdId = std::make_shared<std::uint64_t>(0);
+            BookingWork work;
+            work.parts.emplace_back(owner_of(theaterTitle, movieTitle, showtime), [&reservationSystem, holdId, theaterTitle, movieTitle, seats, ttl, showtime]
+                                    {
+                                        *holdId = reservationSystem.holdSeats(theaterTitle, movieTitle, seats, ttl, showtime);
+                                        return false; // Holds are not logged, nothing to wait for
+                                    });
+            work.respond = [holdId, keepAlive](std::string &response)
+            {
+                if (*holdId != 0)
+                {
+                    Json::Value result;
+                    result["hold"] = Json::UInt64(*holdId);
+                    writeHttpOkResponse(response, result, keepAlive);
+                }
+                else
+                {
+                    writeHttpErrorResponse(response, "No available seats.", keepAlive);
+                }
+            };
+            submit_booking(out, std::move(work));
+            return;
+        }
+    }
+    else if (request.target == "/holds/confirm" || request.target == "/holds/release")
+    {
+        if (requestBodyJson.isMember("hold") && requestBodyJson["hold"].isUInt64())
+        {
+            std::uint64_t holdId = requestBodyJson["hold"].asUInt64();
+            bool confirm = request.target == "/holds/confirm";
+
+            ReservationSystem &reservationSystem = reservationSystem_;
+            Metrics &metrics = metrics_;
+            auto done = std::make_shared<bool>(false);
+            BookingWork work;
+            work.parts.emplace_back(owner_of_hold(holdId), [&reservationSystem, &metrics, done, holdId, confirm]
+                                    {
+                                        if (!confirm)
+                                        {
+                                            *done = reservationSystem.releaseHold(holdId);
+                                            return false;
+                                        }
+                                        *done = reservationSystem.confirmHold(holdId);
+                                        metrics.recordBooking(*done);
+                                        return *done;
+                                    });
+            work.respond = [done, keepAlive](std::string &response)
+            {
+                if (*done)
+                {
+                    writeHttpOkResponse(response, true, keepAlive);
+                }
+                else
+                {
+                    writeHttpErrorResponse(response, "No such hold.", keepAlive);
+                }
+            };
+            submit_booking(out, std::move(work));
+            return;
+        }
+    }
+    else if (request.target == "/bookings/changes")
+    {
+        // Seat deltas since the client's version instead of the whole room, long polling when there are none
+        if (requestBodyJson.isMember("movie") && requestBodyJson.isMember("theater"))
+        {
+            std::string movieTitle = requestBodyJson["movie"].asString();
+            std::string theaterTitle = requestBodyJson["theater"].asString();
+            ShowtimeId showtime;
+            const Json::Value &versionJson = requestBodyJson.get("version", 0);
+            const Json::Value &waitJson = requestBodyJson.get("wait", DEFAULT_CHANGES_WAIT_SECONDS);
+            if (!read_showtime(requestBodyJson, showtime) || !versionJson.isUInt64() || !waitJson.isNumeric() || waitJson.asDouble() < 0)
+            {
+                writeHttpBadRequestResponse(out, keepAlive);
+                return;
+            }
+            auto wait = std::make_shared<ChangeWait>();
+            if (!reservationSystem_.followSeats(theaterTitle, movieTitle, showtime, wait->feed))
+            {
+                writeHttpNotFoundResponse(out, keepAlive);
+                return;
+            }
+            wait->since = versionJson.asUInt64();
+            SeatChanges changes;
+            reservationSystem_.readSeatChanges(wait->feed, wait->since, changes);
+            double seconds = std::min(waitJson.asDouble(), MAX_CHANGES_WAIT_SECONDS);
+            if (changes.full || !changes.booked.empty() || !changes.freed.empty() || seconds <= 0)
+            {
+                write_changes_response(out, changes, keepAlive);
+                return;
+            }
+            wait->since = changes.version;
+            wait->wait = std::chrono::milliseconds(static_cast<std::int64_t>(seconds * 1000));
+            wait->keepAlive = keepAlive;
+            changeWait_ = std::move(wait);
+            return;
+        }
+    }
+    else if (request.target == "/admin/reload")
+    {
+        // A replica takes its catalog from the same file as its primary, reloading one alone would make their rooms differ
+        if (replica)
+        {
+            writeHttpForbiddenResponse(out, "Read-only replica, reload the primary.", keepAlive);
+            return;
+        }
+        // Nothing authenticates admin requests, remote operators use SIGHUP on the host instead
+        if (!peer_is_loopback())
+        {
+            writeHttpForbiddenResponse(out, "Admin requests are only taken from this host.", keepAlive);
+            return;
+        }
+        // Loads the catalog file again off the event loop, requests keep using the current one meanwhile
+        Logger &logger = logger_;
+        bool started = reservationSystem_.reloadCatalogAsync(reservationSystem_.getCatalogPath(), [&logger](const std::string &error)
+                                                             {
+                                                                 if (error.empty())
+                                                                 {
+                                                                     logger.log(LogLevel::Info, "Catalog reloaded");
+                                                                 }
+                                                                 else
+                                                                 {
+                                                                     logger.log(LogLevel::Error, "Catalog reload failed: ", error);
+                                                                 }
+                                                             });
+        writeHttpResponse(out, started ? "202 Accepted" : "409 Conflict", "", "", keepAlive);
+        return;
+    }
+    else
+    {
+        writeHttpMethodNotAllowedResponse(out, keepAlive);
+        return;
+    }
+
+    // A known endpoint without the fields it needs
+    writeHttpBadRequestResponse(out, keepAlive);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <asio.hpp>
+#include <json/json.h>
+
+#include "admission_control.h"
+#include "http_parser.h"
+#include "idempotency_table.h"
+#include "logger.h"
+#include "metrics.h"
+#include "reservation_system.h"
+#include "response_cache.h"
+#include "shard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Session class to dipatch dispatch requests asyncronously.
+/// A session serves one persistent HTTP/1.1 connection. Requests are parsed in
+/// place from a reusable read buffer, pipelined requests are answered in order
+/// and their responses leave in a single write. Cached responses are not copied into
+/// the write buffer: the write gathers them from the cache next to the buffered bytes.
+/// Booking responses wait until the booking log made them durable; responses
+/// behind them queue up so the order is kept. All handlers run on the session strand.
+/// On a sharded server bookings run on the shard owning their room. Later requests
+/// of the connection wait until the owner applied the booking, so they see it.
+/// A booking request with an Idempotency-Key header that was answered before gets the
+/// stored response again instead of booking twice, see IdempotencyTable.
+/// A /bookings/changes request with nothing new to report is parked on the room's
+/// change ring until the next seat change or its wait runs out (long polling).
+/// Requests are answered with 503 while AdmissionControl reports overload. A client that
+/// takes too long to send a request header or body, or stays idle too long between
+/// requests, is disconnected; one timer per connection tracks the read deadline.
+/// On a read replica bookings are refused with 403, they only come from the primary.
+class Session : public std::enable_shared_from_this<Session>
+{
+public:
+    /// @brief Constructor
+    /// @param socket
+    /// @param reservationSystem
+    /// @param responseCache shared cache of read endpoint responses
+    /// @param idempotencyTable shared responses of recent booking requests by idempotency key
+    /// @param admission server load limits, read deadlines and body size limit
+    /// @param logger request log
+    /// @param metrics request and booking counters
+    /// @param shards shards of a sharded server, nullptr if every thread may book every room
+    /// @param shardIndex shard whose thread runs this session
+    Session(asio::ip::tcp::socket socket, ReservationSystem &reservationSystem, ResponseCache &responseCache, IdempotencyTable &idempotencyTable, AdmissionControl &admission, Logger &logger, Metrics &metrics,
+            ShardGroup *shards = nullptr, std::size_t shardIndex = 0);
+
+    ~Session();
+
+    /// @brief Session async callback
+    void start();
+
+private:
+    static constexpr std::size_t INITIAL_BUFFER_SIZE = 4096;
+    static constexpr std::size_t MAX_BUFFER_SIZE = 1 << 20; // Output queued before reading stops
+    static constexpr std::size_t MAX_DEFERRED_RESPONSES = 256;
+    static constexpr double DEFAULT_HOLD_TTL_SECONDS = 300;
+    static constexpr double DEFAULT_CHANGES_WAIT_SECONDS = 25;
+    static constexpr double MAX_CHANGES_WAIT_SECONDS = 60;
+
+    /// @brief A response that has to wait, e.g. for its booking to be durable
+    struct DeferredResponse
+    {
+        std::string bytes;
+        bool ready = false;
+        Metrics::Route route = Metrics::Route::Other; // Request the response answers, timed once it is ready
+        std::chrono::steady_clock::time_point start;
+        std::string idempotencyKey; // Key the response is stored under once ready, empty if none
+        bool inFlight = false;      // Counted by AdmissionControl until ready
+    };
+
+    /// @brief A shared response sent by reference, after the first 'offset' bytes of its buffer
+    struct SharedResponse
+    {
+        std::size_t offset;
+        std::shared_ptr<const std::string> bytes;
+    };
+
+    /// @brief Buffer sequence over 'gather_', so async_write copies no buffer list
+    struct GatherBuffers
+    {
+        using value_type = asio::const_buffer;
+        using const_iterator = const asio::const_buffer *;
+        const_iterator first;
+        const_iterator last;
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return last; }
+    };
+
+    /// @brief The booking of one request. Each part books rooms owned by one shard and runs
+    /// on that shard, 'respond' writes the response once every part ran.
+    struct BookingWork
+    {
+        std::vector<std::pair<std::size_t, std::function<bool()>>> parts; // Owning shard, booking returning whether it booked seats
+        std::function<void(std::string &)> respond;
+    };
+
+    /// @brief A /bookings/changes request waiting for the next seat change
+    struct ChangeWait
+    {
+        SeatFeed feed;
+        std::uint64_t since = 0;
+        std::chrono::milliseconds wait{0};
+        bool keepAlive = true;
+        std::uint64_t ticket = 0; // Of the wait on the change ring
+        bool done = false;        // Answered, by a change or the timer
+        std::unique_ptr<asio::steady_timer> timer;
+    };
+
+    /// @brief What the connection is waiting for from the client, each with its own read deadline
+    enum class ReadPhase
+    {
+        Idle,   // The next request
+        Header, // The rest of a request header
+        Body    // The rest of a request body
+    };
+
+    /// @brief Reads more bytes from the socket into the free end of the read buffer
+    void async_read();
+
+    /// @brief Starts a read unless one is running, the connection is closing or too much output is queued
+    void continue_reading();
+
+    /// @brief Handles every complete request in the read buffer, then writes and reads again
+    void process_requests();
+
+    /// @brief Moves the read deadline after the read buffer changed: it restarts when the read phase
+    /// changes, and every time the connection goes idle. The timer is only rearmed to bring it forward.
+    void update_read_deadline();
+
+    /// @brief Waits on the read timer until 'readDeadline_'
+    void arm_read_timer();
+
+    /// @brief Closes a connection whose read deadline passed, with 408 if a request was partly sent.
+    /// The deadline is pushed back instead while the session itself keeps the client waiting.
+    void read_deadline_passed();
+
+    /// @brief Answers a request with 503 and Retry-After without handling it
+    void shed_request(const HttpRequest &request, std::string &out);
+
+    /// @brief Sends the ready responses unless a write is running, closes once all is sent
+    void start_write();
+
+    /// @brief Makes room at the end of the read buffer, compacting or growing it
+    /// @return false if the buffer is full and already at 'maxReadBuffer_'
+    bool reserve_read_space();
+
+    /// @brief Where the next response goes: the write buffer, or a new queue slot behind deferred responses
+    std::string &response_buffer();
+
+    /// @brief Moves the response written to 'out' from 'mark' on into a deferred slot that is not ready
+    /// @param queued whether 'out' is the last slot of the deferred queue rather than the write buffer
+    std::shared_ptr<DeferredResponse> defer_response(std::string &out, std::size_t mark, bool queued);
+
+    /// @brief Marks a deferred response ready and sends what can be sent, callable from any thread
+    void complete_deferred(std::shared_ptr<DeferredResponse> deferred);
+
+    /// @brief Marks a deferred response ready and records its request, on the strand
+    void finish_deferred(const std::shared_ptr<DeferredResponse> &deferred);
+
+    /// @brief Claims the idempotency key of a booking request, see IdempotencyTable::claim
+    /// @return false if the response was written instead: the stored one, or why the key cannot be used
+    bool claim_idempotency_key(const HttpRequest &request, std::string &out);
+
+    /// @brief Stores the final response of a request that claimed an idempotency key, 'response' starting at 'from'
+    void store_idempotent_response(const std::string &key, const std::string &response, std::size_t from);
+
+    /// @brief Records a finished request, 'response' starting at 'from'
+    void record_request(Metrics::Route route, std::chrono::steady_clock::time_point start, const std::string &response, std::size_t from);
+
+    /// @brief Writes the /metrics page: server counters, room contention and shard queues
+    void write_metrics_response(std::string &out, bool keepAlive);
+
+    /// @brief Holds back the response just written to 'out' from 'mark' on until the bookings are durable
+    void defer_until_durable(std::string &out, std::size_t mark, bool queued);
+
+    /// @brief Runs a booking where its rooms live. If this shard owns them all it runs
+    /// right away into 'out', otherwise it is kept for forward_booking.
+    void submit_booking(std::string &out, BookingWork work);
+
+    /// @brief Hands the kept booking to its owning shards, the response waits in a deferred slot.
+    /// Request handling pauses until every part ran.
+    void forward_booking(std::string &out, std::size_t mark, bool queued);
+
+    /// @brief Parks the changes request just handled until its room changes or its wait runs out,
+    /// the response waits in a deferred slot. Requests behind it are handled meanwhile.
+    void wait_for_changes(std::string &out, std::size_t mark, bool queued);
+
+    /// @brief Writes the seat changes of a /bookings/changes response
+    static void write_changes_response(std::string &out, const SeatChanges &changes, bool keepAlive);
+
+    /// @brief Shard owning the room booked for a theater movie or one of its showtimes, this session's shard if there is none
+    std::size_t owner_of(const std::string &theaterName, const std::string &movieTitle, ShowtimeId showtime = NO_SHOWTIME) const;
+
+    /// @brief Shard owning the room a hold was taken in, this session's shard if there is none
+    std::size_t owner_of_hold(std::uint64_t holdId) const;
+
+    /// @brief Whether the client connected from this host, admin requests are only taken from there
+    bool peer_is_loopback() const;
+
+    /// @brief Moves the ready responses at the front of the deferred queue to the write buffer
+    void flush_deferred();
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// @brief This here routes requests to our APIs
+    /// @param request parsed request, views into the read buffer
+    /// @param out buffer the response is appended to
+    void handle_request(const HttpRequest &request, std::string &out);
+
+    /// @brief Handles /find, /bookings, /showtimes and /seats, whose bodies are decoded without jsoncpp
+    void handle_seat_request(const HttpRequest &request, std::string &out);
+
+    /// @brief Queues the cached response for 'key' if it is still at 'version'.
+    /// Only keep-alive responses are cached.
+    /// @return false on a miss, the caller then builds the response
+    bool write_cached_response(std::string &out, const std::string &key, std::uint64_t version, bool keepAlive);
+
+    /// @brief Queues a 200 OK response and caches it under 'key' at 'version'
+    void write_and_cache_response(std::string &out, const std::string &key, std::uint64_t version, const Json::Value &jsonData, bool keepAlive);
+
+    /// @brief Queues a 200 OK response with a json body already encoded, and caches it like write_and_cache_response
+    void write_and_cache_body(std::string &out, const std::string &key, std::uint64_t version, std::string_view body, bool keepAlive);
+
+    /// @brief Queues a shared response. Sent by reference when 'out' is the write buffer, copied into a deferred slot otherwise
+    void queue_shared(std::string &out, std::shared_ptr<const std::string> response);
+
+    /// @brief Parses a request body into 'json'
+    /// @return false if the body is not valid JSON
+    static bool parse_json_body(std::string_view body, Json::Value &json);
+
+    /// @brief Reads the seat numbers of a "seats" field, skipping and logging entries that are not ints
+    /// @return false if the field is not an array
+    bool read_seats(const Json::Value &seatsJson, std::vector<int> &seats);
+
+    /// @brief Reads the optional "showtime" field of a request, NO_SHOWTIME when it is missing
+    /// @return false if the field is there but not a showtime id
+    bool read_showtime(const Json::Value &requestJson, ShowtimeId &showtime);
+
+    asio::ip::tcp::socket socket_;
+    asio::strand<asio::ip::tcp::socket::executor_type> strand_;
+    std::vector<char> readBuffer_; // Bytes [readStart_, readEnd_) are received but not consumed
+    std::size_t maxReadBuffer_;    // Fits the largest accepted request
+    std::size_t readStart_ = 0;
+    std::size_t readEnd_ = 0;
+    HttpRequestParser parser_;
+    std::string writeBuffer_; // Ready responses waiting for the next write, reused between writes
+    std::string outBuffer_;   // Responses being written
+    std::vector<SharedResponse> writeShared_; // Shared responses queued between the bytes of writeBuffer_
+    std::vector<SharedResponse> outShared_;   // Those of outBuffer_, kept alive until written
+    std::size_t writeSharedBytes_ = 0;
+    std::vector<asio::const_buffer> gather_;  // Buffers of the running write
+    std::deque<std::shared_ptr<DeferredResponse>> deferred_;
+    bool reading_ = false;
+    bool writing_ = false;
+    bool closeAfterWrite_ = false;
+    bool awaitDurable_ = false;               // Set by handle_request when its response must wait for the booking log
+    std::unique_ptr<BookingWork> forwarded_;  // Set by handle_request when its booking runs on other shards
+    bool forwarding_ = false;                 // A forwarded booking has not run yet, requests behind it wait
+    std::shared_ptr<ChangeWait> changeWait_;  // Set by handle_request when its response waits for seat changes
+    Metrics::Route requestRoute_ = Metrics::Route::Other; // Request being handled, copied into deferred responses
+    std::chrono::steady_clock::time_point requestStart_;
+    std::string idempotencyKey_; // Claimed by the request being handled, copied into deferred responses
+    asio::steady_timer readTimer_;
+    std::chrono::steady_clock::time_point readDeadline_;
+    ReadPhase readPhase_ = ReadPhase::Idle;
+    bool readTimerArmed_ = false; // A wait is pending until readTimer_.expiry()
+    ReservationSystem &reservationSystem_;
+    ResponseCache &responseCache_;
+    IdempotencyTable &idempotencyTable_;
+    AdmissionControl &admission_;
+    Logger &logger_;
+    Metrics &metrics_;
+    ShardGroup *shards_;
+    std::size_t shardIndex_;
+};
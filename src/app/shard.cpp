@@ -0,0 +1,180 @@
+#include <algorithm>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "shard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool pin_thread(std::thread &thread, unsigned cpu)
+{
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % cpus, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Shard Implementation
+///////////////////////////////////////////////////////////////////////////////
+
+Shard::Shard(std::size_t index)
+    : index_(index), context_(1), work_(asio::make_work_guard(context_))
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Shard::~Shard()
+{
+    stop();
+    join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t Shard::index() const
+{
+    return index_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+asio::io_context &Shard::context()
+{
+    return context_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Shard::execute(std::function<void()> task)
+{
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    inbox_.push(std::move(task));
+    // One wake-up per batch of tasks, producers after the first only enqueue
+    if (!scheduled_.exchange(true, std::memory_order_acq_rel))
+    {
+        asio::post(context_, [this]
+                   { drain(); });
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Shard::drain()
+{
+    // Clear the flag before looking, a task pushed after this exchange posts a new drain
+    scheduled_.exchange(false, std::memory_order_acq_rel);
+    std::function<void()> task;
+    while (inbox_.pop(task))
+    {
+        task();
+        executed_.store(executed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t Shard::pending() const
+{
+    // Executed first, so a racing task can only make the result too large, never wrap it
+    std::uint64_t executed = executed_.load(std::memory_order_relaxed);
+    return pushed_.load(std::memory_order_relaxed) - executed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Shard::start(int cpu)
+{
+    thread_ = std::thread([this]
+                          { context_.run(); });
+    if (cpu >= 0)
+    {
+        pin_thread(thread_, static_cast<unsigned>(cpu));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Shard::stop()
+{
+    work_.reset();
+    context_.stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Shard::join()
+{
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ShardGroup Implementation
+///////////////////////////////////////////////////////////////////////////////
+
+ShardGroup::ShardGroup(std::size_t count)
+{
+    for (std::size_t i = 0; i < std::max<std::size_t>(count, 1); ++i)
+    {
+        shards_.emplace_back(new Shard(i));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t ShardGroup::size() const
+{
+    return shards_.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Shard &ShardGroup::at(std::size_t index)
+{
+    return *shards_[index];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t ShardGroup::owner_of(long roomOrdinal) const
+{
+    return static_cast<std::size_t>(roomOrdinal) % shards_.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ShardGroup::start(bool pinThreads)
+{
+    for (auto &shard : shards_)
+    {
+        shard->start(pinThreads ? static_cast<int>(shard->index()) : -1);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ShardGroup::stop()
+{
+    for (auto &shard : shards_)
+    {
+        shard->stop();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ShardGroup::join()
+{
+    for (auto &shard : shards_)
+    {
+        shard->join();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <asio.hpp>
+
+#include "mpsc_queue.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Pins 'thread' to one CPU, wrapping around the available CPUs
+/// @return false if the affinity could not be set
+bool pin_thread(std::thread &thread, unsigned cpu);
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief One event loop of the sharded server.
+/// A shard runs its own io_context on a single thread, accepts its own connections and
+/// owns a subset of the rooms. Other shards hand it the bookings of its rooms through a
+/// lock-free inbox, so the seat state of a room is only ever touched by one core.
+class Shard
+{
+public:
+    explicit Shard(std::size_t index);
+    ~Shard();
+
+    Shard(const Shard &) = delete;
+    Shard &operator=(const Shard &) = delete;
+
+    std::size_t index() const;
+    asio::io_context &context();
+
+    /// @brief Runs 'task' on this shard's thread, callable from any thread
+    void execute(std::function<void()> task);
+
+    /// @brief Number of tasks handed to the shard that have not run yet
+    std::uint64_t pending() const;
+
+    /// @brief Starts the shard thread, pinned to 'cpu' unless it is negative
+    void start(int cpu);
+
+    /// @brief Stops the event loop, queued tasks are dropped
+    void stop();
+
+    /// @brief Waits for the shard thread to finish
+    void join();
+
+private:
+    /// @brief Runs every task in the inbox
+    void drain();
+
+    std::size_t index_;
+    asio::io_context context_;
+    asio::executor_work_guard<asio::io_context::executor_type> work_;
+    MpscQueue<std::function<void()>> inbox_;
+    std::atomic<bool> scheduled_{false}; // A drain is posted and has not started yet
+    std::atomic<std::uint64_t> pushed_{0};
+    std::atomic<std::uint64_t> executed_{0}; // Written by the shard thread only
+    std::thread thread_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief The shards of the server and the room to shard assignment
+class ShardGroup
+{
+public:
+    /// @brief Creates 'count' shards, at least one
+    explicit ShardGroup(std::size_t count);
+
+    std::size_t size() const;
+    Shard &at(std::size_t index);
+
+    /// @brief Shard owning the room with ordinal 'roomOrdinal', see ReservationSystem::getRoomOrdinal
+    std::size_t owner_of(long roomOrdinal) const;
+
+    /// @brief Starts every shard thread, shard N pinned to CPU N if 'pinThreads' is set
+    void start(bool pinThreads);
+
+    void stop();
+    void join();
+
+private:
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
@@ -0,0 +1,150 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "http_responses.h"
+#include "reservation_system.h"
+#include "seat_request_decoder.h"
+#include "synthetic_catalog.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Cost of building the json responses, from the catalog query to the HTTP bytes
+///////////////////////////////////////////////////////////////////////////////
+
+static void BM_BookingsResponse(benchmark::State &state)
+{
+    CatalogShape shape;
+    shape.seatsPerRoom = static_cast<int>(state.range(0));
+    std::unique_ptr<ReservationSystem> system = makeSyntheticSystem(shape);
+    const Showing showing = syntheticShowings(shape).front();
+    for (int seat = 0; seat < shape.seatsPerRoom; seat += 2)
+    {
+        system->bookSeats(showing.theater, showing.movie, {seat});
+    }
+
+    std::string out;
+    for (auto _ : state)
+    {
+        out.clear();
+        writeHttpOkResponse(out, system->getBookings(showing.theater, showing.movie), true);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_BookingsResponse)->RangeMultiplier(16)->Range(64, 16384);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void BM_BookingsSerialize(benchmark::State &state)
+{
+    CatalogShape shape;
+    shape.seatsPerRoom = static_cast<int>(state.range(0));
+    std::unique_ptr<ReservationSystem> system = makeSyntheticSystem(shape);
+    const Showing showing = syntheticShowings(shape).front();
+    const Json::Value bookings = system->getBookings(showing.theater, showing.movie);
+
+    // Only the Json::Value to text step, the part a hand written encoder would replace
+    Json::StreamWriterBuilder writer;
+    std::size_t bytes = 0;
+    for (auto _ : state)
+    {
+        std::string text = Json::writeString(writer, bookings);
+        bytes = text.size();
+        benchmark::DoNotOptimize(text.data());
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_BookingsSerialize)->RangeMultiplier(16)->Range(64, 16384);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void BM_BookingsWriteJson(benchmark::State &state)
+{
+    CatalogShape shape;
+    shape.seatsPerRoom = static_cast<int>(state.range(0));
+    std::unique_ptr<ReservationSystem> system = makeSyntheticSystem(shape);
+    const Showing showing = syntheticShowings(shape).front();
+    for (int seat = 0; seat < shape.seatsPerRoom; seat += 2)
+    {
+        system->bookSeats(showing.theater, showing.movie, {seat});
+    }
+
+    // The path /bookings takes on a cache miss: seat map snapshots encoded into a reused buffer
+    std::string out;
+    for (auto _ : state)
+    {
+        out.clear();
+        system->writeBookingsJson(out, showing.theater, showing.movie);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_BookingsWriteJson)->RangeMultiplier(16)->Range(64, 16384);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void BM_MoviesResponse(benchmark::State &state)
+{
+    CatalogShape shape;
+    shape.theaters = static_cast<int>(state.range(0));
+    shape.movies = shape.theaters * shape.roomsPerTheater / 2 + 1;
+    std::unique_ptr<ReservationSystem> system = makeSyntheticSystem(shape);
+
+    std::string out;
+    for (auto _ : state)
+    {
+        out.clear();
+        writeHttpOkResponse(out, system->getAllPlayingMoviesJson(), true);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_MoviesResponse)->RangeMultiplier(10)->Range(1, 1000);
+
+///////////////////////////////////////////////////////////////////////////////
+
+// A /seats request body with 'range' seats, decoded as a json document or by the fixed schema decoder
+static std::string seatsRequestBody(int seats)
+{
+    std::string body = R"({"movie": "Movie 17", "theater": "Theater 42", "seats": [)";
+    for (int seat = 0; seat < seats; ++seat)
+    {
+        body += (seat ? "," : "") + std::to_string(seat * 3);
+    }
+    return body + "]}";
+}
+
+static void BM_DecodeSeatsJsoncpp(benchmark::State &state)
+{
+    const std::string body = seatsRequestBody(static_cast<int>(state.range(0)));
+    std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+    for (auto _ : state)
+    {
+        Json::Value json;
+        reader->parse(body.data(), body.data() + body.size(), &json, nullptr);
+        std::vector<int> seats;
+        for (const auto &seatJson : json["seats"])
+        {
+            seats.push_back(seatJson.asInt());
+        }
+        benchmark::DoNotOptimize(seats.data());
+    }
+    state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_DecodeSeatsJsoncpp)->Arg(1)->Arg(8)->Arg(64);
+
+static void BM_DecodeSeatsFixedSchema(benchmark::State &state)
+{
+    const std::string body = seatsRequestBody(static_cast<int>(state.range(0)));
+    for (auto _ : state)
+    {
+        SeatRequestBody request;
+        SeatRequestDecoder(body).decode(request);
+        benchmark::DoNotOptimize(request.seats);
+    }
+    state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_DecodeSeatsFixedSchema)->Arg(1)->Arg(8)->Arg(64);
+
+///////////////////////////////////////////////////////////////////////////////
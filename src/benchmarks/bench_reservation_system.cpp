@@ -0,0 +1,178 @@
+#include <memory>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "reservation_system.h"
+#include "synthetic_catalog.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Reservation core benchmarks, single thread unless stated otherwise.
+// Catalog sizes are theaters of 4 rooms each, seat counts are per room.
+///////////////////////////////////////////////////////////////////////////////
+
+static CatalogShape shapeFor(benchmark::State &state)
+{
+    CatalogShape shape;
+    shape.theaters = static_cast<int>(state.range(0));
+    shape.movies = shape.theaters * shape.roomsPerTheater / 2 + 1;
+    shape.seatsPerRoom = static_cast<int>(state.range(1));
+    return shape;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void BM_BookSeats(benchmark::State &state)
+{
+    CatalogShape shape = shapeFor(state);
+    std::unique_ptr<ReservationSystem> system = makeSyntheticSystem(shape);
+    std::vector<Showing> showings = syntheticShowings(shape);
+
+    // One seat per call, walking every showing before moving to the next seat
+    std::vector<int> seats(1, 0);
+    std::size_t next = 0;
+    for (auto _ : state)
+    {
+        const Showing &showing = showings[next];
+        benchmark::DoNotOptimize(system->bookSeats(showing.theater, showing.movie, seats));
+        if (++next == showings.size())
+        {
+            next = 0;
+            if (++seats[0] == shape.seatsPerRoom)
+            {
+                // Every seat is booked, start over on an empty catalog
+                state.PauseTiming();
+                system = makeSyntheticSystem(shape);
+                seats[0] = 0;
+                state.ResumeTiming();
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BookSeats)->ArgsProduct({{1, 10, 100, 1000}, {64, 1024, 16384}});
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void BM_GetBookings(benchmark::State &state)
+{
+    CatalogShape shape = shapeFor(state);
+    std::unique_ptr<ReservationSystem> system = makeSyntheticSystem(shape);
+    std::vector<Showing> showings = syntheticShowings(shape);
+
+    // Every other seat booked, so the answer is not a run of zeros
+    const Showing &showing = showings.front();
+    for (int seat = 0; seat < shape.seatsPerRoom; seat += 2)
+    {
+        system->bookSeats(showing.theater, showing.movie, {seat});
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(system->getBookings(showing.theater, showing.movie));
+    }
+    state.SetItemsProcessed(state.iterations() * shape.seatsPerRoom);
+}
+BENCHMARK(BM_GetBookings)->ArgsProduct({{1, 1000}, {64, 1024, 16384}});
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void BM_GetAllPlayingMoviesJson(benchmark::State &state)
+{
+    CatalogShape shape = shapeFor(state);
+    std::unique_ptr<ReservationSystem> system = makeSyntheticSystem(shape);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(system->getAllPlayingMoviesJson());
+    }
+    state.counters["movies"] = shape.movies;
+}
+BENCHMARK(BM_GetAllPlayingMoviesJson)->ArgsProduct({{1, 10, 100, 1000}, {64}});
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void BM_IsSeatAvailable(benchmark::State &state)
+{
+    const int capacity = static_cast<int>(state.range(0));
+    Room room("Room", capacity);
+    std::vector<int> booked;
+    for (int seat = 0; seat < capacity; seat += 3)
+    {
+        booked.push_back(seat);
+    }
+    room.reserveSeats(booked);
+
+    int seat = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(room.isSeatAvailable(seat));
+        if (++seat == capacity)
+        {
+            seat = 0;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IsSeatAvailable)->RangeMultiplier(16)->Range(64, 1 << 16);
+
+///////////////////////////////////////////////////////////////////////////////
+// Contention: threads book one seat per call, either all in the same room,
+// where neighbouring seats share a word, or each in a room of its own.
+///////////////////////////////////////////////////////////////////////////////
+
+static const int MAX_BOOKING_THREADS = 8;
+static const int CONTENDED_SEATS = 1 << 24; // Large enough that runs rarely wrap onto booked seats
+static std::unique_ptr<ReservationSystem> contendedSystem;
+static std::vector<Showing> contendedShowings;
+
+/// @brief Builds the shared catalog before the benchmark threads start
+static void setUpContended(const benchmark::State &)
+{
+    CatalogShape shape;
+    shape.theaters = MAX_BOOKING_THREADS;
+    shape.roomsPerTheater = 1;
+    shape.movies = MAX_BOOKING_THREADS;
+    shape.seatsPerRoom = CONTENDED_SEATS;
+    shape.seatsPerRow = 1 << 12;
+    contendedSystem = makeSyntheticSystem(shape);
+    contendedShowings = syntheticShowings(shape);
+}
+
+static void tearDownContended(const benchmark::State &)
+{
+    contendedSystem.reset();
+}
+
+static void BM_BookSeatsContended(benchmark::State &state)
+{
+    const bool sameRoom = state.range(0) == 0;
+    const int threads = state.threads();
+    const int thread = state.thread_index();
+    const Showing &showing = contendedShowings[sameRoom ? 0 : thread];
+
+    // In the same room thread N takes seats N, N + threads, ... so they interleave within words
+    std::vector<int> seats(1, sameRoom ? thread : 0);
+    const int step = sameRoom ? threads : 1;
+    std::int64_t booked = 0;
+    for (auto _ : state)
+    {
+        booked += contendedSystem->bookSeats(showing.theater, showing.movie, seats);
+        seats[0] += step;
+        if (seats[0] >= CONTENDED_SEATS)
+        {
+            seats[0] = sameRoom ? thread : 0;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["booked"] = benchmark::Counter(static_cast<double>(booked), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_BookSeatsContended)
+    ->ArgName("disjoint")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, MAX_BOOKING_THREADS)
+    ->Setup(setUpContended)
+    ->Teardown(tearDownContended)
+    ->UseRealTime();
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,68 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "synthetic_catalog.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Writes a synthetic catalog for the server, the load generator or the benchmarks.
+/// @param argc
+/// @param argv output path, then optional '--theaters <n>', '--rooms <n>' (per theater),
+/// '--movies <n>', '--seats <n>' (per room) and '--columns <n>' (seats per row)
+/// @return
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <output> [--theaters <n>] [--rooms <n>] [--movies <n>] [--seats <n>] [--columns <n>]" << std::endl;
+        return 1;
+    }
+
+    CatalogShape shape;
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        int value = std::atoi(argv[i + 1]);
+        if (value <= 0)
+        {
+            std::cerr << "Error: " << option << " needs a positive number" << std::endl;
+            return 1;
+        }
+        if (option == "--theaters")
+        {
+            shape.theaters = value;
+        }
+        else if (option == "--rooms")
+        {
+            shape.roomsPerTheater = value;
+        }
+        else if (option == "--movies")
+        {
+            shape.movies = value;
+        }
+        else if (option == "--seats")
+        {
+            shape.seatsPerRoom = value;
+        }
+        else if (option == "--columns")
+        {
+            shape.seatsPerRow = value;
+        }
+        else
+        {
+            std::cerr << "Error: unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (!writeSyntheticCatalog(shape, argv[1]))
+    {
+        std::cerr << "Error: cannot write " << argv[1] << std::endl;
+        return 2;
+    }
+    std::cout << "Wrote " << shape.theaters << " theaters, " << shape.theaters * shape.roomsPerTheater << " rooms, "
+              << shape.movies << " movies to " << argv[1] << std::endl;
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
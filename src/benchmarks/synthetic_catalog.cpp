@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "synthetic_catalog.h"
+#include "reservation_system.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+static std::string movieTitle(const CatalogShape &shape, int theater, int room)
+{
+    return "Movie " + std::to_string((theater * shape.roomsPerTheater + room) % shape.movies);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Json::Value makeSyntheticCatalog(const CatalogShape &shape)
+{
+    Json::Value root;
+    Json::Value &theaters = root["theaters"] = Json::Value(Json::arrayValue);
+    for (int t = 0; t < shape.theaters; ++t)
+    {
+        Json::Value theater;
+        theater["name"] = "Theater " + std::to_string(t);
+        Json::Value &rooms = theater["rooms"] = Json::Value(Json::arrayValue);
+        for (int r = 0; r < shape.roomsPerTheater; ++r)
+        {
+            Json::Value room;
+            room["name"] = "Room " + std::to_string(r);
+            room["capacity"] = shape.seatsPerRoom;
+            room["columns"] = shape.seatsPerRow;
+            room["movie"]["title"] = movieTitle(shape, t, r);
+            rooms.append(room);
+        }
+        theaters.append(theater);
+    }
+    return root;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool writeSyntheticCatalog(const CatalogShape &shape, const std::string &path)
+{
+    std::ofstream out(path);
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    out << Json::writeString(writer, makeSyntheticCatalog(shape));
+    return static_cast<bool>(out);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<ReservationSystem> makeSyntheticSystem(const CatalogShape &shape)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                 ("synthetic_catalog_" + std::to_string(::getpid()) + ".json");
+    if (!writeSyntheticCatalog(shape, path.string()))
+    {
+        throw std::runtime_error("Cannot write synthetic catalog " + path.string());
+    }
+    std::unique_ptr<ReservationSystem> system(new ReservationSystem(path.string()));
+    std::remove(path.c_str());
+    return system;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<Showing> syntheticShowings(const CatalogShape &shape)
+{
+    std::vector<Showing> showings;
+    for (int t = 0; t < shape.theaters; ++t)
+    {
+        std::set<std::string> seen;
+        for (int r = 0; r < shape.roomsPerTheater; ++r)
+        {
+            std::string movie = movieTitle(shape, t, r);
+            if (seen.insert(movie).second)
+            {
+                showings.push_back(Showing{"Theater " + std::to_string(t), movie});
+            }
+        }
+    }
+    return showings;
+}
+
+///////////////////////////////////////////////////////////////////////////////
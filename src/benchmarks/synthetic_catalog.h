@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+class ReservationSystem;
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Shape of a generated catalog
+struct CatalogShape
+{
+    int theaters = 10;
+    int roomsPerTheater = 4;
+    int movies = 20;
+    int seatsPerRoom = 200;
+    int seatsPerRow = 20;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief A movie shown in a theater, what the booking calls are keyed by
+struct Showing
+{
+    std::string theater;
+    std::string movie;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Builds a catalog in the server's json format.
+/// Theaters, rooms and movies are named "Theater N", "Room N" and "Movie N". Room r of
+/// theater t plays movie (t * roomsPerTheater + r) % movies, so every movie shows in
+/// several theaters and a theater may show a movie in more than one room.
+Json::Value makeSyntheticCatalog(const CatalogShape &shape);
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Writes makeSyntheticCatalog(shape) to 'path'
+/// @return false if the file cannot be written
+bool writeSyntheticCatalog(const CatalogShape &shape, const std::string &path);
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Loads a ReservationSystem from a generated catalog, going through a temporary file
+std::unique_ptr<ReservationSystem> makeSyntheticSystem(const CatalogShape &shape);
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @return every distinct theater and movie pair of the generated catalog, in catalog order
+std::vector<Showing> syntheticShowings(const CatalogShape &shape);
@@ -0,0 +1,83 @@
+#include "admission_control.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+AdmissionControl::AdmissionControl(const Limits &limits, std::size_t loopCount)
+    : limits(limits), loopLags(new LoopLag[loopCount > 0 ? loopCount : 1]), loopCount(loopCount > 0 ? loopCount : 1)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const AdmissionControl::Limits &AdmissionControl::getLimits() const
+{
+    return limits;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool AdmissionControl::openConnection()
+{
+    if (connections.fetch_add(1, std::memory_order_relaxed) >= limits.maxConnections)
+    {
+        connections.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AdmissionControl::closeConnection()
+{
+    connections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool AdmissionControl::admitRequest(std::size_t loop) const
+{
+    if (inFlight.load(std::memory_order_relaxed) >= limits.maxInFlight)
+    {
+        return false;
+    }
+    auto lag = std::chrono::nanoseconds(loopLags[loop % loopCount].nanos.load(std::memory_order_relaxed));
+    return lag <= limits.maxLoopLag;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AdmissionControl::startRequest()
+{
+    inFlight.fetch_add(1, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AdmissionControl::finishRequest()
+{
+    inFlight.fetch_sub(1, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AdmissionControl::recordLoopLag(std::size_t loop, std::chrono::nanoseconds lag)
+{
+    loopLags[loop % loopCount].nanos.store(lag.count(), std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t AdmissionControl::getConnectionCount() const
+{
+    return connections.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t AdmissionControl::getInFlightCount() const
+{
+    return inFlight.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
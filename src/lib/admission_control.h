@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Load limits of the HTTP server, shared by all of its event loops.
+///
+/// Counts open connections and requests whose response waits on work queued elsewhere
+/// (the booking log, another shard), and keeps the latest lag of every event loop. A new
+/// connection past the connection cap, or a request while in-flight requests or its loop's
+/// lag are past their threshold, is turned away right away with 503 and Retry-After, so
+/// the requests already admitted keep their latency. The read deadlines and the body size
+/// limit are applied by each session. All counters are relaxed atomics, nothing locks.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class AdmissionControl
+{
+public:
+    struct Limits
+    {
+        std::size_t maxConnections = 10000;
+        std::size_t maxInFlight = 4096;                  // Requests waiting on the booking log or other shards
+        std::chrono::milliseconds maxLoopLag{250};       // Requests are shed while their event loop is this late
+        std::chrono::seconds retryAfter{1};              // Sent with every 503
+        std::chrono::milliseconds headerTimeout{10000};  // From the first byte of a request to the end of its header
+        std::chrono::milliseconds bodyTimeout{30000};    // From the end of the header to the end of the body
+        std::chrono::milliseconds idleTimeout{60000};    // Between requests of a keep-alive connection
+        std::size_t maxBodySize = 1 << 20;
+    };
+
+    /// @param loopCount number of event loops reporting their lag
+    explicit AdmissionControl(const Limits &limits, std::size_t loopCount = 1);
+
+    const Limits &getLimits() const;
+
+    /// @brief Counts a new connection
+    /// @return false if it is over the cap, it was not counted and must be turned away
+    bool openConnection();
+
+    /// @brief Uncounts a connection openConnection let in
+    void closeConnection();
+
+    /// @return whether a request on event loop 'loop' may run, false while the server is overloaded
+    bool admitRequest(std::size_t loop) const;
+
+    /// @brief Counts a request whose response waits on queued work, until finishRequest
+    void startRequest();
+
+    void finishRequest();
+
+    /// @brief Records how late event loop 'loop' ran a handler that was due
+    void recordLoopLag(std::size_t loop, std::chrono::nanoseconds lag);
+
+    std::size_t getConnectionCount() const;
+
+    std::size_t getInFlightCount() const;
+
+private:
+    /// @brief Lag of one event loop, on its own cache line
+    struct alignas(64) LoopLag
+    {
+        std::atomic<std::int64_t> nanos{0};
+    };
+
+    Limits limits;
+    std::atomic<std::size_t> connections{0};
+    alignas(64) std::atomic<std::size_t> inFlight{0};
+    std::unique_ptr<LoopLag[]> loopLags;
+    std::size_t loopCount;
+};
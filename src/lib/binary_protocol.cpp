@@ -0,0 +1,185 @@
+#include "binary_protocol.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /// @brief Reads a little-endian unsigned integer of sizeof(T) bytes
+    template <typename T>
+    T readLittleEndian(const char *data)
+    {
+        T value = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+        {
+            value |= static_cast<T>(static_cast<unsigned char>(data[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    /// @brief Appends a little-endian unsigned integer of sizeof(T) bytes
+    template <typename T>
+    void writeLittleEndian(std::string &out, T value)
+    {
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+        {
+            out += static_cast<char>((value >> (8 * i)) & 0xff);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+BinaryProtocol::Result BinaryProtocol::parseRequest(const char *data, std::size_t size, Request &request)
+{
+    if (size < LENGTH_SIZE)
+    {
+        return Result::Incomplete;
+    }
+    std::uint32_t length = readLittleEndian<std::uint32_t>(data);
+    if (length < HEADER_SIZE || length > MAX_FRAME_SIZE)
+    {
+        return Result::Invalid;
+    }
+    if (size - LENGTH_SIZE < length)
+    {
+        return Result::Incomplete;
+    }
+    request.requestId = readLittleEndian<std::uint32_t>(data + LENGTH_SIZE);
+    request.operation = static_cast<Operation>(data[LENGTH_SIZE + 4]);
+    request.payload = std::string_view(data + LENGTH_SIZE + HEADER_SIZE, length - HEADER_SIZE);
+    request.size = LENGTH_SIZE + length;
+    return Result::Complete;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryProtocol::writeRequest(std::string &out, std::uint32_t requestId, Operation operation, std::string_view payload)
+{
+    writeU32(out, static_cast<std::uint32_t>(HEADER_SIZE + payload.size()));
+    writeU32(out, requestId);
+    out += static_cast<char>(operation);
+    out += payload;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t BinaryProtocol::beginResponse(std::string &out, std::uint32_t requestId, Status status)
+{
+    std::size_t frame = out.size();
+    writeU32(out, 0); // Length, see finishResponse
+    writeU32(out, requestId);
+    out += static_cast<char>(status);
+    return frame;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryProtocol::finishResponse(std::string &out, std::size_t frame)
+{
+    std::uint32_t length = static_cast<std::uint32_t>(out.size() - frame - LENGTH_SIZE);
+    for (std::size_t i = 0; i < LENGTH_SIZE; ++i)
+    {
+        out[frame + i] = static_cast<char>((length >> (8 * i)) & 0xff);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryProtocol::writeU16(std::string &out, std::uint16_t value)
+{
+    writeLittleEndian(out, value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryProtocol::writeU32(std::string &out, std::uint32_t value)
+{
+    writeLittleEndian(out, value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryProtocol::writeU64(std::string &out, std::uint64_t value)
+{
+    writeLittleEndian(out, value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryProtocol::writeString(std::string &out, std::string_view value)
+{
+    value = value.substr(0, 0xffff);
+    writeU16(out, static_cast<std::uint16_t>(value.size()));
+    out += value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryProtocol::writeBitmap(std::string &out, const std::uint64_t *words, std::uint32_t bits)
+{
+    std::size_t wordCount = (static_cast<std::size_t>(bits) + 63) / 64;
+    for (std::size_t w = 0; w < wordCount; ++w)
+    {
+        std::uint64_t word = words[w];
+        if (w + 1 == wordCount && bits % 64 != 0)
+        {
+            word &= (std::uint64_t(1) << (bits % 64)) - 1; // Padding bits go out clear
+        }
+        writeU64(out, word);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool BinaryProtocol::Reader::readU32(std::uint32_t &value)
+{
+    if (data.size() - pos < 4)
+    {
+        return false;
+    }
+    value = readLittleEndian<std::uint32_t>(data.data() + pos);
+    pos += 4;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool BinaryProtocol::Reader::readU64(std::uint64_t &value)
+{
+    if (data.size() - pos < 8)
+    {
+        return false;
+    }
+    value = readLittleEndian<std::uint64_t>(data.data() + pos);
+    pos += 8;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool BinaryProtocol::Reader::readBitmap(std::uint32_t bits, std::vector<int> &seats)
+{
+    std::size_t wordCount = (static_cast<std::size_t>(bits) + 63) / 64;
+    if ((data.size() - pos) / 8 < wordCount)
+    {
+        return false;
+    }
+    seats.clear();
+    for (std::size_t w = 0; w < wordCount; ++w)
+    {
+        std::uint64_t word = 0;
+        readU64(word);
+        if (w + 1 == wordCount && bits % 64 != 0)
+        {
+            word &= (std::uint64_t(1) << (bits % 64)) - 1;
+        }
+        while (word != 0)
+        {
+            seats.push_back(static_cast<int>(w * 64 + static_cast<std::size_t>(__builtin_ctzll(word))));
+            word &= word - 1;
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
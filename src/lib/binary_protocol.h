@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Length-prefixed binary protocol for internal clients.
+///
+/// Every frame is a little-endian u32 length followed by that many bytes:
+///
+///     request:  u32 length | u32 requestId | u8 operation | payload
+///     response: u32 length | u32 requestId | u8 status    | payload
+///
+/// Responses carry the id of their request and may come back in any order, so a client
+/// can keep many requests in flight on one connection. Theaters, movies and rooms are
+/// named by number: their position in the Catalog response. A room number is the room's
+/// ordinal over all theaters and a showtime is its ShowtimeId, 0xffffffff for none.
+/// Numbers stay valid until the catalog version of the Catalog response changes, so requests
+/// using them carry that version and get StaleCatalog once it is no longer the current one.
+///
+///     Catalog    ()                                     -> u64 catalogVersion,
+///                                                          u32 n, n x string theater,
+///                                                          u32 n, n x string movie,
+///                                                          u32 n, n x (u32 theater, u32 movie, u32 capacity, u32 seatsPerRow, string name),
+///                                                          u32 n, n x (u32 room, u32 movie, i64 start)
+///     Occupancy  (u64 catalogVersion, u32 room, u32 showtime) -> u64 version, u32 capacity, bitmap
+///     Book       (u64 catalogVersion, u32 room, u32 showtime, u32 bits, bitmap) -> ()
+///
+/// A string is a u16 length and its bytes. A bitmap of 'bits' bits is ceil(bits / 64) u64
+/// words, bit i of word w standing for seat 64 * w + i. In Occupancy a set bit is a
+/// booked seat, in Book a seat to book; a Book either books every seat or none.
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct BinaryProtocol
+{
+    enum class Operation : std::uint8_t
+    {
+        Catalog = 1,
+        Occupancy = 2,
+        Book = 3
+    };
+
+    enum class Status : std::uint8_t
+    {
+        Ok = 0,
+        Conflict = 1,  // A seat to book is not available
+        NotFound = 2,  // No such room, or the showtime is not one of the room
+        BadRequest = 3,
+        UnknownOperation = 4,
+        ReadOnly = 5,    // A Book sent to a read replica
+        StaleCatalog = 6, // The catalog version is not the current one, fetch the Catalog again
+        NotSynced = 7     // An Occupancy sent to a read replica that has no copy of the bookings yet
+    };
+
+    /// @brief One request frame, 'payload' points into the caller's buffer
+    struct Request
+    {
+        std::uint32_t requestId = 0;
+        Operation operation = Operation::Catalog;
+        std::string_view payload;
+        std::size_t size = 0; // Bytes taken by the frame, prefix included
+    };
+
+    /// @brief Outcome of parseRequest
+    enum class Result
+    {
+        Complete,   // 'request' holds a full frame of request.size bytes
+        Incomplete, // More bytes are needed
+        Invalid     // The frame is too short or too long, the connection should be closed
+    };
+
+    static constexpr std::size_t LENGTH_SIZE = 4;
+    static constexpr std::size_t HEADER_SIZE = 5;           // Request id and operation or status
+    static constexpr std::size_t MAX_FRAME_SIZE = 1 << 20;  // Larger frames are invalid
+    static constexpr std::uint32_t MAX_BITS = 1 << 20;      // Largest seat bitmap of a Book request
+
+    /// @brief Parses the request frame at the start of 'data', never allocates
+    static Result parseRequest(const char *data, std::size_t size, Request &request);
+
+    /// @brief Appends a request frame, for clients and tests
+    static void writeRequest(std::string &out, std::uint32_t requestId, Operation operation, std::string_view payload);
+
+    /// @brief Starts a response frame in 'out', the payload is appended after it
+    /// @return the offset of the frame for finishResponse
+    static std::size_t beginResponse(std::string &out, std::uint32_t requestId, Status status);
+
+    /// @brief Fills in the length of the response frame started at 'frame'
+    static void finishResponse(std::string &out, std::size_t frame);
+
+    static void writeU16(std::string &out, std::uint16_t value);
+    static void writeU32(std::string &out, std::uint32_t value);
+    static void writeU64(std::string &out, std::uint64_t value);
+
+    /// @brief Appends a u16 length and the bytes, cut at 65535 bytes
+    static void writeString(std::string &out, std::string_view value);
+
+    /// @brief Appends the first 'bits' bits of 'words' as a bitmap
+    static void writeBitmap(std::string &out, const std::uint64_t *words, std::uint32_t bits);
+
+    /// @brief Reads little-endian fields off the front of a payload, each returns false when it runs short
+    class Reader
+    {
+    public:
+        explicit Reader(std::string_view data) : data(data) {}
+
+        bool readU32(std::uint32_t &value);
+        bool readU64(std::uint64_t &value);
+
+        /// @brief Reads a bitmap of 'bits' bits as the numbers of its set bits
+        bool readBitmap(std::uint32_t bits, std::vector<int> &seats);
+
+        /// @brief Whether every byte was read
+        bool atEnd() const { return pos == data.size(); }
+
+    private:
+        std::string_view data;
+        std::size_t pos = 0;
+    };
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Counting and scanning kernels over plain 64-bit seat words.
+/// They run on a snapshot of a SeatMap so large rooms are read in a few wide passes.
+/// The AVX2 paths are used when the build targets it (see RESERVATION_NATIVE_ARCH),
+/// otherwise the scalar loops compile to popcnt/tzcnt.
+///////////////////////////////////////////////////////////////////////////////////////
+
+namespace bitmap
+{
+    /// @brief Number of set bits in 'count' words
+    inline std::size_t popcount(const std::uint64_t *words, std::size_t count)
+    {
+        std::size_t total = 0;
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        // Nibble lookup popcount (Mula), 4 words per iteration
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i lowMask = _mm256_set1_epi8(0x0f);
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+            __m256i lo = _mm256_and_si256(v, lowMask);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+            __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+        }
+        total += static_cast<std::size_t>(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+                                          _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3));
+#endif
+        for (; i < count; ++i)
+        {
+            total += static_cast<std::size_t>(__builtin_popcountll(words[i]));
+        }
+        return total;
+    }
+
+    /// @brief Position of the first bit equal to 'value' at or after 'from', below 'bits'.
+    /// @return the bit position, or -1 if there is none in range
+    inline long findFirst(const std::uint64_t *words, std::size_t bits, std::size_t from, bool value)
+    {
+        if (from >= bits)
+        {
+            return -1;
+        }
+        std::size_t count = (bits + 63) / 64;
+        std::size_t i = from / 64;
+        // Searching for clear bits is searching for set bits of the inverted word
+        const std::uint64_t flip = value ? 0 : ~std::uint64_t(0);
+
+        // Bits below 'from' in the first word never match
+        std::uint64_t match = (words[i] ^ flip) & (~std::uint64_t(0) << (from % 64));
+        while (!match)
+        {
+            ++i;
+#if defined(__AVX2__)
+            // Skip words without a match 4 at a time
+            const __m256i none = _mm256_set1_epi64x(static_cast<long long>(flip));
+            while (i + 4 <= count)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+                if (_mm256_movemask_epi8(_mm256_cmpeq_epi64(v, none)) != -1)
+                {
+                    break;
+                }
+                i += 4;
+            }
+#endif
+            if (i >= count)
+            {
+                return -1;
+            }
+            match = words[i] ^ flip;
+        }
+        std::size_t position = i * 64 + static_cast<std::size_t>(__builtin_ctzll(match));
+        return position < bits ? static_cast<long>(position) : -1;
+    }
+
+    /// @brief Position of the first clear bit at or after 'from', or -1
+    inline long findFirstClear(const std::uint64_t *words, std::size_t bits, std::size_t from)
+    {
+        return findFirst(words, bits, from, false);
+    }
+
+    /// @brief Position of the first set bit at or after 'from', or -1
+    inline long findFirstSet(const std::uint64_t *words, std::size_t bits, std::size_t from)
+    {
+        return findFirst(words, bits, from, true);
+    }
+}
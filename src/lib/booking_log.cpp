@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "booking_log.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    const char CHECKPOINT_MAGIC[4] = {'R', 'S', 'C', 'K'};
+    const std::uint32_t CHECKPOINT_FORMAT = 1;
+    const std::size_t CHECKPOINT_HEADER_SIZE = 16; // magic, format, first segment
+    const std::size_t FRAME_HEADER_SIZE = 8;       // payload length, checksum
+
+    void putU16(std::string &out, std::uint32_t value)
+    {
+        out += static_cast<char>(value & 0xff);
+        out += static_cast<char>((value >> 8) & 0xff);
+    }
+
+    void putU32(std::string &out, std::uint32_t value)
+    {
+        putU16(out, value & 0xffff);
+        putU16(out, value >> 16);
+    }
+
+    void putU64(std::string &out, std::uint64_t value)
+    {
+        putU32(out, static_cast<std::uint32_t>(value));
+        putU32(out, static_cast<std::uint32_t>(value >> 32));
+    }
+
+    std::uint32_t getU16(const char *data)
+    {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+        return bytes[0] | (std::uint32_t(bytes[1]) << 8);
+    }
+
+    std::uint32_t getU32(const char *data)
+    {
+        return getU16(data) | (getU16(data + 2) << 16);
+    }
+
+    std::uint64_t getU64(const char *data)
+    {
+        return getU32(data) | (std::uint64_t(getU32(data + 4)) << 32);
+    }
+
+    /// @brief FNV-1a, enough to spot torn or damaged records at the tail of a segment
+    std::uint32_t checksum(const char *data, std::size_t size)
+    {
+        std::uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    bool readFile(const std::string &filename, std::string &data)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    /// @brief Makes a created, renamed or deleted directory entry durable
+    void syncDirectory(const std::string &filename)
+    {
+        std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+        int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+
+    /// @brief First segment not covered by the checkpoint of 'path', 1 without a valid checkpoint
+    std::uint64_t checkpointFirstSegment(const std::string &checkpointFile, std::string *data = nullptr)
+    {
+        std::string contents;
+        if (!readFile(checkpointFile, contents) || contents.size() < CHECKPOINT_HEADER_SIZE ||
+            std::memcmp(contents.data(), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+            getU32(contents.data() + 4) != CHECKPOINT_FORMAT)
+        {
+            return 1;
+        }
+        if (data)
+        {
+            data->swap(contents);
+        }
+        return getU64((data ? data->data() : contents.data()) + 8);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+BookingLog::BookingLog(const std::string &path, SnapshotFunction snapshot, std::size_t checkpointBytes)
+    : path(path), snapshot(std::move(snapshot)), checkpointBytes(checkpointBytes)
+{
+    // Always start a fresh segment, the tail of the last one may be torn
+    std::vector<std::uint64_t> segments = listSegments(path);
+    std::uint64_t next = segments.empty() ? 1 : segments.back() + 1;
+    openSegment(std::max(next, checkpointFirstSegment(checkpointPath(path))));
+
+    writer = std::thread([this] { writerLoop(); });
+    checkpointer = std::thread([this] { checkpointLoop(); });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+BookingLog::~BookingLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWriter.notify_one();
+    writer.join();
+    wakeCheckpoint.notify_one();
+    checkpointer.join();
+    ::close(fd);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t BookingLog::recover(const std::string &path, const RecordVisitor &apply)
+{
+    std::size_t applied = 0;
+    std::string data;
+    std::uint64_t firstSegment = checkpointFirstSegment(checkpointPath(path), &data);
+    if (!data.empty())
+    {
+        applied += decodeAll(data, CHECKPOINT_HEADER_SIZE, apply);
+    }
+
+    for (std::uint64_t number : listSegments(path))
+    {
+        if (number >= firstSegment && readFile(segmentPath(path, number), data))
+        {
+            applied += decodeAll(data, 0, apply);
+        }
+    }
+    return applied;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BookingLog::append(const std::string &theater, const std::string &room, const std::vector<int> &seats, std::int64_t showtimeStart)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        encode(pending, theater, room, seats, showtimeStart);
+    }
+    wakeWriter.notify_one();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BookingLog::whenDurable(std::function<void()> callback)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingCallbacks.push_back(std::move(callback));
+    }
+    wakeWriter.notify_one();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BookingLog::requestCheckpoint()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        checkpointRequested = true;
+    }
+    wakeWriter.notify_one();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BookingLog::writerLoop()
+{
+    std::string batch;
+    std::vector<std::function<void()>> callbacks;
+    for (;;)
+    {
+        bool rotate = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWriter.wait(lock, [this]
+                            { return stopping || !pending.empty() || !pendingCallbacks.empty() ||
+                                     (checkpointRequested && !checkpointRunning); });
+            if (stopping && pending.empty() && pendingCallbacks.empty())
+            {
+                break;
+            }
+            // Take everything queued so far, appenders keep filling a fresh buffer meanwhile
+            batch.swap(pending);
+            callbacks.swap(pendingCallbacks);
+            rotate = checkpointRequested && !checkpointRunning;
+        }
+
+        if (!batch.empty())
+        {
+            writeDurably(fd, batch.data(), batch.size(), segmentPath(path, segment));
+            segmentBytes += batch.size();
+            batch.clear();
+        }
+        for (auto &callback : callbacks)
+        {
+            callback();
+        }
+        callbacks.clear();
+
+        if (!rotate && segmentBytes >= checkpointBytes)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            rotate = !checkpointRunning;
+        }
+        if (rotate)
+        {
+            // Every record of the closed segment is already applied in memory,
+            // so a snapshot taken from now on covers it
+            std::uint64_t closed = segment;
+            openSegment(segment + 1);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                checkpointRequested = false;
+                checkpointRunning = true;
+                closedSegment = closed;
+            }
+            wakeCheckpoint.notify_one();
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BookingLog::checkpointLoop()
+{
+    for (;;)
+    {
+        std::uint64_t upTo = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCheckpoint.wait(lock, [this]
+                                { return stopping || checkpointRunning; });
+            if (!checkpointRunning)
+            {
+                break;
+            }
+            upTo = closedSegment;
+        }
+
+        std::string data(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        putU32(data, CHECKPOINT_FORMAT);
+        putU64(data, upTo + 1);
+        snapshot([&data](const Record &record)
+                 { encode(data, record.theater, record.room, record.seats, record.showtimeStart); });
+
+        // Write aside and rename, a crash leaves either the old or the new checkpoint
+        std::string finalPath = checkpointPath(path);
+        std::string tempPath = finalPath + ".tmp";
+        int tempFd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (tempFd < 0)
+        {
+            std::cerr << "BookingLog: cannot create " << tempPath << ": " << std::strerror(errno) << std::endl;
+        }
+        else
+        {
+            writeDurably(tempFd, data.data(), data.size(), tempPath);
+            ::close(tempFd);
+            if (std::rename(tempPath.c_str(), finalPath.c_str()) == 0)
+            {
+                syncDirectory(finalPath);
+                for (std::uint64_t number : listSegments(path))
+                {
+                    if (number <= upTo)
+                    {
+                        std::remove(segmentPath(path, number).c_str());
+                    }
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            checkpointRunning = false;
+        }
+        wakeWriter.notify_one();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BookingLog::openSegment(std::uint64_t number)
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+    std::string filename = segmentPath(path, number);
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "BookingLog: cannot open " << filename << ": " << std::strerror(errno) << std::endl;
+        std::abort();
+    }
+    syncDirectory(filename);
+    segment = number;
+    segmentBytes = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BookingLog::writeDurably(int fd, const char *data, std::size_t count, const std::string &what)
+{
+    while (count > 0)
+    {
+        ssize_t written = ::write(fd, data, count);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            break;
+        }
+        data += written;
+        count -= static_cast<std::size_t>(written);
+    }
+    if (count > 0 || ::fdatasync(fd) != 0)
+    {
+        // Bookings are already visible in memory and can no longer be made durable
+        std::cerr << "BookingLog: cannot write " << what << ": " << std::strerror(errno) << std::endl;
+        std::abort();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BookingLog::encode(std::string &out, const std::string &theater, const std::string &room, const std::vector<int> &seats,
+                        std::int64_t showtimeStart)
+{
+    std::size_t frameStart = out.size();
+    out.append(FRAME_HEADER_SIZE, '\0'); // Filled in once the payload is known
+
+    putU16(out, static_cast<std::uint32_t>(theater.size()));
+    out += theater;
+    putU16(out, static_cast<std::uint32_t>(room.size()));
+    out += room;
+    putU32(out, static_cast<std::uint32_t>(seats.size()));
+    for (int seat : seats)
+    {
+        putU32(out, static_cast<std::uint32_t>(seat));
+    }
+    if (showtimeStart != Record::NO_START)
+    {
+        putU64(out, static_cast<std::uint64_t>(showtimeStart));
+    }
+
+    std::size_t payloadSize = out.size() - frameStart - FRAME_HEADER_SIZE;
+    std::string header;
+    putU32(header, static_cast<std::uint32_t>(payloadSize));
+    putU32(header, checksum(out.data() + frameStart + FRAME_HEADER_SIZE, payloadSize));
+    out.replace(frameStart, FRAME_HEADER_SIZE, header);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t BookingLog::decodeAll(const std::string &data, std::size_t offset, const RecordVisitor &apply)
+{
+    std::size_t decoded = 0;
+    Record record;
+    std::size_t frameSize = 0;
+    // Stops at a torn write at the tail, nothing after it was acknowledged
+    while (offset < data.size() && decodeRecord(data.data() + offset, data.size() - offset, record, frameSize))
+    {
+        apply(record);
+        ++decoded;
+        offset += frameSize;
+    }
+    return decoded;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BookingLog::encodeRecord(std::string &out, const Record &record)
+{
+    encode(out, record.theater, record.room, record.seats, record.showtimeStart);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool BookingLog::decodeRecord(const char *data, std::size_t size, Record &record, std::size_t &frameSize)
+{
+    if (size < FRAME_HEADER_SIZE)
+    {
+        return false;
+    }
+    std::size_t payloadSize = getU32(data);
+    const char *payload = data + FRAME_HEADER_SIZE;
+    if (payloadSize > size - FRAME_HEADER_SIZE || checksum(payload, payloadSize) != getU32(data + 4))
+    {
+        return false;
+    }
+
+    std::size_t pos = 0;
+    auto readString = [&](std::string &value)
+    {
+        if (pos + 2 > payloadSize)
+        {
+            return false;
+        }
+        std::size_t length = getU16(payload + pos);
+        pos += 2;
+        if (pos + length > payloadSize)
+        {
+            return false;
+        }
+        value.assign(payload + pos, length);
+        pos += length;
+        return true;
+    };
+    if (!readString(record.theater) || !readString(record.room) || pos + 4 > payloadSize)
+    {
+        return false;
+    }
+    std::size_t seatCount = getU32(payload + pos);
+    pos += 4;
+    if (seatCount > (payloadSize - pos) / 4)
+    {
+        return false;
+    }
+    record.seats.resize(seatCount);
+    for (std::size_t i = 0; i < seatCount; ++i, pos += 4)
+    {
+        record.seats[i] = static_cast<int>(getU32(payload + pos));
+    }
+    record.showtimeStart = Record::NO_START;
+    if (pos + 8 <= payloadSize)
+    {
+        record.showtimeStart = static_cast<std::int64_t>(getU64(payload + pos));
+    }
+    frameSize = FRAME_HEADER_SIZE + payloadSize;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::uint64_t> BookingLog::listSegments(const std::string &path)
+{
+    std::vector<std::uint64_t> segments;
+    std::filesystem::path prefix(path);
+    std::filesystem::path directory = prefix.parent_path().empty() ? std::filesystem::path(".") : prefix.parent_path();
+    std::string stem = prefix.filename().string() + ".";
+
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        std::string name = it->path().filename().string();
+        if (name.size() != stem.size() + 8 || name.compare(0, stem.size(), stem) != 0)
+        {
+            continue;
+        }
+        std::string digits = name.substr(stem.size());
+        if (std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; }))
+        {
+            segments.push_back(std::stoull(digits));
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string BookingLog::segmentPath(const std::string &path, std::uint64_t number)
+{
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), ".%08llu", static_cast<unsigned long long>(number));
+    return path + suffix;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string BookingLog::checkpointPath(const std::string &path)
+{
+    return path + ".checkpoint";
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Write-ahead log of successful bookings.
+///
+/// Every booking is appended as a small binary record. A writer thread group-commits:
+/// it writes everything appended since its last pass and covers it with a single
+/// fdatasync, then runs the callbacks waiting for that data to be durable.
+///
+/// The log is split in numbered segments ('path'.00000001, ...). Once a segment grows past
+/// the checkpoint size the writer moves on to a new one, and a checkpoint thread writes the
+/// whole seat state to 'path'.checkpoint and deletes the segments it covers, so recovery
+/// replays at most one checkpoint and a few segments.
+///
+/// Records name the theater and room so a log survives catalog reordering. Showtime bookings
+/// also carry the showtime start after the seats, which older readers skip.
+/// Replaying a record books its seats if they are free, so applying one twice is harmless.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class BookingLog
+{
+public:
+    /// @brief Booked seats of one room or showtime, as stored in the log and in checkpoints
+    struct Record
+    {
+        static constexpr std::int64_t NO_START = INT64_MIN;
+
+        std::string theater;
+        std::string room;
+        std::vector<int> seats;
+        std::int64_t showtimeStart = NO_START; // Start of the showtime booked in the room, NO_START for the room's own seats
+    };
+
+    using RecordVisitor = std::function<void(const Record &)>;
+
+    /// @brief Produces the current seat state, emitting one record per room with bookings
+    using SnapshotFunction = std::function<void(const RecordVisitor &emit)>;
+
+    static const std::size_t DEFAULT_CHECKPOINT_BYTES = 64 * 1024 * 1024;
+
+    /// @brief Opens a new segment after any existing ones and starts the writer threads.
+    /// Call recover() first to load what earlier runs logged.
+    /// @param path prefix of the segment and checkpoint files
+    /// @param snapshot source of the seat state written by checkpoints
+    /// @param checkpointBytes segment size that triggers a checkpoint
+    BookingLog(const std::string &path, SnapshotFunction snapshot, std::size_t checkpointBytes = DEFAULT_CHECKPOINT_BYTES);
+
+    /// @brief Flushes every appended record and stops the writer threads
+    ~BookingLog();
+
+    BookingLog(const BookingLog &) = delete;
+    BookingLog &operator=(const BookingLog &) = delete;
+
+    /// @brief Applies the latest checkpoint and every later segment, in order
+    /// @param path prefix given to the constructor
+    /// @param apply called for each record
+    /// @return number of records applied
+    static std::size_t recover(const std::string &path, const RecordVisitor &apply);
+
+    /// @brief Queues one booking for the next group commit. Does not block on I/O.
+    void append(const std::string &theater, const std::string &room, const std::vector<int> &seats,
+                std::int64_t showtimeStart = Record::NO_START);
+
+    /// @brief Runs 'callback' on the writer thread once everything appended so far is durable
+    void whenDurable(std::function<void()> callback);
+
+    /// @brief Asks for a checkpoint now instead of waiting for the segment to fill up
+    void requestCheckpoint();
+
+    /// @brief Appends one record framed as in the log files, e.g. to ship it to a replica
+    static void encodeRecord(std::string &out, const Record &record);
+
+    /// @brief Decodes the framed record at the start of 'data'
+    /// @param frameSize set to the bytes the frame takes
+    /// @return false if 'data' does not start with a whole, undamaged record
+    static bool decodeRecord(const char *data, std::size_t size, Record &record, std::size_t &frameSize);
+
+private:
+    /// @brief Group commit loop of the writer thread
+    void writerLoop();
+
+    /// @brief Writes checkpoints for the segments handed over by the writer
+    void checkpointLoop();
+
+    /// @brief Closes the current segment, if any, and opens segment 'number'
+    void openSegment(std::uint64_t number);
+
+    /// @brief Writes 'count' bytes to 'fd' and fdatasyncs it, aborting if the log cannot be written
+    static void writeDurably(int fd, const char *data, std::size_t count, const std::string &what);
+
+    /// @brief Appends the framed encoding of one record to 'out'
+    static void encode(std::string &out, const std::string &theater, const std::string &room, const std::vector<int> &seats,
+                       std::int64_t showtimeStart);
+
+    /// @brief Decodes the framed records of a buffer until the end or the first damaged record
+    static std::size_t decodeAll(const std::string &data, std::size_t offset, const RecordVisitor &apply);
+
+    /// @brief Segment numbers present on disk for 'path', ascending
+    static std::vector<std::uint64_t> listSegments(const std::string &path);
+
+    static std::string segmentPath(const std::string &path, std::uint64_t number);
+    static std::string checkpointPath(const std::string &path);
+
+    std::string path;
+    SnapshotFunction snapshot;
+    std::size_t checkpointBytes;
+
+    std::mutex mutex;
+    std::condition_variable wakeWriter;
+    std::condition_variable wakeCheckpoint;
+    std::string pending;                               // Encoded records not yet written
+    std::vector<std::function<void()>> pendingCallbacks; // Waiting for 'pending' to be durable
+    bool stopping = false;
+    bool checkpointRequested = false;
+    std::uint64_t closedSegment = 0; // Last segment handed to the checkpoint thread, 0 if none
+    bool checkpointRunning = false;
+
+    // Owned by the writer thread
+    int fd = -1;
+    std::uint64_t segment = 0;
+    std::size_t segmentBytes = 0;
+
+    std::thread writer;
+    std::thread checkpointer;
+};
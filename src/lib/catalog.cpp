@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <json/json.h>
+
+#include "catalog.h"
+
+namespace
+{
+    /// @brief Title of a room's movie, empty if it plays none
+    const std::string &movieTitleOf(const std::shared_ptr<Movie> &movie)
+    {
+        static const std::string none;
+        return movie ? movie->getTitle() : none;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<Catalog> Catalog::load(const std::string &filename)
+{
+    auto catalog = std::make_shared<Catalog>();
+    if (isSnapshot(filename))
+    {
+        catalog->loadSnapshot(filename);
+    }
+    else
+    {
+        catalog->loadJson(filename);
+    }
+    catalog->buildIndex();
+    return catalog;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Catalog::loadJson(const std::string &filename)
+{
+    std::ifstream jsonFile(filename);
+    if (!jsonFile)
+    {
+        throw std::runtime_error("cannot open catalog " + filename);
+    }
+    Json::Value root;
+    jsonFile >> root;
+
+    const Json::Value &theatersJson = root["theaters"];
+    std::uint32_t roomOrdinal = 0;
+    for (const auto &theaterJson : theatersJson)
+    {
+        std::string theaterName = theaterJson["name"].asString();
+        Theater theater(theaterName);
+
+        const Json::Value &roomsJson = theaterJson["rooms"];
+        for (const auto &roomJson : roomsJson)
+        {
+            std::string roomName = roomJson["name"].asString();
+            std::string movieTitle = roomJson["movie"]["title"].asString();
+
+            // Capacity is either declared or derived from a rows x columns layout
+            int seatsPerRow = roomJson.get("columns", 0).asInt();
+            int capacity = roomJson.get("capacity", seatsPerRow * roomJson.get("rows", 0).asInt()).asInt();
+            if (capacity <= 0)
+            {
+                capacity = NUMBER_OF_AVAILABLE_SEATS;
+            }
+            Room room(roomName, capacity, seatsPerRow);
+            room.setPlayingMovie(internMovie(movieTitle));
+            theater.addRoom(std::move(room));
+
+            // Showtimes play the room's movie unless they name their own
+            for (const auto &showtimeJson : roomJson["showtimes"])
+            {
+                std::int64_t start = 0;
+                if (!ShowtimeStore::parseStart(showtimeJson["start"].asString(), start))
+                {
+                    throw std::runtime_error("invalid showtime start '" + showtimeJson["start"].asString() + "' in room " + roomName);
+                }
+                std::string showtimeMovie = showtimeJson["movie"].get("title", movieTitle).asString();
+                showtimes.add(roomOrdinal, static_cast<std::uint32_t>(internMovie(showtimeMovie)->getId()), start, capacity, seatsPerRow);
+            }
+            ++roomOrdinal;
+        }
+        theaters.push_back(std::move(theater));
+    }
+    showtimes.allocate();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<Movie> Catalog::internMovie(const std::string &movieTitle)
+{
+    auto it = movieIndex.find(movieTitle);
+    if (it != movieIndex.end())
+    {
+        return it->second;
+    }
+    auto movie = std::make_shared<Movie>(movieTitle, static_cast<int>(movies.size()));
+    movies.push_back(movie);
+    movieIndex.emplace(movieTitle, movie);
+    return movie;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Catalog::buildIndex()
+{
+    theatersByMovie.assign(movies.size(), std::vector<std::size_t>());
+
+    for (std::size_t pos = 0; pos < theaters.size(); ++pos)
+    {
+        theaterIndex.emplace(theaters[pos].getName(), pos);
+        for (auto &room : theaters[pos].getRooms())
+        {
+            roomOrdinals.emplace(&room, static_cast<long>(roomOrdinals.size()));
+            roomTable.push_back(&room);
+            roomTheaters.push_back(pos);
+
+            std::shared_ptr<Movie> movie = room.getPlayingMovie();
+            if (!movie)
+            {
+                continue;
+            }
+            std::vector<Room *> &rooms = roomIndex[roomKey(pos, movie->getId())];
+            if (rooms.empty())
+            {
+                // Add theater only once if it has multiple rooms showing the same movie
+                theatersByMovie[movie->getId()].push_back(pos);
+            }
+            rooms.push_back(&room);
+        }
+    }
+
+    for (ShowtimeId showtime = 0; showtime < showtimes.size(); ++showtime)
+    {
+        std::uint32_t roomOrdinal = showtimes.getRoom(showtime);
+        if (roomOrdinal >= roomTable.size() || showtimes.getMovie(showtime) >= movies.size())
+        {
+            throw std::runtime_error("showtime " + std::to_string(showtime) + " refers to an unknown room or movie");
+        }
+        if (!showtimeKeys.emplace(showtimeKey(roomOrdinal, showtimes.getStart(showtime)), showtime).second)
+        {
+            throw std::runtime_error("two showtimes start at " + ShowtimeStore::formatStart(showtimes.getStart(showtime)) +
+                                     " in room " + roomTable[roomOrdinal]->getRoomName());
+        }
+        std::size_t pos = roomTheaters[roomOrdinal];
+        std::uint64_t key = roomKey(pos, static_cast<int>(showtimes.getMovie(showtime)));
+        std::vector<ShowtimeId> &ids = showtimeIndex[key];
+        if (ids.empty() && roomIndex.find(key) == roomIndex.end())
+        {
+            // The theater shows the movie only at showtimes
+            theatersByMovie[showtimes.getMovie(showtime)].push_back(pos);
+        }
+        ids.push_back(showtime);
+    }
+    for (auto &entry : showtimeIndex)
+    {
+        std::stable_sort(entry.second.begin(), entry.second.end(), [this](ShowtimeId a, ShowtimeId b)
+                         { return showtimes.getStart(a) < showtimes.getStart(b); });
+    }
+    for (auto &positions : theatersByMovie)
+    {
+        std::sort(positions.begin(), positions.end());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t Catalog::carrySeatsFrom(Catalog &previous)
+{
+    std::size_t carried = 0;
+    std::vector<long> previousOrdinals(roomTable.size(), -1);
+    for (std::size_t ordinal = 0; ordinal < roomTable.size(); ++ordinal)
+    {
+        Room &room = *roomTable[ordinal];
+        long previousOrdinal = previous.findRoom(theaters[roomTheaters[ordinal]].getName(), room.getRoomName());
+        if (previousOrdinal < 0)
+        {
+            continue; // A new room
+        }
+        previousOrdinals[ordinal] = previousOrdinal;
+        Room &previousRoom = *previous.roomTable[previousOrdinal];
+        if (movieTitleOf(room.getPlayingMovie()) != movieTitleOf(previousRoom.getPlayingMovie()))
+        {
+            continue; // Another movie, the seats sold for the old one are not its seats
+        }
+        if (room.shareSeats(previousRoom))
+        {
+            ++carried;
+            continue;
+        }
+        // Resized, keep what still fits. Bookings on the old room fail from here on, so the copy misses none
+        previousRoom.seal();
+        for (int seatNumber : previousRoom.getConfirmedSeats())
+        {
+            room.reserveSeat(seatNumber);
+        }
+    }
+
+    for (ShowtimeId showtime = 0; showtime < showtimes.size(); ++showtime)
+    {
+        long previousOrdinal = previousOrdinals[showtimes.getRoom(showtime)];
+        if (previousOrdinal < 0)
+        {
+            continue;
+        }
+        auto previousIt = previous.showtimeKeys.find(showtimeKey(static_cast<std::uint32_t>(previousOrdinal), showtimes.getStart(showtime)));
+        if (previousIt == previous.showtimeKeys.end() ||
+            movies[showtimes.getMovie(showtime)]->getTitle() != previous.movies[previous.showtimes.getMovie(previousIt->second)]->getTitle())
+        {
+            continue;
+        }
+        if (showtimes.shareSeats(showtime, previous.showtimes, previousIt->second))
+        {
+            ++carried;
+            continue;
+        }
+        previous.showtimes.seal(previousIt->second);
+        for (int seatNumber : previous.showtimes.getBookedSeats(previousIt->second))
+        {
+            showtimes.reserve(showtime, {seatNumber});
+        }
+    }
+    return carried;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const std::vector<Room *> *Catalog::findRooms(const std::string &theaterName, const std::string &movieTitle) const
+{
+    auto theaterIt = theaterIndex.find(theaterName);
+    if (theaterIt == theaterIndex.end())
+    {
+        return nullptr;
+    }
+    auto movieIt = movieIndex.find(movieTitle);
+    if (movieIt == movieIndex.end())
+    {
+        return nullptr;
+    }
+    auto roomsIt = roomIndex.find(roomKey(theaterIt->second, movieIt->second->getId()));
+    if (roomsIt == roomIndex.end())
+    {
+        return nullptr;
+    }
+    return &roomsIt->second;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+long Catalog::findRoom(const std::string &theaterName, const std::string &roomName) const
+{
+    auto theaterIt = theaterIndex.find(theaterName);
+    if (theaterIt == theaterIndex.end())
+    {
+        return -1;
+    }
+    for (const auto &room : theaters[theaterIt->second].getRooms())
+    {
+        if (room.getRoomName() == roomName)
+        {
+            return roomOrdinals.at(&room);
+        }
+    }
+    return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Catalog::isShowtimeOf(const std::string &theaterName, const std::string &movieTitle, ShowtimeId showtime) const
+{
+    if (showtime >= showtimes.size())
+    {
+        return false;
+    }
+    auto theaterIt = theaterIndex.find(theaterName);
+    auto movieIt = movieIndex.find(movieTitle);
+    return theaterIt != theaterIndex.end() && movieIt != movieIndex.end() &&
+           roomTheaters[showtimes.getRoom(showtime)] == theaterIt->second &&
+           showtimes.getMovie(showtime) == static_cast<std::uint32_t>(movieIt->second->getId());
+}
+
+///////////////////////////////////////////////////////////////////////////////
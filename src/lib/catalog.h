@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "classes.h"
+#include "showtime_store.h"
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief One loaded version of the theaters, rooms, movies and showtimes, with their lookup tables.
+///
+/// The structure never changes once loaded, only seats do, through their lock-free seat maps.
+/// A new catalog file is loaded into a new Catalog, which takes over the seats of the rooms
+/// and showtimes it shares with the running one (see carrySeatsFrom) before it replaces it.
+/// ReservationSystem publishes the current catalog through an RcuPointer.
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct Catalog : std::enable_shared_from_this<Catalog>
+{
+    /// @brief Loads a json catalog or a binary catalog snapshot
+    /// @throws std::runtime_error or Json::Exception if the file is not a valid catalog
+    static std::shared_ptr<Catalog> load(const std::string &filename);
+
+    /// @brief Whether 'filename' holds a binary catalog snapshot rather than JSON
+    static bool isSnapshot(const std::string &filename);
+
+    /// @brief Writes the catalog and the current seat state as a binary snapshot
+    /// @param path file to write, replaced atomically
+    void saveSnapshot(const std::string &path) const;
+
+    /// @brief Makes the rooms and showtimes also found in 'previous' book into its seats, so
+    /// bookings made through either catalog are seen by both. Rooms match by theater and room
+    /// name, showtimes also by start, and both only while they show the same movie: a room or
+    /// showtime playing another movie starts empty. A room or showtime whose capacity changed
+    /// takes a copy of the confirmed seats that still fit instead, after sealing the old one
+    /// (see SeatMap::seal) so no booking made on it can be missed by the copy. Holds on sealed
+    /// rooms are the caller's to move, and must not change while this runs.
+    /// @return number of rooms and showtimes that kept their seats
+    std::size_t carrySeatsFrom(Catalog &previous);
+
+    /// @brief Returns the rooms of a theater showing a movie, or nullptr if there are none
+    const std::vector<Room *> *findRooms(const std::string &theaterName, const std::string &movieTitle) const;
+
+    /// @return the ordinal of a room of a theater, or -1 if there is none
+    long findRoom(const std::string &theaterName, const std::string &roomName) const;
+
+    /// @brief Checks a showtime exists and shows the movie in the theater
+    bool isShowtimeOf(const std::string &theaterName, const std::string &movieTitle, ShowtimeId showtime) const;
+
+    /// @brief Composes the key of a showtime in 'showtimeKeys'
+    static std::uint64_t showtimeKey(std::uint32_t roomOrdinal, std::int64_t start)
+    {
+        return (static_cast<std::uint64_t>(roomOrdinal) << 32) | static_cast<std::uint32_t>(start);
+    }
+
+    /// @brief Composes the room index key of a theater position and a movie id
+    static std::uint64_t roomKey(std::size_t theaterPos, int movieId)
+    {
+        return (static_cast<std::uint64_t>(theaterPos) << 32) | static_cast<std::uint32_t>(movieId);
+    }
+
+    std::uint64_t version = 1;                  // Catalog version this catalog was published as
+    std::shared_ptr<void> snapshotMapping;      // Mapped catalog snapshot holding the seat words, if loaded from one
+    std::vector<std::shared_ptr<Movie>> movies; // Interned movies, indexed by movie id
+    std::vector<Theater> theaters;
+
+    std::unordered_map<std::string, std::shared_ptr<Movie>> movieIndex; // movie title -> interned movie
+    std::unordered_map<std::string, std::size_t> theaterIndex;          // theater name -> position in 'theaters'
+    std::unordered_map<std::uint64_t, std::vector<Room *>> roomIndex;   // (theater, movie id) -> rooms
+    std::vector<std::vector<std::size_t>> theatersByMovie;             // movie id -> theater positions
+    std::unordered_map<const Room *, long> roomOrdinals;                // room -> position over all theaters
+    std::vector<Room *> roomTable;                                      // room ordinal -> room
+    std::vector<std::size_t> roomTheaters;                              // room ordinal -> theater position
+
+    ShowtimeStore showtimes;                                                  // Seats and ids only, names come from the tables above
+    std::unordered_map<std::uint64_t, std::vector<ShowtimeId>> showtimeIndex; // (theater, movie id) -> showtimes by start
+    std::unordered_map<std::uint64_t, ShowtimeId> showtimeKeys;               // (room ordinal, start) -> showtime
+
+private:
+    /// @brief Reads the theaters of a json catalog
+    void loadJson(const std::string &filename);
+
+    /// @brief Maps a binary catalog snapshot and builds the theaters on top of it, see saveSnapshot
+    void loadSnapshot(const std::string &filename);
+
+    /// @brief Returns the interned movie for a title, creating it with the next id if needed
+    std::shared_ptr<Movie> internMovie(const std::string &movieTitle);
+
+    /// @brief Builds the theater/room/movie lookup tables, once the theaters are in place
+    void buildIndex();
+};
@@ -0,0 +1,277 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "catalog_snapshot.h"
+#include "catalog.h"
+
+using namespace catalog_snapshot;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /// @brief Appends a trivially copyable value to a byte buffer
+    template <typename T>
+    void append(std::string &out, const T &value)
+    {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    /// @brief Pads a byte buffer to a multiple of 'alignment'
+    void pad(std::string &out, std::size_t alignment)
+    {
+        out.append((alignment - out.size() % alignment) % alignment, '\0');
+    }
+
+    /// @brief Adds a string to the string blob
+    StringRef addString(std::string &strings, const std::string &value)
+    {
+        StringRef ref{static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(value.size())};
+        strings += value;
+        return ref;
+    }
+
+    /// @brief Checks that 'count' entries of 'size' bytes at 'offset' lie inside the file
+    bool inBounds(std::uint64_t offset, std::uint64_t count, std::uint64_t size, std::uint64_t fileSize)
+    {
+        return offset <= fileSize && count <= (fileSize - offset) / (size ? size : 1);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Catalog::isSnapshot(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    return file && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Catalog::saveSnapshot(const std::string &path) const
+{
+    std::string strings;
+    std::string movieTable;
+    for (const auto &movie : movies)
+    {
+        append(movieTable, MovieEntry{addString(strings, movie->getTitle())});
+    }
+
+    std::string theaterTable;
+    std::vector<const Room *> rooms;
+    for (const auto &theater : theaters)
+    {
+        TheaterEntry entry{addString(strings, theater.getName()), static_cast<std::uint32_t>(rooms.size()),
+                           static_cast<std::uint32_t>(theater.getRooms().size())};
+        append(theaterTable, entry);
+        for (const auto &room : theater.getRooms())
+        {
+            rooms.push_back(&room);
+        }
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.formatVersion = FORMAT_VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.movieCount = static_cast<std::uint32_t>(movies.size());
+    header.theaterCount = static_cast<std::uint32_t>(theaters.size());
+    header.roomCount = static_cast<std::uint32_t>(rooms.size());
+    header.showtimeCount = static_cast<std::uint32_t>(showtimes.size());
+
+    std::string showtimeTable;
+    for (ShowtimeId showtime = 0; showtime < showtimes.size(); ++showtime)
+    {
+        append(showtimeTable, ShowtimeEntry{showtimes.getRoom(showtime), showtimes.getMovie(showtime), showtimes.getStart(showtime)});
+    }
+
+    // Room names go to the blob before its size is fixed, seat offsets come after it
+    std::vector<StringRef> roomNames;
+    for (const Room *room : rooms)
+    {
+        roomNames.push_back(addString(strings, room->getRoomName()));
+    }
+
+    header.moviesOffset = sizeof(Header);
+    header.theatersOffset = header.moviesOffset + movieTable.size();
+    header.roomsOffset = header.theatersOffset + theaterTable.size();
+    header.showtimesOffset = header.roomsOffset + rooms.size() * sizeof(RoomEntry);
+    header.stringsOffset = header.showtimesOffset + showtimeTable.size();
+    header.stringsSize = strings.size();
+
+    std::uint64_t wordsOffset = header.stringsOffset + strings.size();
+    wordsOffset += (SeatMap::CACHE_LINE_SIZE - wordsOffset % SeatMap::CACHE_LINE_SIZE) % SeatMap::CACHE_LINE_SIZE;
+
+    std::string roomTable;
+    std::string seatWords;
+    std::vector<std::uint64_t> words;
+    for (std::size_t i = 0; i < rooms.size(); ++i)
+    {
+        const Room *room = rooms[i];
+        const SeatMap &seats = room->getSeatMap();
+        RoomEntry entry{roomNames[i],
+                        room->getPlayingMovie() ? static_cast<std::uint32_t>(room->getPlayingMovie()->getId()) : NO_MOVIE,
+                        static_cast<std::uint32_t>(room->getCapacity()),
+                        static_cast<std::uint32_t>(room->getSeatsPerRow()),
+                        static_cast<std::uint32_t>(seats.getWordCount()),
+                        wordsOffset + seatWords.size()};
+        append(roomTable, entry);
+
+        words.resize(seats.getWordCount());
+        seats.snapshot(words.data());
+        seatWords.append(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(std::uint64_t));
+    }
+    // Room words are whole cache lines, so the showtime block starts aligned
+    header.showtimeWordsOffset = wordsOffset + seatWords.size();
+    words.resize(showtimes.getWordCount());
+    showtimes.copyWords(words.data());
+    seatWords.append(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(std::uint64_t));
+    header.fileSize = wordsOffset + seatWords.size();
+
+    std::string data;
+    data.reserve(header.fileSize);
+    append(data, header);
+    data += movieTable;
+    data += theaterTable;
+    data += roomTable;
+    data += showtimeTable;
+    data += strings;
+    pad(data, SeatMap::CACHE_LINE_SIZE);
+    data += seatWords;
+
+    // Write aside and rename so a running server never maps a half written file
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out)
+        {
+            throw std::runtime_error("cannot write catalog snapshot " + tempPath);
+        }
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        throw std::runtime_error("cannot rename catalog snapshot to " + path);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Catalog::loadSnapshot(const std::string &filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    if (fd < 0 || ::fstat(fd, &status) != 0 || static_cast<std::size_t>(status.st_size) < sizeof(Header))
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        throw std::runtime_error("cannot open catalog snapshot " + filename);
+    }
+    std::size_t size = static_cast<std::size_t>(status.st_size);
+
+    // Private writable mapping: seat words are booked in place, pages are copied on first write
+    void *base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        throw std::runtime_error("cannot map catalog snapshot " + filename);
+    }
+    snapshotMapping.reset(base, [size](void *mapping)
+                          { ::munmap(mapping, size); });
+
+    char *data = static_cast<char *>(base);
+    const Header &header = *reinterpret_cast<const Header *>(data);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.formatVersion != FORMAT_VERSION ||
+        header.byteOrderMark != BYTE_ORDER_MARK || header.fileSize != size ||
+        !inBounds(header.moviesOffset, header.movieCount, sizeof(MovieEntry), size) ||
+        !inBounds(header.theatersOffset, header.theaterCount, sizeof(TheaterEntry), size) ||
+        !inBounds(header.roomsOffset, header.roomCount, sizeof(RoomEntry), size) ||
+        !inBounds(header.showtimesOffset, header.showtimeCount, sizeof(ShowtimeEntry), size) ||
+        !inBounds(header.stringsOffset, header.stringsSize, 1, size))
+    {
+        throw std::runtime_error("invalid catalog snapshot " + filename);
+    }
+
+    const char *strings = data + header.stringsOffset;
+    auto readString = [&](const StringRef &ref)
+    {
+        if (!inBounds(ref.offset, ref.length, 1, header.stringsSize))
+        {
+            throw std::runtime_error("invalid string in catalog snapshot " + filename);
+        }
+        return std::string(strings + ref.offset, ref.length);
+    };
+
+    const MovieEntry *movieEntries = reinterpret_cast<const MovieEntry *>(data + header.moviesOffset);
+    for (std::uint32_t i = 0; i < header.movieCount; ++i)
+    {
+        internMovie(readString(movieEntries[i].title));
+    }
+
+    const TheaterEntry *theaterEntries = reinterpret_cast<const TheaterEntry *>(data + header.theatersOffset);
+    const RoomEntry *roomEntries = reinterpret_cast<const RoomEntry *>(data + header.roomsOffset);
+    theaters.reserve(header.theaterCount);
+    for (std::uint32_t t = 0; t < header.theaterCount; ++t)
+    {
+        const TheaterEntry &theaterEntry = theaterEntries[t];
+        if (!inBounds(theaterEntry.firstRoom, theaterEntry.roomCount, 1, header.roomCount))
+        {
+            throw std::runtime_error("invalid theater in catalog snapshot " + filename);
+        }
+        Theater theater(readString(theaterEntry.name));
+        for (std::uint32_t r = theaterEntry.firstRoom; r < theaterEntry.firstRoom + theaterEntry.roomCount; ++r)
+        {
+            const RoomEntry &roomEntry = roomEntries[r];
+            if (roomEntry.wordCount != SeatMap::wordCountFor(static_cast<int>(roomEntry.capacity)) ||
+                roomEntry.wordsOffset % SeatMap::CACHE_LINE_SIZE != 0 ||
+                !inBounds(roomEntry.wordsOffset, roomEntry.wordCount, sizeof(std::uint64_t), size) ||
+                (roomEntry.movieId != NO_MOVIE && roomEntry.movieId >= movies.size()))
+            {
+                throw std::runtime_error("invalid room in catalog snapshot " + filename);
+            }
+
+            // The room books straight into the mapped seat words
+            Room room(readString(roomEntry.name), static_cast<int>(roomEntry.capacity), static_cast<int>(roomEntry.seatsPerRow),
+                      reinterpret_cast<std::uint64_t *>(data + roomEntry.wordsOffset), snapshotMapping);
+            if (roomEntry.movieId != NO_MOVIE)
+            {
+                room.setPlayingMovie(movies[roomEntry.movieId]);
+            }
+            theater.addRoom(std::move(room));
+        }
+        theaters.push_back(std::move(theater));
+    }
+
+    const ShowtimeEntry *showtimeEntries = reinterpret_cast<const ShowtimeEntry *>(data + header.showtimesOffset);
+    for (std::uint32_t i = 0; i < header.showtimeCount; ++i)
+    {
+        const ShowtimeEntry &showtimeEntry = showtimeEntries[i];
+        if (showtimeEntry.room >= header.roomCount || showtimeEntry.movieId >= movies.size())
+        {
+            throw std::runtime_error("invalid showtime in catalog snapshot " + filename);
+        }
+        const RoomEntry &roomEntry = roomEntries[showtimeEntry.room];
+        showtimes.add(showtimeEntry.room, showtimeEntry.movieId, showtimeEntry.start, static_cast<int>(roomEntry.capacity),
+                      static_cast<int>(roomEntry.seatsPerRow));
+    }
+    if (header.showtimeWordsOffset % SeatMap::CACHE_LINE_SIZE != 0 ||
+        !inBounds(header.showtimeWordsOffset, showtimes.getWordCount(), sizeof(std::uint64_t), size))
+    {
+        throw std::runtime_error("invalid showtime seats in catalog snapshot " + filename);
+    }
+    // Showtimes book straight into the mapped seat words too
+    showtimes.allocate(reinterpret_cast<std::uint64_t *>(data + header.showtimeWordsOffset), snapshotMapping);
+}
+
+///////////////////////////////////////////////////////////////////////////////
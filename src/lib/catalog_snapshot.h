@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief On-disk layout of a binary catalog snapshot.
+///
+/// A snapshot holds the theaters, rooms, movies and showtimes of a catalog plus the seat
+/// state of every room and showtime, laid out so the server can mmap it and use it in place:
+/// the seat words of each room sit on their own cache-line aligned block and become the
+/// room's SeatMap storage, those of all showtimes follow as the ShowtimeStore's one block.
+/// The mapping is private, so bookings never write back to the file.
+///
+/// All integers are in host byte order, 'byteOrderMark' rejects files from other hosts.
+/// String offsets are relative to 'stringsOffset', every other offset to the file start.
+/// JSON stays the authoring format, snapshots are compiled from it with
+/// ReservationSystem::saveSnapshot (server option --compile-snapshot).
+/// Rooms and showtimes hold on to the mapping, so it outlives catalogs that carried their seats.
+///////////////////////////////////////////////////////////////////////////////////////
+
+namespace catalog_snapshot
+{
+    const char MAGIC[8] = {'R', 'S', 'C', 'A', 'T', 'S', 'N', 'P'};
+    const std::uint32_t FORMAT_VERSION = 3; // 3: showtime bitmaps packed word by word
+    const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+    const std::uint32_t NO_MOVIE = 0xffffffff;
+
+    struct StringRef
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t formatVersion;
+        std::uint32_t byteOrderMark;
+        std::uint32_t movieCount;
+        std::uint32_t theaterCount;
+        std::uint32_t roomCount;
+        std::uint32_t showtimeCount;
+        std::uint64_t moviesOffset;
+        std::uint64_t theatersOffset;
+        std::uint64_t roomsOffset;
+        std::uint64_t showtimesOffset;
+        std::uint64_t stringsOffset;
+        std::uint64_t stringsSize;
+        std::uint64_t showtimeWordsOffset; // Cache-line aligned seat words of all showtimes, in showtime order
+        std::uint64_t fileSize;
+    };
+
+    /// @brief Movies are stored in id order
+    struct MovieEntry
+    {
+        StringRef title;
+    };
+
+    struct TheaterEntry
+    {
+        StringRef name;
+        std::uint32_t firstRoom; // Rooms of a theater are consecutive in the room table
+        std::uint32_t roomCount;
+    };
+
+    struct RoomEntry
+    {
+        StringRef name;
+        std::uint32_t movieId; // NO_MOVIE when nothing is playing
+        std::uint32_t capacity;
+        std::uint32_t seatsPerRow;
+        std::uint32_t wordCount;   // SeatMap::wordCountFor(capacity)
+        std::uint64_t wordsOffset; // Cache-line aligned seat words
+    };
+
+    /// @brief Showtimes are stored in id order, capacity and row length are the room's
+    struct ShowtimeEntry
+    {
+        std::uint32_t room; // Position in the room table
+        std::uint32_t movieId;
+        std::int64_t start; // Minutes since the Unix epoch, UTC
+    };
+
+    static_assert(sizeof(Header) == 96, "snapshot header layout");
+    static_assert(sizeof(TheaterEntry) == 16, "snapshot theater layout");
+    static_assert(sizeof(RoomEntry) == 32, "snapshot room layout");
+    static_assert(sizeof(ShowtimeEntry) == 16, "snapshot showtime layout");
+}
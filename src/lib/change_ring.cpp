@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+
+#include "change_ring.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+ChangeRing::ChangeRing() : changes(CAPACITY)
+{
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    firstVersion = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+    version = firstVersion;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ChangeRing::publish(const std::vector<int> &seats, bool booked)
+{
+    std::vector<std::pair<std::uint64_t, std::function<void()>>> woken;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++version;
+        Change &change = changes[version % CAPACITY];
+        change.booked = booked;
+        change.seats.assign(seats.begin(), seats.end());
+        if (waiters.empty())
+        {
+            return;
+        }
+        woken.swap(waiters);
+    }
+    // Outside the lock, a waiter may read the ring again right away
+    for (auto &waiter : woken)
+    {
+        waiter.second();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ChangeRing::getVersion() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return version;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ChangeRing::readSince(std::uint64_t since, std::vector<int> &booked, std::vector<int> &freed, std::uint64_t &version) const
+{
+    booked.clear();
+    freed.clear();
+    // Seat and state of every change after 'since', in publishing order
+    std::vector<std::pair<int, bool>> seats;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        version = this->version;
+        if (since < firstVersion || since > this->version || this->version - since > CAPACITY)
+        {
+            return false;
+        }
+        for (std::uint64_t v = since + 1; v <= this->version; ++v)
+        {
+            const Change &change = changes[v % CAPACITY];
+            for (int seatNumber : change.seats)
+            {
+                seats.emplace_back(seatNumber, change.booked);
+            }
+        }
+    }
+
+    // The last change of a seat wins
+    std::stable_sort(seats.begin(), seats.end(), [](const std::pair<int, bool> &a, const std::pair<int, bool> &b)
+                     { return a.first < b.first; });
+    for (std::size_t i = 0; i < seats.size(); ++i)
+    {
+        if (i + 1 < seats.size() && seats[i + 1].first == seats[i].first)
+        {
+            continue;
+        }
+        (seats[i].second ? booked : freed).push_back(seats[i].first);
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ChangeRing::waitAfter(std::uint64_t since, std::function<void()> wake)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (version != since)
+    {
+        return 0;
+    }
+    std::uint64_t ticket = nextTicket++;
+    waiters.emplace_back(ticket, std::move(wake));
+    return ticket;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ChangeRing::cancelWait(std::uint64_t ticket)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(waiters.begin(), waiters.end(), [ticket](const std::pair<std::uint64_t, std::function<void()>> &waiter)
+                           { return waiter.first == ticket; });
+    if (it != waiters.end())
+    {
+        waiters.erase(it);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t ChangeRing::getWaiterCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return waiters.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Recent seat changes of one room or showtime, for clients following its occupancy.
+///
+/// Every booking or freeing of seats is published as one change carrying the next version.
+/// The last CAPACITY changes are kept in a ring, so a reader that knows a version can catch up
+/// with the seats changed since instead of reading the whole room, and a reader that fell
+/// further behind, or holds a version of another ring, is told to start over from a full copy.
+/// Versions start at the creation time in microseconds, so the versions of a ring made after a
+/// restart or a capacity change do not run into those handed out by an earlier one.
+/// Waiters are woken by the next change; publishing costs nothing more when there are none.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class ChangeRing
+{
+public:
+    /// @brief Number of changes kept
+    static constexpr std::size_t CAPACITY = 256;
+
+    ChangeRing();
+
+    ChangeRing(const ChangeRing &) = delete;
+    ChangeRing &operator=(const ChangeRing &) = delete;
+
+    /// @brief Records seats that were booked or freed, then wakes every waiter
+    void publish(const std::vector<int> &seats, bool booked);
+
+    /// @return the version of the latest change
+    std::uint64_t getVersion() const;
+
+    /// @brief Collects the seats changed after version 'since', each once with its latest state, ascending
+    /// @param version set to the version the changes bring the reader to
+    /// @return false if 'since' is not a version of this ring or its changes were overwritten,
+    /// the reader then needs a full copy of the seats
+    bool readSince(std::uint64_t since, std::vector<int> &booked, std::vector<int> &freed, std::uint64_t &version) const;
+
+    /// @brief Calls 'wake' once, on the publishing thread, when a change after version 'since' is published
+    /// @return a ticket for cancelWait, or 0 if there already is such a change; 'wake' is then never called
+    std::uint64_t waitAfter(std::uint64_t since, std::function<void()> wake);
+
+    /// @brief Forgets a waiter that was not woken yet, e.g. when its client gave up
+    void cancelWait(std::uint64_t ticket);
+
+    /// @return number of waiters not woken yet
+    std::size_t getWaiterCount() const;
+
+private:
+    /// @brief One published change
+    struct Change
+    {
+        bool booked = false;
+        std::vector<int> seats; // Keeps its capacity when the slot is reused
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Change> changes; // Change of version v in slot v % CAPACITY
+    std::uint64_t firstVersion;  // Version before the first change
+    std::uint64_t version;
+    std::vector<std::pair<std::uint64_t, std::function<void()>>> waiters; // Ticket and callback
+    std::uint64_t nextTicket = 1;
+};
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include "classes.h"
 
@@ -10,6 +11,11 @@ const std::string &Movie::getTitle() const
     return title;
 }
 
+int Movie::getId() const
+{
+    return id;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Room Implementation
 ///////////////////////////////////////////////////////////////////////////////
@@ -29,6 +35,132 @@ void Room::setPlayingMovie(std::shared_ptr<Movie> movie)
     playingMovie = movie;
 }
 
+int Room::getCapacity() const
+{
+    return state->seats.getCapacity();
+}
+
+int Room::getSeatsPerRow() const
+{
+    return seatsPerRow;
+}
+
+int Room::getRowCount() const
+{
+    return seatsPerRow > 0 ? (state->seats.getCapacity() + seatsPerRow - 1) / seatsPerRow : 0;
+}
+
+int Room::countAvailableSeats() const
+{
+    return state->seats.countAvailable();
+}
+
+std::uint64_t Room::getVersion() const
+{
+    return state->seats.getVersion();
+}
+
+const SeatMap &Room::getSeatMap() const
+{
+    return state->seats;
+}
+
+bool Room::shareSeats(const Room &other)
+{
+    if (other.getCapacity() != getCapacity())
+    {
+        return false;
+    }
+    state = other.state;
+    return true;
+}
+
+bool Room::sharesSeatsWith(const Room &other) const
+{
+    return state == other.state;
+}
+
+void Room::seal()
+{
+    state->seats.seal();
+    state->held.seal();
+}
+
+std::vector<int> Room::getConfirmedSeats() const
+{
+    std::vector<int> confirmed = state->seats.getBookedSeats();
+    confirmed.erase(std::remove_if(confirmed.begin(), confirmed.end(), [this](int seatNumber)
+                                   { return !state->held.isAvailable(seatNumber); }),
+                    confirmed.end());
+    return confirmed;
+}
+
+bool Room::holdSeats(const std::vector<int> &seatNumbers)
+{
+    // The seats are ours alone once booked, so marking them held cannot fail
+    if (!state->seats.reserve(seatNumbers))
+    {
+        return false;
+    }
+    state->held.reserve(seatNumbers);
+    publishChange(seatNumbers, true);
+    return true;
+}
+
+void Room::confirmHeldSeats(const std::vector<int> &seatNumbers)
+{
+    state->held.release(seatNumbers);
+}
+
+void Room::releaseHeldSeats(const std::vector<int> &seatNumbers)
+{
+    // Unmark first, so a booking racing for the freed seats never looks held
+    state->held.release(seatNumbers);
+    state->seats.release(seatNumbers);
+    publishChange(seatNumbers, false);
+}
+
+void Room::releaseSeats(const std::vector<int> &seatNumbers)
+{
+    state->seats.release(seatNumbers);
+    publishChange(seatNumbers, false);
+}
+
+ChangeRing *Room::getChangeRing() const
+{
+    return state->changes.load();
+}
+
+ChangeRing &Room::followChanges()
+{
+    ChangeRing *ring = state->changes.load();
+    if (!ring)
+    {
+        // Two first followers may race, the loser drops its ring and takes the winner's
+        ChangeRing *created = new ChangeRing();
+        if (state->changes.compare_exchange_strong(ring, created))
+        {
+            ring = created;
+        }
+        else
+        {
+            delete created;
+        }
+    }
+    return *ring;
+}
+
+void Room::publishChange(const std::vector<int> &seatNumbers, bool booked) const
+{
+    // Sequentially consistent after the seat update: a follower that created the ring after this
+    // load reads the seats after creating it, so it sees the update in its full copy instead
+    ChangeRing *ring = state->changes.load();
+    if (ring)
+    {
+        ring->publish(seatNumbers, booked);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Theater Implementation
 ///////////////////////////////////////////////////////////////////////////////
@@ -45,7 +177,17 @@ void Theater::addRoom(const Room &room)
     rooms.push_back(room);
 }
 
+void Theater::addRoom(Room &&room)
+{
+    rooms.push_back(std::move(room));
+}
+
 const std::vector<Room> &Theater::getRooms() const
 {
     return rooms;
 }
+
+std::vector<Room> &Theater::getRooms()
+{
+    return rooms;
+}
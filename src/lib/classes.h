@@ -1,9 +1,14 @@
+#pragma once
+
+#include <atomic>
 #include <string>
 #include <vector>
 #include <memory>
-#include <bitset>
-#include <mutex>
 
+#include "change_ring.h"
+#include "seat_map.h"
+
+/// @brief Default room capacity when the catalog does not declare one
 const int NUMBER_OF_AVAILABLE_SEATS = 20;
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -14,13 +19,19 @@ class Movie
 {
 public:
     /// @brief Represents a cinema movie.
-    Movie(const std::string &title) : title(title) {}
+    /// @param title
+    /// @param id numeric identifier assigned when the title is interned by the ReservationSystem
+    Movie(const std::string &title, int id = 0) : title(title), id(id) {}
 
     /// @brief Returns the title of this movide
     const std::string &getTitle() const;
 
+    /// @brief Returns the interned numeric id of this movie
+    int getId() const;
+
 private:
     std::string title;
+    int id;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -32,14 +43,41 @@ class Room
 public:
     /// @brief Create a Room with its room name
     /// @param roomName
-    Room(const std::string &roomName) : roomName(roomName), seats(NUMBER_OF_AVAILABLE_SEATS, true) {}
+    /// @param capacity number of seats in the room
+    /// @param seatsPerRow seats in each row, seat N sits in row N / seatsPerRow. 0 means a single row
+    Room(const std::string &roomName, int capacity = NUMBER_OF_AVAILABLE_SEATS, int seatsPerRow = 0)
+        : roomName(roomName), seatsPerRow(seatsPerRow > 0 ? seatsPerRow : capacity), state(std::make_shared<SeatState>(capacity)) {}
+
+    /// @brief Create a Room whose seats live in external storage, see SeatMap
+    /// @param storageOwner keeps the external storage alive for as long as any room uses it, may be null
+    Room(const std::string &roomName, int capacity, int seatsPerRow, std::uint64_t *externalSeatWords,
+         std::shared_ptr<void> storageOwner = nullptr)
+        : roomName(roomName), seatsPerRow(seatsPerRow > 0 ? seatsPerRow : capacity),
+          state(std::make_shared<SeatState>(capacity, externalSeatWords, std::move(storageOwner))) {}
+
+    /// @brief a move constructor keeping the seat storage, so rooms can be relocated without copying seats
+    Room(Room &&other) noexcept
+        : roomName(std::move(other.roomName)), playingMovie(std::move(other.playingMovie)), seatsPerRow(other.seatsPerRow), state(std::move(other.state))
+    {
+    }
 
-    /// @brief a copy constructor to properly handle mutex
+    /// @brief a copy constructor taking a copy of the current seat occupancy
     Room(const Room &other)
-        : roomName(other.roomName), seats(other.seats), playingMovie(other.playingMovie)
+        : roomName(other.roomName), playingMovie(other.playingMovie), seatsPerRow(other.seatsPerRow), state(std::make_shared<SeatState>(*other.state))
     {
     }
 
+    /// @brief Makes this room book into the seats of 'other' from now on, e.g. the same room in an older catalog.
+    /// Bookings and holds made through either room are seen by both.
+    /// @return false, changing nothing, if the rooms differ in capacity
+    bool shareSeats(const Room &other);
+
+    /// @return whether the room books into the same seats as 'other', see shareSeats
+    bool sharesSeatsWith(const Room &other) const;
+
+    /// @brief Refuses every seat change from now on, bookings and holds included, see SeatMap::seal
+    void seal();
+
     /// @return the room name
     const std::string &getRoomName() const;
 
@@ -49,35 +87,135 @@ public:
     /// @brief Sets the current movie to this room
     void setPlayingMovie(std::shared_ptr<Movie> movie);
 
+    /// @return number of seats in the room
+    int getCapacity() const;
+
+    /// @return number of seats in each row
+    int getSeatsPerRow() const;
+
+    /// @return number of rows, the last one may be partial
+    int getRowCount() const;
+
+    /// @return number of seats not booked yet
+    int countAvailableSeats() const;
+
+    /// @return the booked seat numbers, ascending
+    std::vector<int> getBookedSeats() const
+    {
+        return state->seats.getBookedSeats();
+    }
+
+    /// @return the booked seat numbers that are not merely held, ascending
+    std::vector<int> getConfirmedSeats() const;
+
+    /// @brief Occupancy version, incremented by every booking in this room
+    std::uint64_t getVersion() const;
+
+    /// @brief Read access to the seat bitmap
+    const SeatMap &getSeatMap() const;
+
     /// @brief Checks room for seats available.
-    /// @param seatNumber integer that goes from [0 - 'NUMBER_OF_AVAILABLE_SEATS']
+    /// @param seatNumber integer that goes from [0 - capacity)
     bool isSeatAvailable(int seatNumber) const
     {
-        std::lock_guard<std::mutex> lock(mutex); // Lock the mutex
-        if (seatNumber >= 0 && seatNumber < seats.size())
-        {
-            return seats[seatNumber];
-        }
-        return false;
+        return state->seats.isAvailable(seatNumber);
     }
 
     /// @brief Books one seat if not already booked
     bool reserveSeat(int seatNumber)
     {
-        if (seatNumber >= 0 && seatNumber < seats.size() && seats[seatNumber])
+        if (!state->seats.reserve(seatNumber))
+        {
+            return false;
+        }
+        publishChange({seatNumber}, true);
+        return true;
+    }
+
+    /// @brief Books all the given seats, or none of them if any is already booked
+    bool reserveSeats(const std::vector<int> &seatNumbers)
+    {
+        if (!state->seats.reserve(seatNumbers))
         {
-            std::lock_guard<std::mutex> lock(mutex); // Lock the mutex
-            seats[seatNumber] = false;
-            return true; // Reservation successful
+            return false;
         }
-        return false; // Reservation failed
+        publishChange(seatNumbers, true);
+        return true;
     }
 
+    /// @brief Books several seat requests in one pass over the seat map
+    /// @return whether each request was booked, in order
+    std::vector<bool> reserveSeatsBatch(const std::vector<const std::vector<int> *> &requests)
+    {
+        std::vector<bool> booked = state->seats.reserveBatch(requests);
+        for (std::size_t i = 0; i < booked.size(); ++i)
+        {
+            if (booked[i])
+            {
+                publishChange(*requests[i], true);
+            }
+        }
+        return booked;
+    }
+
+    /// @brief Finds and books 'count' free seats, adjacent in one row if 'contiguous' is set
+    /// @return the booked seats, empty if there was no room for the request
+    std::vector<int> reserveAvailableSeats(int count, bool contiguous)
+    {
+        std::vector<int> seats = state->seats.reserveAvailable(count, contiguous, seatsPerRow);
+        if (!seats.empty())
+        {
+            publishChange(seats, true);
+        }
+        return seats;
+    }
+
+    /// @brief Takes all the given seats, or none of them, until confirmHeldSeats or releaseHeldSeats.
+    /// Held seats count as booked for everybody else, but are left out of getConfirmedSeats.
+    bool holdSeats(const std::vector<int> &seatNumbers);
+
+    /// @brief Turns held seats into bookings
+    void confirmHeldSeats(const std::vector<int> &seatNumbers);
+
+    /// @brief Frees held seats for other bookings
+    void releaseHeldSeats(const std::vector<int> &seatNumbers);
+
+    /// @brief Frees booked seats that are not held, e.g. those a primary dropped from a read replica's room
+    void releaseSeats(const std::vector<int> &seatNumbers);
+
+    /// @return the ring every seat change of the room is published to, or nullptr while nobody follows the room
+    ChangeRing *getChangeRing() const;
+
+    /// @brief Starts publishing the seat changes of the room, if not done yet
+    /// @return the change ring, shared by every copy sharing the seats and alive as long as the seats are
+    ChangeRing &followChanges();
+
 private:
     std::string roomName;
     std::shared_ptr<Movie> playingMovie; // Pointer to a movie
-    std::vector<bool> seats;
-    mutable std::mutex mutex; // Mutable since isSeatAvailable is const
+    /// @brief Seats of a room, shared by the copies of the room in successive catalogs
+    struct SeatState
+    {
+        explicit SeatState(int capacity) : seats(capacity), held(capacity) {}
+
+        SeatState(int capacity, std::uint64_t *externalWords, std::shared_ptr<void> storageOwner)
+            : seats(capacity, externalWords), held(capacity), storageOwner(std::move(storageOwner)) {}
+
+        SeatState(const SeatState &other) : seats(other.seats), held(other.held) {}
+
+        ~SeatState() { delete changes.load(); }
+
+        SeatMap seats;                      // Lock-free occupancy bitmap
+        SeatMap held;                       // Seats of 'seats' that are only held, never part of a snapshot
+        std::shared_ptr<void> storageOwner; // Owner of external seat words, if any
+        std::atomic<ChangeRing *> changes{nullptr}; // Created by the first follower, see followChanges
+    };
+
+    /// @brief Publishes changed seats to the change ring, if the room has one
+    void publishChange(const std::vector<int> &seatNumbers, bool booked) const;
+
+    int seatsPerRow;
+    std::shared_ptr<SeatState> state;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -96,9 +234,15 @@ public:
     /// @brief Adds a room to the theater
     void addRoom(const Room &room);
 
+    /// @brief Adds a room to the theater without copying its seats
+    void addRoom(Room &&room);
+
     /// @brief Gets the room vector for this theater
     const std::vector<Room> &getRooms() const;
 
+    /// @brief Gets the mutable room vector for this theater
+    std::vector<Room> &getRooms();
+
 private:
     std::string name;
     std::vector<Room> rooms; // Store the rooms in the theater
@@ -0,0 +1,197 @@
+#include <cstring>
+
+#include "http_parser.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /// @brief Case-insensitive comparison against a lower-case header name
+    bool equalsLower(std::string_view value, std::string_view lower)
+    {
+        if (value.size() != lower.size())
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < value.size(); ++i)
+        {
+            char c = value[i];
+            if (c >= 'A' && c <= 'Z')
+            {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+            if (c != lower[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Strips spaces and tabs around a header value
+    std::string_view trim(std::string_view value)
+    {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+        {
+            value.remove_suffix(1);
+        }
+        return value;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+HttpRequestParser::HttpRequestParser(std::size_t maxBodySize)
+    : maxBodySize(maxBodySize)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+HttpRequestParser::Result HttpRequestParser::parse(const char *data, std::size_t size, HttpRequest &request)
+{
+    // Look for the blank line ending the header, resuming where the last call stopped
+    std::size_t headerSize = headerEnd;
+    for (std::size_t i = scanned > 3 ? scanned - 3 : 0; headerSize == 0 && i + 3 < size; ++i)
+    {
+        if (data[i] == '\r' && data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n')
+        {
+            headerSize = i + 4;
+        }
+    }
+    if (headerSize == 0)
+    {
+        scanned = size;
+        return size > MAX_HEADER_SIZE ? Result::HeaderTooLarge : Result::Incomplete;
+    }
+    if (headerSize > MAX_HEADER_SIZE)
+    {
+        return Result::HeaderTooLarge; // It all came in one read, the limit holds all the same
+    }
+    headerEnd = headerSize;
+
+    std::size_t contentLength = 0;
+    Result result = parseHeader(data, headerSize, request, contentLength);
+    if (result != Result::Complete)
+    {
+        return result;
+    }
+    if (contentLength > maxBodySize)
+    {
+        return Result::TooLarge;
+    }
+    if (size - headerSize < contentLength)
+    {
+        return Result::Incomplete; // Header is complete, the body is still arriving
+    }
+
+    request.body = std::string_view(data + headerSize, contentLength);
+    request.size = headerSize + contentLength;
+    reset();
+    return Result::Complete;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void HttpRequestParser::reset()
+{
+    scanned = 0;
+    headerEnd = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool HttpRequestParser::inBody() const
+{
+    return headerEnd != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+HttpRequestParser::Result HttpRequestParser::parseHeader(const char *data, std::size_t headerSize, HttpRequest &request, std::size_t &contentLength) const
+{
+    std::string_view header(data, headerSize - 2); // Keep the CRLF of the last line
+
+    // Request line: METHOD SP TARGET SP HTTP/1.x CRLF
+    std::size_t lineEnd = header.find("\r\n");
+    std::string_view line = header.substr(0, lineEnd);
+    std::size_t methodEnd = line.find(' ');
+    std::size_t targetEnd = methodEnd == std::string_view::npos ? std::string_view::npos : line.find(' ', methodEnd + 1);
+    if (targetEnd == std::string_view::npos)
+    {
+        return Result::Invalid;
+    }
+    std::string_view version = line.substr(targetEnd + 1);
+    if (version.size() != 8 || version.compare(0, 7, "HTTP/1.") != 0 || version[7] < '0' || version[7] > '9')
+    {
+        return Result::Invalid;
+    }
+    request.method = line.substr(0, methodEnd);
+    request.target = line.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    request.versionMinor = version[7] - '0';
+    request.keepAlive = request.versionMinor >= 1;
+    request.body = std::string_view();
+    request.idempotencyKey = std::string_view();
+    contentLength = 0;
+
+    // Header fields: NAME ":" VALUE CRLF
+    std::size_t pos = lineEnd + 2;
+    while (pos < header.size())
+    {
+        lineEnd = header.find("\r\n", pos);
+        line = header.substr(pos, lineEnd - pos);
+        pos = lineEnd + 2;
+
+        std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+        {
+            return Result::Invalid;
+        }
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = trim(line.substr(colon + 1));
+
+        if (equalsLower(name, "content-length"))
+        {
+            if (value.empty())
+            {
+                return Result::Invalid;
+            }
+            std::size_t length = 0;
+            for (char c : value)
+            {
+                if (c < '0' || c > '9' || length > (static_cast<std::size_t>(-1) - 9) / 10)
+                {
+                    return Result::Invalid;
+                }
+                length = length * 10 + static_cast<std::size_t>(c - '0');
+            }
+            contentLength = length;
+        }
+        else if (equalsLower(name, "connection"))
+        {
+            if (equalsLower(value, "close"))
+            {
+                request.keepAlive = false;
+            }
+            else if (equalsLower(value, "keep-alive"))
+            {
+                request.keepAlive = true;
+            }
+        }
+        else if (equalsLower(name, "idempotency-key"))
+        {
+            request.idempotencyKey = value;
+        }
+        else if (equalsLower(name, "transfer-encoding"))
+        {
+            return Result::Invalid; // Chunked request bodies are not supported
+        }
+    }
+    return Result::Complete;
+}
+
+///////////////////////////////////////////////////////////////////////////////
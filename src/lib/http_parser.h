@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief One parsed HTTP request.
+/// All views point into the connection read buffer and stay valid until it is consumed.
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct HttpRequest
+{
+    std::string_view method;
+    std::string_view target;
+    std::string_view body;
+    std::string_view idempotencyKey; // Value of an Idempotency-Key header, empty without one
+    int versionMinor = 1;       // HTTP/1.<versionMinor>
+    bool keepAlive = true;      // Whether the connection stays open after the response
+    std::size_t size = 0;       // Bytes taken by the request, header and body
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Incremental HTTP/1.x request parser.
+/// Works in place on the caller's buffer and never allocates. Feed it the unconsumed
+/// bytes of the connection each time more data arrives; it remembers how far it already
+/// searched for the end of the header so partial requests are not rescanned.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class HttpRequestParser
+{
+public:
+    /// @brief Outcome of a parse call
+    enum class Result
+    {
+        Complete,   // 'request' holds a full request of request.size bytes
+        Incomplete, // More bytes are needed
+        Invalid,        // Malformed or unsupported request, the connection should be closed
+        TooLarge,       // The body is longer than the parser accepts, the connection should be closed
+        HeaderTooLarge  // The header is longer than MAX_HEADER_SIZE, the connection should be closed
+    };
+
+    /// @brief Largest accepted request header
+    static const std::size_t MAX_HEADER_SIZE = 8192;
+
+    /// @brief Largest accepted request body by default
+    static const std::size_t DEFAULT_MAX_BODY_SIZE = 1 << 20;
+
+    /// @param maxBodySize longer bodies are TooLarge, told by their Content-Length before they arrive
+    explicit HttpRequestParser(std::size_t maxBodySize = DEFAULT_MAX_BODY_SIZE);
+
+    /// @brief Tries to parse one request at the start of 'data'
+    /// @param data unconsumed bytes of the connection
+    /// @param size number of bytes in 'data'
+    /// @param request filled in when the result is Complete
+    Result parse(const char *data, std::size_t size, HttpRequest &request);
+
+    /// @brief Forgets any partial progress, e.g. after the caller consumed a request
+    void reset();
+
+    /// @return whether the header of the pending request is complete and its body is still arriving
+    bool inBody() const;
+
+private:
+    /// @brief Parses a complete header block of 'headerSize' bytes
+    Result parseHeader(const char *data, std::size_t headerSize, HttpRequest &request, std::size_t &contentLength) const;
+
+    std::size_t maxBodySize;
+    std::size_t scanned = 0;   // Bytes already searched for the header terminator
+    std::size_t headerEnd = 0; // Size of the header once its terminator was found
+};
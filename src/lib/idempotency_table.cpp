@@ -0,0 +1,131 @@
+#include <functional>
+
+#include "idempotency_table.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+IdempotencyTable::IdempotencyTable(std::chrono::seconds maxAge, std::size_t maxBytes)
+    : maxAge(maxAge), maxBytesPerShard(maxBytes / SHARD_COUNT + 1)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+IdempotencyTable::Claim IdempotencyTable::claim(const std::string &key, std::uint64_t fingerprint, std::shared_ptr<const std::string> &response,
+                                                Clock::time_point now)
+{
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    evict(shard, now);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end())
+    {
+        if (it->second.fingerprint != fingerprint)
+        {
+            return Claim::Mismatch;
+        }
+        if (!it->second.response)
+        {
+            return Claim::InProgress;
+        }
+        response = it->second.response;
+        return Claim::Replay;
+    }
+
+    Entry entry{fingerprint, shard.nextClaim++, now, nullptr};
+    shard.bytes += costOf(key, entry);
+    shard.order.emplace_back(key, entry.claimNumber);
+    shard.entries.emplace(key, std::move(entry));
+    return Claim::New;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void IdempotencyTable::complete(const std::string &key, std::shared_ptr<const std::string> response, Clock::time_point now)
+{
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end() || it->second.response)
+    {
+        return; // Evicted while the request ran, the response is not kept
+    }
+    shard.bytes -= costOf(key, it->second);
+    it->second.response = std::move(response);
+    shard.bytes += costOf(key, it->second);
+    evict(shard, now);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void IdempotencyTable::abandon(const std::string &key)
+{
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end() && !it->second.response)
+    {
+        // Its place in 'order' is skipped once it comes up, the claim number no longer matches
+        shard.bytes -= costOf(key, it->second);
+        shard.entries.erase(it);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t IdempotencyTable::fingerprintOf(std::string_view target, std::string_view body)
+{
+    std::hash<std::string_view> hash;
+    std::uint64_t fingerprint = hash(target);
+    return fingerprint ^ (hash(body) + 0x9e3779b97f4a7c15ull + (fingerprint << 6) + (fingerprint >> 2));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t IdempotencyTable::size() const
+{
+    std::size_t count = 0;
+    for (const Shard &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count += shard.entries.size();
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+IdempotencyTable::Shard &IdempotencyTable::shardFor(const std::string &key) const
+{
+    return shards[std::hash<std::string>()(key) % SHARD_COUNT];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void IdempotencyTable::evict(Shard &shard, Clock::time_point now) const
+{
+    while (!shard.order.empty())
+    {
+        const auto &oldest = shard.order.front();
+        auto it = shard.entries.find(oldest.first);
+        if (it != shard.entries.end() && it->second.claimNumber == oldest.second)
+        {
+            if (now - it->second.claimed < maxAge && shard.bytes <= maxBytesPerShard)
+            {
+                return; // Every later claim is younger
+            }
+            shard.bytes -= costOf(it->first, it->second);
+            shard.entries.erase(it);
+        }
+        shard.order.pop_front();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t IdempotencyTable::costOf(const std::string &key, const Entry &entry)
+{
+    return ENTRY_OVERHEAD + 2 * key.size() + (entry.response ? entry.response->size() : 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Recent idempotency keys of booking requests and the responses sent for them.
+///
+/// A client that retries a booking with the same Idempotency-Key gets the stored response
+/// instead of booking again. The first request claims its key, which stays pending until
+/// its response is stored. Requests meeting a pending key or a key used for another request
+/// are told so. Entries expire 'maxAge' after their claim and the oldest ones go first
+/// once the stored bytes pass 'maxBytes'. The table is split in independently locked
+/// shards, each evicting in claim order from its own queue, so no lookup scans it.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class IdempotencyTable
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::seconds DEFAULT_MAX_AGE{3600};
+    static constexpr std::size_t DEFAULT_MAX_BYTES = 64 << 20;
+    static constexpr std::size_t MAX_KEY_SIZE = 255; // Longer keys are rejected
+
+    /// @brief Outcome of claim
+    enum class Claim
+    {
+        New,        // First use of the key, the caller runs the request and calls complete
+        Replay,     // The key was used for the same request, 'response' is what it got
+        InProgress, // The first request with the key has not finished yet
+        Mismatch    // The key was used for a different request
+    };
+
+    explicit IdempotencyTable(std::chrono::seconds maxAge = DEFAULT_MAX_AGE, std::size_t maxBytes = DEFAULT_MAX_BYTES);
+
+    /// @brief Looks up a key, claiming it if it is unknown or expired
+    /// @param fingerprint identifies the request, see fingerprintOf
+    /// @param response set to the stored response on Replay
+    Claim claim(const std::string &key, std::uint64_t fingerprint, std::shared_ptr<const std::string> &response,
+                Clock::time_point now = Clock::now());
+
+    /// @brief Stores the response of a claimed key, retries now get it
+    void complete(const std::string &key, std::shared_ptr<const std::string> response, Clock::time_point now = Clock::now());
+
+    /// @brief Forgets a claimed key without a response, so a retry runs the request again
+    void abandon(const std::string &key);
+
+    /// @brief Hashes what a request does: its target and body
+    static std::uint64_t fingerprintOf(std::string_view target, std::string_view body);
+
+    /// @return number of keys, pending ones included
+    std::size_t size() const;
+
+private:
+    static const std::size_t SHARD_COUNT = 16;
+    static const std::size_t ENTRY_OVERHEAD = 128; // Rough cost of an entry besides its key and response
+
+    struct Entry
+    {
+        std::uint64_t fingerprint;
+        std::uint64_t claimNumber;                  // Tells this claim apart from earlier ones of the key in 'order'
+        Clock::time_point claimed;
+        std::shared_ptr<const std::string> response; // nullptr while pending
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        std::deque<std::pair<std::string, std::uint64_t>> order; // Keys and claim numbers, oldest claim first
+        std::size_t bytes = 0;
+        std::uint64_t nextClaim = 0;
+    };
+
+    Shard &shardFor(const std::string &key) const;
+
+    /// @brief Drops the entries of a shard that are too old or over its byte budget, oldest first
+    void evict(Shard &shard, Clock::time_point now) const;
+
+    /// @return bytes an entry counts for
+    static std::size_t costOf(const std::string &key, const Entry &entry);
+
+    std::chrono::seconds maxAge;
+    std::size_t maxBytesPerShard;
+    mutable Shard shards[SHARD_COUNT];
+};
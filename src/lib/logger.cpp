@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "logger.h"
+
+namespace
+{
+    std::atomic<std::uint64_t> nextLoggerId{1};
+
+    const char *levelName(LogLevel level)
+    {
+        switch (level)
+        {
+        case LogLevel::Debug:
+            return "DEBUG";
+        case LogLevel::Info:
+            return "INFO";
+        case LogLevel::Warning:
+            return "WARN";
+        case LogLevel::Error:
+            return "ERROR";
+        default:
+            return "";
+        }
+    }
+
+    /// @brief Ring cache of the calling thread: the ring last used, then one per logger it wrote to
+    struct LocalRings
+    {
+        std::uint64_t lastLoggerId = 0;
+        void *lastRing = nullptr;
+        std::vector<std::pair<std::uint64_t, void *>> byLogger; // Logger ids are never reused
+    };
+
+    thread_local LocalRings localRingCache;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Logger::Logger(const std::string &path, LogLevel level, std::uint32_t sampleEvery)
+    : id(nextLoggerId.fetch_add(1)), threshold(level), sampleEvery(std::max<std::uint32_t>(sampleEvery, 1)),
+      output(stdout), ownsOutput(false)
+{
+    if (!path.empty() && path != "-")
+    {
+        output = std::fopen(path.c_str(), "a");
+        if (!output)
+        {
+            throw std::runtime_error("cannot open log file " + path);
+        }
+        ownsOutput = true;
+    }
+    writer = std::thread([this]
+                         { writerLoop(); });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Logger::~Logger()
+{
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopping = true;
+    }
+    wakeWriter.notify_one();
+    writer.join();
+    flush();
+    if (ownsOutput)
+    {
+        std::fclose(output);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Logger::parseLevel(const std::string &name, LogLevel &level)
+{
+    static const std::pair<const char *, LogLevel> names[] = {
+        {"debug", LogLevel::Debug}, {"info", LogLevel::Info}, {"warning", LogLevel::Warning}, {"error", LogLevel::Error}, {"off", LogLevel::Off}};
+    for (const auto &entry : names)
+    {
+        if (name == entry.first)
+        {
+            level = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Logger::Ring &Logger::localRing()
+{
+    if (localRingCache.lastLoggerId == id)
+    {
+        return *static_cast<Ring *>(localRingCache.lastRing);
+    }
+    // A thread switching between loggers keeps the ring it has in each
+    auto cached = std::find_if(localRingCache.byLogger.begin(), localRingCache.byLogger.end(),
+                               [this](const std::pair<std::uint64_t, void *> &entry)
+                               { return entry.first == id; });
+    if (cached == localRingCache.byLogger.end())
+    {
+        // First message of this thread: register a ring, the only time a producer locks
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.emplace_back(new Ring());
+        rings.back()->threadNumber = static_cast<std::uint32_t>(rings.size());
+        cached = localRingCache.byLogger.emplace(localRingCache.byLogger.end(), id, rings.back().get());
+    }
+    localRingCache.lastLoggerId = id;
+    localRingCache.lastRing = cached->second;
+    return *static_cast<Ring *>(cached->second);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Logger::Record *Logger::beginRecord(LogLevel level)
+{
+    Ring &ring = localRing();
+    if (level < LogLevel::Warning && ring.sampleCounter++ % sampleEvery != 0)
+    {
+        return nullptr;
+    }
+    std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= RING_SIZE)
+    {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Record &record = ring.records[head % RING_SIZE];
+    record.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    record.level = level;
+    record.truncated = false;
+    record.length = 0;
+    return &record;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::commitRecord()
+{
+    Ring &ring = localRing();
+    ring.head.store(ring.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::append(Record &record, std::string_view text)
+{
+    std::size_t room = MAX_MESSAGE_SIZE - record.length;
+    if (text.size() > room)
+    {
+        text = text.substr(0, room);
+        record.truncated = true;
+    }
+    std::memcpy(record.text + record.length, text.data(), text.size());
+    record.length = static_cast<std::uint16_t>(record.length + text.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::append(Record &record, char character)
+{
+    append(record, std::string_view(&character, 1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::format(const Ring &ring, const Record &record, std::string &out)
+{
+    // Consecutive records mostly fall in the same second, format the date once per second
+    std::int64_t second = record.time / 1000000;
+    if (second != cachedSecond)
+    {
+        std::time_t seconds = static_cast<std::time_t>(second);
+        std::tm local;
+        localtime_r(&seconds, &local);
+        std::strftime(cachedTime, sizeof(cachedTime), "%Y-%m-%d %H:%M:%S", &local);
+        cachedSecond = second;
+    }
+    char micros[16]; // Room for any int, the value always takes 6 digits
+    std::snprintf(micros, sizeof(micros), ".%06d", static_cast<int>(record.time % 1000000));
+
+    out += cachedTime;
+    out += micros;
+    out += ' ';
+    out += levelName(record.level);
+    out += " [t";
+    out += std::to_string(ring.threadNumber);
+    out += "] ";
+    out.append(record.text, record.length);
+    if (record.truncated)
+    {
+        out += "...";
+    }
+    out += '\n';
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Logger::drain()
+{
+    std::lock_guard<std::mutex> drainLock(drainMutex);
+    std::vector<Ring *> current;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (auto &ring : rings)
+        {
+            current.push_back(ring.get());
+        }
+    }
+
+    buffer.clear();
+    for (Ring *ring : current)
+    {
+        std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        std::uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail)
+        {
+            format(*ring, ring->records[tail % RING_SIZE], buffer);
+        }
+        ring->tail.store(tail, std::memory_order_release); // Hands the records back to the thread
+    }
+
+    std::uint64_t dropped = getDroppedCount();
+    if (dropped != reportedDropped)
+    {
+        buffer += "logger: dropped ";
+        buffer += std::to_string(dropped - reportedDropped);
+        buffer += " messages, ring full\n";
+        reportedDropped = dropped;
+    }
+
+    if (buffer.empty())
+    {
+        return false;
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), output);
+    std::fflush(output);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::flush()
+{
+    drain();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t Logger::getDroppedCount() const
+{
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    std::uint64_t dropped = 0;
+    for (const auto &ring : rings)
+    {
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::writerLoop()
+{
+    const auto IDLE_WAIT = std::chrono::milliseconds(5);
+
+    std::unique_lock<std::mutex> lock(stopMutex);
+    while (!stopping)
+    {
+        lock.unlock();
+        bool wrote = drain();
+        lock.lock();
+        if (!wrote)
+        {
+            // Producers never signal, the writer polls while idle
+            wakeWriter.wait_for(lock, IDLE_WAIT);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum class LogLevel : std::uint8_t
+{
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Asynchronous logger for the request path.
+///
+/// Every logging thread gets its own ring of fixed size records. log() copies the message
+/// parts into the next free record without locking or allocating. If the ring is full the
+/// message is dropped and counted. A writer thread drains the rings, adds the timestamp
+/// and level, and writes the lines in batches to a file or stdout.
+///
+/// Messages below the level are skipped. With sampling only every Nth debug or info
+/// message of a thread is kept; warnings and errors are always kept.
+/// Lines of one thread stay in order. Lines of different threads may interleave out of
+/// timestamp order.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class Logger
+{
+public:
+    static constexpr std::size_t RING_SIZE = 1024;       // Records per thread
+    static constexpr std::size_t MAX_MESSAGE_SIZE = 240; // Longer messages are cut
+
+    /// @brief Starts the writer thread
+    /// @param path file the lines are appended to, stdout if empty or "-"
+    /// @param level lowest level written
+    /// @param sampleEvery keep one of every 'sampleEvery' debug and info messages per thread
+    explicit Logger(const std::string &path = std::string(), LogLevel level = LogLevel::Info, std::uint32_t sampleEvery = 1);
+
+    /// @brief Writes what is queued and stops the writer thread
+    ~Logger();
+
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    /// @brief Whether messages of 'level' are written at all
+    bool isEnabled(LogLevel level) const
+    {
+        return level >= threshold && level != LogLevel::Off;
+    }
+
+    /// @brief Queues one line made of 'parts': strings, characters and integers
+    template <typename... Parts>
+    void log(LogLevel level, const Parts &...parts)
+    {
+        if (!isEnabled(level))
+        {
+            return;
+        }
+        Record *record = beginRecord(level);
+        if (!record)
+        {
+            return; // Sampled out or dropped
+        }
+        (append(*record, parts), ...);
+        commitRecord();
+    }
+
+    /// @brief Blocks until every message queued before the call is written
+    void flush();
+
+    /// @brief Number of messages lost because a ring was full
+    std::uint64_t getDroppedCount() const;
+
+    /// @brief Parses "debug", "info", "warning", "error" or "off"
+    /// @return false if 'name' is none of them
+    static bool parseLevel(const std::string &name, LogLevel &level);
+
+private:
+    struct Record
+    {
+        std::int64_t time; // Microseconds since the epoch
+        LogLevel level;
+        bool truncated;
+        std::uint16_t length;
+        char text[MAX_MESSAGE_SIZE];
+    };
+
+    /// @brief Single producer single consumer ring of one thread
+    struct Ring
+    {
+        alignas(64) std::atomic<std::uint64_t> head{0}; // Next record to fill, written by the owning thread
+        std::uint64_t sampleCounter = 0;
+        alignas(64) std::atomic<std::uint64_t> tail{0}; // Next record to write, written by the writer
+        std::atomic<std::uint64_t> dropped{0};
+        std::uint32_t threadNumber = 0;
+        Record records[RING_SIZE];
+    };
+
+    /// @brief Ring of the calling thread, created on its first message
+    Ring &localRing();
+
+    /// @brief Claims the next record of the calling thread's ring
+    /// @return nullptr if the message is sampled out or the ring is full
+    Record *beginRecord(LogLevel level);
+
+    /// @brief Publishes the record claimed by beginRecord to the writer
+    void commitRecord();
+
+    static void append(Record &record, std::string_view text);
+    static void append(Record &record, char character);
+
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    static void append(Record &record, T value)
+    {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        append(record, std::string_view(digits, result.ptr - digits));
+    }
+
+    /// @brief Writes every queued record, writer thread or flush() only
+    /// @return whether anything was written
+    bool drain();
+
+    /// @brief Formats one record as a line into 'out'
+    void format(const Ring &ring, const Record &record, std::string &out);
+
+    void writerLoop();
+
+    const std::uint64_t id; // Tells thread local ring caches of different loggers apart
+    const LogLevel threshold;
+    const std::uint32_t sampleEvery;
+    FILE *output;
+    bool ownsOutput;
+
+    mutable std::mutex ringsMutex; // Guards 'rings' against threads registering
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    std::mutex drainMutex; // Makes the writer thread and flush() take turns as the consumer
+    std::string buffer;    // Formatted lines of one drain pass
+    std::int64_t cachedSecond = -1;
+    char cachedTime[32];
+    std::uint64_t reportedDropped = 0;
+
+    std::mutex stopMutex;
+    std::condition_variable wakeWriter;
+    bool stopping = false;
+    std::thread writer;
+};
@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "metrics.h"
+
+namespace
+{
+    std::atomic<std::uint64_t> nextMetricsId{1};
+
+    /// @brief Metrics block of the calling thread, valid for the instance with 'metricsId'
+    struct LocalMetrics
+    {
+        std::uint64_t metricsId = 0;
+        void *metrics = nullptr;
+    };
+
+    thread_local LocalMetrics localMetricsCache;
+
+    const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999, 1.0};
+    const double NANOS_PER_SECOND = 1e9;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// LatencyHistogram Implementation
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t LatencyHistogram::bucketFor(std::uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+    {
+        return static_cast<std::size_t>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > MAX_EXPONENT)
+    {
+        return BUCKET_COUNT - 1;
+    }
+    // The top SUB_BUCKET_BITS bits below the leading one pick the sub bucket
+    std::size_t sub = static_cast<std::size_t>(value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+    return SUB_BUCKETS + (exponent - SUB_BUCKET_BITS) * SUB_BUCKETS + sub;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t LatencyHistogram::bucketUpperBound(std::size_t index)
+{
+    if (index < SUB_BUCKETS)
+    {
+        return index;
+    }
+    int shift = static_cast<int>((index - SUB_BUCKETS) / SUB_BUCKETS);
+    std::uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LatencyHistogram::record(std::uint64_t value)
+{
+    std::atomic<std::uint64_t> &bucket = buckets[bucketFor(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LatencyHistogram::addTo(std::vector<std::uint64_t> &counts) const
+{
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        counts[i] += buckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t LatencyHistogram::valueAtQuantile(const std::vector<std::uint64_t> &counts, double quantile)
+{
+    std::uint64_t total = 0;
+    for (std::uint64_t count : counts)
+    {
+        total += count;
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    // Rank of the wanted value, 1 based, at least the first one
+    std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(quantile * total + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts.size(); ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            return bucketUpperBound(i);
+        }
+    }
+    return bucketUpperBound(counts.size() - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Metrics Implementation
+///////////////////////////////////////////////////////////////////////////////
+
+Metrics::Metrics() : id(nextMetricsId.fetch_add(1))
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Metrics::ThreadMetrics &Metrics::local()
+{
+    if (localMetricsCache.metricsId == id)
+    {
+        return *static_cast<ThreadMetrics *>(localMetricsCache.metrics);
+    }
+    // First update from this thread: register its block, the only time an update locks
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    threads.emplace_back(new ThreadMetrics());
+    localMetricsCache.metricsId = id;
+    localMetricsCache.metrics = threads.back().get();
+    return *threads.back();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Metrics::recordRequest(Route route, std::uint64_t nanos, bool error)
+{
+    ThreadMetrics &metrics = local();
+    std::size_t index = static_cast<std::size_t>(route);
+    metrics.requests[index].add();
+    if (error)
+    {
+        metrics.errors[index].add();
+    }
+    metrics.latencySum[index].add(nanos);
+    metrics.latency[index].record(nanos);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Metrics::recordBooking(bool booked)
+{
+    ThreadMetrics &metrics = local();
+    (booked ? metrics.bookingSuccesses : metrics.bookingConflicts).add();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Metrics::sessionOpened()
+{
+    local().sessionsOpened.add();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Metrics::sessionClosed()
+{
+    local().sessionsClosed.add();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Metrics::recordRejection(Rejection reason)
+{
+    local().rejections[static_cast<std::size_t>(reason)].add();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Metrics::recordLoopLag(std::uint64_t nanos)
+{
+    local().loopLag.record(nanos);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Metrics::Totals Metrics::collect() const
+{
+    Totals totals;
+    totals.latency.assign(static_cast<std::size_t>(Route::Count), std::vector<std::uint64_t>(LatencyHistogram::BUCKET_COUNT, 0));
+    totals.loopLag.assign(LatencyHistogram::BUCKET_COUNT, 0);
+
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    std::uint64_t opened = 0;
+    std::uint64_t closed = 0;
+    for (const auto &metrics : threads)
+    {
+        for (std::size_t route = 0; route < static_cast<std::size_t>(Route::Count); ++route)
+        {
+            totals.requests[route] += metrics->requests[route].get();
+            totals.errors[route] += metrics->errors[route].get();
+            totals.latencySum[route] += metrics->latencySum[route].get();
+            metrics->latency[route].addTo(totals.latency[route]);
+        }
+        totals.bookingSuccesses += metrics->bookingSuccesses.get();
+        totals.bookingConflicts += metrics->bookingConflicts.get();
+        opened += metrics->sessionsOpened.get();
+        closed += metrics->sessionsClosed.get();
+        for (std::size_t reason = 0; reason < static_cast<std::size_t>(Rejection::Count); ++reason)
+        {
+            totals.rejections[reason] += metrics->rejections[reason].get();
+        }
+        metrics->loopLag.addTo(totals.loopLag);
+    }
+    // Sessions may close on another thread than the one that opened them
+    totals.openSessions = static_cast<std::int64_t>(opened - closed);
+    return totals;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Metrics::render(std::string &out) const
+{
+    Totals totals = collect();
+
+    out += "# TYPE reservation_requests_total counter\n";
+    for (std::size_t route = 0; route < static_cast<std::size_t>(Route::Count); ++route)
+    {
+        writeSample(out, "reservation_requests_total", label("route", routeName(static_cast<Route>(route))), static_cast<double>(totals.requests[route]));
+    }
+    out += "# TYPE reservation_request_errors_total counter\n";
+    for (std::size_t route = 0; route < static_cast<std::size_t>(Route::Count); ++route)
+    {
+        writeSample(out, "reservation_request_errors_total", label("route", routeName(static_cast<Route>(route))), static_cast<double>(totals.errors[route]));
+    }
+    out += "# TYPE reservation_request_duration_seconds summary\n";
+    for (std::size_t route = 0; route < static_cast<std::size_t>(Route::Count); ++route)
+    {
+        std::string routeLabel = label("route", routeName(static_cast<Route>(route)));
+        for (double quantile : QUANTILES)
+        {
+            char quantileText[16];
+            std::snprintf(quantileText, sizeof(quantileText), "%g", quantile);
+            writeSample(out, "reservation_request_duration_seconds", routeLabel + "," + label("quantile", quantileText),
+                        LatencyHistogram::valueAtQuantile(totals.latency[route], quantile) / NANOS_PER_SECOND);
+        }
+        writeSample(out, "reservation_request_duration_seconds_sum", routeLabel, totals.latencySum[route] / NANOS_PER_SECOND);
+        writeSample(out, "reservation_request_duration_seconds_count", routeLabel, static_cast<double>(totals.requests[route]));
+    }
+
+    out += "# TYPE reservation_bookings_total counter\n";
+    writeSample(out, "reservation_bookings_total", label("result", "success"), static_cast<double>(totals.bookingSuccesses));
+    writeSample(out, "reservation_bookings_total", label("result", "conflict"), static_cast<double>(totals.bookingConflicts));
+
+    out += "# TYPE reservation_sessions_open gauge\n";
+    writeSample(out, "reservation_sessions_open", "", static_cast<double>(totals.openSessions));
+
+    out += "# TYPE reservation_rejections_total counter\n";
+    for (std::size_t reason = 0; reason < static_cast<std::size_t>(Rejection::Count); ++reason)
+    {
+        writeSample(out, "reservation_rejections_total", label("reason", rejectionName(static_cast<Rejection>(reason))), static_cast<double>(totals.rejections[reason]));
+    }
+
+    out += "# TYPE reservation_event_loop_lag_seconds summary\n";
+    for (double quantile : QUANTILES)
+    {
+        char quantileText[16];
+        std::snprintf(quantileText, sizeof(quantileText), "%g", quantile);
+        writeSample(out, "reservation_event_loop_lag_seconds", label("quantile", quantileText),
+                    LatencyHistogram::valueAtQuantile(totals.loopLag, quantile) / NANOS_PER_SECOND);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Metrics::Route Metrics::routeFor(std::string_view target)
+{
+    for (std::size_t route = 0; route < static_cast<std::size_t>(Route::Other); ++route)
+    {
+        if (target == routeName(static_cast<Route>(route)))
+        {
+            return static_cast<Route>(route);
+        }
+    }
+    return Route::Other;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const char *Metrics::routeName(Route route)
+{
+    static const char *names[] = {"/movies", "/find", "/bookings", "/bookings/changes", "/seats", "/seats/batch", "/seats/auto", "/showtimes", "/holds", "/holds/confirm", "/holds/release", "/admin/reload", "/metrics", "binary/catalog", "binary/occupancy", "binary/book", "other"};
+    return route < Route::Count ? names[static_cast<std::size_t>(route)] : "other";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const char *Metrics::rejectionName(Rejection reason)
+{
+    static const char *names[] = {"connection_limit", "overload", "timeout", "body_too_large"};
+    return reason < Rejection::Count ? names[static_cast<std::size_t>(reason)] : "other";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Metrics::writeSample(std::string &out, std::string_view name, std::string_view labels, double value)
+{
+    char number[32];
+    std::snprintf(number, sizeof(number), "%.9g", value);
+    out += name;
+    if (!labels.empty())
+    {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += number;
+    out += '\n';
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string Metrics::label(std::string_view name, std::string_view value)
+{
+    std::string text(name);
+    text += "=\"";
+    for (char character : value)
+    {
+        if (character == '\\' || character == '"')
+        {
+            text += '\\';
+            text += character;
+        }
+        else if (character == '\n')
+        {
+            text += "\\n";
+        }
+        else
+        {
+            text += character;
+        }
+    }
+    text += '"';
+    return text;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Latency histogram with HDR-style log-linear buckets.
+/// Values below 16 get their own bucket. Above that every power of two is split into 16
+/// equal buckets, so a recorded value is off by less than 1/16 (6.25%) of itself.
+/// Values are nanoseconds. Anything past 2^41 ns (about 36 minutes) lands in the last bucket.
+/// Only one thread records, any thread may read.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr std::size_t SUB_BUCKETS = std::size_t(1) << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 40;
+    static constexpr std::size_t BUCKET_COUNT = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    /// @brief Adds one value, owning thread only
+    void record(std::uint64_t value);
+
+    /// @brief Adds the bucket counts to 'counts', which must hold BUCKET_COUNT entries
+    void addTo(std::vector<std::uint64_t> &counts) const;
+
+    /// @brief Bucket holding 'value'
+    static std::size_t bucketFor(std::uint64_t value);
+
+    /// @brief Largest value that falls in bucket 'index'
+    static std::uint64_t bucketUpperBound(std::size_t index);
+
+    /// @brief Value at 'quantile' (0..1) of merged bucket counts, 0 if there are none
+    static std::uint64_t valueAtQuantile(const std::vector<std::uint64_t> &counts, double quantile);
+
+private:
+    std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> buckets{};
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Server metrics: request rates, errors and latencies per route, booking outcomes,
+/// open sessions and event loop lag.
+///
+/// Every thread updates its own block of counters with plain relaxed stores, no locks and
+/// no shared cache lines. render() adds the blocks up when /metrics is scraped and writes
+/// them in the Prometheus text format.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class Metrics
+{
+public:
+    enum class Route : std::uint8_t
+    {
+        Movies,
+        Find,
+        Bookings,
+        BookingChanges,
+        Seats,
+        SeatsBatch,
+        SeatsAuto,
+        Showtimes,
+        Holds,
+        HoldsConfirm,
+        HoldsRelease,
+        AdminReload,
+        Metrics,
+        BinaryCatalog,
+        BinaryOccupancy,
+        BinaryBook,
+        Other,
+        Count
+    };
+
+    /// @brief Why the server turned a connection or request away
+    enum class Rejection : std::uint8_t
+    {
+        ConnectionLimit, // Too many open connections
+        Overload,        // Too many requests in flight or the event loop too late
+        Timeout,         // The client did not send a request in time
+        BodyTooLarge,
+        Count
+    };
+
+    /// @brief Merged view of every thread's counters
+    struct Totals
+    {
+        std::array<std::uint64_t, static_cast<std::size_t>(Route::Count)> requests{};
+        std::array<std::uint64_t, static_cast<std::size_t>(Route::Count)> errors{};
+        std::array<std::uint64_t, static_cast<std::size_t>(Route::Count)> latencySum{};
+        std::vector<std::vector<std::uint64_t>> latency; // Bucket counts per route
+        std::uint64_t bookingSuccesses = 0;
+        std::uint64_t bookingConflicts = 0;
+        std::int64_t openSessions = 0;
+        std::array<std::uint64_t, static_cast<std::size_t>(Rejection::Count)> rejections{};
+        std::vector<std::uint64_t> loopLag;
+    };
+
+    Metrics();
+
+    Metrics(const Metrics &) = delete;
+    Metrics &operator=(const Metrics &) = delete;
+
+    /// @brief Counts a request of 'route' that took 'nanos', 'error' for 4xx and 5xx responses
+    void recordRequest(Route route, std::uint64_t nanos, bool error);
+
+    /// @brief Counts a booking attempt, 'booked' false if its seats were taken
+    void recordBooking(bool booked);
+
+    void sessionOpened();
+    void sessionClosed();
+
+    /// @brief Counts a connection or request turned away
+    void recordRejection(Rejection reason);
+
+    /// @brief Records how late the event loop ran a handler that was due
+    void recordLoopLag(std::uint64_t nanos);
+
+    /// @brief Adds up the counters of all threads
+    Totals collect() const;
+
+    /// @brief Writes the merged counters in the Prometheus text format
+    void render(std::string &out) const;
+
+    /// @brief Route of a request target
+    static Route routeFor(std::string_view target);
+
+    static const char *routeName(Route route);
+
+    static const char *rejectionName(Rejection reason);
+
+    /// @brief Writes one sample line, 'labels' as built by label()
+    static void writeSample(std::string &out, std::string_view name, std::string_view labels, double value);
+
+    /// @brief Formats name="value", escaping the value
+    static std::string label(std::string_view name, std::string_view value);
+
+private:
+    /// @brief One single writer counter
+    struct Counter
+    {
+        void add(std::uint64_t amount = 1)
+        {
+            value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        std::uint64_t get() const
+        {
+            return value.load(std::memory_order_relaxed);
+        }
+
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    /// @brief Counters written by one thread
+    struct alignas(64) ThreadMetrics
+    {
+        std::array<Counter, static_cast<std::size_t>(Route::Count)> requests;
+        std::array<Counter, static_cast<std::size_t>(Route::Count)> errors;
+        std::array<Counter, static_cast<std::size_t>(Route::Count)> latencySum;
+        std::array<LatencyHistogram, static_cast<std::size_t>(Route::Count)> latency;
+        Counter bookingSuccesses;
+        Counter bookingConflicts;
+        Counter sessionsOpened;
+        Counter sessionsClosed;
+        std::array<Counter, static_cast<std::size_t>(Rejection::Count)> rejections;
+        LatencyHistogram loopLag;
+    };
+
+    /// @brief Block of the calling thread, created on its first update
+    ThreadMetrics &local();
+
+    const std::uint64_t id; // Tells thread local caches of different instances apart
+    mutable std::mutex threadsMutex; // Guards 'threads' against threads registering
+    std::vector<std::unique_ptr<ThreadMetrics>> threads;
+};
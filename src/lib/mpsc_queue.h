@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Unbounded lock-free multi-producer single-consumer queue.
+/// Producers link their node in with a single atomic exchange and never wait for each
+/// other or for the consumer. Only one thread at a time may call pop().
+/// A push that is halfway through can hide the items behind it from pop() for a moment;
+/// it never loses them.
+///////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head(new Node()), tail(head.load(std::memory_order_relaxed))
+    {
+    }
+
+    ~MpscQueue()
+    {
+        T ignored;
+        while (pop(ignored))
+        {
+        }
+        delete tail;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    /// @brief Appends 'value', safe to call from any thread
+    void push(T value)
+    {
+        Node *node = new Node(std::move(value));
+        Node *previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    /// @brief Takes the oldest value, consumer thread only
+    /// @return false if the queue is empty
+    bool pop(T &value)
+    {
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+        {
+            return false;
+        }
+        // 'next' becomes the new empty front node
+        value = std::move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        Node() : next(nullptr)
+        {
+        }
+
+        explicit Node(T value) : next(nullptr), value(std::move(value))
+        {
+        }
+
+        std::atomic<Node *> next;
+        T value;
+    };
+
+    alignas(64) std::atomic<Node *> head; // Last pushed node, shared by the producers
+    alignas(64) Node *tail;               // Empty node in front of the oldest value, owned by the consumer
+};
@@ -0,0 +1,84 @@
+#include <stdexcept>
+
+#include "rcu_pointer.h"
+
+namespace
+{
+    /// @brief Hazard slots of one thread, alone on their cache line
+    struct alignas(64) ThreadSlots
+    {
+        std::atomic<const void *> slots[rcu::MAX_NESTING] = {};
+    };
+
+    /// @brief Every live thread's slots. Locked when a thread starts or stops reading and by writers scanning them
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<ThreadSlots *> threads;
+    };
+
+    Registry &registry()
+    {
+        // Never destroyed, threads may still unregister while statics are torn down
+        static Registry *instance = new Registry();
+        return *instance;
+    }
+
+    /// @brief Registers the slots of a thread for its lifetime
+    struct Registration
+    {
+        Registration() : slots(new ThreadSlots())
+        {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            registry().threads.push_back(slots);
+        }
+
+        ~Registration()
+        {
+            {
+                std::lock_guard<std::mutex> lock(registry().mutex);
+                auto &threads = registry().threads;
+                threads.erase(std::remove(threads.begin(), threads.end(), slots), threads.end());
+            }
+            delete slots;
+        }
+
+        ThreadSlots *slots;
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::atomic<const void *> &rcu::acquireSlot()
+{
+    thread_local Registration registration;
+    for (auto &slot : registration.slots->slots)
+    {
+        // Only this thread writes its slots
+        if (slot.load(std::memory_order_relaxed) == nullptr)
+        {
+            return slot;
+        }
+    }
+    throw std::runtime_error("too many nested read sections");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool rcu::isInUse(const void *object)
+{
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    for (const ThreadSlots *thread : registry().threads)
+    {
+        for (const auto &slot : thread->slots)
+        {
+            if (slot.load(std::memory_order_seq_cst) == object)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Hazard slots shared by every RcuPointer.
+/// Each thread owns a few slots, on their own cache line, naming the objects it is reading.
+/// Only the owning thread writes them; writers read them all to find objects still in use.
+///////////////////////////////////////////////////////////////////////////////////////
+
+namespace rcu
+{
+    /// @brief Read sections one thread may have open at the same time
+    const int MAX_NESTING = 4;
+
+    /// @brief Takes a free hazard slot of the calling thread, registering the thread on first use.
+    /// Throws std::runtime_error if all MAX_NESTING slots are taken.
+    std::atomic<const void *> &acquireSlot();
+
+    /// @brief Whether any thread's hazard slot names 'object'
+    bool isInUse(const void *object);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Pointer to a shared object that is replaced as a whole, read-copy-update style.
+///
+/// Readers open a read section with read(). It names the current object in a hazard slot
+/// of the reading thread and keeps it alive until the guard goes away, without taking a
+/// lock or writing a cache line any other thread writes. A writer builds a new object
+/// off to the side and publishes it with one atomic pointer store. The replaced object
+/// is retired: readers already in it keep using it, and reclaim() frees it once no
+/// hazard slot names it any more. Writers are serialized with each other only.
+///////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class RcuPointer
+{
+public:
+    /// @brief Keeps the object read at the start of a read section alive until it ends
+    class ReadGuard
+    {
+    public:
+        ReadGuard(ReadGuard &&other) noexcept : slot(other.slot), object(other.object)
+        {
+            other.slot = nullptr;
+        }
+
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        ~ReadGuard()
+        {
+            if (slot)
+            {
+                slot->store(nullptr, std::memory_order_release);
+            }
+        }
+
+        T *get() const { return object; }
+        T *operator->() const { return object; }
+        T &operator*() const { return *object; }
+
+    private:
+        friend class RcuPointer;
+
+        ReadGuard(std::atomic<const void *> *slot, T *object) : slot(slot), object(object) {}
+
+        std::atomic<const void *> *slot;
+        T *object;
+    };
+
+    explicit RcuPointer(std::shared_ptr<T> initial) : pointer(initial.get()), owner(std::move(initial))
+    {
+    }
+
+    RcuPointer(const RcuPointer &) = delete;
+    RcuPointer &operator=(const RcuPointer &) = delete;
+
+    /// @brief Opens a read section on the current object
+    ReadGuard read() const
+    {
+        std::atomic<const void *> &slot = rcu::acquireSlot();
+        T *object = pointer.load(std::memory_order_acquire);
+        while (true)
+        {
+            // Announce before checking: a writer swapping after the check finds the slot when it reclaims
+            slot.store(object, std::memory_order_seq_cst);
+            T *current = pointer.load(std::memory_order_seq_cst);
+            if (current == object)
+            {
+                return ReadGuard(&slot, object);
+            }
+            object = current;
+        }
+    }
+
+    /// @return the current object, for writers building the next one from it
+    std::shared_ptr<T> current() const
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        return owner;
+    }
+
+    /// @brief Makes 'next' the current object and retires the previous one
+    /// @return the previous object
+    std::shared_ptr<T> publish(std::shared_ptr<T> next)
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        std::shared_ptr<T> previous = std::move(owner);
+        owner = std::move(next);
+        pointer.store(owner.get(), std::memory_order_seq_cst);
+        retired.push_back(previous);
+        return previous;
+    }
+
+    /// @brief Frees the retired objects no read section uses any more
+    /// @return number of retired objects still in use
+    std::size_t reclaim()
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        retired.erase(std::remove_if(retired.begin(), retired.end(), [](const std::shared_ptr<T> &object)
+                                     { return !rcu::isInUse(object.get()); }),
+                      retired.end());
+        return retired.size();
+    }
+
+private:
+    std::atomic<T *> pointer;
+    mutable std::mutex writerMutex; // Taken by writers and reclaim() only
+    std::shared_ptr<T> owner;
+    std::vector<std::shared_ptr<T>> retired; // Replaced objects, possibly still read
+};
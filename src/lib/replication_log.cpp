@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <chrono>
+
+#include "replication_log.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    void putU32(std::string &out, std::uint32_t value)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            out += static_cast<char>((value >> shift) & 0xff);
+        }
+    }
+
+    void putU64(std::string &out, std::uint64_t value)
+    {
+        putU32(out, static_cast<std::uint32_t>(value));
+        putU32(out, static_cast<std::uint32_t>(value >> 32));
+    }
+
+    std::uint32_t getU32(const char *data)
+    {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+        return bytes[0] | (std::uint32_t(bytes[1]) << 8) | (std::uint32_t(bytes[2]) << 16) | (std::uint32_t(bytes[3]) << 24);
+    }
+
+    std::uint64_t getU64(const char *data)
+    {
+        return getU32(data) | (std::uint64_t(getU32(data + 4)) << 32);
+    }
+
+    /// @brief Overwrites the 8 bytes at 'offset' of 'out'
+    void patchU64(std::string &out, std::size_t offset, std::uint64_t value)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            out[offset + i] = static_cast<char>((value >> (8 * i)) & 0xff);
+        }
+    }
+
+    const std::size_t SEQUENCE_OFFSET = ReplicationLog::LENGTH_SIZE + 1; // After the length and the type
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ReplicationLog::ReplicationLog(std::size_t maxBytes)
+    : maxBytes(maxBytes)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicationLog::append(const BookingLog::Record &record)
+{
+    // Encoded outside the lock, only the sequence and time are filled in under it
+    std::string frame;
+    writeRecord(frame, 0, 0, record);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    push(std::move(frame));
+    wakeWaiters(lock);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicationLog::appendResets(const BookingLog::SnapshotFunction &snapshot)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    snapshot([this](const BookingLog::Record &record)
+             {
+                 std::string frame;
+                 writeRecord(frame, 0, 0, record, MessageType::Reset);
+                 push(std::move(frame));
+             });
+    wakeWaiters(lock);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicationLog::push(std::string frame)
+{
+    // Stamped with the sequence, so a replica's lag never goes backwards
+    patchU64(frame, SEQUENCE_OFFSET, ++sequence);
+    patchU64(frame, SEQUENCE_OFFSET + 8, static_cast<std::uint64_t>(nowMicros()));
+    bytes += frame.size();
+    frames.push_back(std::move(frame));
+    while (bytes > maxBytes && frames.size() > 1)
+    {
+        bytes -= frames.front().size();
+        frames.pop_front();
+        ++firstSequence;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicationLog::wakeWaiters(std::unique_lock<std::mutex> &lock)
+{
+    if (waiters.empty())
+    {
+        return;
+    }
+    std::vector<std::pair<std::uint64_t, std::function<void()>>> woken;
+    woken.swap(waiters);
+    lock.unlock();
+    for (auto &waiter : woken)
+    {
+        waiter.second();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ReplicationLog::getSequence() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return sequence;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReplicationLog::readSince(std::uint64_t &since, std::string &out, std::size_t maxBytes) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (since > sequence || since + 1 < firstSequence)
+    {
+        return false;
+    }
+    std::size_t start = out.size();
+    while (since < sequence && (out.size() == start || out.size() - start < maxBytes))
+    {
+        ++since;
+        out += frames[since - firstSequence];
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ReplicationLog::waitAfter(std::uint64_t since, std::function<void()> wake)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sequence != since)
+    {
+        return 0;
+    }
+    std::uint64_t ticket = nextTicket++;
+    waiters.emplace_back(ticket, std::move(wake));
+    return ticket;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicationLog::cancelWait(std::uint64_t ticket)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(waiters.begin(), waiters.end(), [ticket](const std::pair<std::uint64_t, std::function<void()>> &waiter)
+                           { return waiter.first == ticket; });
+    if (it != waiters.end())
+    {
+        waiters.erase(it);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicationLog::writeRecord(std::string &out, std::uint64_t sequence, std::int64_t primaryMicros, const BookingLog::Record &record,
+                                 MessageType type)
+{
+    std::size_t frame = out.size();
+    putU32(out, 0); // Filled in by finishFrame
+    out += static_cast<char>(type);
+    putU64(out, sequence);
+    putU64(out, static_cast<std::uint64_t>(primaryMicros));
+    BookingLog::encodeRecord(out, record);
+    finishFrame(out, frame);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicationLog::writeMarker(std::string &out, MessageType type, std::uint64_t sequence, std::int64_t primaryMicros)
+{
+    std::size_t frame = out.size();
+    putU32(out, 0);
+    out += static_cast<char>(type);
+    putU64(out, sequence);
+    putU64(out, static_cast<std::uint64_t>(primaryMicros));
+    finishFrame(out, frame);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ReplicationLog::Result ReplicationLog::parseMessage(const char *data, std::size_t size, Message &message)
+{
+    if (size < LENGTH_SIZE)
+    {
+        return Result::Incomplete;
+    }
+    std::size_t length = getU32(data);
+    if (length < HEADER_SIZE || length > MAX_FRAME_SIZE)
+    {
+        return Result::Invalid;
+    }
+    if (size - LENGTH_SIZE < length)
+    {
+        return Result::Incomplete;
+    }
+    auto type = static_cast<MessageType>(data[LENGTH_SIZE]);
+    if (type != MessageType::Record && type != MessageType::Synced && type != MessageType::Heartbeat && type != MessageType::Reset)
+    {
+        return Result::Invalid;
+    }
+    message.type = type;
+    message.sequence = getU64(data + SEQUENCE_OFFSET);
+    message.primaryMicros = static_cast<std::int64_t>(getU64(data + SEQUENCE_OFFSET + 8));
+    message.record = std::string_view(data + LENGTH_SIZE + HEADER_SIZE, length - HEADER_SIZE);
+    message.size = LENGTH_SIZE + length;
+    return Result::Complete;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReplicationLog::readRecord(const Message &message, BookingLog::Record &record)
+{
+    std::size_t frameSize = 0;
+    return (message.type == MessageType::Record || message.type == MessageType::Reset) &&
+           BookingLog::decodeRecord(message.record.data(), message.record.size(), record, frameSize) &&
+           frameSize == message.record.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::int64_t ReplicationLog::nowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReplicationLog::finishFrame(std::string &out, std::size_t frame)
+{
+    std::uint32_t length = static_cast<std::uint32_t>(out.size() - frame - LENGTH_SIZE);
+    for (int i = 0; i < 4; ++i)
+    {
+        out[frame + i] = static_cast<char>((length >> (8 * i)) & 0xff);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+double ReplicaStatus::getLagSeconds() const
+{
+    std::int64_t last = primaryMicros.load(std::memory_order_relaxed);
+    if (last == 0)
+    {
+        return -1;
+    }
+    return std::max<std::int64_t>(ReplicationLog::nowMicros() - last, 0) / 1e6;
+}
+
+///////////////////////////////////////////////////////////////////////////////
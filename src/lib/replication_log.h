@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "booking_log.h"
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Recent bookings of a primary, numbered in order, for the read replicas it feeds.
+///
+/// Every booking the primary makes is appended as one message holding its booking log
+/// record. Seats the primary frees, when a reload gives a room another movie or resizes it,
+/// are sent as Reset messages setting each room's seats to exactly those of the record.
+/// The messages of the last 'maxBytes' are kept, so a replica that knows the last sequence
+/// it got reads on from there. A replica that fell further behind is told to start over
+/// from a full copy, one Reset per room and showtime. Records only ever book seats and
+/// replaying one twice is harmless, so a full copy may overlap the messages sent after it.
+///
+/// The stream to a replica is a sequence of frames:
+///
+///     u32 length | u8 type | u64 sequence | i64 primary time (µs since the epoch) | payload
+///
+/// A Record or Reset frame carries one booking log frame (see BookingLog::encodeRecord); resets
+/// of a full copy have sequence 0. Synced ends a full copy, its sequence is the last booking the
+/// copy may miss. Heartbeat tells an idle replica the primary is still there and how late
+/// it is. All integers are little-endian.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class ReplicationLog
+{
+public:
+    enum class MessageType : std::uint8_t
+    {
+        Record = 1,
+        Synced = 2,
+        Heartbeat = 3,
+        Reset = 4
+    };
+
+    /// @brief One frame of the stream, 'record' points into the caller's buffer
+    struct Message
+    {
+        MessageType type = MessageType::Heartbeat;
+        std::uint64_t sequence = 0;
+        std::int64_t primaryMicros = 0;
+        std::string_view record; // Booking log frame of a Record or Reset
+        std::size_t size = 0;    // Bytes taken by the frame, prefix included
+    };
+
+    /// @brief Outcome of parseMessage
+    enum class Result
+    {
+        Complete,   // 'message' holds a full frame of message.size bytes
+        Incomplete, // More bytes are needed
+        Invalid     // Unknown type or bad length, the connection should be closed
+    };
+
+    static constexpr std::size_t DEFAULT_MAX_BYTES = 16 << 20;
+    static constexpr std::size_t LENGTH_SIZE = 4;
+    static constexpr std::size_t HEADER_SIZE = 17;         // Type, sequence and time
+    static constexpr std::size_t MAX_FRAME_SIZE = 1 << 20; // Larger frames are invalid
+
+    explicit ReplicationLog(std::size_t maxBytes = DEFAULT_MAX_BYTES);
+
+    ReplicationLog(const ReplicationLog &) = delete;
+    ReplicationLog &operator=(const ReplicationLog &) = delete;
+
+    /// @brief Appends a booking with the next sequence, then wakes every waiter
+    void append(const BookingLog::Record &record);
+
+    /// @brief Appends the records 'snapshot' emits as Reset messages, then wakes every waiter.
+    /// The snapshot runs under the log's lock, so every booking appended before the resets is
+    /// in them, and must not append itself.
+    void appendResets(const BookingLog::SnapshotFunction &snapshot);
+
+    /// @return the sequence of the latest booking, 0 before the first
+    std::uint64_t getSequence() const;
+
+    /// @brief Appends the frames of the bookings after 'since' to 'out', about 'maxBytes' at most
+    /// but at least one, and moves 'since' to the last one appended
+    /// @return false if bookings after 'since' were dropped already, the replica needs a full copy
+    bool readSince(std::uint64_t &since, std::string &out, std::size_t maxBytes) const;
+
+    /// @brief Calls 'wake' once, on the appending thread, when a booking after 'since' is appended
+    /// @return a ticket for cancelWait, or 0 if there already is such a booking; 'wake' is then never called
+    std::uint64_t waitAfter(std::uint64_t since, std::function<void()> wake);
+
+    /// @brief Forgets a waiter that was not woken yet
+    void cancelWait(std::uint64_t ticket);
+
+    /// @brief Appends a Record frame, or a Reset frame if 'type' says so
+    static void writeRecord(std::string &out, std::uint64_t sequence, std::int64_t primaryMicros, const BookingLog::Record &record,
+                            MessageType type = MessageType::Record);
+
+    /// @brief Appends a Synced or Heartbeat frame
+    static void writeMarker(std::string &out, MessageType type, std::uint64_t sequence, std::int64_t primaryMicros);
+
+    /// @brief Parses the frame at the start of 'data', never allocates
+    static Result parseMessage(const char *data, std::size_t size, Message &message);
+
+    /// @brief Decodes the booking of a Record or Reset
+    /// @return false if the record is damaged
+    static bool readRecord(const Message &message, BookingLog::Record &record);
+
+    /// @return the wall clock in microseconds since the epoch, the time of every frame
+    static std::int64_t nowMicros();
+
+private:
+    /// @brief Fills in the length of the frame started at 'frame'
+    static void finishFrame(std::string &out, std::size_t frame);
+
+    /// @brief Numbers and stamps a frame, keeps it and drops the oldest past 'maxBytes'. Called with 'mutex' held
+    void push(std::string frame);
+
+    /// @brief Wakes every waiter after an append. Called with 'mutex' held, which it releases
+    void wakeWaiters(std::unique_lock<std::mutex> &lock);
+
+    mutable std::mutex mutex;
+    std::deque<std::string> frames; // Frame of booking firstSequence + i
+    std::uint64_t firstSequence = 1;
+    std::uint64_t sequence = 0;
+    std::size_t bytes = 0;
+    std::size_t maxBytes;
+    std::vector<std::pair<std::uint64_t, std::function<void()>>> waiters; // Ticket and callback
+    std::uint64_t nextTicket = 1;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Progress of a read replica, written by its replication client and read by the
+/// sessions answering requests and /metrics
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct ReplicaStatus
+{
+    std::atomic<bool> connected{false};
+    std::atomic<bool> synced{false};               // A full copy of the primary's bookings was applied at least once
+    std::atomic<std::uint64_t> sequence{0};        // Last booking of the primary applied
+    std::atomic<std::int64_t> primaryMicros{0};    // Primary time of the last frame applied
+    std::atomic<std::uint64_t> appliedRecords{0};
+
+    /// @return seconds the replica is behind the primary: the age of the last frame applied, -1 before
+    /// the first. An idle primary sends heartbeats, so this stays small while the replica keeps up.
+    double getLagSeconds() const;
+};
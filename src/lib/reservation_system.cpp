@@ -1,147 +1,1028 @@
-
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <stdexcept>
 #include <vector>
+#include <utility>
 
 #include "reservation_system.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
 ReservationSystem::ReservationSystem(const std::string &filename)
+    : catalogPath(filename), catalog(Catalog::load(filename))
 {
-    std::ifstream jsonFile(filename);
-    Json::Value root;
-    jsonFile >> root;
+}
+
+///////////////////////////////////////////////////////////////////////////////
 
-    const Json::Value &theatersJson = root["theaters"];
-    for (const auto &theaterJson : theatersJson)
+ReservationSystem::~ReservationSystem()
+{
+    if (reloadThread.joinable())
     {
-        std::string theaterName = theaterJson["name"].asString();
-        Theater theater(theaterName);
+        reloadThread.join();
+    }
+}
 
-        const Json::Value &roomsJson = theaterJson["rooms"];
-        for (const auto &roomJson : roomsJson)
+///////////////////////////////////////////////////////////////////////////////
+
+const std::string &ReservationSystem::getCatalogPath() const
+{
+    return catalogPath;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ReservationSystem::reloadCatalog(const std::string &filename)
+{
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    std::shared_ptr<Catalog> next = Catalog::load(filename);
+    std::shared_ptr<Catalog> previous = catalog.current();
+    {
+        // Holds cannot change while their rooms are copied and moved
+        std::lock_guard<std::mutex> holdsLock(holdsMutex);
+        next->carrySeatsFrom(*previous);
+        moveHolds(*next);
+        next->version = previous->version + 1;
+        catalog.publish(next);
+        catalogVersion.store(next->version, std::memory_order_release);
+    }
+    previous.reset();
+
+    // Calls that started on the old catalog are short, wait for them to leave it
+    while (catalog.reclaim() > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (bookingLog)
+    {
+        // Rooms that changed movie start empty, replay must not put their old records back
+        bookingLog->requestCheckpoint();
+    }
+    if (replicationLog)
+    {
+        // Replicas only ever add seats from records, tell them which seats each room kept.
+        // No booking lands in an old room any more, so none can follow its reset
+        replicationLog->appendResets([this](const BookingLog::RecordVisitor &emit)
+                                     { visitBookings(emit, true); });
+    }
+    return next->version;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::moveHolds(Catalog &next)
+{
+    for (auto it = holds.begin(); it != holds.end();)
+    {
+        Hold &hold = it->second;
+        long ordinal = next.findRoom(hold.theater, hold.room->getRoomName());
+        if (ordinal < 0)
+        {
+            ++it; // The room is gone, the hold ends on the old one
+            continue;
+        }
+        Room &room = *next.roomTable[ordinal];
+        if (hold.showtime == NO_SHOWTIME ? !moveRoomHold(hold, room) : !moveShowtimeHold(hold, next, ordinal))
         {
-            std::string roomName = roomJson["name"].asString();
-            std::string movieTitle = roomJson["movie"]["title"].asString();
-            Movie movie(movieTitle);
-            Room room(roomName);
-            room.setPlayingMovie(std::make_shared<Movie>(movie));
-            theater.addRoom(room);
+            it = holds.erase(it); // Its timer finds nothing and is skipped
+            continue;
         }
-        theaters.push_back(theater);
+        hold.catalog = next.shared_from_this();
+        hold.room = &room;
+        hold.roomOrdinal = ordinal;
+        ++it;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReservationSystem::moveRoomHold(const Hold &hold, Room &room)
+{
+    if (room.sharesSeatsWith(*hold.room))
+    {
+        return true;
+    }
+    if (hold.room->getSeatMap().isSealed())
+    {
+        // Resized, the old room was sealed with the hold in it and the copy left held seats out
+        return room.holdSeats(hold.seats);
+    }
+    freeHeldSeats(hold); // Another movie now, the old room is left behind
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReservationSystem::moveShowtimeHold(Hold &hold, Catalog &next, long ordinal)
+{
+    const ShowtimeStore &previous = hold.catalog->showtimes;
+    auto showtimeIt = next.showtimeKeys.find(Catalog::showtimeKey(static_cast<std::uint32_t>(ordinal), previous.getStart(hold.showtime)));
+    if (showtimeIt == next.showtimeKeys.end() || (!next.showtimes.sharesSeatsWith(showtimeIt->second, previous, hold.showtime) &&
+                                                  !previous.isSealed(hold.showtime)))
+    {
+        freeHeldSeats(hold); // Gone or another movie now, the old showtime is left behind
+        return false;
+    }
+    ShowtimeId showtime = showtimeIt->second;
+    // Held seats are booked ones to a showtime, so a resized one got those that still fit in its copy
+    int capacity = next.showtimes.getCapacity(showtime);
+    if (std::all_of(hold.seats.begin(), hold.seats.end(), [capacity](int seatNumber)
+                    { return seatNumber < capacity; }))
+    {
+        hold.showtime = showtime;
+        return true;
     }
+    std::vector<int> copied;
+    std::copy_if(hold.seats.begin(), hold.seats.end(), std::back_inserter(copied), [capacity](int seatNumber)
+                 { return seatNumber < capacity; });
+    next.showtimes.release(showtime, copied);
+    return false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void ReservationSystem::addMovie(std::shared_ptr<Movie> movie)
+void ReservationSystem::freeHeldSeats(const Hold &hold)
 {
-    movies.push_back(movie);
+    if (hold.showtime != NO_SHOWTIME)
+    {
+        hold.catalog->showtimes.release(hold.showtime, hold.seats);
+    }
+    else
+    {
+        hold.room->releaseHeldSeats(hold.seats);
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void ReservationSystem::addTheater(const Theater &theater)
+bool ReservationSystem::reloadCatalogAsync(const std::string &filename, std::function<void(const std::string &error)> done)
 {
-    theaters.push_back(theater);
+    if (reloading.exchange(true, std::memory_order_acq_rel))
+    {
+        return false;
+    }
+    if (reloadThread.joinable())
+    {
+        reloadThread.join(); // The previous reload is over, it cleared 'reloading'
+    }
+    reloadThread = std::thread([this, filename, done]
+                               {
+                                   std::string error;
+                                   try
+                                   {
+                                       reloadCatalog(filename);
+                                   }
+                                   catch (const std::exception &e)
+                                   {
+                                       error = e.what();
+                                   }
+                                   if (done)
+                                   {
+                                       done(error);
+                                   }
+                                   reloading.store(false, std::memory_order_release);
+                               });
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+long ReservationSystem::getRoomOrdinal(const std::string &theaterName, const std::string &movieTitle, ShowtimeId showtime) const
+{
+    auto current = catalog.read();
+    if (showtime != NO_SHOWTIME)
+    {
+        return current->isShowtimeOf(theaterName, movieTitle, showtime) ? static_cast<long>(current->showtimes.getRoom(showtime)) : -1;
+    }
+    const std::vector<Room *> *rooms = current->findRooms(theaterName, movieTitle);
+    if (!rooms)
+    {
+        return -1;
+    }
+    // Bookings always go to the first room, see bookSeats
+    return current->roomOrdinals.at(rooms->front());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::forEachRoom(const std::function<void(const std::string &theaterName, const Room &room)> &visit) const
+{
+    auto current = catalog.read();
+    for (const auto &theater : current->theaters)
+    {
+        for (const auto &room : theater.getRooms())
+        {
+            visit(theater.getName(), room);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ReservationSystem::getCatalogVersion() const
+{
+    return catalogVersion.load(std::memory_order_acquire);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ReservationSystem::getBookingsVersion(const std::string &theaterTitle, const std::string &movieTitle, ShowtimeId showtime) const
+{
+    auto current = catalog.read();
+    // Catalog version in the top bits, so a reload never repeats an earlier version
+    std::uint64_t version = current->version << 48;
+    if (showtime != NO_SHOWTIME)
+    {
+        return current->isShowtimeOf(theaterTitle, movieTitle, showtime) ? version + current->showtimes.getVersion(showtime) : version;
+    }
+    const std::vector<Room *> *rooms = current->findRooms(theaterTitle, movieTitle);
+    if (rooms)
+    {
+        for (const Room *room : *rooms)
+        {
+            version += room->getVersion();
+        }
+    }
+    return version;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReservationSystem::followSeats(const std::string &theaterName, const std::string &movieTitle, ShowtimeId showtime, SeatFeed &feed)
+{
+    auto current = catalog.read();
+    feed.catalog = current->shared_from_this();
+    feed.showtime = showtime;
+    feed.room = nullptr;
+    if (showtime != NO_SHOWTIME)
+    {
+        if (!current->isShowtimeOf(theaterName, movieTitle, showtime))
+        {
+            return false;
+        }
+        feed.ring = &current->showtimes.followChanges(showtime);
+        return true;
+    }
+    const std::vector<Room *> *rooms = current->findRooms(theaterName, movieTitle);
+    if (!rooms)
+    {
+        return false;
+    }
+    // Bookings by theater and movie go to the first room, see bookSeats
+    feed.room = rooms->front();
+    feed.ring = &rooms->front()->followChanges();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::readSeatChanges(const SeatFeed &feed, std::uint64_t since, SeatChanges &changes) const
+{
+    changes.full = !feed.ring->readSince(since, changes.booked, changes.freed, changes.version);
+    if (!changes.full)
+    {
+        return;
+    }
+
+    // Copied after reading the version: every change up to it is in the copy, later ones the
+    // follower gets again as deltas, which only restate the seats' latest state
+    thread_local std::vector<std::uint64_t> words;
+    int capacity = 0;
+    if (feed.room)
+    {
+        const SeatMap &seats = feed.room->getSeatMap();
+        capacity = seats.getCapacity();
+        words.resize(std::max(words.size(), seats.getWordCount()));
+        seats.snapshot(words.data());
+    }
+    else
+    {
+        capacity = feed.catalog->showtimes.getCapacity(feed.showtime);
+        words.resize(std::max(words.size(), SeatMap::seatWordCountFor(capacity)));
+        feed.catalog->showtimes.snapshot(feed.showtime, words.data());
+    }
+    for (int w = 0; w * SeatMap::SEATS_PER_WORD < capacity; ++w)
+    {
+        for (std::uint64_t word = words[w]; word != 0; word &= word - 1)
+        {
+            int seatNumber = w * SeatMap::SEATS_PER_WORD + __builtin_ctzll(word);
+            if (seatNumber < capacity)
+            {
+                changes.booked.push_back(seatNumber);
+            }
+        }
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void ReservationSystem::addRoomToTheater(const std::string &theaterName, const Room &room)
+void ReservationSystem::visitSeatSnapshots(const std::string &theaterTitle, const std::string &movieTitle, ShowtimeId showtime,
+                                           const std::function<void(const std::uint64_t *words, int capacity)> &visit) const
 {
-    for (auto &theater : theaters)
+    // Reused by every call on this thread, grows to the largest room once
+    thread_local std::vector<std::uint64_t> words;
+    auto current = catalog.read();
+
+    if (showtime != NO_SHOWTIME)
     {
-        if (theater.getName() == theaterName)
+        // Same shape as for rooms, with the showtime as the only room
+        if (current->isShowtimeOf(theaterTitle, movieTitle, showtime))
         {
-            theater.addRoom(room);
-            break;
+            int capacity = current->showtimes.getCapacity(showtime);
+            words.resize(std::max(words.size(), SeatMap::seatWordCountFor(capacity)));
+            current->showtimes.snapshot(showtime, words.data());
+            visit(words.data(), capacity);
         }
+        return;
+    }
+
+    const std::vector<Room *> *rooms = current->findRooms(theaterTitle, movieTitle);
+    if (!rooms)
+    {
+        return;
+    }
+    for (const Room *room : *rooms)
+    {
+        const SeatMap &seats = room->getSeatMap();
+        words.resize(std::max(words.size(), seats.getWordCount()));
+        seats.snapshot(words.data());
+        visit(words.data(), seats.getCapacity());
     }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-Json::Value ReservationSystem::getBookings(const std::string &theaterTitle, const std::string &movieTitle) const
+Json::Value ReservationSystem::getBookings(const std::string &theaterTitle, const std::string &movieTitle, ShowtimeId showtime) const
 {
     Json::Value bookings(Json::arrayValue);
+    visitSeatSnapshots(theaterTitle, movieTitle, showtime, [&bookings](const std::uint64_t *words, int capacity)
+                       {
+                           Json::Value roomBookings(Json::arrayValue);
+                           for (int seatNumber = 0; seatNumber < capacity; ++seatNumber)
+                           {
+                               roomBookings.append(static_cast<int>((words[seatNumber / 64] >> (seatNumber % 64)) & 1));
+                           }
+                           bookings.append(roomBookings);
+                       });
+    return bookings;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::writeBookingsJson(std::string &out, const std::string &theaterTitle, const std::string &movieTitle, ShowtimeId showtime) const
+{
+    bool firstRoom = true;
+    out += '[';
+    visitSeatSnapshots(theaterTitle, movieTitle, showtime, [&out, &firstRoom](const std::uint64_t *words, int capacity)
+                       {
+                           // "0," or "1," per seat, the last comma becomes the closing bracket
+                           std::size_t start = out.size();
+                           out.resize(start + (firstRoom ? 0 : 1) + 1 + (capacity > 0 ? 2 * static_cast<std::size_t>(capacity) : 1));
+                           char *text = &out[start];
+                           if (!firstRoom)
+                           {
+                               *text++ = ',';
+                           }
+                           firstRoom = false;
+                           *text++ = '[';
+                           for (int seatNumber = 0; seatNumber < capacity; ++seatNumber)
+                           {
+                               *text++ = static_cast<char>('0' + ((words[seatNumber / 64] >> (seatNumber % 64)) & 1));
+                               *text++ = ',';
+                           }
+                           if (capacity > 0)
+                           {
+                               --text;
+                           }
+                           *text = ']';
+                       });
+    out += ']';
+}
 
-    for (const auto &theater : theaters)
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReservationSystem::bookSeats(const std::string &theaterName, const std::string &movieName, const std::vector<int> &in_seats, ShowtimeId showtime)
+{
+    auto current = catalog.read();
+    if (showtime != NO_SHOWTIME)
     {
-        if (theater.getName() == theaterTitle)
+        if (!current->isShowtimeOf(theaterName, movieName, showtime) || !current->showtimes.reserve(showtime, in_seats))
         {
-            for (const auto &room : theater.getRooms())
+            return false;
+        }
+        logBooking(*current, showtime, in_seats);
+        return true;
+    }
+
+    const std::vector<Room *> *rooms = current->findRooms(theaterName, movieName);
+    if (!rooms)
+    {
+        return false; // No matching theater or room
+    }
+    Room &room = *rooms->front();
+
+    // Reserve ALL seats with one compare-and-swap per seat word, or none of them
+    if (!room.reserveSeats(in_seats))
+    {
+        return false;
+    }
+    logBooking(theaterName, room, in_seats);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<bool> ReservationSystem::bookSeatsBatch(const std::vector<BookingRequest> &requests)
+{
+    std::vector<bool> results(requests.size(), false);
+    auto current = catalog.read();
+
+    // Group items by room or showtime, keeping request order inside each group
+    std::vector<std::pair<Room *, ShowtimeId>> groupTargets;
+    std::vector<std::vector<std::size_t>> groupItems;
+    std::map<std::pair<Room *, ShowtimeId>, std::size_t> groupByTarget;
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+        std::pair<Room *, ShowtimeId> target(nullptr, requests[i].showtime);
+        if (target.second != NO_SHOWTIME)
+        {
+            if (!current->isShowtimeOf(requests[i].theater, requests[i].movie, target.second))
+            {
+                continue; // No such showtime of the movie in the theater
+            }
+        }
+        else
+        {
+            const std::vector<Room *> *rooms = current->findRooms(requests[i].theater, requests[i].movie);
+            if (!rooms)
+            {
+                continue; // No matching theater or room
+            }
+            target.first = rooms->front();
+        }
+        auto inserted = groupByTarget.emplace(target, groupTargets.size());
+        if (inserted.second)
+        {
+            groupTargets.push_back(target);
+            groupItems.push_back(std::vector<std::size_t>());
+        }
+        groupItems[inserted.first->second].push_back(i);
+    }
+
+    std::vector<const std::vector<int> *> seats;
+    for (std::size_t group = 0; group < groupTargets.size(); ++group)
+    {
+        seats.clear();
+        for (std::size_t i : groupItems[group])
+        {
+            seats.push_back(&requests[i].seats);
+        }
+        Room *room = groupTargets[group].first;
+        ShowtimeId showtime = groupTargets[group].second;
+        std::vector<bool> booked = room ? room->reserveSeatsBatch(seats) : current->showtimes.reserveBatch(showtime, seats);
+        for (std::size_t n = 0; n < booked.size(); ++n)
+        {
+            std::size_t i = groupItems[group][n];
+            results[i] = booked[n];
+            if (booked[n])
             {
-                if (room.getPlayingMovie() && room.getPlayingMovie()->getTitle() == movieTitle)
+                if (room)
                 {
-                    Json::Value roomBookings(Json::arrayValue);
-                    for (int seatNumber = 0; seatNumber < NUMBER_OF_AVAILABLE_SEATS; ++seatNumber)
-                    {
-                        roomBookings.append(room.isSeatAvailable(seatNumber) ? 0 : 1);
-                    }
-                    bookings.append(roomBookings);
+                    logBooking(requests[i].theater, *room, requests[i].seats);
+                }
+                else
+                {
+                    logBooking(*current, showtime, requests[i].seats);
                 }
             }
         }
     }
-    return bookings;
+    return results;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool ReservationSystem::bookSeats(const std::string &theaterName, const std::string &movieName, const std::vector<int> &in_seats)
+RoomBooking ReservationSystem::bookRoomSeats(std::uint64_t catalogVersion, std::uint32_t roomOrdinal, ShowtimeId showtime, const std::vector<int> &seats)
 {
-    for (auto &theater : theaters)
+    auto current = catalog.read();
+    if (current->version != catalogVersion)
+    {
+        return RoomBooking::StaleCatalog; // The same number may be another room now
+    }
+    if (roomOrdinal >= current->roomTable.size())
+    {
+        return RoomBooking::UnknownRoom;
+    }
+    if (showtime != NO_SHOWTIME)
     {
-        if (theater.getName() == theaterName)
+        if (showtime >= current->showtimes.size() || current->showtimes.getRoom(showtime) != roomOrdinal)
         {
-            for (auto &room : theater.getRooms())
-            {
-                if (room.getPlayingMovie() && room.getPlayingMovie()->getTitle() == movieName)
+            return RoomBooking::UnknownRoom;
+        }
+        if (!current->showtimes.reserve(showtime, seats))
+        {
+            return RoomBooking::Unavailable;
+        }
+        logBooking(*current, showtime, seats);
+        return RoomBooking::Booked;
+    }
+    Room &room = *current->roomTable[roomOrdinal];
+    if (!room.reserveSeats(seats))
+    {
+        return RoomBooking::Unavailable;
+    }
+    logBooking(current->theaters[current->roomTheaters[roomOrdinal]].getName(), room, seats);
+    return RoomBooking::Booked;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+RoomSnapshot ReservationSystem::snapshotRoomSeats(std::uint64_t catalogVersion, std::uint32_t roomOrdinal, ShowtimeId showtime,
+                                                  std::vector<std::uint64_t> &words, int &capacity, std::uint64_t &version) const
+{
+    auto current = catalog.read();
+    if (current->version != catalogVersion)
+    {
+        return RoomSnapshot::StaleCatalog;
+    }
+    if (roomOrdinal >= current->roomTable.size())
+    {
+        return RoomSnapshot::UnknownRoom;
+    }
+    version = current->version << 48;
+    if (showtime != NO_SHOWTIME)
+    {
+        const ShowtimeStore &showtimes = current->showtimes;
+        if (showtime >= showtimes.size() || showtimes.getRoom(showtime) != roomOrdinal)
+        {
+            return RoomSnapshot::UnknownRoom;
+        }
+        capacity = showtimes.getCapacity(showtime);
+        words.resize(SeatMap::seatWordCountFor(capacity));
+        version += showtimes.snapshot(showtime, words.data()); // The version of the copy, not one read next to it
+        return RoomSnapshot::Copied;
+    }
+    const SeatMap &seats = current->roomTable[roomOrdinal]->getSeatMap();
+    capacity = seats.getCapacity();
+    words.resize(seats.getWordCount());
+    version += seats.snapshot(words.data());
+    return RoomSnapshot::Copied;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const Catalog> ReservationSystem::getCatalog() const
+{
+    return catalog.read()->shared_from_this();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<int> ReservationSystem::bookBestAvailable(const std::string &theaterName, const std::string &movieName, int count, bool contiguous,
+                                                      ShowtimeId showtime)
+{
+    auto current = catalog.read();
+    if (showtime != NO_SHOWTIME)
+    {
+        if (!current->isShowtimeOf(theaterName, movieName, showtime))
+        {
+            return std::vector<int>();
+        }
+        std::vector<int> seats = current->showtimes.reserveAvailable(showtime, count, contiguous);
+        if (!seats.empty())
+        {
+            logBooking(*current, showtime, seats);
+        }
+        return seats;
+    }
+
+    const std::vector<Room *> *rooms = current->findRooms(theaterName, movieName);
+    if (!rooms)
+    {
+        return std::vector<int>(); // No matching theater or room
+    }
+    std::vector<int> seats = rooms->front()->reserveAvailableSeats(count, contiguous);
+    if (!seats.empty())
+    {
+        logBooking(theaterName, *rooms->front(), seats);
+    }
+    return seats;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ReservationSystem::holdSeats(const std::string &theaterName, const std::string &movieName, const std::vector<int> &seats,
+                                          std::chrono::milliseconds ttl, ShowtimeId showtime, std::chrono::steady_clock::time_point now)
+{
+    auto current = catalog.read();
+    const std::vector<Room *> *rooms = current->findRooms(theaterName, movieName);
+    if (!rooms || seats.empty() || ttl.count() <= 0)
+    {
+        return 0;
+    }
+    if (showtime != NO_SHOWTIME && !current->isShowtimeOf(theaterName, movieName, showtime))
+    {
+        return 0;
+    }
+    // A showtime hold is told apart from a booking by the hold table alone, see visitBookings
+    Room &room = showtime != NO_SHOWTIME ? *current->roomTable[current->showtimes.getRoom(showtime)] : *rooms->front();
+
+    std::lock_guard<std::mutex> lock(holdsMutex);
+    if (showtime != NO_SHOWTIME ? !current->showtimes.reserve(showtime, seats) : !room.holdSeats(seats))
+    {
+        return 0;
+    }
+    // Ids stay below 2^53 so json clients read them exactly
+    std::uint64_t holdId = 0;
+    while (holdId == 0 || holds.count(holdId))
+    {
+        holdId = holdIds() & ((std::uint64_t(1) << 53) - 1);
+    }
+    // Round the expiry up to a whole tick, a hold never ends early
+    std::uint64_t expiryTick = holdTick(now + ttl - std::chrono::nanoseconds(1)) + 1;
+    holds.emplace(holdId, Hold{current->shared_from_this(), theaterName, &room, current->roomOrdinals.at(&room), showtime, seats, expiryTick});
+    holdTimers.schedule(holdId, expiryTick);
+    return holdId;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReservationSystem::confirmHold(std::uint64_t holdId)
+{
+    Hold hold;
+    {
+        std::lock_guard<std::mutex> lock(holdsMutex);
+        auto it = holds.find(holdId);
+        if (it == holds.end())
+        {
+            return false;
+        }
+        hold = std::move(it->second);
+        holds.erase(it);
+        if (hold.showtime == NO_SHOWTIME)
+        {
+            hold.room->confirmHeldSeats(hold.seats);
+        }
+    }
+    // Logged after the seats stop being held, so a checkpoint covering the record includes them
+    if (hold.showtime != NO_SHOWTIME)
+    {
+        logBooking(*hold.catalog, hold.showtime, hold.seats);
+    }
+    else
+    {
+        logBooking(hold.theater, *hold.room, hold.seats);
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReservationSystem::releaseHold(std::uint64_t holdId)
+{
+    std::lock_guard<std::mutex> lock(holdsMutex);
+    auto it = holds.find(holdId);
+    if (it == holds.end())
+    {
+        return false;
+    }
+    freeHeldSeats(it->second);
+    holds.erase(it);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t ReservationSystem::expireHolds(std::chrono::steady_clock::time_point now)
+{
+    std::size_t released = 0;
+    expireHolds(now, [this, now, &released](std::uint64_t holdId, long)
                 {
-                    // Check if ALL seats are available and reserve them
-                    bool allSeatsAvailable = true;
-                    std::vector<int> seats(in_seats);
-                    // Sort the vector to bring duplicates together
-                    std::sort(seats.begin(), seats.end());
-
-                    // Use std::unique to rearrange elements and return the end of unique range
-                    auto uniqueEnd = std::unique(seats.begin(), seats.end());
-
-                    // Erase elements after the unique range
-                    seats.erase(uniqueEnd, seats.end());
-                    for (int seatNumber : seats)
+                    if (expireHold(holdId, now))
                     {
-                        if (!room.isSeatAvailable(seatNumber))
-                        {
-                            allSeatsAvailable = false; // At least one seat is not available
-                            break;                     // Exit the loop, no need to check the rest
-                        }
+                        ++released;
                     }
+                });
+    return released;
+}
 
-                    if (allSeatsAvailable)
-                    {
-                        // Reserve all the available seats
-                        for (int seatNumber : seats)
-                        {
-                            if (!const_cast<Room &>(room).reserveSeat(seatNumber))
-                            {
-                                return false; // Midoperation error
-                            }
-                        }
-                        return true; // Booking successful
-                    }
-                    else
-                    {
-                        return false; // At least one seat is not available
-                    }
-                }
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t ReservationSystem::expireHolds(std::chrono::steady_clock::time_point now, const std::function<void(std::uint64_t holdId, long roomOrdinal)> &expire)
+{
+    std::vector<std::pair<std::uint64_t, long>> expired;
+    {
+        std::lock_guard<std::mutex> lock(holdsMutex);
+        std::uint64_t tick = holdTick(now);
+        holdTimers.advance(tick, [this, tick, &expired](std::uint64_t holdId)
+                           {
+                               auto it = holds.find(holdId);
+                               // Confirmed and released holds left their timer behind, and their id may be in use again
+                               if (it == holds.end() || it->second.expiryTick > tick)
+                               {
+                                   return;
+                               }
+                               expired.emplace_back(holdId, it->second.roomOrdinal);
+                           });
+    }
+    for (const auto &hold : expired)
+    {
+        expire(hold.first, hold.second);
+    }
+    return expired.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReservationSystem::expireHold(std::uint64_t holdId, std::chrono::steady_clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(holdsMutex);
+    auto it = holds.find(holdId);
+    if (it == holds.end() || it->second.expiryTick > holdTick(now))
+    {
+        return false;
+    }
+    freeHeldSeats(it->second);
+    holds.erase(it);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t ReservationSystem::getHoldCount() const
+{
+    std::lock_guard<std::mutex> lock(holdsMutex);
+    return holds.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+long ReservationSystem::getHoldRoomOrdinal(std::uint64_t holdId) const
+{
+    std::lock_guard<std::mutex> lock(holdsMutex);
+    auto it = holds.find(holdId);
+    return it == holds.end() ? -1 : it->second.roomOrdinal;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ReservationSystem::holdTick(std::chrono::steady_clock::time_point time) const
+{
+    if (time <= holdEpoch)
+    {
+        return 0;
+    }
+    return static_cast<std::uint64_t>((time - holdEpoch) / HOLD_TICK);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t ReservationSystem::enableBookingLog(const std::string &path, std::size_t checkpointBytes)
+{
+    bookingLog.reset();
+    auto current = catalog.read();
+    std::size_t replayed = BookingLog::recover(path, [this, &current](const BookingLog::Record &record)
+                                               { applyLoggedBooking(*current, record); });
+    bookingLog.reset(new BookingLog(path, [this](const BookingLog::RecordVisitor &emit)
+                                    { visitBookings(emit); },
+                                    checkpointBytes));
+    return replayed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReservationSystem::hasBookingLog() const
+{
+    return bookingLog != nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::whenDurable(std::function<void()> callback)
+{
+    if (bookingLog)
+    {
+        bookingLog->whenDurable(std::move(callback));
+    }
+    else
+    {
+        callback();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::enableReplicationLog(std::size_t maxBytes)
+{
+    replicationLog.reset(new ReplicationLog(maxBytes));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ReplicationLog *ReservationSystem::getReplicationLog() const
+{
+    return replicationLog.get();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::enableReplica()
+{
+    replicaStatus.reset(new ReplicaStatus());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ReplicaStatus *ReservationSystem::getReplicaStatus() const
+{
+    return replicaStatus.get();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::applyReplicatedBooking(const BookingLog::Record &record)
+{
+    auto current = catalog.read();
+    applyLoggedBooking(*current, record);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::applyReplicatedReset(const BookingLog::Record &record)
+{
+    auto current = catalog.read();
+    long roomOrdinal = current->findRoom(record.theater, record.room);
+    if (roomOrdinal < 0)
+    {
+        return;
+    }
+    std::vector<int> kept = record.seats;
+    std::sort(kept.begin(), kept.end());
+    auto dropped = [&kept](std::vector<int> booked)
+    {
+        booked.erase(std::remove_if(booked.begin(), booked.end(), [&kept](int seatNumber)
+                                    { return std::binary_search(kept.begin(), kept.end(), seatNumber); }),
+                     booked.end());
+        return booked;
+    };
+    if (record.showtimeStart == BookingLog::Record::NO_START)
+    {
+        Room &room = *current->roomTable[roomOrdinal];
+        std::vector<int> freed = dropped(room.getBookedSeats());
+        if (!freed.empty())
+        {
+            room.releaseSeats(freed);
+        }
+    }
+    else
+    {
+        auto showtimeIt = current->showtimeKeys.find(Catalog::showtimeKey(static_cast<std::uint32_t>(roomOrdinal), record.showtimeStart));
+        if (showtimeIt == current->showtimeKeys.end())
+        {
+            return;
+        }
+        std::vector<int> freed = dropped(current->showtimes.getBookedSeats(showtimeIt->second));
+        if (!freed.empty())
+        {
+            current->showtimes.release(showtimeIt->second, freed);
+        }
+    }
+    // The kept seats a replica missed, e.g. booked while it was away
+    applyLoggedBooking(*current, record);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+long ReservationSystem::getRecordRoomOrdinal(const BookingLog::Record &record) const
+{
+    auto current = catalog.read();
+    return current->findRoom(record.theater, record.room);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::logBooking(const std::string &theaterName, const Room &room, const std::vector<int> &seats)
+{
+    if (bookingLog)
+    {
+        bookingLog->append(theaterName, room.getRoomName(), seats);
+    }
+    if (replicationLog)
+    {
+        BookingLog::Record record;
+        record.theater = theaterName;
+        record.room = room.getRoomName();
+        record.seats = seats;
+        replicationLog->append(record);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::logBooking(const Catalog &current, ShowtimeId showtime, const std::vector<int> &seats)
+{
+    if (bookingLog)
+    {
+        std::uint32_t roomOrdinal = current.showtimes.getRoom(showtime);
+        bookingLog->append(current.theaters[current.roomTheaters[roomOrdinal]].getName(), current.roomTable[roomOrdinal]->getRoomName(), seats,
+                           current.showtimes.getStart(showtime));
+    }
+    if (replicationLog)
+    {
+        std::uint32_t roomOrdinal = current.showtimes.getRoom(showtime);
+        BookingLog::Record record;
+        record.theater = current.theaters[current.roomTheaters[roomOrdinal]].getName();
+        record.room = current.roomTable[roomOrdinal]->getRoomName();
+        record.seats = seats;
+        record.showtimeStart = current.showtimes.getStart(showtime);
+        replicationLog->append(record);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::applyLoggedBooking(Catalog &current, const BookingLog::Record &record)
+{
+    long roomOrdinal = current.findRoom(record.theater, record.room);
+    if (roomOrdinal < 0)
+    {
+        return; // The room left the catalog since the booking was logged
+    }
+    if (record.showtimeStart == BookingLog::Record::NO_START)
+    {
+        for (int seatNumber : record.seats)
+        {
+            current.roomTable[roomOrdinal]->reserveSeat(seatNumber);
+        }
+        return;
+    }
+    auto showtimeIt = current.showtimeKeys.find(Catalog::showtimeKey(static_cast<std::uint32_t>(roomOrdinal), record.showtimeStart));
+    if (showtimeIt == current.showtimeKeys.end())
+    {
+        return; // The showtime left the catalog
+    }
+    for (int seatNumber : record.seats)
+    {
+        current.showtimes.reserve(showtimeIt->second, {seatNumber});
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::visitBookings(const BookingLog::RecordVisitor &emit, bool includeEmpty) const
+{
+    // Held seats are not bookings yet, keep holds still while telling them apart
+    std::lock_guard<std::mutex> lock(holdsMutex);
+    auto current = catalog.read();
+    const ShowtimeStore &showtimes = current->showtimes;
+    std::unordered_map<ShowtimeId, std::vector<int>> heldShowtimeSeats;
+    for (const auto &entry : holds)
+    {
+        const Hold &hold = entry.second;
+        if (hold.showtime != NO_SHOWTIME && hold.catalog.get() == &*current)
+        {
+            std::vector<int> &held = heldShowtimeSeats[hold.showtime];
+            held.insert(held.end(), hold.seats.begin(), hold.seats.end());
+        }
+    }
+    BookingLog::Record record;
+    for (const auto &theater : current->theaters)
+    {
+        for (const auto &room : theater.getRooms())
+        {
+            record.seats = room.getConfirmedSeats();
+            if (includeEmpty || !record.seats.empty())
+            {
+                record.theater = theater.getName();
+                record.room = room.getRoomName();
+                emit(record);
             }
         }
     }
-    return false; // No matching theater or room
+
+    for (ShowtimeId showtime = 0; showtime < showtimes.size(); ++showtime)
+    {
+        record.seats = showtimes.getBookedSeats(showtime);
+        auto heldIt = heldShowtimeSeats.find(showtime);
+        if (heldIt != heldShowtimeSeats.end())
+        {
+            const std::vector<int> &held = heldIt->second;
+            record.seats.erase(std::remove_if(record.seats.begin(), record.seats.end(), [&held](int seatNumber)
+                                              { return std::find(held.begin(), held.end(), seatNumber) != held.end(); }),
+                               record.seats.end());
+        }
+        if (includeEmpty || !record.seats.empty())
+        {
+            std::uint32_t roomOrdinal = showtimes.getRoom(showtime);
+            record.theater = current->theaters[current->roomTheaters[roomOrdinal]].getName();
+            record.room = current->roomTable[roomOrdinal]->getRoomName();
+            record.showtimeStart = showtimes.getStart(showtime);
+            emit(record);
+        }
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -149,8 +1030,9 @@ bool ReservationSystem::bookSeats(const std::string &theaterName, const std::str
 Json::Value ReservationSystem::getAllPlayingMoviesJson() const
 {
     Json::Value movieTitles(Json::arrayValue);
+    auto current = catalog.read();
     // Iterate through theaters and add movie titles
-    for (const auto &theater : theaters)
+    for (const auto &theater : current->theaters)
     {
         for (const auto &room : theater.getRooms())
         {
@@ -165,23 +1047,71 @@ Json::Value ReservationSystem::getAllPlayingMoviesJson() const
 
 ///////////////////////////////////////////////////////////////////////////////
 
+Json::Value ReservationSystem::getShowtimesJson(const std::string &theaterTitle, const std::string &movieTitle) const
+{
+    Json::Value showtimesJson(Json::arrayValue);
+    auto current = catalog.read();
+    auto theaterIt = current->theaterIndex.find(theaterTitle);
+    auto movieIt = current->movieIndex.find(movieTitle);
+    if (theaterIt == current->theaterIndex.end() || movieIt == current->movieIndex.end())
+    {
+        return showtimesJson;
+    }
+    auto showtimesIt = current->showtimeIndex.find(Catalog::roomKey(theaterIt->second, movieIt->second->getId()));
+    if (showtimesIt == current->showtimeIndex.end())
+    {
+        return showtimesJson;
+    }
+    for (ShowtimeId showtime : showtimesIt->second)
+    {
+        Json::Value showtimeJson;
+        showtimeJson["id"] = showtime;
+        showtimeJson["room"] = current->roomTable[current->showtimes.getRoom(showtime)]->getRoomName();
+        showtimeJson["start"] = ShowtimeStore::formatStart(current->showtimes.getStart(showtime));
+        showtimesJson.append(showtimeJson);
+    }
+    return showtimesJson;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t ReservationSystem::getShowtimeCount() const
+{
+    return catalog.read()->showtimes.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 Json::Value ReservationSystem::getTheatersShowingMovieJson(const std::string &movieTitle) const
 {
     Json::Value theatersJson(Json::arrayValue);
+    auto current = catalog.read();
 
-    for (const auto &theater : theaters)
+    auto movieIt = current->movieIndex.find(movieTitle);
+    if (movieIt == current->movieIndex.end())
     {
-        for (const auto &room : theater.getRooms())
-        {
-            if (room.getPlayingMovie() && room.getPlayingMovie()->getTitle() == movieTitle)
-            {
-                theatersJson.append(theater.getName());
-                break; // Add theater only once if it has multiple rooms showing the same movie
-            }
-        }
+        return theatersJson;
+    }
+    for (std::size_t pos : current->theatersByMovie[movieIt->second->getId()])
+    {
+        theatersJson.append(current->theaters[pos].getName());
     }
 
     return theatersJson;
 }
 
-///////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+///////////////////////////////////////////////////////////////////////////////
+
+bool ReservationSystem::isCatalogSnapshot(const std::string &filename)
+{
+    return Catalog::isSnapshot(filename);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ReservationSystem::saveSnapshot(const std::string &path) const
+{
+    catalog.read()->saveSnapshot(path);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -1,31 +1,227 @@
+#pragma once
 
 #include "classes.h"
+#include "booking_log.h"
+#include "catalog.h"
+#include "rcu_pointer.h"
+#include "replication_log.h"
+#include "showtime_store.h"
+#include "timer_wheel.h"
 #include <json/json.h>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief One item of a batch booking: seats for a movie in a theater
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct BookingRequest
+{
+    std::string theater;
+    std::string movie;
+    std::vector<int> seats;
+    ShowtimeId showtime = NO_SHOWTIME;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Outcome of a booking addressed by room ordinal, see bookRoomSeats
+///////////////////////////////////////////////////////////////////////////////////////
+
+enum class RoomBooking
+{
+    Booked,
+    Unavailable,  // A seat is out of range, booked or held
+    UnknownRoom,  // No such room, or the showtime is not one of the room
+    StaleCatalog  // The numbers are from another catalog version, nothing was looked up
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Outcome of an occupancy copy addressed by room ordinal, see snapshotRoomSeats
+///////////////////////////////////////////////////////////////////////////////////////
+
+enum class RoomSnapshot
+{
+    Copied,
+    UnknownRoom, // No such room, or the showtime is not one of the room
+    StaleCatalog // The numbers are from another catalog version, nothing was copied
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief A follower of the seat changes of one room or showtime, see followSeats
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct SeatFeed
+{
+    std::shared_ptr<const Catalog> catalog; // Keeps the followed seats and their ring alive across reloads
+    const Room *room = nullptr;             // Room followed, nullptr for a showtime
+    ShowtimeId showtime = NO_SHOWTIME;
+    ChangeRing *ring = nullptr;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Seats of a feed changed since a version, see readSeatChanges
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct SeatChanges
+{
+    std::uint64_t version = 0; // Version the changes bring the follower to
+    bool full = false;         // 'booked' lists every booked seat, the follower's version was unknown or too old
+    std::vector<int> booked;   // Ascending
+    std::vector<int> freed;    // Ascending, held seats that were given back
+};
 
 ///////////////////////////////////////////////////////////////////////////////////////
 /// @brief This is the reservation system interface.
-/// Here we add Theaters, rooms and movies and provide a booking mechanism
+/// Here we add Theaters, rooms and movies and provide a booking mechanism.
+/// Every call works on the catalog current when it starts, a reload swaps in a new one
+/// without waiting for or blocking the calls still using the old one.
 ///////////////////////////////////////////////////////////////////////////////////////
 
 class ReservationSystem
 {
 public:
     /// @brief Constructs our Reservation System
-    /// @param filename of a json file with the theaters definition
+    /// @param filename of a json file with the theaters definition, or of a binary catalog snapshot
     ReservationSystem(const std::string &filename);
 
+    /// @brief Waits for a running catalog reload
+    ~ReservationSystem();
+
+    /// @brief Loads a new catalog and swaps it in for the running one.
+    /// The new catalog keeps the seats of the rooms and showtimes it shares with the old one,
+    /// see Catalog::carrySeatsFrom. Calls already running finish on the old catalog, which is
+    /// freed once they are done. Bookings on a resized room fail while its seats are copied.
+    /// Holds follow their room into the new catalog, and are dropped if it lost the seats or
+    /// now plays another movie.
+    /// @param filename json catalog or binary catalog snapshot
+    /// @return the new catalog version
+    /// @throws if 'filename' is not a valid catalog, the running catalog then stays
+    std::uint64_t reloadCatalog(const std::string &filename);
+
+    /// @brief Runs reloadCatalog on a background thread
+    /// @param done called on that thread with the error message, empty on success
+    /// @return false, doing nothing, if a reload is already running
+    bool reloadCatalogAsync(const std::string &filename, std::function<void(const std::string &error)> done = nullptr);
+
+    /// @return the catalog file given to the constructor
+    const std::string &getCatalogPath() const;
+
     /// @brief Allows to book seats inside a theater movie room
     /// @param theaterName
     /// @param roomName
     /// @param seats
+    /// @param showtime showtime of the movie in the theater, or NO_SHOWTIME for the room's own seats
     /// @return
-    bool bookSeats(const std::string &theaterName, const std::string &roomName, const std::vector<int> &seats);
+    bool bookSeats(const std::string &theaterName, const std::string &roomName, const std::vector<int> &seats, ShowtimeId showtime = NO_SHOWTIME);
+
+    /// @brief Books many requests at once, touching each room's seat map a single time.
+    /// Every item is all-or-nothing on its own, items for the same room are decided in order.
+    /// @param requests
+    /// @return whether each item was booked, in request order
+    std::vector<bool> bookSeatsBatch(const std::vector<BookingRequest> &requests);
+
+    /// @brief Books seats of a room, or of one of its showtimes, addressed by number instead of by name.
+    /// All-or-nothing like bookSeats.
+    /// @param catalogVersion version of the catalog the numbers were taken from, see getCatalog
+    /// @param roomOrdinal room position over all theaters of that catalog
+    /// @param showtime showtime of that room, or NO_SHOWTIME for the room's own seats
+    RoomBooking bookRoomSeats(std::uint64_t catalogVersion, std::uint32_t roomOrdinal, ShowtimeId showtime, const std::vector<int> &seats);
+
+    /// @brief Copies the occupancy words of a room, or of one of its showtimes, in one consistent pass
+    /// @param catalogVersion version of the catalog the numbers were taken from, see bookRoomSeats
+    /// @param words resized to hold the words, a set bit is a booked seat
+    /// @param capacity set to the number of seats
+    /// @param version set to the bookings version of the copy, see getBookingsVersion
+    RoomSnapshot snapshotRoomSeats(std::uint64_t catalogVersion, std::uint32_t roomOrdinal, ShowtimeId showtime,
+                                   std::vector<std::uint64_t> &words, int &capacity, std::uint64_t &version) const;
+
+    /// @brief The current catalog, for listing it. Keeps it alive past a reload, so do not hold on to it
+    std::shared_ptr<const Catalog> getCatalog() const;
+
+    /// @brief Finds and books the best available seats for a theater movie room
+    /// @param theaterName
+    /// @param movieName
+    /// @param count number of seats wanted
+    /// @param contiguous whether the seats must be adjacent and in the same row
+    /// @param showtime showtime of the movie in the theater, or NO_SHOWTIME for the room's own seats
+    /// @return the booked seat numbers, empty if the request could not be met
+    std::vector<int> bookBestAvailable(const std::string &theaterName, const std::string &movieName, int count, bool contiguous,
+                                       ShowtimeId showtime = NO_SHOWTIME);
+
+    /// @brief Resolution of hold expiry, expireHolds should run about this often
+    static constexpr std::chrono::milliseconds HOLD_TICK{10};
+
+    /// @brief Holds seats of a theater movie room, or of one of its showtimes, for 'ttl', without booking them yet.
+    /// Held seats are unavailable to other bookings and holds until the hold is confirmed,
+    /// released or expires. Holds are not logged, a restart frees them.
+    /// @param showtime showtime of the movie in the theater, or NO_SHOWTIME for the room's own seats
+    /// @return the hold id, or 0 if the room or showtime is unknown or any seat is not available
+    std::uint64_t holdSeats(const std::string &theaterName, const std::string &movieName, const std::vector<int> &seats,
+                            std::chrono::milliseconds ttl, ShowtimeId showtime = NO_SHOWTIME,
+                            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    /// @brief Books the seats of a hold for good
+    /// @return false if the hold is unknown, already ended or expired
+    bool confirmHold(std::uint64_t holdId);
+
+    /// @brief Gives the seats of a hold back
+    /// @return false if the hold is unknown, already ended or expired
+    bool releaseHold(std::uint64_t holdId);
+
+    /// @brief Releases the holds whose ttl ran out by 'now'
+    /// @return number of released holds
+    std::size_t expireHolds(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    /// @brief Hands out the holds whose ttl ran out by 'now' instead of releasing them, so each can be
+    /// released with expireHold by the thread owning its room
+    /// @param expire called with each hold id and its room ordinal, once the holds are no longer locked
+    /// @return number of holds handed out
+    std::size_t expireHolds(std::chrono::steady_clock::time_point now, const std::function<void(std::uint64_t holdId, long roomOrdinal)> &expire);
+
+    /// @brief Releases a hold handed out by expireHolds
+    /// @return false if the hold ended meanwhile, or its ttl did not run out by 'now'
+    bool expireHold(std::uint64_t holdId, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    /// @return number of holds neither confirmed, released nor expired
+    std::size_t getHoldCount() const;
+
+    /// @brief Room ordinal of the room a hold took its seats in, e.g. to end the hold on the shard owning the room
+    /// @return -1 if the hold is unknown, already ended or expired
+    long getHoldRoomOrdinal(std::uint64_t holdId) const;
 
     /// @brief Return the whole booking informatino of a theater movie room
     /// @param theaterTitle
     /// @param movieTitle
+    /// @param showtime showtime of the movie in the theater, or NO_SHOWTIME for the rooms' own seats
     /// @return
-    Json::Value getBookings(const std::string &theaterTitle, const std::string &movieTitle) const;
+    Json::Value getBookings(const std::string &theaterTitle, const std::string &movieTitle, ShowtimeId showtime = NO_SHOWTIME) const;
+
+    /// @brief Appends the bookings of getBookings to 'out' as compact json text, e.g. [[0,1,0],[1,1]].
+    /// Each room's seat map is copied once and encoded from the copy, so a room is never seen
+    /// half way through a booking and no per-seat value is built.
+    void writeBookingsJson(std::string &out, const std::string &theaterTitle, const std::string &movieTitle, ShowtimeId showtime = NO_SHOWTIME) const;
+
+    /// @brief Follows the seat changes of the room that bookings of a theater movie go to, or of a showtime.
+    /// From then on every booking and freed hold of it is published to its ChangeRing as one delta.
+    /// @return false if the theater does not show the movie, or the showtime is not one of it
+    bool followSeats(const std::string &theaterName, const std::string &movieTitle, ShowtimeId showtime, SeatFeed &feed);
+
+    /// @brief Reads the seats of a feed changed after version 'since', or all booked seats if the
+    /// ring no longer has every change since then. Pass 0 to start with the full seats.
+    void readSeatChanges(const SeatFeed &feed, std::uint64_t since, SeatChanges &changes) const;
+
+    /// @brief Lists the showtimes of a movie in a theater, earliest first
+    /// @return array of { "id", "room", "start" } objects, start as "YYYY-MM-DDTHH:MM" UTC
+    Json::Value getShowtimesJson(const std::string &theaterTitle, const std::string &movieTitle) const;
+
+    /// @return number of showtimes in the catalog
+    std::size_t getShowtimeCount() const;
 
     /// @brief Returns all playing movies in ALL theaters
     /// @return
@@ -36,15 +232,140 @@ public:
     /// @return
     Json::Value getTheatersShowingMovieJson(const std::string &movieTitle) const;
 
+    /// @brief Version of the theaters/rooms/movies definition, changes whenever the catalog does.
+    /// Results of getAllPlayingMoviesJson and getTheatersShowingMovieJson only depend on it.
+    std::uint64_t getCatalogVersion() const;
+
+    /// @brief Version of the bookings of a theater movie, see getBookings.
+    /// Changes whenever one of its rooms, or the showtime if given, is booked or the catalog changes.
+    std::uint64_t getBookingsVersion(const std::string &theaterTitle, const std::string &movieTitle, ShowtimeId showtime = NO_SHOWTIME) const;
+
+    /// @brief Position of the room that bookings of a theater movie go to, stable until the catalog changes.
+    /// Used to give every room an owning thread.
+    /// @param showtime showtime of the movie in the theater, its room is the one booked
+    /// @return the room ordinal, or -1 if the theater does not show the movie
+    long getRoomOrdinal(const std::string &theaterName, const std::string &movieTitle, ShowtimeId showtime = NO_SHOWTIME) const;
+
+    /// @brief Calls 'visit' for every room with the name of its theater, in catalog order
+    void forEachRoom(const std::function<void(const std::string &theaterName, const Room &room)> &visit) const;
+
+    /// @brief Writes the catalog and the current seat state as a binary snapshot.
+    /// The constructor loads such a file by mapping it instead of parsing JSON.
+    /// @param path file to write, replaced atomically
+    void saveSnapshot(const std::string &path) const;
+
+    /// @brief Whether 'filename' holds a binary catalog snapshot rather than JSON
+    static bool isCatalogSnapshot(const std::string &filename);
+
+    /// @brief Makes bookings durable in a write-ahead log.
+    /// Replays what earlier runs logged under 'path' into the catalog, then logs every new booking.
+    /// @param path prefix of the log segment and checkpoint files
+    /// @param checkpointBytes log size after which the seat state is checkpointed
+    /// @return number of replayed log records
+    std::size_t enableBookingLog(const std::string &path, std::size_t checkpointBytes = BookingLog::DEFAULT_CHECKPOINT_BYTES);
+
+    /// @brief Whether bookings are written to a log, see enableBookingLog
+    bool hasBookingLog() const;
+
+    /// @brief Runs 'callback' once every booking made so far is durable.
+    /// Without a booking log it runs right away on the calling thread.
+    void whenDurable(std::function<void()> callback);
+
+    /// @brief Makes this system a primary: from then on every booking is also appended to a
+    /// ReplicationLog that read replicas follow, see getReplicationLog
+    /// @param maxBytes size of the recent bookings kept for replicas that catch up
+    void enableReplicationLog(std::size_t maxBytes = ReplicationLog::DEFAULT_MAX_BYTES);
+
+    /// @return the replication log of a primary, nullptr otherwise
+    ReplicationLog *getReplicationLog() const;
+
+    /// @brief Makes this system a read replica, whose bookings only come from applyReplicatedBooking
+    void enableReplica();
+
+    /// @return the replication progress of a read replica, nullptr otherwise
+    ReplicaStatus *getReplicaStatus() const;
+
+    /// @brief Books the seats of a record received from the primary that are still free.
+    /// Records of rooms or showtimes missing from this catalog are skipped.
+    void applyReplicatedBooking(const BookingLog::Record &record);
+
+    /// @brief Sets the seats of the room or showtime of a Reset received from the primary to exactly
+    /// those of the record, freeing the others. Records of rooms or showtimes missing from this catalog are skipped.
+    void applyReplicatedReset(const BookingLog::Record &record);
+
+    /// @brief Room ordinal of the room a logged or replicated record books, e.g. to apply it on the thread owning the room
+    /// @return -1 if the room is not in the catalog
+    long getRecordRoomOrdinal(const BookingLog::Record &record) const;
+
+    /// @brief Emits one record per room and per showtime holding bookings, held seats left out.
+    /// Used by log checkpoints and for the full copy a replica starts from.
+    /// @param includeEmpty also emit the rooms and showtimes without bookings, e.g. to reset a replica's copy of them
+    void visitBookings(const BookingLog::RecordVisitor &emit, bool includeEmpty = false) const;
+
 private:
-    ReservationSystem() {}
+    /// @brief Calls 'visit' with a snapshot of the seat words of each room of a theater movie,
+    /// or of the showtime if given, see getBookings
+    void visitSeatSnapshots(const std::string &theaterTitle, const std::string &movieTitle, ShowtimeId showtime,
+                            const std::function<void(const std::uint64_t *words, int capacity)> &visit) const;
+
+    /// @brief Appends a successful booking to the log, if there is one
+    void logBooking(const std::string &theaterName, const Room &room, const std::vector<int> &seats);
+
+    /// @brief Appends a successful showtime booking to the log, if there is one
+    void logBooking(const Catalog &current, ShowtimeId showtime, const std::vector<int> &seats);
+
+    /// @brief Books the seats of a log or checkpoint record that are still free
+    void applyLoggedBooking(Catalog &current, const BookingLog::Record &record);
+
+    /// @brief Wheel tick of a point in time, counted from 'holdEpoch'
+    std::uint64_t holdTick(std::chrono::steady_clock::time_point time) const;
+
+    std::string catalogPath;
+    RcuPointer<Catalog> catalog;
+    std::atomic<std::uint64_t> catalogVersion{1};
+
+    /// @brief Points the holds at their rooms in 'next', dropping those it cannot keep, see reloadCatalog.
+    /// Called with 'holdsMutex' held.
+    void moveHolds(Catalog &next);
+
+    std::mutex reloadMutex; // Taken by reloads only, so they run one at a time
+    std::thread reloadThread;
+    std::atomic<bool> reloading{false};
+
+    /// @brief Seats taken by a hold
+    struct Hold
+    {
+        std::shared_ptr<Catalog> catalog; // Keeps 'room' alive across reloads
+        std::string theater;
+        Room *room;
+        long roomOrdinal;    // Position of 'room' in 'catalog', see getHoldRoomOrdinal
+        ShowtimeId showtime; // Showtime of 'room' in 'catalog' holding the seats, or NO_SHOWTIME for the room itself
+        std::vector<int> seats;
+        std::uint64_t expiryTick;
+    };
+
+    /// @brief Gives the seats of a hold back to its room or showtime. Called with 'holdsMutex' held
+    static void freeHeldSeats(const Hold &hold);
+
+    /// @brief Takes a room hold into 'room' of the next catalog, see moveHolds
+    /// @return false, the seats given back, if the room cannot keep it
+    static bool moveRoomHold(const Hold &hold, Room &room);
+
+    /// @brief Points a showtime hold at its showtime in the room at 'ordinal' of 'next', see moveHolds
+    /// @return false, the seats given back, if there is no such showtime or it cannot keep the hold
+    static bool moveShowtimeHold(Hold &hold, Catalog &next, long ordinal);
+
+    // Holds change seat bits under 'holdsMutex', so checkpoints taking it never see a half made hold
+    mutable std::mutex holdsMutex;
+    std::unordered_map<std::uint64_t, Hold> holds;        // hold id -> held seats
+    TimerWheel holdTimers;                                // hold ids by expiry tick, ended holds are skipped
+    std::chrono::steady_clock::time_point holdEpoch = std::chrono::steady_clock::now();
+    std::mt19937_64 holdIds{std::random_device{}()};     // Hold ids are hard to guess, not sequential
 
-    void addMovie(std::shared_ptr<Movie> movie);
-    void addTheater(const Theater &theater);
-    void addRoomToTheater(const std::string &theaterName, const Room &room);
+    std::unique_ptr<ReplicationLog> replicationLog;
+    std::unique_ptr<ReplicaStatus> replicaStatus;
 
-    std::vector<std::shared_ptr<Movie>> movies;
-    std::vector<Theater> theaters;
+    std::unique_ptr<BookingLog> bookingLog; // Declared last, its threads read the rooms until it is gone
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
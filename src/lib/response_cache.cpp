@@ -0,0 +1,68 @@
+#include <functional>
+
+#include "response_cache.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+ResponseCache::ResponseCache(std::size_t maxEntries)
+    : maxEntriesPerShard(maxEntries / SHARD_COUNT + 1)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const std::string> ResponseCache::find(const std::string &key, std::uint64_t version) const
+{
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end() || it->second.version != version)
+    {
+        return nullptr;
+    }
+    return it->second.response;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ResponseCache::store(const std::string &key, std::uint64_t version, std::shared_ptr<const std::string> response)
+{
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end())
+    {
+        it->second.version = version;
+        it->second.response = std::move(response);
+        return;
+    }
+    if (shard.entries.size() >= maxEntriesPerShard)
+    {
+        shard.entries.erase(shard.entries.begin()); // Make room, any entry will do
+    }
+    shard.entries.emplace(key, Entry{version, std::move(response)});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string ResponseCache::makeKey(const std::string &endpoint, const std::string &first, const std::string &second)
+{
+    // NUL separated, titles never contain one
+    std::string key;
+    key.reserve(endpoint.size() + first.size() + second.size() + 2);
+    key += endpoint;
+    key += '\0';
+    key += first;
+    key += '\0';
+    key += second;
+    return key;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ResponseCache::Shard &ResponseCache::shardFor(const std::string &key) const
+{
+    return shards[std::hash<std::string>()(key) % SHARD_COUNT];
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Cache of finished HTTP responses for the read endpoints.
+/// Entries are keyed by endpoint and arguments and tagged with the data version they were
+/// built from. A lookup with a different version misses, so callers invalidate entries
+/// just by asking with the current version. The table is split in independently locked
+/// shards so concurrent readers rarely meet.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class ResponseCache
+{
+public:
+    /// @brief Creates a cache holding up to 'maxEntries' responses
+    explicit ResponseCache(std::size_t maxEntries = 4096);
+
+    /// @brief Returns the stored response for 'key' if it was built from 'version'
+    /// @return the response bytes, or nullptr on a miss
+    std::shared_ptr<const std::string> find(const std::string &key, std::uint64_t version) const;
+
+    /// @brief Stores the response for 'key' built from 'version', replacing any older one
+    void store(const std::string &key, std::uint64_t version, std::shared_ptr<const std::string> response);
+
+    /// @brief Composes a cache key out of an endpoint and its arguments
+    static std::string makeKey(const std::string &endpoint, const std::string &first, const std::string &second = std::string());
+
+private:
+    static const std::size_t SHARD_COUNT = 16;
+
+    struct Entry
+    {
+        std::uint64_t version;
+        std::shared_ptr<const std::string> response;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    Shard &shardFor(const std::string &key) const;
+
+    std::size_t maxEntriesPerShard;
+    mutable Shard shards[SHARD_COUNT];
+};
@@ -0,0 +1,543 @@
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <thread>
+
+#include "seat_map.h"
+#include "bitmap_kernels.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// SeatMap Implementation
+///////////////////////////////////////////////////////////////////////////////
+
+SeatMap::SeatMap(int capacity)
+    : capacity(std::max(capacity, 0)), wordCount(0), storage(nullptr), words(nullptr), ownVersion(0), version(&ownVersion), contention(0)
+{
+    allocate();
+}
+
+SeatMap::SeatMap(int capacity, std::uint64_t *externalWords, std::atomic<std::uint64_t> *externalVersion, bool padded)
+    : capacity(std::max(capacity, 0)), wordCount(padded ? wordCountFor(capacity) : seatWordCountFor(capacity)), storage(nullptr), ownVersion(0),
+      version(externalVersion ? externalVersion : &ownVersion), contention(0)
+{
+    static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t) &&
+                      std::atomic<std::uint64_t>::is_always_lock_free,
+                  "seat words are shared with plain 64-bit storage");
+    words = reinterpret_cast<std::atomic<std::uint64_t> *>(externalWords);
+}
+
+SeatMap::SeatMap(SeatMap &&other) noexcept
+    : capacity(other.capacity), wordCount(other.wordCount), storage(other.storage), words(other.words),
+      ownVersion(other.ownVersion.load(std::memory_order_acquire)),
+      version(other.version == &other.ownVersion ? &ownVersion : other.version), contention(other.getContentionCount())
+{
+    other.capacity = 0;
+    other.wordCount = 0;
+    other.storage = nullptr;
+    other.words = nullptr;
+}
+
+SeatMap::SeatMap(const SeatMap &other)
+    : capacity(other.capacity), wordCount(0), storage(nullptr), words(nullptr), ownVersion(0), version(&ownVersion), contention(0)
+{
+    allocate();
+    std::vector<std::uint64_t> copy(wordCount);
+    ownVersion.store(other.snapshot(copy.data()) << WRITER_BITS, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < wordCount; ++i)
+    {
+        words[i].store(copy[i], std::memory_order_relaxed);
+    }
+}
+
+SeatMap::~SeatMap()
+{
+    ::operator delete(storage);
+}
+
+std::size_t SeatMap::wordCountFor(int capacity)
+{
+    const std::size_t wordsPerLine = CACHE_LINE_SIZE / sizeof(std::uint64_t);
+    // Pad to whole cache lines, the extra words stay zero and are never handed out
+    return (seatWordCountFor(capacity) + wordsPerLine - 1) / wordsPerLine * wordsPerLine;
+}
+
+std::size_t SeatMap::seatWordCountFor(int capacity)
+{
+    return std::max<std::size_t>(1, (std::max(capacity, 0) + SEATS_PER_WORD - 1) / SEATS_PER_WORD);
+}
+
+void SeatMap::allocate()
+{
+    wordCount = wordCountFor(capacity);
+
+    std::size_t bytes = wordCount * sizeof(std::atomic<std::uint64_t>);
+    std::size_t space = bytes + CACHE_LINE_SIZE;
+    storage = ::operator new(space);
+    void *aligned = storage;
+    std::align(CACHE_LINE_SIZE, bytes, aligned, space);
+
+    words = static_cast<std::atomic<std::uint64_t> *>(aligned);
+    for (std::size_t i = 0; i < wordCount; ++i)
+    {
+        new (&words[i]) std::atomic<std::uint64_t>(0);
+    }
+}
+
+int SeatMap::getCapacity() const
+{
+    return capacity;
+}
+
+std::size_t SeatMap::getWordCount() const
+{
+    return wordCount;
+}
+
+std::uint64_t SeatMap::snapshot(std::uint64_t *out) const
+{
+    const int SPINS_BEFORE_YIELD = 64;
+
+    for (int attempt = 0;; ++attempt)
+    {
+        std::uint64_t before = version->load(std::memory_order_acquire);
+        if ((before & RUNNING_MASK) == 0)
+        {
+            copyWords(out);
+            // Keeps the word loads above the second version load: a copied word written by a
+            // change means the version moved, since the change marked itself before writing
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (version->load(std::memory_order_relaxed) == before)
+            {
+                return before >> WRITER_BITS;
+            }
+        }
+        if (attempt >= SPINS_BEFORE_YIELD)
+        {
+            std::this_thread::yield(); // Changes are a handful of atomics, but their thread may be descheduled
+        }
+    }
+}
+
+void SeatMap::copyWords(std::uint64_t *out) const
+{
+    for (std::size_t i = 0; i < wordCount; ++i)
+    {
+        out[i] = words[i].load(std::memory_order_relaxed);
+    }
+}
+
+std::uint64_t SeatMap::getVersion() const
+{
+    return version->load(std::memory_order_acquire) >> WRITER_BITS;
+}
+
+bool SeatMap::beginWrite()
+{
+    if (version->fetch_add(1, std::memory_order_acq_rel) & SEALED)
+    {
+        version->fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void SeatMap::endWrite(bool changed)
+{
+    // One atomic add both ends the change and counts it
+    if (changed)
+    {
+        version->fetch_add((std::uint64_t(1) << WRITER_BITS) - 1, std::memory_order_release);
+    }
+    else
+    {
+        version->fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void SeatMap::seal()
+{
+    const int SPINS_BEFORE_YIELD = 64;
+
+    version->fetch_or(SEALED, std::memory_order_acq_rel);
+    // Changes that began before the seal finish, the ones after it back out right away
+    for (int attempt = 0; version->load(std::memory_order_acquire) & RUNNING_MASK; ++attempt)
+    {
+        if (attempt >= SPINS_BEFORE_YIELD)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool SeatMap::isSealed() const
+{
+    return (version->load(std::memory_order_acquire) & SEALED) != 0;
+}
+
+std::uint64_t SeatMap::getContentionCount() const
+{
+    return contention.load(std::memory_order_relaxed);
+}
+
+void SeatMap::noteContention()
+{
+    // Only reached on retries, which already fight over this map's cache lines
+    contention.fetch_add(1, std::memory_order_relaxed);
+}
+
+int SeatMap::countAvailable() const
+{
+    std::vector<std::uint64_t> copy(wordCount);
+    snapshot(copy.data());
+    return capacity - static_cast<int>(bitmap::popcount(copy.data(), wordCount));
+}
+
+std::vector<int> SeatMap::getBookedSeats() const
+{
+    std::vector<std::uint64_t> copy(wordCount);
+    snapshot(copy.data());
+    std::vector<int> booked;
+    for (long seat = bitmap::findFirstSet(copy.data(), capacity, 0); seat >= 0;
+         seat = bitmap::findFirstSet(copy.data(), capacity, seat + 1))
+    {
+        booked.push_back(static_cast<int>(seat));
+    }
+    return booked;
+}
+
+int SeatMap::findAvailable(int from) const
+{
+    if (from < 0)
+    {
+        from = 0;
+    }
+    std::vector<std::uint64_t> copy(wordCount);
+    snapshot(copy.data());
+    return static_cast<int>(bitmap::findFirstClear(copy.data(), capacity, from));
+}
+
+bool SeatMap::isAvailable(int seatNumber) const
+{
+    if (seatNumber < 0 || seatNumber >= capacity)
+    {
+        return false;
+    }
+    std::uint64_t bit = std::uint64_t(1) << (seatNumber % SEATS_PER_WORD);
+    return (words[seatNumber / SEATS_PER_WORD].load(std::memory_order_acquire) & bit) == 0;
+}
+
+bool SeatMap::reserve(int seatNumber)
+{
+    if (seatNumber < 0 || seatNumber >= capacity)
+    {
+        return false;
+    }
+    std::uint64_t bit = std::uint64_t(1) << (seatNumber % SEATS_PER_WORD);
+    std::atomic<std::uint64_t> &word = words[seatNumber / SEATS_PER_WORD];
+    if ((word.load(std::memory_order_acquire) & bit) && !waitForRollback(word, bit))
+    {
+        return false; // Taken, no need to make snapshots wait
+    }
+    if (!beginWrite())
+    {
+        return false;
+    }
+    // fetch_or both claims the seat and tells whether somebody else had it
+    bool claimed = (word.fetch_or(bit, std::memory_order_acq_rel) & bit) == 0;
+    endWrite(claimed);
+    return claimed;
+}
+
+bool SeatMap::reserve(const std::vector<int> &seatNumbers)
+{
+    std::vector<WordMask> masks;
+    if (!toWordMasks(seatNumbers, masks))
+    {
+        return false;
+    }
+    if (masks.empty())
+    {
+        return true;
+    }
+
+    const int MAX_ATTEMPTS = 8; // Bounds the retries while other requests keep claiming the same seats
+
+    for (int attempt = 1;; ++attempt)
+    {
+        if (!beginWrite())
+        {
+            return false;
+        }
+        std::size_t i = 0;
+        for (; i < masks.size(); ++i)
+        {
+            std::atomic<std::uint64_t> &word = words[masks[i].word];
+            std::uint64_t current = word.load(std::memory_order_acquire);
+            bool taken = false;
+            while (true)
+            {
+                if (current & masks[i].mask)
+                {
+                    taken = true; // At least one seat of this word is booked
+                    break;
+                }
+                if (word.compare_exchange_weak(current, current | masks[i].mask,
+                                               std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    break;
+                }
+                noteContention(); // Another booking changed the word, look again
+            }
+            if (taken)
+            {
+                break;
+            }
+        }
+        if (i == masks.size())
+        {
+            endWrite(true);
+            return true;
+        }
+
+        // Give back the words already claimed by this request
+        for (std::size_t j = 0; j < i; ++j)
+        {
+            words[masks[j].word].fetch_and(~masks[j].mask, std::memory_order_acq_rel);
+        }
+        endWrite(false);
+        // The seats may only be claimed by a request that is about to give them back as well
+        if (attempt == MAX_ATTEMPTS || !waitForRollback(words[masks[i].word], masks[i].mask))
+        {
+            return false;
+        }
+    }
+}
+
+bool SeatMap::waitForRollback(const std::atomic<std::uint64_t> &word, std::uint64_t mask) const
+{
+    const int SPINS_BEFORE_YIELD = 64;
+    const int MAX_WAITS = 128; // Bounds the wait for a real conflict while other changes keep running
+
+    for (int attempt = 0; attempt < MAX_WAITS; ++attempt)
+    {
+        // Read the writers first: a rollback clears its bits before it stops counting as running
+        bool running = (version->load(std::memory_order_acquire) & RUNNING_MASK) != 0;
+        if ((word.load(std::memory_order_acquire) & mask) == 0)
+        {
+            return true;
+        }
+        if (!running)
+        {
+            return false;
+        }
+        if (attempt >= SPINS_BEFORE_YIELD)
+        {
+            std::this_thread::yield();
+        }
+    }
+    return false;
+}
+
+bool SeatMap::release(const std::vector<int> &seatNumbers)
+{
+    std::vector<WordMask> masks;
+    if (!toWordMasks(seatNumbers, masks))
+    {
+        return false;
+    }
+    if (masks.empty())
+    {
+        return true;
+    }
+    if (!beginWrite())
+    {
+        return false;
+    }
+    for (const WordMask &wordMask : masks)
+    {
+        words[wordMask.word].fetch_and(~wordMask.mask, std::memory_order_acq_rel);
+    }
+    endWrite(true);
+    return true;
+}
+
+std::vector<int> SeatMap::reserveAvailable(int count, bool contiguous, int seatsPerRow)
+{
+    const int MAX_ATTEMPTS = 16;
+
+    std::vector<int> picked;
+    if (count <= 0 || count > capacity)
+    {
+        return picked;
+    }
+    std::vector<std::uint64_t> copy(wordCount);
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt)
+    {
+        copyWords(copy.data());
+        picked.clear();
+        if (!pickAvailable(copy.data(), count, contiguous, seatsPerRow, picked))
+        {
+            break; // Not enough free seats, no point retrying
+        }
+        if (reserve(picked))
+        {
+            return picked;
+        }
+        if (isSealed())
+        {
+            break;
+        }
+        // A concurrent booking took one of the picked seats, look again
+        noteContention();
+    }
+    picked.clear();
+    return picked;
+}
+
+std::vector<bool> SeatMap::reserveBatch(const std::vector<const std::vector<int> *> &requests)
+{
+    const int MAX_ATTEMPTS = 16;
+
+    std::vector<bool> booked(requests.size(), false);
+    std::vector<std::vector<WordMask>> masks(requests.size());
+    std::vector<bool> valid(requests.size());
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+        valid[i] = toWordMasks(*requests[i], masks[i]);
+    }
+
+    std::vector<std::uint64_t> before(wordCount);
+    std::vector<std::uint64_t> after(wordCount);
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt)
+    {
+        // Decide every request against a private copy of the map
+        copyWords(before.data());
+        after = before;
+        for (std::size_t i = 0; i < requests.size(); ++i)
+        {
+            booked[i] = valid[i];
+            for (const WordMask &wordMask : masks[i])
+            {
+                if (after[wordMask.word] & wordMask.mask)
+                {
+                    booked[i] = false; // Taken before the batch or by an earlier request
+                    break;
+                }
+            }
+            if (booked[i])
+            {
+                for (const WordMask &wordMask : masks[i])
+                {
+                    after[wordMask.word] |= wordMask.mask;
+                }
+            }
+        }
+
+        if (after == before)
+        {
+            return booked; // Nothing to book
+        }
+
+        // Commit the changed words, undoing them if any word moved since the copy
+        if (!beginWrite())
+        {
+            return std::vector<bool>(requests.size(), false);
+        }
+        std::size_t committed = 0;
+        for (; committed < wordCount; ++committed)
+        {
+            if (after[committed] == before[committed])
+            {
+                continue;
+            }
+            std::uint64_t expected = before[committed];
+            if (!words[committed].compare_exchange_strong(expected, after[committed], std::memory_order_acq_rel))
+            {
+                break;
+            }
+        }
+        if (committed == wordCount)
+        {
+            endWrite(true);
+            return booked;
+        }
+        for (std::size_t w = 0; w < committed; ++w)
+        {
+            words[w].fetch_and(~(after[w] ^ before[w]), std::memory_order_acq_rel);
+        }
+        endWrite(false);
+        noteContention();
+    }
+
+    // Heavy contention on this room: fall back to booking requests one by one
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+        booked[i] = valid[i] && reserve(*requests[i]);
+    }
+    return booked;
+}
+
+bool SeatMap::pickAvailable(const std::uint64_t *snapshotWords, int count, bool contiguous, int seatsPerRow,
+                            std::vector<int> &picked) const
+{
+    if (!contiguous)
+    {
+        long seat = bitmap::findFirstClear(snapshotWords, capacity, 0);
+        while (seat >= 0 && static_cast<int>(picked.size()) < count)
+        {
+            picked.push_back(static_cast<int>(seat));
+            seat = bitmap::findFirstClear(snapshotWords, capacity, seat + 1);
+        }
+        return static_cast<int>(picked.size()) == count;
+    }
+
+    if (seatsPerRow <= 0)
+    {
+        seatsPerRow = capacity;
+    }
+    for (int rowStart = 0; rowStart < capacity; rowStart += seatsPerRow)
+    {
+        int rowEnd = std::min(rowStart + seatsPerRow, capacity);
+        long start = bitmap::findFirstClear(snapshotWords, rowEnd, rowStart);
+        while (start >= 0 && rowEnd - start >= count)
+        {
+            // The free run ends at the next booked seat or at the end of the row
+            long end = bitmap::findFirstSet(snapshotWords, rowEnd, start);
+            if (end < 0)
+            {
+                end = rowEnd;
+            }
+            if (end - start >= count)
+            {
+                for (int seat = static_cast<int>(start); seat < start + count; ++seat)
+                {
+                    picked.push_back(seat);
+                }
+                return true;
+            }
+            start = bitmap::findFirstClear(snapshotWords, rowEnd, end);
+        }
+    }
+    return false;
+}
+
+bool SeatMap::toWordMasks(const std::vector<int> &seatNumbers, std::vector<WordMask> &masks) const
+{
+    std::vector<int> seats(seatNumbers);
+    std::sort(seats.begin(), seats.end());
+
+    for (int seatNumber : seats)
+    {
+        if (seatNumber < 0 || seatNumber >= capacity)
+        {
+            return false;
+        }
+        std::size_t word = seatNumber / SEATS_PER_WORD;
+        if (masks.empty() || masks.back().word != word)
+        {
+            masks.push_back(WordMask{word, 0});
+        }
+        masks.back().mask |= std::uint64_t(1) << (seatNumber % SEATS_PER_WORD);
+    }
+    return true;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Lock-free seat occupancy bitmap.
+/// Seats are packed 64 per word, a set bit means the seat is booked.
+/// Words live in cache-line aligned storage padded to whole lines, so two rooms never share a line.
+/// Multi-seat reservations take every word they touch with one compare-and-swap,
+/// and are rolled back if any seat was already booked, so they succeed or fail as a whole.
+/// Readers copy the map seqlock style: every change is bracketed by a writer count in the
+/// version word, and a copy only counts if no writer was active and the version did not
+/// move while it was taken. Readers never block writers and only retry when one raced them,
+/// so a copy never shows half of a multi-word booking or one that was rolled back.
+/// A sealed map refuses every change from then on, see seal.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class SeatMap
+{
+public:
+    static const int SEATS_PER_WORD = 64;
+    static const std::size_t CACHE_LINE_SIZE = 64;
+
+    /// @brief Creates a map with 'capacity' free seats
+    explicit SeatMap(int capacity);
+
+    /// @brief Creates a map over words owned by someone else, e.g. a mapped catalog snapshot.
+    /// @param externalWords cache-line aligned storage of wordCountFor(capacity) words, must outlive the map
+    /// @param externalVersion version word shared by every map over 'externalWords', nullptr for one of its own
+    /// @param padded false if 'externalWords' only holds seatWordCountFor(capacity) words, not on a line of its own
+    SeatMap(int capacity, std::uint64_t *externalWords, std::atomic<std::uint64_t> *externalVersion = nullptr, bool padded = true);
+
+    /// @brief Copies the current occupancy of another map
+    SeatMap(const SeatMap &other);
+
+    /// @brief Takes over the storage of another map, which is left empty
+    SeatMap(SeatMap &&other) noexcept;
+
+    SeatMap &operator=(const SeatMap &other) = delete;
+
+    ~SeatMap();
+
+    /// @return number of seats in the map
+    int getCapacity() const;
+
+    /// @return number of 64-bit words backing the map
+    std::size_t getWordCount() const;
+
+    /// @return number of 64-bit words backing a map of 'capacity' seats, padded to whole cache lines
+    static std::size_t wordCountFor(int capacity);
+
+    /// @return number of 64-bit words holding 'capacity' seats without padding, at least one
+    static std::size_t seatWordCountFor(int capacity);
+
+    /// @brief Copies the occupancy words into 'out', which must hold getWordCount() words.
+    /// The copy is the state of the map at one moment, retried while a change races it.
+    /// @return the occupancy version the copy has, see getVersion
+    std::uint64_t snapshot(std::uint64_t *out) const;
+
+    /// @return number of seats not booked
+    int countAvailable() const;
+
+    /// @brief Occupancy version, incremented after every change to the map
+    std::uint64_t getVersion() const;
+
+    /// @brief Number of times a booking had to retry because another thread changed the map under it
+    std::uint64_t getContentionCount() const;
+
+    /// @brief Stops every change to the map for good: bookings fail as if the seats were taken and
+    /// releases change nothing. Returns once the changes already running are over, so the words
+    /// keep what was booked until then. Every map over the same version word is sealed with it.
+    void seal();
+
+    /// @return whether seal was called
+    bool isSealed() const;
+
+    /// @return the booked seat numbers, ascending
+    std::vector<int> getBookedSeats() const;
+
+    /// @return the first available seat at or after 'from', or -1 if there is none
+    int findAvailable(int from = 0) const;
+
+    /// @brief Checks a seat is inside the map and not booked
+    bool isAvailable(int seatNumber) const;
+
+    /// @brief Books one seat if not already booked
+    bool reserve(int seatNumber);
+
+    /// @brief Books all seats or none of them.
+    /// Fails if any seat is out of range or already booked. Duplicated seats count once.
+    bool reserve(const std::vector<int> &seatNumbers);
+
+    /// @brief Frees the given seats, booked or not.
+    /// @return false, changing nothing, if any seat is out of range or the map is sealed
+    bool release(const std::vector<int> &seatNumbers);
+
+    /// @brief Finds and books 'count' free seats in one go.
+    /// Free seats are picked lowest number first. When 'contiguous' is set they must be
+    /// adjacent and inside one row of 'seatsPerRow' seats. Retries if another booking races it.
+    /// @return the booked seats, or an empty vector if the request cannot be met
+    std::vector<int> reserveAvailable(int count, bool contiguous, int seatsPerRow);
+
+    /// @brief Books several independent seat requests against this map in one pass.
+    /// Requests are decided in order on a private copy of the map, so later ones lose to
+    /// earlier ones, and all winners are then committed with one compare-and-swap per word.
+    /// @return whether each request was booked
+    std::vector<bool> reserveBatch(const std::vector<const std::vector<int> *> &requests);
+
+private:
+    /// @brief Picks 'count' free seats from a snapshot, see reserveAvailable
+    bool pickAvailable(const std::uint64_t *snapshotWords, int count, bool contiguous, int seatsPerRow,
+                       std::vector<int> &picked) const;
+
+    /// @brief One word of a multi-seat request
+    struct WordMask
+    {
+        std::size_t word;
+        std::uint64_t mask;
+    };
+
+    /// @brief Groups seat numbers into per-word masks, sorted by word
+    bool toWordMasks(const std::vector<int> &seatNumbers, std::vector<WordMask> &masks) const;
+
+    /// @brief Waits while seats of 'mask' in 'word' may be claims another change is about to roll back.
+    /// Callers hold no claims while waiting, so the change holding the seats never waits on them.
+    /// @return true once the seats are free, false if they stay booked with no other change running
+    bool waitForRollback(const std::atomic<std::uint64_t> &word, std::uint64_t mask) const;
+
+    /// @brief Marks a change as running, snapshots wait for it to end
+    /// @return false, marking nothing, if the map is sealed and must not change
+    bool beginWrite();
+
+    /// @brief Ends a change begun with beginWrite, counting a new version if 'changed'
+    void endWrite(bool changed);
+
+    /// @brief Copies the words one by one, without checking for racing changes. For writers,
+    /// which validate what they copied with compare-and-swap anyway.
+    void copyWords(std::uint64_t *out) const;
+
+    /// @brief Records a retry caused by a concurrent booking
+    void noteContention();
+
+    /// @brief Allocates 'wordCount' zeroed words on a cache line boundary
+    void allocate();
+
+    int capacity;
+    std::size_t wordCount;
+    void *storage;                       // Raw allocation, over-sized for alignment. Null for external words
+    std::atomic<std::uint64_t> *words; // Aligned view into 'storage'
+    static const int WRITER_BITS = 16;
+    static const std::uint64_t SEALED = std::uint64_t(1) << (WRITER_BITS - 1); // Top writer bit, never reached by the count
+    static const std::uint64_t RUNNING_MASK = SEALED - 1;                       // Changes running
+
+    std::atomic<std::uint64_t> ownVersion; // Used unless the version word is external
+    std::atomic<std::uint64_t> *version;   // Changes made, shifted by WRITER_BITS, plus the changes running
+    std::atomic<std::uint64_t> contention;
+};
@@ -0,0 +1,494 @@
+#include <limits>
+
+#include "seat_request_decoder.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /// @brief Value of a hex digit, or -1
+    int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F')
+        {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SeatRequestDecoder::decode(SeatRequestBody &request)
+{
+    pos = 0;
+    skipWhitespace();
+    if (pos == body.size())
+    {
+        return true; // No body, no fields
+    }
+    if (!consume('{'))
+    {
+        return false;
+    }
+    bool first = true;
+    while (!consume('}'))
+    {
+        if (!first && !consume(','))
+        {
+            return false;
+        }
+        first = false;
+
+        std::string_view key;
+        skipWhitespace();
+        if (!parseString(request, key) || !consume(':'))
+        {
+            return false;
+        }
+        skipWhitespace();
+        if (key == "movie" || key == "theater")
+        {
+            std::string_view &value = key == "movie" ? request.movie : request.theater;
+            if (!parseString(request, value))
+            {
+                return false;
+            }
+            (key == "movie" ? request.hasMovie : request.hasTheater) = true;
+        }
+        else if (key == "showtime")
+        {
+            bool isInteger = false;
+            std::int64_t value = 0;
+            if (!parseNumber(isInteger, value) || !isInteger || value < 0 || value >= NO_SHOWTIME)
+            {
+                return false;
+            }
+            request.showtime = static_cast<ShowtimeId>(value);
+        }
+        else if (key == "seats")
+        {
+            if (!parseSeats(request))
+            {
+                return false;
+            }
+        }
+        else if (!skipValue(request, 0))
+        {
+            return false;
+        }
+    }
+    skipWhitespace();
+    return pos == body.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SeatRequestDecoder::skipWhitespace()
+{
+    while (pos < body.size() && (body[pos] == ' ' || body[pos] == '\t' || body[pos] == '\n' || body[pos] == '\r'))
+    {
+        ++pos;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SeatRequestDecoder::consume(char c)
+{
+    skipWhitespace();
+    if (pos < body.size() && body[pos] == c)
+    {
+        ++pos;
+        return true;
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SeatRequestDecoder::parseString(SeatRequestBody &request, std::string_view &value)
+{
+    if (pos >= body.size() || body[pos] != '"')
+    {
+        return false;
+    }
+    std::size_t start = ++pos;
+
+    // Common case: no escapes, the value is a view of the body
+    while (pos < body.size() && body[pos] != '"' && body[pos] != '\\')
+    {
+        if (static_cast<unsigned char>(body[pos]) < 0x20)
+        {
+            return false; // Control characters must be escaped
+        }
+        ++pos;
+    }
+    if (pos >= body.size())
+    {
+        return false;
+    }
+    if (body[pos] == '"')
+    {
+        value = body.substr(start, pos - start);
+        ++pos;
+        return true;
+    }
+
+    // Copy what came before the first escape, then unescape the rest
+    std::size_t textStart = request.textSize;
+    auto append = [&request](char c)
+    {
+        if (request.textSize == SeatRequestBody::MAX_TEXT_SIZE)
+        {
+            return false;
+        }
+        request.text[request.textSize++] = c;
+        return true;
+    };
+    for (std::size_t i = start; i < pos; ++i)
+    {
+        if (!append(body[i]))
+        {
+            return false;
+        }
+    }
+    while (pos < body.size() && body[pos] != '"')
+    {
+        char c = body[pos++];
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+            return false;
+        }
+        if (c != '\\')
+        {
+            if (!append(c))
+            {
+                return false;
+            }
+            continue;
+        }
+        if (pos >= body.size())
+        {
+            return false;
+        }
+        char escape = body[pos++];
+        switch (escape)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            c = escape;
+            break;
+        case 'b':
+            c = '\b';
+            break;
+        case 'f':
+            c = '\f';
+            break;
+        case 'n':
+            c = '\n';
+            break;
+        case 'r':
+            c = '\r';
+            break;
+        case 't':
+            c = '\t';
+            break;
+        case 'u':
+        {
+            auto readHex = [this](std::uint32_t &unit)
+            {
+                if (body.size() - pos < 4)
+                {
+                    return false;
+                }
+                unit = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    int digit = hexValue(body[pos++]);
+                    if (digit < 0)
+                    {
+                        return false;
+                    }
+                    unit = unit * 16 + static_cast<std::uint32_t>(digit);
+                }
+                return true;
+            };
+            std::uint32_t codePoint = 0;
+            if (!readHex(codePoint))
+            {
+                return false;
+            }
+            if (codePoint >= 0xd800 && codePoint < 0xdc00)
+            {
+                // High surrogate, a low one must follow
+                std::uint32_t low = 0;
+                if (body.substr(pos, 2) != "\\u" || (pos += 2, !readHex(low)) || low < 0xdc00 || low >= 0xe000)
+                {
+                    return false;
+                }
+                codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+            }
+            else if (codePoint >= 0xdc00 && codePoint < 0xe000)
+            {
+                return false;
+            }
+
+            // Encode as UTF-8
+            bool fits = true;
+            if (codePoint < 0x80)
+            {
+                fits = append(static_cast<char>(codePoint));
+            }
+            else if (codePoint < 0x800)
+            {
+                fits = append(static_cast<char>(0xc0 | (codePoint >> 6))) &&
+                       append(static_cast<char>(0x80 | (codePoint & 0x3f)));
+            }
+            else if (codePoint < 0x10000)
+            {
+                fits = append(static_cast<char>(0xe0 | (codePoint >> 12))) &&
+                       append(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f))) &&
+                       append(static_cast<char>(0x80 | (codePoint & 0x3f)));
+            }
+            else
+            {
+                fits = append(static_cast<char>(0xf0 | (codePoint >> 18))) &&
+                       append(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f))) &&
+                       append(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f))) &&
+                       append(static_cast<char>(0x80 | (codePoint & 0x3f)));
+            }
+            if (!fits)
+            {
+                return false;
+            }
+            continue;
+        }
+        default:
+            return false;
+        }
+        if (!append(c))
+        {
+            return false;
+        }
+    }
+    if (pos >= body.size())
+    {
+        return false;
+    }
+    ++pos;
+    value = std::string_view(request.text + textStart, request.textSize - textStart);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SeatRequestDecoder::parseNumber(bool &isInteger, std::int64_t &value)
+{
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    bool negative = pos < body.size() && body[pos] == '-';
+    if (negative)
+    {
+        ++pos;
+    }
+    if (pos >= body.size() || body[pos] < '0' || body[pos] > '9')
+    {
+        return false;
+    }
+    std::uint64_t magnitude = 0;
+    const std::uint64_t limit = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+    if (body[pos] == '0')
+    {
+        ++pos;
+    }
+    else
+    {
+        while (pos < body.size() && body[pos] >= '0' && body[pos] <= '9')
+        {
+            magnitude = magnitude > limit / 10 ? limit + 1 : magnitude * 10 + static_cast<std::uint64_t>(body[pos] - '0');
+            ++pos;
+        }
+    }
+    isInteger = true;
+    if (pos < body.size() && body[pos] == '.')
+    {
+        isInteger = false;
+        ++pos;
+        std::size_t digits = pos;
+        while (pos < body.size() && body[pos] >= '0' && body[pos] <= '9')
+        {
+            ++pos;
+        }
+        if (pos == digits)
+        {
+            return false;
+        }
+    }
+    if (pos < body.size() && (body[pos] == 'e' || body[pos] == 'E'))
+    {
+        isInteger = false;
+        ++pos;
+        if (pos < body.size() && (body[pos] == '+' || body[pos] == '-'))
+        {
+            ++pos;
+        }
+        std::size_t digits = pos;
+        while (pos < body.size() && body[pos] >= '0' && body[pos] <= '9')
+        {
+            ++pos;
+        }
+        if (pos == digits)
+        {
+            return false;
+        }
+    }
+    magnitude = magnitude > limit ? limit : magnitude;
+    value = negative ? -static_cast<std::int64_t>(magnitude) : static_cast<std::int64_t>(magnitude);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SeatRequestDecoder::parseSeats(SeatRequestBody &request)
+{
+    if (!consume('['))
+    {
+        return false;
+    }
+    request.hasSeats = true;
+    request.seatCount = 0;
+    request.skippedSeats = 0;
+    bool first = true;
+    while (!consume(']'))
+    {
+        if (!first && !consume(','))
+        {
+            return false;
+        }
+        first = false;
+        skipWhitespace();
+
+        bool isInteger = false;
+        std::int64_t value = 0;
+        char c = pos < body.size() ? body[pos] : '\0';
+        if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            if (!parseNumber(isInteger, value))
+            {
+                return false;
+            }
+        }
+        else if (!skipValue(request, 1))
+        {
+            return false;
+        }
+
+        if (!isInteger || value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max())
+        {
+            ++request.skippedSeats;
+        }
+        else if (request.seatCount == SeatRequestBody::MAX_SEATS)
+        {
+            return false;
+        }
+        else
+        {
+            request.seats[request.seatCount++] = static_cast<int>(value);
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SeatRequestDecoder::skipValue(SeatRequestBody &request, int depth)
+{
+    if (depth > MAX_DEPTH)
+    {
+        return false;
+    }
+    skipWhitespace();
+    if (pos >= body.size())
+    {
+        return false;
+    }
+    switch (body[pos])
+    {
+    case '"':
+    {
+        // Unescaped text is dropped again right away
+        std::size_t textSize = request.textSize;
+        std::string_view ignored;
+        bool valid = parseString(request, ignored);
+        request.textSize = textSize;
+        return valid;
+    }
+    case '{':
+    case '[':
+    {
+        bool isObject = body[pos++] == '{';
+        char close = isObject ? '}' : ']';
+        bool first = true;
+        while (!consume(close))
+        {
+            if (!first && !consume(','))
+            {
+                return false;
+            }
+            first = false;
+            if (isObject)
+            {
+                skipWhitespace();
+                std::size_t textSize = request.textSize;
+                std::string_view key;
+                bool valid = parseString(request, key) && consume(':');
+                request.textSize = textSize;
+                if (!valid)
+                {
+                    return false;
+                }
+            }
+            if (!skipValue(request, depth + 1))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    case 't':
+        return parseLiteral("true");
+    case 'f':
+        return parseLiteral("false");
+    case 'n':
+        return parseLiteral("null");
+    default:
+    {
+        bool isInteger = false;
+        std::int64_t value = 0;
+        return parseNumber(isInteger, value);
+    }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool SeatRequestDecoder::parseLiteral(std::string_view word)
+{
+    if (body.substr(pos, word.size()) != word)
+    {
+        return false;
+    }
+    pos += word.size();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "showtime_store.h"
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Fields of a /find, /bookings, /showtimes or /seats request body.
+/// Strings point into the request body, or into 'text' when they had escapes to undo,
+/// so they are valid as long as both are.
+///////////////////////////////////////////////////////////////////////////////////////
+
+struct SeatRequestBody
+{
+    static constexpr std::size_t MAX_SEATS = 256;     // Longer seat lists are rejected
+    static constexpr std::size_t MAX_TEXT_SIZE = 512; // Room for unescaped strings
+
+    std::string_view movie;
+    std::string_view theater;
+    bool hasMovie = false;
+    bool hasTheater = false;
+    bool hasSeats = false;
+    ShowtimeId showtime = NO_SHOWTIME;
+
+    int seats[MAX_SEATS];
+    std::size_t seatCount = 0;
+    std::size_t skippedSeats = 0; // Seat list entries that were not integers, left out
+
+    char text[MAX_TEXT_SIZE];
+    std::size_t textSize = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Decodes the fixed request schema of the seat endpoints straight from the body.
+///
+/// A single pass over the bytes fills a SeatRequestBody without building a document or
+/// allocating. "movie" and "theater" must be strings, "showtime" a showtime id and
+/// "seats" an array. Other members are checked for syntax and skipped, and a repeated
+/// member replaces the earlier one. Anything that is not one JSON object, a wrong type
+/// for a known member or a body over the fixed capacities fails the decode.
+/// An empty body decodes as an empty object.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class SeatRequestDecoder
+{
+public:
+    /// @brief Deepest nesting accepted inside skipped members
+    static constexpr int MAX_DEPTH = 32;
+
+    explicit SeatRequestDecoder(std::string_view body) : body(body) {}
+
+    /// @brief Decodes the whole body into 'request'
+    /// @return false if the body is malformed or does not fit the schema
+    bool decode(SeatRequestBody &request);
+
+private:
+    /// @brief Skips spaces, tabs and line breaks
+    void skipWhitespace();
+
+    /// @brief Consumes 'c' after any whitespace
+    bool consume(char c);
+
+    /// @brief Parses a string at the cursor, unescaping into request.text if needed
+    bool parseString(SeatRequestBody &request, std::string_view &value);
+
+    /// @brief Parses a number at the cursor
+    /// @param isInteger set when it has no fraction or exponent
+    /// @param value its value if 'isInteger', clamped to the int64 range
+    bool parseNumber(bool &isInteger, std::int64_t &value);
+
+    /// @brief Parses the "seats" array
+    bool parseSeats(SeatRequestBody &request);
+
+    /// @brief Checks and skips any value
+    bool skipValue(SeatRequestBody &request, int depth);
+
+    /// @brief Consumes the literal 'word', e.g. "true"
+    bool parseLiteral(std::string_view word);
+
+    std::string_view body;
+    std::size_t pos = 0;
+};
@@ -0,0 +1,374 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include "showtime_store.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+ShowtimeStore::Block::~Block()
+{
+    for (std::size_t i = 0; i < showtimeCount; ++i)
+    {
+        delete changeRings[i].load();
+    }
+    ::operator delete(storage);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ShowtimeId ShowtimeStore::add(std::uint32_t roomOrdinal, std::uint32_t movieId, std::int64_t start, int capacity, int seatsPerRow)
+{
+    ShowtimeId showtime = static_cast<ShowtimeId>(rooms.size());
+    rooms.push_back(roomOrdinal);
+    movies.push_back(movieId);
+    starts.push_back(start);
+    capacities.push_back(static_cast<std::uint32_t>(capacity > 0 ? capacity : 0));
+    rowLengths.push_back(static_cast<std::uint32_t>(seatsPerRow > 0 ? seatsPerRow : capacities.back()));
+    // Bitmaps are packed word by word, padding each to a cache line would take 8 words for a small room
+    wordOffsets.push_back(wordCount);
+    wordCount += SeatMap::seatWordCountFor(capacity);
+    return showtime;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ShowtimeStore::allocate(std::uint64_t *externalWords, std::shared_ptr<void> storageOwner)
+{
+    auto block = std::make_shared<Block>();
+    block->versions.reset(new std::atomic<std::uint64_t>[rooms.size()]);
+    block->changeRings.reset(new std::atomic<ChangeRing *>[rooms.size()]);
+    block->showtimeCount = rooms.size();
+    std::uint64_t *words = externalWords;
+    if (words)
+    {
+        block->storageOwner = std::move(storageOwner);
+    }
+    else
+    {
+        std::size_t bytes = wordCount * sizeof(std::uint64_t);
+        block->storage = ::operator new(bytes + SeatMap::CACHE_LINE_SIZE);
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block->storage);
+        address += (SeatMap::CACHE_LINE_SIZE - address % SeatMap::CACHE_LINE_SIZE) % SeatMap::CACHE_LINE_SIZE;
+        words = reinterpret_cast<std::uint64_t *>(address);
+        std::memset(words, 0, bytes);
+    }
+
+    seatWords.resize(rooms.size());
+    versions.resize(rooms.size());
+    changeRings.resize(rooms.size());
+    blockOf.assign(rooms.size(), 0);
+    for (std::size_t i = 0; i < rooms.size(); ++i)
+    {
+        block->versions[i].store(0, std::memory_order_relaxed);
+        versions[i] = &block->versions[i];
+        block->changeRings[i].store(nullptr, std::memory_order_relaxed);
+        changeRings[i] = &block->changeRings[i];
+        seatWords[i] = words + wordOffsets[i];
+    }
+    blocks.assign(1, std::move(block));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ShowtimeStore::shareSeats(ShowtimeId showtime, const ShowtimeStore &other, ShowtimeId otherShowtime)
+{
+    if (getCapacity(showtime) != other.getCapacity(otherShowtime))
+    {
+        return false;
+    }
+    // Keep the other store's block alive for as long as we book into it
+    const std::shared_ptr<Block> &block = other.blocks[other.blockOf[otherShowtime]];
+    auto it = std::find(blocks.begin(), blocks.end(), block);
+    if (it == blocks.end())
+    {
+        it = blocks.insert(blocks.end(), block);
+    }
+    blockOf[showtime] = static_cast<std::uint32_t>(it - blocks.begin());
+    seatWords[showtime] = other.seatWords[otherShowtime];
+    versions[showtime] = other.versions[otherShowtime];
+    changeRings[showtime] = other.changeRings[otherShowtime];
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t ShowtimeStore::size() const
+{
+    return rooms.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t ShowtimeStore::getWordCount() const
+{
+    return wordCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint32_t ShowtimeStore::getRoom(ShowtimeId showtime) const
+{
+    return rooms[showtime];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint32_t ShowtimeStore::getMovie(ShowtimeId showtime) const
+{
+    return movies[showtime];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::int64_t ShowtimeStore::getStart(ShowtimeId showtime) const
+{
+    return starts[showtime];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int ShowtimeStore::getCapacity(ShowtimeId showtime) const
+{
+    return static_cast<int>(capacities[showtime]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int ShowtimeStore::getSeatsPerRow(ShowtimeId showtime) const
+{
+    return static_cast<int>(rowLengths[showtime]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ShowtimeStore::getVersion(ShowtimeId showtime) const
+{
+    return seatsOf(showtime).getVersion();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ShowtimeStore::copyWords(std::uint64_t *out) const
+{
+    for (ShowtimeId showtime = 0; showtime < size(); ++showtime)
+    {
+        seatsOf(showtime).snapshot(out + wordOffsets[showtime]);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ShowtimeStore::snapshot(ShowtimeId showtime, std::uint64_t *out) const
+{
+    return seatsOf(showtime).snapshot(out);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ShowtimeStore::isAvailable(ShowtimeId showtime, int seatNumber) const
+{
+    return seatsOf(showtime).isAvailable(seatNumber);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<int> ShowtimeStore::getBookedSeats(ShowtimeId showtime) const
+{
+    return seatsOf(showtime).getBookedSeats();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ShowtimeStore::sharesSeatsWith(ShowtimeId showtime, const ShowtimeStore &other, ShowtimeId otherShowtime) const
+{
+    return seatWords[showtime] == other.seatWords[otherShowtime];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ShowtimeStore::seal(ShowtimeId showtime)
+{
+    seatsOf(showtime).seal();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ShowtimeStore::isSealed(ShowtimeId showtime) const
+{
+    return seatsOf(showtime).isSealed();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ShowtimeStore::reserve(ShowtimeId showtime, const std::vector<int> &seatNumbers)
+{
+    if (!seatsOf(showtime).reserve(seatNumbers))
+    {
+        return false;
+    }
+    publishChange(showtime, seatNumbers, true);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<int> ShowtimeStore::reserveAvailable(ShowtimeId showtime, int count, bool contiguous)
+{
+    std::vector<int> seats = seatsOf(showtime).reserveAvailable(count, contiguous, getSeatsPerRow(showtime));
+    if (!seats.empty())
+    {
+        publishChange(showtime, seats, true);
+    }
+    return seats;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<bool> ShowtimeStore::reserveBatch(ShowtimeId showtime, const std::vector<const std::vector<int> *> &requests)
+{
+    std::vector<bool> booked = seatsOf(showtime).reserveBatch(requests);
+    for (std::size_t i = 0; i < booked.size(); ++i)
+    {
+        if (booked[i])
+        {
+            publishChange(showtime, *requests[i], true);
+        }
+    }
+    return booked;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ShowtimeStore::release(ShowtimeId showtime, const std::vector<int> &seatNumbers)
+{
+    if (!seatsOf(showtime).release(seatNumbers))
+    {
+        return false;
+    }
+    publishChange(showtime, seatNumbers, false);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SeatMap ShowtimeStore::seatsOf(ShowtimeId showtime) const
+{
+    // Building the view costs no allocation. It shares the showtime's version word, so snapshots
+    // see changes made through other views; its contention counter is dropped
+    return SeatMap(getCapacity(showtime), seatWords[showtime], versions[showtime], false);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ChangeRing *ShowtimeStore::getChangeRing(ShowtimeId showtime) const
+{
+    return changeRings[showtime]->load();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ChangeRing &ShowtimeStore::followChanges(ShowtimeId showtime)
+{
+    ChangeRing *ring = changeRings[showtime]->load();
+    if (!ring)
+    {
+        ChangeRing *created = new ChangeRing();
+        if (changeRings[showtime]->compare_exchange_strong(ring, created))
+        {
+            ring = created;
+        }
+        else
+        {
+            delete created;
+        }
+    }
+    return *ring;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ShowtimeStore::publishChange(ShowtimeId showtime, const std::vector<int> &seatNumbers, bool booked) const
+{
+    // Loaded after the seat update like Room::publishChange does
+    ChangeRing *ring = changeRings[showtime]->load();
+    if (ring)
+    {
+        ring->publish(seatNumbers, booked);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /// @brief Days from 1970-01-01 to a proleptic Gregorian date
+    std::int64_t daysFromCivil(std::int64_t year, unsigned month, unsigned day)
+    {
+        year -= month <= 2;
+        const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+        const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+        const unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + static_cast<std::int64_t>(dayOfEra) - 719468;
+    }
+
+    /// @brief Inverse of daysFromCivil
+    void civilFromDays(std::int64_t days, std::int64_t &year, unsigned &month, unsigned &day)
+    {
+        days += 719468;
+        const std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+        const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        const unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+        day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        year = static_cast<std::int64_t>(yearOfEra) + era * 400 + (month <= 2);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ShowtimeStore::parseStart(const std::string &text, std::int64_t &start)
+{
+    int year = 0;
+    unsigned month = 0, day = 0, hour = 0, minute = 0;
+    char separator = 0;
+    int consumed = 0;
+    if (std::sscanf(text.c_str(), "%4d-%2u-%2u%c%2u:%2u%n", &year, &month, &day, &separator, &hour, &minute, &consumed) != 6 ||
+        static_cast<std::size_t>(consumed) != text.size() || (separator != 'T' && separator != ' ') ||
+        month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59)
+    {
+        return false;
+    }
+    // Reject days past the end of the month, e.g. February 30th
+    std::int64_t days = daysFromCivil(year, month, day);
+    std::int64_t checkYear;
+    unsigned checkMonth, checkDay;
+    civilFromDays(days, checkYear, checkMonth, checkDay);
+    if (checkMonth != month || checkDay != day)
+    {
+        return false;
+    }
+    start = days * 24 * 60 + hour * 60 + minute;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string ShowtimeStore::formatStart(std::int64_t start)
+{
+    std::int64_t days = start >= 0 ? start / (24 * 60) : (start - (24 * 60 - 1)) / (24 * 60);
+    int minuteOfDay = static_cast<int>(start - days * 24 * 60);
+    std::int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+    char text[32];
+    std::snprintf(text, sizeof(text), "%04lld-%02u-%02uT%02d:%02d", static_cast<long long>(year), month, day,
+                  minuteOfDay / 60, minuteOfDay % 60);
+    return text;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "change_ring.h"
+#include "seat_map.h"
+
+/// @brief Index of a showtime in its ShowtimeStore
+using ShowtimeId = std::uint32_t;
+
+/// @brief No showtime: the call is about the room's own seats, as before showtimes existed
+const ShowtimeId NO_SHOWTIME = 0xffffffff;
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Compact storage for many showtimes.
+/// Showtimes are kept struct-of-arrays style: one array per field indexed by ShowtimeId,
+/// and the seat bitmaps of all showtimes back to back in one cache-line aligned block, each
+/// taking whole words only, so neighbouring showtimes may share a cache line.
+/// A showtime costs a few dozen bytes next to its bitmap and holds no strings; rooms and
+/// movies are referred to by ordinal and id, their names live with the catalog.
+/// Seat operations have the semantics of SeatMap, which runs them over the showtime's words.
+/// Showtimes are added first, then allocate() lays out the seats, after which the store is fixed.
+/// A showtime may then share its seats with a showtime of another store, see shareSeats.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class ShowtimeStore
+{
+public:
+    ShowtimeStore() {}
+
+    ShowtimeStore(const ShowtimeStore &) = delete;
+    ShowtimeStore &operator=(const ShowtimeStore &) = delete;
+
+    /// @brief Adds a showtime, seats are laid out by allocate()
+    /// @param roomOrdinal room the showtime plays in
+    /// @param movieId interned id of the movie shown
+    /// @param start start time in minutes since the Unix epoch, UTC
+    /// @param capacity number of seats, the room's
+    /// @param seatsPerRow row length used to pick adjacent seats, the room's
+    ShowtimeId add(std::uint32_t roomOrdinal, std::uint32_t movieId, std::int64_t start, int capacity, int seatsPerRow);
+
+    /// @brief Lays out the seat bitmaps of every showtime added so far, all free.
+    /// @param externalWords storage of getWordCount() words to use instead of allocating, e.g. a
+    /// mapped catalog snapshot. Must be cache-line aligned
+    /// @param storageOwner keeps 'externalWords' alive for as long as any store uses them, may be null
+    void allocate(std::uint64_t *externalWords = nullptr, std::shared_ptr<void> storageOwner = nullptr);
+
+    /// @brief Makes a showtime book into the seats of showtime 'otherShowtime' of 'other' from now on,
+    /// e.g. the same showtime in an older catalog. Both stores then see each other's bookings of it.
+    /// @return false, changing nothing, if the showtimes differ in capacity
+    bool shareSeats(ShowtimeId showtime, const ShowtimeStore &other, ShowtimeId otherShowtime);
+
+    /// @return number of showtimes
+    std::size_t size() const;
+
+    /// @return number of 64-bit seat words of all showtimes, known once every showtime is added
+    std::size_t getWordCount() const;
+
+    std::uint32_t getRoom(ShowtimeId showtime) const;
+    std::uint32_t getMovie(ShowtimeId showtime) const;
+    std::int64_t getStart(ShowtimeId showtime) const;
+    int getCapacity(ShowtimeId showtime) const;
+    int getSeatsPerRow(ShowtimeId showtime) const;
+
+    /// @brief Occupancy version of a showtime, incremented after every change to its seats
+    std::uint64_t getVersion(ShowtimeId showtime) const;
+
+    /// @brief Copies the seat words of every showtime into 'out', which must hold getWordCount() words.
+    /// Showtimes follow each other as laid out by allocate(), shared ones included
+    void copyWords(std::uint64_t *out) const;
+
+    /// @brief Copies the seat words of one showtime into 'out', which must hold SeatMap::seatWordCountFor(getCapacity(showtime)) words.
+    /// The copy is consistent, see SeatMap::snapshot
+    /// @return the occupancy version the copy has
+    std::uint64_t snapshot(ShowtimeId showtime, std::uint64_t *out) const;
+
+    /// @brief Checks a seat is inside the showtime and not booked
+    bool isAvailable(ShowtimeId showtime, int seatNumber) const;
+
+    /// @return the booked seat numbers of a showtime, ascending
+    std::vector<int> getBookedSeats(ShowtimeId showtime) const;
+
+    /// @brief Whether 'showtime' books into the same seat words as 'otherShowtime' of 'other', see shareSeats
+    bool sharesSeatsWith(ShowtimeId showtime, const ShowtimeStore &other, ShowtimeId otherShowtime) const;
+
+    /// @brief Refuses every seat change of the showtime from now on, see SeatMap::seal
+    void seal(ShowtimeId showtime);
+
+    /// @return whether seal was called for the showtime
+    bool isSealed(ShowtimeId showtime) const;
+
+    /// @brief Books all seats or none of them, see SeatMap::reserve
+    bool reserve(ShowtimeId showtime, const std::vector<int> &seatNumbers);
+
+    /// @brief Finds and books 'count' free seats, see SeatMap::reserveAvailable
+    std::vector<int> reserveAvailable(ShowtimeId showtime, int count, bool contiguous);
+
+    /// @brief Books several seat requests in one pass, see SeatMap::reserveBatch
+    std::vector<bool> reserveBatch(ShowtimeId showtime, const std::vector<const std::vector<int> *> &requests);
+
+    /// @brief Frees booked seats, e.g. those of an ended hold, see SeatMap::release
+    bool release(ShowtimeId showtime, const std::vector<int> &seatNumbers);
+
+    /// @return the ring every seat change of a showtime is published to, or nullptr while nobody follows it
+    ChangeRing *getChangeRing(ShowtimeId showtime) const;
+
+    /// @brief Starts publishing the seat changes of a showtime, if not done yet, see Room::followChanges
+    ChangeRing &followChanges(ShowtimeId showtime);
+
+    /// @brief Parses a "YYYY-MM-DDTHH:MM" UTC start time, a space may stand for the 'T'
+    /// @return false if 'text' is not such a time
+    static bool parseStart(const std::string &text, std::int64_t &start);
+
+    /// @brief Formats a start time as "YYYY-MM-DDTHH:MM"
+    static std::string formatStart(std::int64_t start);
+
+private:
+    /// @brief A SeatMap working on the words of one showtime, valid while the store is
+    SeatMap seatsOf(ShowtimeId showtime) const;
+
+    /// @brief Publishes booked or freed seats to the showtime's change ring, if it has one
+    void publishChange(ShowtimeId showtime, const std::vector<int> &seatNumbers, bool booked) const;
+
+    /// @brief Seat words and versions laid out by one allocate() call
+    struct Block
+    {
+        ~Block();
+
+        void *storage = nullptr;            // Owned allocation, over-sized for alignment. Null for external words
+        std::shared_ptr<void> storageOwner; // Owner of external words, if any
+        std::unique_ptr<std::atomic<std::uint64_t>[]> versions;
+        std::unique_ptr<std::atomic<ChangeRing *>[]> changeRings; // Created by the first follower of each showtime
+        std::size_t showtimeCount = 0;
+    };
+
+    // One entry per showtime in each array
+    std::vector<std::uint32_t> rooms;
+    std::vector<std::uint32_t> movies;
+    std::vector<std::int64_t> starts;
+    std::vector<std::uint32_t> capacities;
+    std::vector<std::uint32_t> rowLengths;
+    std::vector<std::uint64_t> wordOffsets;               // First seat word of each showtime in the block of allocate()
+    std::vector<std::uint64_t *> seatWords;               // Seat words of each showtime, in our block or a shared one
+    std::vector<std::atomic<std::uint64_t> *> versions;   // Occupancy version of each showtime, next to its words
+    std::vector<std::atomic<ChangeRing *> *> changeRings; // Change ring slot of each showtime, in the same block as its words
+    std::vector<std::uint32_t> blockOf;                   // Position in 'blocks' of the block holding each showtime's seats
+
+    std::size_t wordCount = 0;
+    std::vector<std::shared_ptr<Block>> blocks; // Our own block first, then blocks shared with other stores
+};
@@ -0,0 +1,100 @@
+#include "timer_wheel.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+TimerWheel::TimerWheel(std::uint64_t startTick) : currentTick(startTick), count(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::schedule(std::uint64_t id, std::uint64_t deadlineTick)
+{
+    // The slot of the current tick has already fired
+    place(Timer{id, deadlineTick > currentTick ? deadlineTick : currentTick + 1});
+    ++count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t TimerWheel::advance(std::uint64_t nowTick, const std::function<void(std::uint64_t id)> &expire)
+{
+    std::size_t expired = 0;
+    while (currentTick < nowTick)
+    {
+        if (count == 0)
+        {
+            currentTick = nowTick; // Nothing to move, skip the idle ticks
+            break;
+        }
+        ++currentTick;
+
+        // Higher levels turn when every level below them wraps around, largest first
+        int top = 0;
+        while (top + 1 < LEVELS && (currentTick & ((std::uint64_t(1) << (SLOT_BITS * (top + 1))) - 1)) == 0)
+        {
+            ++top;
+        }
+        for (int level = top; level > 0; --level)
+        {
+            cascade(level);
+        }
+
+        std::vector<Timer> due;
+        due.swap(slots[0][currentTick & (SLOTS - 1)]);
+        for (const Timer &timer : due)
+        {
+            --count;
+            ++expired;
+            expire(timer.id);
+        }
+    }
+    return expired;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t TimerWheel::getCurrentTick() const
+{
+    return currentTick;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t TimerWheel::size() const
+{
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::place(const Timer &timer)
+{
+    // Lowest level that turns into the deadline's slot within one rotation
+    for (int level = 0; level < LEVELS; ++level)
+    {
+        int shift = SLOT_BITS * level;
+        if ((timer.deadline >> shift) - (currentTick >> shift) < static_cast<std::uint64_t>(SLOTS))
+        {
+            slots[level][(timer.deadline >> shift) & (SLOTS - 1)].push_back(timer);
+            return;
+        }
+    }
+    // Beyond the span: park in the top slot turned last, it is placed again from there
+    const int topShift = SLOT_BITS * (LEVELS - 1);
+    slots[LEVELS - 1][((currentTick >> topShift) - 1) & (SLOTS - 1)].push_back(timer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::cascade(int level)
+{
+    std::vector<Timer> moving;
+    moving.swap(slots[level][(currentTick >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+    for (const Timer &timer : moving)
+    {
+        place(timer);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// @brief Hierarchical timer wheel keyed by tick numbers.
+/// Four levels of 64 slots cover 2^24 ticks. A timer sits in the lowest level whose span
+/// reaches its deadline and moves one level down each time the wheel turns into its slot,
+/// so scheduling and expiring cost O(1) per timer however many are pending.
+/// Timers are identified by the caller's ids and cannot be cancelled: owners drop the
+/// ids they no longer care about when they expire. Not thread safe.
+///////////////////////////////////////////////////////////////////////////////////////
+
+class TimerWheel
+{
+public:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+
+    /// @param startTick tick the wheel starts at
+    explicit TimerWheel(std::uint64_t startTick = 0);
+
+    /// @brief Adds a timer firing once the wheel reaches 'deadlineTick'.
+    /// Deadlines already passed fire on the next tick, deadlines past the wheel's span
+    /// are parked in the top level and placed again as it turns.
+    void schedule(std::uint64_t id, std::uint64_t deadlineTick);
+
+    /// @brief Turns the wheel up to 'nowTick', calling 'expire' with the id of every timer due
+    /// @return number of expired timers
+    std::size_t advance(std::uint64_t nowTick, const std::function<void(std::uint64_t id)> &expire);
+
+    /// @return the last tick the wheel turned to
+    std::uint64_t getCurrentTick() const;
+
+    /// @return number of pending timers
+    std::size_t size() const;
+
+private:
+    struct Timer
+    {
+        std::uint64_t id;
+        std::uint64_t deadline;
+    };
+
+    /// @brief Puts a timer in the slot matching its deadline relative to the current tick
+    void place(const Timer &timer);
+
+    /// @brief Empties a slot of a higher level into the levels below it
+    void cascade(int level);
+
+    std::vector<Timer> slots[LEVELS][SLOTS];
+    std::uint64_t currentTick;
+    std::size_t count;
+};
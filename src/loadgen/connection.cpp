@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+#include "connection.h"
+
+using asio::ip::tcp;
+
+///////////////////////////////////////////////////////////////////////////////
+
+LoadConnection::LoadConnection(asio::io_context &io_context, const tcp::endpoint &endpoint, const LoadSchedule &schedule,
+                               Workload &workload, std::mt19937_64 &random, LoadStats &stats)
+    : socket_(io_context), timer_(io_context), endpoint_(endpoint), schedule_(schedule), workload_(workload), random_(random),
+      stats_(stats), intended_(schedule.firstSend), readBuffer_(16384)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadConnection::start()
+{
+    auto self(shared_from_this());
+    socket_.async_connect(endpoint_, [this, self](asio::error_code ec)
+                          {
+                              if (ec)
+                              {
+                                  ++stats_.socketErrors;
+                                  return;
+                              }
+                              socket_.set_option(tcp::no_delay(true), ec);
+                              schedule_next();
+                          });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadConnection::schedule_next()
+{
+    LoadClock::time_point now = LoadClock::now();
+    if (!schedule_.openLoop)
+    {
+        intended_ = now; // Closed loop: the next request goes out right away
+    }
+    if (intended_ >= schedule_.end)
+    {
+        close();
+        return;
+    }
+    if (intended_ <= now)
+    {
+        send();
+        return;
+    }
+    auto self(shared_from_this());
+    timer_.expires_at(intended_);
+    timer_.async_wait([this, self](asio::error_code ec)
+                      {
+                          if (!ec)
+                          {
+                              send();
+                          }
+                      });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadConnection::send()
+{
+    request_.clear();
+    endpointInFlight_ = workload_.next(random_, request_);
+    sent_ = LoadClock::now();
+
+    auto self(shared_from_this());
+    asio::async_write(socket_, asio::buffer(request_), [this, self](asio::error_code ec, std::size_t /*length*/)
+                      {
+                          if (ec)
+                          {
+                              ++stats_.socketErrors;
+                              close();
+                              return;
+                          }
+                          read_response();
+                      });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadConnection::read_response()
+{
+    int status = 0;
+    std::size_t size = parse_response(status);
+    if (size > 0)
+    {
+        LoadClock::time_point done = LoadClock::now();
+        std::size_t index = static_cast<std::size_t>(endpointInFlight_);
+        ++stats_.requests[index];
+        if (status < 200 || status >= 300)
+        {
+            ++stats_.failures[index];
+        }
+        record(endpointInFlight_, done - (schedule_.openLoop ? intended_ : sent_));
+
+        std::memmove(readBuffer_.data(), readBuffer_.data() + size, readEnd_ - size);
+        readEnd_ -= size;
+        intended_ += schedule_.interval;
+        schedule_next();
+        return;
+    }
+
+    if (readEnd_ == readBuffer_.size())
+    {
+        readBuffer_.resize(readBuffer_.size() * 2);
+    }
+    auto self(shared_from_this());
+    socket_.async_read_some(asio::buffer(readBuffer_.data() + readEnd_, readBuffer_.size() - readEnd_),
+                            [this, self](asio::error_code ec, std::size_t length)
+                            {
+                                if (ec)
+                                {
+                                    ++stats_.socketErrors;
+                                    close();
+                                    return;
+                                }
+                                readEnd_ += length;
+                                read_response();
+                            });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadConnection::record(Workload::Endpoint endpoint, LoadClock::duration latency)
+{
+    LatencyHistogram &histogram = stats_.latency[static_cast<std::size_t>(endpoint)];
+    std::int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    histogram.record(static_cast<std::uint64_t>(std::max<std::int64_t>(nanos, 0)));
+
+    // Closed loop: add the requests a steady client would have sent while this one stalled
+    std::int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(schedule_.correction).count();
+    if (!schedule_.openLoop && interval > 0)
+    {
+        for (std::int64_t missing = nanos - interval; missing >= interval; missing -= interval)
+        {
+            histogram.record(static_cast<std::uint64_t>(missing));
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t LoadConnection::parse_response(int &status) const
+{
+    const char *data = readBuffer_.data();
+    const char *end = data + readEnd_;
+    const char *headerEnd = std::search(data, end, "\r\n\r\n", "\r\n\r\n" + 4);
+    if (headerEnd == end)
+    {
+        return 0;
+    }
+    // "HTTP/1.1 200 OK"
+    status = readEnd_ > 12 ? std::atoi(data + 9) : 0;
+
+    std::size_t contentLength = 0;
+    static const char HEADER[] = "\r\ncontent-length:";
+    for (const char *line = data; line < headerEnd; ++line)
+    {
+        if (static_cast<std::size_t>(headerEnd - line) > sizeof(HEADER) - 1 && strncasecmp(line, HEADER, sizeof(HEADER) - 1) == 0)
+        {
+            contentLength = static_cast<std::size_t>(std::strtoull(line + sizeof(HEADER) - 1, nullptr, 10));
+            break;
+        }
+    }
+    std::size_t size = static_cast<std::size_t>(headerEnd - data) + 4 + contentLength;
+    return size <= readEnd_ ? size : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadConnection::close()
+{
+    asio::error_code ignored;
+    timer_.cancel();
+    socket_.shutdown(tcp::socket::shutdown_both, ignored);
+    socket_.close(ignored);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <asio.hpp>
+
+#include "metrics.h"
+#include "workload.h"
+
+using LoadClock = std::chrono::steady_clock;
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Results of one load generator thread, merged at the end
+struct LoadStats
+{
+    static constexpr std::size_t ENDPOINTS = static_cast<std::size_t>(Workload::Endpoint::Count);
+
+    std::array<LatencyHistogram, ENDPOINTS> latency;
+    std::array<std::uint64_t, ENDPOINTS> requests{};
+    std::array<std::uint64_t, ENDPOINTS> failures{}; // Responses other than 2xx
+    std::uint64_t socketErrors = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief How a connection paces its requests
+struct LoadSchedule
+{
+    bool openLoop = true;
+    LoadClock::duration interval{0};   // Time between intended sends, open loop
+    LoadClock::duration correction{0}; // Expected interval for closed loop correction, 0 for none
+    LoadClock::time_point firstSend;
+    LoadClock::time_point end;          // No request is sent at or after it
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief One keep-alive connection of the load generator.
+/// It has one request in flight at a time. In open loop every request has an intended
+/// send time on a fixed schedule. If the previous response is late the request goes out
+/// late, but its latency still counts from the intended time, so a stalled server shows
+/// up in the tail instead of silently slowing the generator down (coordinated omission).
+class LoadConnection : public std::enable_shared_from_this<LoadConnection>
+{
+public:
+    LoadConnection(asio::io_context &io_context, const asio::ip::tcp::endpoint &endpoint, const LoadSchedule &schedule,
+                   Workload &workload, std::mt19937_64 &random, LoadStats &stats);
+
+    void start();
+
+private:
+    /// @brief Sends the next request at its intended time, or closes once the run is over
+    void schedule_next();
+
+    void send();
+    void read_response();
+
+    /// @brief Records one latency, with the closed loop correction if enabled
+    void record(Workload::Endpoint endpoint, LoadClock::duration latency);
+
+    /// @brief Finds a complete response at the front of the read buffer
+    /// @return its size, or 0 if more bytes are needed
+    std::size_t parse_response(int &status) const;
+
+    void close();
+
+    asio::ip::tcp::socket socket_;
+    asio::steady_timer timer_;
+    asio::ip::tcp::endpoint endpoint_;
+    LoadSchedule schedule_;
+    Workload &workload_;
+    std::mt19937_64 &random_;
+    LoadStats &stats_;
+
+    LoadClock::time_point intended_; // When the request in flight should have been sent
+    LoadClock::time_point sent_;
+    Workload::Endpoint endpointInFlight_ = Workload::Endpoint::Movies;
+    std::string request_;
+    std::vector<char> readBuffer_;
+    std::size_t readEnd_ = 0;
+};
@@ -0,0 +1,239 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <asio.hpp>
+
+#include "connection.h"
+#include "metrics.h"
+#include "workload.h"
+
+using asio::ip::tcp;
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Load generator options, see printUsage
+struct LoadOptions
+{
+    std::string catalog;
+    std::string host = "127.0.0.1";
+    std::string port = "8080";
+    bool openLoop = true;
+    double rate = 1000.0; // Requests per second over all connections
+    int connections = 16;
+    int threads = 1;
+    double duration = 10.0;
+    double zipfExponent = 1.0;
+    Workload::Mix mix = {1, 1, 2, 4, 2};
+    std::uint64_t seed = 1;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief One thread of the load generator with its own event loop, connections and results
+struct LoadWorker
+{
+    LoadWorker(const LoadOptions &options, std::uint64_t seed)
+        : workload(options.catalog, options.zipfExponent, options.mix), random(seed)
+    {
+    }
+
+    asio::io_context io_context{1};
+    Workload workload;
+    std::mt19937_64 random;
+    LoadStats stats;
+    std::thread thread;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Prints the command line options
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " <catalog> [--host <host>] [--port <port>] [--mode open|closed] [--rate <requests/s>]"
+              << " [--connections <n>] [--threads <n>] [--duration <seconds>] [--zipf <exponent>]"
+              << " [--mix movies=1,find=1,bookings=2,seats=4,auto=2] [--seed <n>]" << std::endl
+              << "  open loop sends at --rate and measures latency from each request's intended send time," << std::endl
+              << "  closed loop sends when the previous response arrived and corrects for --rate if given." << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Parses the command line into 'options'
+/// @return false on unknown or malformed options
+bool parseOptions(int argc, char *argv[], LoadOptions &options, bool &rateGiven)
+{
+    if (argc < 2)
+    {
+        return false;
+    }
+    options.catalog = argv[1];
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (option == "--host")
+        {
+            options.host = value;
+        }
+        else if (option == "--port")
+        {
+            options.port = value;
+        }
+        else if (option == "--mode" && (value == "open" || value == "closed"))
+        {
+            options.openLoop = value == "open";
+        }
+        else if (option == "--rate" && std::atof(value.c_str()) > 0)
+        {
+            options.rate = std::atof(value.c_str());
+            rateGiven = true;
+        }
+        else if (option == "--connections" && std::atoi(value.c_str()) > 0)
+        {
+            options.connections = std::atoi(value.c_str());
+        }
+        else if (option == "--threads" && std::atoi(value.c_str()) > 0)
+        {
+            options.threads = std::atoi(value.c_str());
+        }
+        else if (option == "--duration" && std::atof(value.c_str()) > 0)
+        {
+            options.duration = std::atof(value.c_str());
+        }
+        else if (option == "--zipf" && std::atof(value.c_str()) >= 0)
+        {
+            options.zipfExponent = std::atof(value.c_str());
+        }
+        else if (option == "--mix" && Workload::parseMix(value, options.mix))
+        {
+        }
+        else if (option == "--seed")
+        {
+            options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Prints one report line out of merged bucket counts
+void printRow(const char *name, std::uint64_t requests, std::uint64_t failures, const std::vector<std::uint64_t> &counts)
+{
+    const double NANOS_PER_MICRO = 1000.0;
+    std::printf("%-12s %10llu %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", name, static_cast<unsigned long long>(requests),
+                static_cast<unsigned long long>(failures),
+                LatencyHistogram::valueAtQuantile(counts, 0.5) / NANOS_PER_MICRO,
+                LatencyHistogram::valueAtQuantile(counts, 0.9) / NANOS_PER_MICRO,
+                LatencyHistogram::valueAtQuantile(counts, 0.99) / NANOS_PER_MICRO,
+                LatencyHistogram::valueAtQuantile(counts, 0.999) / NANOS_PER_MICRO,
+                LatencyHistogram::valueAtQuantile(counts, 1.0) / NANOS_PER_MICRO);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Drives the reservation server with a configurable request mix and reports latencies.
+/// @param argc
+/// @param argv catalog the server runs with, then the options in printUsage
+/// @return
+int main(int argc, char *argv[])
+{
+    LoadOptions options;
+    bool rateGiven = false;
+    if (!parseOptions(argc, argv, options, rateGiven))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        std::vector<std::unique_ptr<LoadWorker>> workers;
+        for (int t = 0; t < options.threads; ++t)
+        {
+            workers.emplace_back(new LoadWorker(options, options.seed + t));
+        }
+        tcp::resolver resolver(workers.front()->io_context);
+        tcp::endpoint endpoint = *resolver.resolve(options.host, options.port).begin();
+
+        // Every connection sends at rate / connections, staggered so arrivals are evenly spaced
+        auto interval = std::chrono::duration_cast<LoadClock::duration>(std::chrono::duration<double>(options.connections / options.rate));
+        LoadClock::time_point start = LoadClock::now() + std::chrono::milliseconds(100);
+        for (int c = 0; c < options.connections; ++c)
+        {
+            LoadWorker &worker = *workers[c % workers.size()];
+            LoadSchedule schedule;
+            schedule.openLoop = options.openLoop;
+            schedule.interval = interval;
+            schedule.correction = !options.openLoop && rateGiven ? interval : LoadClock::duration(0);
+            schedule.firstSend = start + interval * c / options.connections;
+            schedule.end = start + std::chrono::duration_cast<LoadClock::duration>(std::chrono::duration<double>(options.duration));
+            std::make_shared<LoadConnection>(worker.io_context, endpoint, schedule, worker.workload, worker.random, worker.stats)->start();
+        }
+
+        for (auto &worker : workers)
+        {
+            LoadWorker *running = worker.get();
+            worker->thread = std::thread([running]
+                                         { running->io_context.run(); });
+        }
+        for (auto &worker : workers)
+        {
+            worker->thread.join();
+        }
+        double elapsed = std::chrono::duration<double>(LoadClock::now() - start).count();
+
+        // Merge the per thread results
+        std::vector<std::uint64_t> all(LatencyHistogram::BUCKET_COUNT, 0);
+        std::uint64_t totalRequests = 0;
+        std::uint64_t totalFailures = 0;
+        std::uint64_t socketErrors = 0;
+        std::printf("mode %s, %d connections, %d threads, %.1f s%s\n", options.openLoop ? "open" : "closed", options.connections,
+                    options.threads, options.duration, options.openLoop || rateGiven ? ", corrected for coordinated omission" : "");
+        std::printf("%-12s %10s %10s %10s %10s %10s %10s %10s\n", "endpoint", "requests", "non-2xx", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+        for (std::size_t e = 0; e < LoadStats::ENDPOINTS; ++e)
+        {
+            std::vector<std::uint64_t> counts(LatencyHistogram::BUCKET_COUNT, 0);
+            std::uint64_t requests = 0;
+            std::uint64_t failures = 0;
+            for (auto &worker : workers)
+            {
+                worker->stats.latency[e].addTo(counts);
+                worker->stats.latency[e].addTo(all);
+                requests += worker->stats.requests[e];
+                failures += worker->stats.failures[e];
+            }
+            if (requests > 0)
+            {
+                printRow(Workload::endpointName(static_cast<Workload::Endpoint>(e)), requests, failures, counts);
+            }
+            totalRequests += requests;
+            totalFailures += failures;
+        }
+        for (auto &worker : workers)
+        {
+            socketErrors += worker->stats.socketErrors;
+        }
+        printRow("all", totalRequests, totalFailures, all);
+        std::printf("throughput %.1f requests/s", totalRequests / elapsed);
+        if (options.openLoop)
+        {
+            std::printf(" (target %.1f)", options.rate);
+        }
+        std::printf(", socket errors %llu\n", static_cast<unsigned long long>(socketErrors));
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
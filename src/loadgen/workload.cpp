@@ -0,0 +1,184 @@
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "reservation_system.h"
+#include "workload.h"
+
+namespace
+{
+    const char *ENDPOINT_NAMES[] = {"movies", "find", "bookings", "seats", "auto"};
+    const char *ENDPOINT_PATHS[] = {"/movies", "/find", "/bookings", "/seats", "/seats/auto"};
+
+    /// @brief Appends 'text' as a JSON string
+    void appendJsonString(std::string &out, const std::string &text)
+    {
+        out += '"';
+        for (char character : text)
+        {
+            if (character == '"' || character == '\\')
+            {
+                out += '\\';
+            }
+            out += character;
+        }
+        out += '"';
+    }
+
+    void appendRequest(std::string &out, const char *method, const char *path, const std::string &body)
+    {
+        out += method;
+        out += ' ';
+        out += path;
+        out += " HTTP/1.1\r\nHost: loadgen\r\n";
+        if (!body.empty())
+        {
+            out += "Content-Type: application/json\r\nContent-Length: ";
+            out += std::to_string(body.size());
+            out += "\r\n";
+        }
+        out += "\r\n";
+        out += body;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Workload::Workload(const std::string &catalogPath, double zipfExponent, const Mix &mix)
+{
+    ReservationSystem catalog(catalogPath);
+    std::set<std::pair<std::string, std::string>> seen;
+    std::set<std::string> seenMovies;
+    catalog.forEachRoom([&](const std::string &theaterName, const Room &room)
+                        {
+                            if (!room.getPlayingMovie())
+                            {
+                                return;
+                            }
+                            const std::string &title = room.getPlayingMovie()->getTitle();
+                            // Bookings of a theater movie go to its first room
+                            if (seen.emplace(theaterName, title).second)
+                            {
+                                targets.push_back(Target{theaterName, title, room.getCapacity()});
+                            }
+                            if (seenMovies.insert(title).second)
+                            {
+                                movies.push_back(title);
+                            }
+                        });
+    if (targets.empty())
+    {
+        throw std::runtime_error("catalog " + catalogPath + " has no playing movies");
+    }
+
+    targetChoice = zipf(targets.size(), zipfExponent);
+    movieChoice = zipf(movies.size(), zipfExponent);
+    endpointChoice = std::discrete_distribution<std::size_t>(mix.begin(), mix.end());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::discrete_distribution<std::size_t> Workload::zipf(std::size_t count, double exponent)
+{
+    std::vector<double> weights(count);
+    for (std::size_t rank = 0; rank < count; ++rank)
+    {
+        weights[rank] = 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+    }
+    return std::discrete_distribution<std::size_t>(weights.begin(), weights.end());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Workload::Endpoint Workload::next(std::mt19937_64 &random, std::string &out)
+{
+    Endpoint endpoint = static_cast<Endpoint>(endpointChoice(random));
+    const char *path = ENDPOINT_PATHS[static_cast<std::size_t>(endpoint)];
+    const Target &target = targets[targetChoice(random)];
+
+    std::string body;
+    switch (endpoint)
+    {
+    case Endpoint::Movies:
+        appendRequest(out, "GET", path, body);
+        return endpoint;
+    case Endpoint::Find:
+        body = "{\"movie\":";
+        appendJsonString(body, movies[movieChoice(random)]);
+        body += "}";
+        break;
+    case Endpoint::Bookings:
+    case Endpoint::Seats:
+    case Endpoint::SeatsAuto:
+        body = "{\"theater\":";
+        appendJsonString(body, target.theater);
+        body += ",\"movie\":";
+        appendJsonString(body, target.movie);
+        if (endpoint == Endpoint::Seats)
+        {
+            body += ",\"seats\":[";
+            body += std::to_string(std::uniform_int_distribution<int>(0, target.capacity - 1)(random));
+            body += "]";
+        }
+        else if (endpoint == Endpoint::SeatsAuto)
+        {
+            body += ",\"count\":2";
+        }
+        body += "}";
+        break;
+    default:
+        break;
+    }
+    appendRequest(out, "POST", path, body);
+    return endpoint;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const char *Workload::endpointName(Endpoint endpoint)
+{
+    return ENDPOINT_PATHS[static_cast<std::size_t>(endpoint)];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Workload::parseMix(const std::string &text, Mix &mix)
+{
+    mix.fill(0.0);
+    std::stringstream stream(text);
+    std::string item;
+    double total = 0.0;
+    while (std::getline(stream, item, ','))
+    {
+        std::size_t equals = item.find('=');
+        if (equals == std::string::npos)
+        {
+            return false;
+        }
+        std::string name = item.substr(0, equals);
+        double weight = std::atof(item.c_str() + equals + 1);
+        std::size_t index = 0;
+        while (index < mix.size() && name != ENDPOINT_NAMES[index])
+        {
+            ++index;
+        }
+        if (index == mix.size() || weight < 0.0)
+        {
+            return false;
+        }
+        mix[index] = weight;
+        total += weight;
+    }
+    return total > 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t Workload::getTargetCount() const
+{
+    return targets.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
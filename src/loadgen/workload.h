@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+/// @brief Request mix of the load generator.
+/// Theaters and movies come from the server catalog. Which theater movie a request
+/// targets follows a Zipf distribution over the catalog order, so the first entries
+/// play the blockbusters that draw most of the traffic.
+class Workload
+{
+public:
+    enum class Endpoint
+    {
+        Movies,
+        Find,
+        Bookings,
+        Seats,
+        SeatsAuto,
+        Count
+    };
+
+    using Mix = std::array<double, static_cast<std::size_t>(Endpoint::Count)>;
+
+    /// @brief Loads the catalog the server runs with
+    /// @param catalogPath json catalog or catalog snapshot
+    /// @param zipfExponent skew of the theater movie choice, 0 for uniform
+    /// @param mix relative weight of every endpoint
+    Workload(const std::string &catalogPath, double zipfExponent, const Mix &mix);
+
+    /// @brief Appends the next HTTP request to 'out'
+    /// @return the endpoint it goes to
+    Endpoint next(std::mt19937_64 &random, std::string &out);
+
+    static const char *endpointName(Endpoint endpoint);
+
+    /// @brief Parses a mix like "movies=1,find=1,bookings=2,seats=4,auto=2".
+    /// Endpoints that are not named get weight 0.
+    /// @return false on unknown names or bad weights
+    static bool parseMix(const std::string &text, Mix &mix);
+
+    /// @brief Number of distinct theater movies requests can target
+    std::size_t getTargetCount() const;
+
+private:
+    /// @brief A theater movie and the seats of the room bookings go to
+    struct Target
+    {
+        std::string theater;
+        std::string movie;
+        int capacity;
+    };
+
+    /// @brief Builds Zipf weights for 'count' ranks
+    static std::discrete_distribution<std::size_t> zipf(std::size_t count, double exponent);
+
+    std::vector<Target> targets;
+    std::vector<std::string> movies; // Distinct titles, in order of first appearance
+    std::discrete_distribution<std::size_t> targetChoice;
+    std::discrete_distribution<std::size_t> movieChoice;
+    std::discrete_distribution<std::size_t> endpointChoice;
+};
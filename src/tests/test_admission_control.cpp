@@ -0,0 +1,46 @@
+#include "gtest/gtest.h"
+#include "admission_control.h"
+
+namespace {
+    AdmissionControl::Limits smallLimits() {
+        AdmissionControl::Limits limits;
+        limits.maxConnections = 2;
+        limits.maxInFlight = 2;
+        limits.maxLoopLag = std::chrono::milliseconds(100);
+        return limits;
+    }
+}
+
+TEST(AdmissionControlTest, capsConnections) {
+    AdmissionControl admission(smallLimits());
+    EXPECT_TRUE(admission.openConnection());
+    EXPECT_TRUE(admission.openConnection());
+    EXPECT_FALSE(admission.openConnection());
+    EXPECT_EQ(admission.getConnectionCount(), 2u); // The refused one is not counted
+
+    admission.closeConnection();
+    EXPECT_TRUE(admission.openConnection());
+}
+
+TEST(AdmissionControlTest, shedsWhileRequestsPileUp) {
+    AdmissionControl admission(smallLimits());
+    EXPECT_TRUE(admission.admitRequest(0));
+    admission.startRequest();
+    admission.startRequest();
+    EXPECT_EQ(admission.getInFlightCount(), 2u);
+    EXPECT_FALSE(admission.admitRequest(0));
+
+    admission.finishRequest();
+    EXPECT_TRUE(admission.admitRequest(0));
+}
+
+TEST(AdmissionControlTest, shedsOnLateLoopOnly) {
+    AdmissionControl admission(smallLimits(), 2);
+    admission.recordLoopLag(1, std::chrono::milliseconds(150));
+    EXPECT_TRUE(admission.admitRequest(0));
+    EXPECT_FALSE(admission.admitRequest(1));
+
+    // The next probe that runs on time lets requests in again
+    admission.recordLoopLag(1, std::chrono::milliseconds(1));
+    EXPECT_TRUE(admission.admitRequest(1));
+}
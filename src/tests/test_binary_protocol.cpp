@@ -0,0 +1,89 @@
+#include "gtest/gtest.h"
+#include "binary_protocol.h"
+
+#include <string>
+#include <vector>
+
+TEST(BinaryProtocolTest, requestRoundTrip) {
+    std::string payload;
+    BinaryProtocol::writeU64(payload, 2);
+    BinaryProtocol::writeU32(payload, 3);
+    BinaryProtocol::writeU32(payload, 0xffffffff);
+    std::string frames;
+    BinaryProtocol::writeRequest(frames, 42, BinaryProtocol::Operation::Occupancy, payload);
+    BinaryProtocol::writeRequest(frames, 43, BinaryProtocol::Operation::Catalog, "");
+    EXPECT_EQ(frames.substr(0, 4), std::string("\x15\x00\x00\x00", 4)); // Little-endian length
+
+    BinaryProtocol::Request request;
+    ASSERT_EQ(BinaryProtocol::parseRequest(frames.data(), frames.size(), request), BinaryProtocol::Result::Complete);
+    EXPECT_EQ(request.requestId, 42u);
+    EXPECT_EQ(request.operation, BinaryProtocol::Operation::Occupancy);
+    EXPECT_EQ(request.size, 25u);
+    EXPECT_EQ(request.payload.data(), frames.data() + 9); // Points into the buffer
+
+    BinaryProtocol::Reader reader(request.payload);
+    std::uint64_t catalogVersion = 0;
+    std::uint32_t room = 0, showtime = 0;
+    EXPECT_TRUE(reader.readU64(catalogVersion));
+    EXPECT_TRUE(reader.readU32(room));
+    EXPECT_TRUE(reader.readU32(showtime));
+    EXPECT_TRUE(reader.atEnd());
+    EXPECT_FALSE(reader.readU32(room));
+    EXPECT_EQ(catalogVersion, 2u);
+    EXPECT_EQ(room, 3u);
+    EXPECT_EQ(showtime, 0xffffffffu);
+
+    ASSERT_EQ(BinaryProtocol::parseRequest(frames.data() + request.size, frames.size() - request.size, request),
+              BinaryProtocol::Result::Complete);
+    EXPECT_EQ(request.requestId, 43u);
+    EXPECT_TRUE(request.payload.empty());
+}
+
+TEST(BinaryProtocolTest, partialAndInvalidFrames) {
+    std::string frames;
+    BinaryProtocol::writeRequest(frames, 1, BinaryProtocol::Operation::Book, "abcdefgh");
+    BinaryProtocol::Request request;
+    for (std::size_t size = 0; size < frames.size(); ++size) {
+        EXPECT_EQ(BinaryProtocol::parseRequest(frames.data(), size, request), BinaryProtocol::Result::Incomplete);
+    }
+
+    std::string tooShort("\x04\x00\x00\x00\x01\x00\x00\x00", 8); // Length below the header size
+    EXPECT_EQ(BinaryProtocol::parseRequest(tooShort.data(), tooShort.size(), request), BinaryProtocol::Result::Invalid);
+    std::string tooLong("\xff\xff\xff\x7f", 4);
+    EXPECT_EQ(BinaryProtocol::parseRequest(tooLong.data(), tooLong.size(), request), BinaryProtocol::Result::Invalid);
+}
+
+TEST(BinaryProtocolTest, responseFrame) {
+    std::string out = "previous";
+    std::size_t frame = BinaryProtocol::beginResponse(out, 7, BinaryProtocol::Status::Conflict);
+    BinaryProtocol::writeString(out, "Room 1");
+    BinaryProtocol::finishResponse(out, frame);
+
+    EXPECT_EQ(frame, 8u);
+    ASSERT_EQ(out.size(), 8u + 4 + 5 + 2 + 6);
+    EXPECT_EQ(out.substr(8, 4), std::string("\x0d\x00\x00\x00", 4));
+    EXPECT_EQ(out.substr(12, 4), std::string("\x07\x00\x00\x00", 4));
+    EXPECT_EQ(out[16], static_cast<char>(BinaryProtocol::Status::Conflict));
+    EXPECT_EQ(out.substr(17), std::string("\x06\x00Room 1", 8));
+}
+
+TEST(BinaryProtocolTest, bitmapRoundTrip) {
+    std::vector<std::uint64_t> words = {0x8000000000000001ull, ~0ull};
+    std::string out;
+    BinaryProtocol::writeBitmap(out, words.data(), 70);
+    ASSERT_EQ(out.size(), 16u);
+    EXPECT_EQ(out.substr(8), std::string("\x3f\x00\x00\x00\x00\x00\x00\x00", 8)); // Padding bits cleared
+
+    std::vector<int> seats;
+    BinaryProtocol::Reader reader(out);
+    ASSERT_TRUE(reader.readBitmap(70, seats));
+    EXPECT_TRUE(reader.atEnd());
+    EXPECT_EQ(seats, std::vector<int>({0, 63, 64, 65, 66, 67, 68, 69}));
+
+    // Set padding bits of a request are ignored, a short bitmap is rejected
+    BinaryProtocol::Reader padded(std::string_view(out.data(), 8));
+    ASSERT_TRUE(padded.readBitmap(1, seats));
+    EXPECT_EQ(seats, std::vector<int>({0}));
+    BinaryProtocol::Reader shortBitmap(std::string_view(out.data(), 8));
+    EXPECT_FALSE(shortBitmap.readBitmap(65, seats));
+}
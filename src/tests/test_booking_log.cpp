@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "booking_log.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+
+/// @brief Gives every test its own empty log directory
+class BookingLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        directory = ::testing::TempDir() + "booking_log_" +
+                    ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        path = directory + "/wal";
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::vector<BookingLog::Record> recoverAll() {
+        std::vector<BookingLog::Record> records;
+        BookingLog::recover(path, [&records](const BookingLog::Record &record) { records.push_back(record); });
+        return records;
+    }
+
+    std::string directory;
+    std::string path;
+};
+
+TEST_F(BookingLogTest, appendAndRecover) {
+    {
+        BookingLog log(path, [](const BookingLog::RecordVisitor &) {});
+        log.append("Theater A", "Room 1", {1, 2});
+        log.append("Theater B", "Room 2", {7});
+        std::promise<void> durable;
+        log.whenDurable([&durable] { durable.set_value(); });
+        durable.get_future().wait();
+    }
+    auto records = recoverAll();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].theater, "Theater A");
+    EXPECT_EQ(records[0].room, "Room 1");
+    EXPECT_EQ(records[0].seats, std::vector<int>({1, 2}));
+    EXPECT_EQ(records[1].seats, std::vector<int>({7}));
+}
+
+TEST_F(BookingLogTest, showtimeStart) {
+    {
+        BookingLog log(path, [](const BookingLog::RecordVisitor &) {});
+        log.append("Theater A", "Room 1", {1});
+        log.append("Theater A", "Room 1", {2}, -60);
+    }
+    auto records = recoverAll();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].showtimeStart, BookingLog::Record::NO_START);
+    EXPECT_EQ(records[1].showtimeStart, -60);
+    EXPECT_EQ(records[1].seats, std::vector<int>({2}));
+}
+
+TEST_F(BookingLogTest, tornTailIsIgnored) {
+    {
+        BookingLog log(path, [](const BookingLog::RecordVisitor &) {});
+        log.append("Theater A", "Room 1", {1});
+        log.append("Theater A", "Room 1", {2});
+    }
+    auto segment = std::filesystem::directory_iterator(directory)->path();
+    std::filesystem::resize_file(segment, std::filesystem::file_size(segment) - 3);
+    auto records = recoverAll();
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].seats, std::vector<int>({1}));
+
+    // A restart writes to a new segment after the damaged one
+    {
+        BookingLog log(path, [](const BookingLog::RecordVisitor &) {});
+        log.append("Theater A", "Room 1", {3});
+    }
+    EXPECT_EQ(recoverAll().size(), 2u);
+}
+
+TEST_F(BookingLogTest, checkpointReplacesSegments) {
+    std::vector<int> state;
+    {
+        BookingLog log(path, [&state](const BookingLog::RecordVisitor &emit) {
+            emit(BookingLog::Record{"Theater A", "Room 1", state});
+        }, 64);
+        for (int seat = 0; seat < 20; ++seat) {
+            state.push_back(seat);
+            log.append("Theater A", "Room 1", {seat});
+            std::promise<void> durable;
+            log.whenDurable([&durable] { durable.set_value(); });
+            durable.get_future().wait();
+        }
+    }
+    auto records = recoverAll();
+    std::vector<int> recovered;
+    for (const auto &record : records) {
+        recovered.insert(recovered.end(), record.seats.begin(), record.seats.end());
+    }
+    std::sort(recovered.begin(), recovered.end());
+    recovered.erase(std::unique(recovered.begin(), recovered.end()), recovered.end());
+    EXPECT_EQ(recovered, state);
+    EXPECT_LT(records.size(), 20u); // Older segments were folded into the checkpoint
+    EXPECT_TRUE(std::filesystem::exists(path + ".checkpoint"));
+}
@@ -0,0 +1,63 @@
+#include "gtest/gtest.h"
+#include "change_ring.h"
+
+#include <vector>
+
+TEST(ChangeRingTest, readSinceMergesChanges) {
+    ChangeRing ring;
+    std::uint64_t start = ring.getVersion();
+    ring.publish({3, 4}, true);
+    ring.publish({4, 9}, false);
+    ring.publish({9}, true);
+
+    std::vector<int> booked, freed;
+    std::uint64_t version = 0;
+    ASSERT_TRUE(ring.readSince(start, booked, freed, version));
+    EXPECT_EQ(version, start + 3);
+    EXPECT_EQ(booked, std::vector<int>({3, 9})); // A seat's last change wins
+    EXPECT_EQ(freed, std::vector<int>({4}));
+
+    ASSERT_TRUE(ring.readSince(start + 1, booked, freed, version));
+    EXPECT_EQ(booked, std::vector<int>({9}));
+    EXPECT_EQ(freed, std::vector<int>({4}));
+
+    ASSERT_TRUE(ring.readSince(version, booked, freed, version));
+    EXPECT_TRUE(booked.empty());
+    EXPECT_TRUE(freed.empty());
+}
+
+TEST(ChangeRingTest, unknownOrOverwrittenVersions) {
+    ChangeRing ring;
+    std::uint64_t start = ring.getVersion();
+    std::vector<int> booked, freed;
+    std::uint64_t version = 0;
+    EXPECT_FALSE(ring.readSince(0, booked, freed, version));
+    EXPECT_FALSE(ring.readSince(start + 1, booked, freed, version)); // Not handed out yet
+    EXPECT_EQ(version, start);
+
+    for (std::size_t i = 0; i <= ChangeRing::CAPACITY; ++i) {
+        ring.publish({static_cast<int>(i)}, true);
+    }
+    EXPECT_FALSE(ring.readSince(start, booked, freed, version)); // First change was overwritten
+    ASSERT_TRUE(ring.readSince(start + 1, booked, freed, version));
+    EXPECT_EQ(booked.size(), ChangeRing::CAPACITY);
+    EXPECT_EQ(booked.front(), 1);
+}
+
+TEST(ChangeRingTest, waitersWakeOnce) {
+    ChangeRing ring;
+    std::uint64_t start = ring.getVersion();
+    int woken = 0;
+    int cancelled = 0;
+    EXPECT_NE(ring.waitAfter(start, [&woken] { ++woken; }), 0u);
+    std::uint64_t ticket = ring.waitAfter(start, [&cancelled] { ++cancelled; });
+    ring.cancelWait(ticket);
+    EXPECT_EQ(ring.getWaiterCount(), 1u);
+
+    ring.publish({1}, true);
+    ring.publish({2}, true);
+    EXPECT_EQ(woken, 1);
+    EXPECT_EQ(cancelled, 0);
+    EXPECT_EQ(ring.getWaiterCount(), 0u);
+    EXPECT_EQ(ring.waitAfter(start, [&woken] { ++woken; }), 0u); // Already behind, not parked
+}
@@ -39,4 +39,39 @@ TEST(TheaterTest, addRoom) {
     EXPECT_EQ(rooms.size(), 2);
     EXPECT_EQ(rooms[0].getRoomName(), "Gold");
     EXPECT_EQ(rooms[1].getRoomName(), "Silver");
-}
\ No newline at end of file
+}
+TEST(RoomTest, reserveSeats) {
+    Room room("Gold");
+    EXPECT_TRUE(room.reserveSeats({1, 2}));
+    EXPECT_FALSE(room.reserveSeats({3, 2})); // Seat 2 taken, seat 3 left untouched
+    EXPECT_TRUE(room.isSeatAvailable(3));
+}
+
+TEST(RoomTest, capacityAndLayout) {
+    Room room("Arena", 2000, 50);
+    EXPECT_EQ(room.getCapacity(), 2000);
+    EXPECT_EQ(room.getSeatsPerRow(), 50);
+    EXPECT_EQ(room.getRowCount(), 40);
+    EXPECT_TRUE(room.reserveSeat(1999));
+    EXPECT_FALSE(room.reserveSeat(2000));
+    EXPECT_EQ(room.countAvailableSeats(), 1999);
+
+    Room defaultRoom("Gold");
+    EXPECT_EQ(defaultRoom.getCapacity(), NUMBER_OF_AVAILABLE_SEATS);
+    EXPECT_EQ(defaultRoom.getRowCount(), 1);
+}
+
+TEST(RoomTest, holdSeats) {
+    Room room("Room", 10);
+    EXPECT_TRUE(room.reserveSeat(0));
+    EXPECT_FALSE(room.holdSeats({0, 1})); // Seat 0 is booked
+    EXPECT_TRUE(room.holdSeats({1, 2}));
+    EXPECT_FALSE(room.isSeatAvailable(1));
+    EXPECT_FALSE(room.reserveSeat(2)); // Held seats are taken for everybody else
+    EXPECT_EQ(room.getConfirmedSeats(), std::vector<int>({0}));
+
+    room.confirmHeldSeats({1});
+    room.releaseHeldSeats({2});
+    EXPECT_EQ(room.getConfirmedSeats(), std::vector<int>({0, 1}));
+    EXPECT_TRUE(room.isSeatAvailable(2));
+}
@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include "http_parser.h"
+
+#include <string>
+
+TEST(HttpRequestParserTest, parseGet) {
+    std::string data = "GET /movies HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    HttpRequestParser parser;
+    HttpRequest request;
+    ASSERT_EQ(parser.parse(data.data(), data.size(), request), HttpRequestParser::Result::Complete);
+    EXPECT_EQ(request.method, "GET");
+    EXPECT_EQ(request.target, "/movies");
+    EXPECT_TRUE(request.body.empty());
+    EXPECT_TRUE(request.keepAlive);
+    EXPECT_EQ(request.size, data.size());
+}
+
+TEST(HttpRequestParserTest, parseIncrementally) {
+    std::string data = "POST /find HTTP/1.1\r\ncontent-LENGTH: 17\r\n\r\n{\"movie\": \"Dune\"}";
+    HttpRequestParser parser;
+    HttpRequest request;
+    for (std::size_t size = 0; size < data.size(); ++size) {
+        ASSERT_EQ(parser.parse(data.data(), size, request), HttpRequestParser::Result::Incomplete);
+    }
+    ASSERT_EQ(parser.parse(data.data(), data.size(), request), HttpRequestParser::Result::Complete);
+    EXPECT_EQ(request.method, "POST");
+    EXPECT_EQ(request.body, "{\"movie\": \"Dune\"}");
+}
+
+TEST(HttpRequestParserTest, parsePipelined) {
+    std::string data = "GET /movies HTTP/1.1\r\n\r\n"
+                       "POST /find HTTP/1.1\r\nContent-Length: 2\r\nConnection: close\r\n\r\n{}";
+    HttpRequestParser parser;
+    HttpRequest request;
+    ASSERT_EQ(parser.parse(data.data(), data.size(), request), HttpRequestParser::Result::Complete);
+    EXPECT_EQ(request.target, "/movies");
+    std::size_t offset = request.size;
+    ASSERT_EQ(parser.parse(data.data() + offset, data.size() - offset, request), HttpRequestParser::Result::Complete);
+    EXPECT_EQ(request.target, "/find");
+    EXPECT_EQ(request.body, "{}");
+    EXPECT_FALSE(request.keepAlive);
+    EXPECT_EQ(offset + request.size, data.size());
+}
+
+TEST(HttpRequestParserTest, keepAliveDefaults) {
+    std::string http10 = "GET / HTTP/1.0\r\n\r\n";
+    std::string http10KeepAlive = "GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n";
+    HttpRequestParser parser;
+    HttpRequest request;
+    ASSERT_EQ(parser.parse(http10.data(), http10.size(), request), HttpRequestParser::Result::Complete);
+    EXPECT_FALSE(request.keepAlive);
+    ASSERT_EQ(parser.parse(http10KeepAlive.data(), http10KeepAlive.size(), request), HttpRequestParser::Result::Complete);
+    EXPECT_TRUE(request.keepAlive);
+}
+
+TEST(HttpRequestParserTest, rejectMalformed) {
+    HttpRequest request;
+    for (std::string data : {"GET /movies\r\n\r\n",
+                             "GET /movies HTTP/2.0\r\n\r\n",
+                             "POST /find HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+                             "POST /find HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n",
+                             "GET / HTTP/1.1\r\nNoColon\r\n\r\n"}) {
+        HttpRequestParser parser;
+        EXPECT_EQ(parser.parse(data.data(), data.size(), request), HttpRequestParser::Result::Invalid) << data;
+    }
+}
+
+TEST(HttpRequestParserTest, headerTooLarge) {
+    HttpRequest request;
+    std::string huge(HttpRequestParser::MAX_HEADER_SIZE + 1, 'a');
+    HttpRequestParser parser;
+    EXPECT_EQ(parser.parse(huge.data(), huge.size(), request), HttpRequestParser::Result::HeaderTooLarge);
+
+    // A whole oversized header in a single read, blank line included
+    std::string header = "GET /movies HTTP/1.1\r\nX-Filler: " + std::string(60 * 1024, 'a') + "\r\n\r\n";
+    HttpRequestParser single;
+    EXPECT_EQ(single.parse(header.data(), header.size(), request), HttpRequestParser::Result::HeaderTooLarge);
+
+    std::string fits = "GET /movies HTTP/1.1\r\nX-Filler: " + std::string(1024, 'a') + "\r\n\r\n";
+    HttpRequestParser other;
+    EXPECT_EQ(other.parse(fits.data(), fits.size(), request), HttpRequestParser::Result::Complete);
+}
+
+TEST(HttpRequestParserTest, idempotencyKey) {
+    std::string data = "POST /seats HTTP/1.1\r\nIdempotency-Key:  retry-42 \r\nContent-Length: 2\r\n\r\n{}"
+                       "POST /seats HTTP/1.1\r\nContent-Length: 2\r\n\r\n{}";
+    HttpRequestParser parser;
+    HttpRequest request;
+    ASSERT_EQ(parser.parse(data.data(), data.size(), request), HttpRequestParser::Result::Complete);
+    EXPECT_EQ(request.idempotencyKey, "retry-42");
+    std::size_t offset = request.size;
+    ASSERT_EQ(parser.parse(data.data() + offset, data.size() - offset, request), HttpRequestParser::Result::Complete);
+    EXPECT_TRUE(request.idempotencyKey.empty()); // Not carried over from the previous request
+}
+
+TEST(HttpRequestParserTest, bodyTooLarge) {
+    HttpRequestParser parser(16);
+    HttpRequest request;
+    std::string header = "POST /seats HTTP/1.1\r\nContent-Length: 17\r\n\r\n";
+    // Refused from the header alone, before the body arrives
+    EXPECT_EQ(parser.parse(header.data(), header.size(), request), HttpRequestParser::Result::TooLarge);
+
+    std::string fits = "POST /seats HTTP/1.1\r\nContent-Length: 16\r\n\r\n0123456789abcdef";
+    HttpRequestParser other(16);
+    EXPECT_EQ(other.parse(fits.data(), fits.size() - 1, request), HttpRequestParser::Result::Incomplete);
+    EXPECT_TRUE(other.inBody());
+    ASSERT_EQ(other.parse(fits.data(), fits.size(), request), HttpRequestParser::Result::Complete);
+    EXPECT_FALSE(other.inBody());
+}
@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "idempotency_table.h"
+
+#include <string>
+
+namespace {
+    using Claim = IdempotencyTable::Claim;
+}
+
+TEST(IdempotencyTableTest, replaysStoredResponse) {
+    IdempotencyTable table;
+    std::uint64_t fingerprint = IdempotencyTable::fingerprintOf("/seats", "{\"seats\":[1]}");
+    std::shared_ptr<const std::string> response;
+    EXPECT_EQ(table.claim("key", fingerprint, response), Claim::New);
+    EXPECT_EQ(table.claim("key", fingerprint, response), Claim::InProgress);
+    EXPECT_EQ(response, nullptr);
+
+    table.complete("key", std::make_shared<const std::string>("booked"));
+    ASSERT_EQ(table.claim("key", fingerprint, response), Claim::Replay);
+    EXPECT_EQ(*response, "booked");
+
+    // The same key for another request is refused, other keys are independent
+    EXPECT_EQ(table.claim("key", IdempotencyTable::fingerprintOf("/seats", "{\"seats\":[2]}"), response), Claim::Mismatch);
+    EXPECT_EQ(table.claim("key", IdempotencyTable::fingerprintOf("/holds", "{\"seats\":[1]}"), response), Claim::Mismatch);
+    EXPECT_EQ(table.claim("other", fingerprint, response), Claim::New);
+    EXPECT_EQ(table.size(), 2u);
+}
+
+TEST(IdempotencyTableTest, abandonLetsRetryRunAgain) {
+    IdempotencyTable table;
+    std::shared_ptr<const std::string> response;
+    EXPECT_EQ(table.claim("key", 1, response), Claim::New);
+    table.abandon("key");
+    EXPECT_EQ(table.claim("key", 1, response), Claim::New);
+    table.complete("key", std::make_shared<const std::string>("done"));
+    table.abandon("key"); // Only pending keys are abandoned
+    EXPECT_EQ(table.claim("key", 1, response), Claim::Replay);
+}
+
+TEST(IdempotencyTableTest, expiresByAge) {
+    IdempotencyTable table(std::chrono::seconds(60));
+    auto start = IdempotencyTable::Clock::now();
+    std::shared_ptr<const std::string> response;
+    EXPECT_EQ(table.claim("old", 1, response, start), Claim::New);
+    table.complete("old", std::make_shared<const std::string>("r"), start);
+    EXPECT_EQ(table.claim("young", 1, response, start + std::chrono::seconds(30)), Claim::New);
+
+    EXPECT_EQ(table.claim("old", 1, response, start + std::chrono::seconds(59)), Claim::Replay);
+    EXPECT_EQ(table.claim("old", 1, response, start + std::chrono::seconds(61)), Claim::New); // Expired, claimed anew
+    EXPECT_EQ(table.claim("young", 1, response, start + std::chrono::seconds(61)), Claim::InProgress);
+}
+
+TEST(IdempotencyTableTest, boundedBytes) {
+    IdempotencyTable table(IdempotencyTable::DEFAULT_MAX_AGE, 64 * 1024);
+    std::shared_ptr<const std::string> response;
+    auto body = std::make_shared<const std::string>(1000, 'x');
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "key" + std::to_string(i);
+        ASSERT_EQ(table.claim(key, 1, response), Claim::New);
+        table.complete(key, body);
+    }
+    EXPECT_LT(table.size(), 80u);
+    EXPECT_GT(table.size(), 0u);
+    EXPECT_EQ(table.claim("key999", 1, response), Claim::Replay); // The newest survive
+}
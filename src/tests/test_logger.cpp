@@ -0,0 +1,127 @@
+#include "gtest/gtest.h"
+#include "logger.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string logPath() {
+    return ::testing::TempDir() + "logger_" + ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".log";
+}
+
+std::vector<std::string> readLines(const std::string &path) {
+    std::ifstream in(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+}
+
+TEST(LoggerTest, writesLevelsAndParts) {
+    std::string path = logPath();
+    std::remove(path.c_str());
+    {
+        Logger logger(path, LogLevel::Info);
+        EXPECT_FALSE(logger.isEnabled(LogLevel::Debug));
+        logger.log(LogLevel::Debug, "hidden");
+        logger.log(LogLevel::Info, "/seats ", 42, ' ', std::string("body"));
+        logger.log(LogLevel::Error, "failed");
+    }
+    auto lines = readLines(path);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[0].find("INFO [t1] /seats 42 body"), std::string::npos);
+    EXPECT_NE(lines[1].find("ERROR [t1] failed"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(LoggerTest, samplesInfoButNotWarnings) {
+    std::string path = logPath();
+    std::remove(path.c_str());
+    {
+        Logger logger(path, LogLevel::Debug, 4);
+        for (int i = 0; i < 8; ++i) {
+            logger.log(LogLevel::Info, "request ", i);
+        }
+        logger.log(LogLevel::Warning, "kept");
+        logger.flush();
+        auto lines = readLines(path);
+        ASSERT_EQ(lines.size(), 3u);
+        EXPECT_NE(lines[0].find("request 0"), std::string::npos);
+        EXPECT_NE(lines[1].find("request 4"), std::string::npos);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(LoggerTest, truncatesLongMessages) {
+    std::string path = logPath();
+    std::remove(path.c_str());
+    {
+        Logger logger(path);
+        logger.log(LogLevel::Info, std::string(Logger::MAX_MESSAGE_SIZE + 50, 'x'));
+    }
+    auto lines = readLines(path);
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find(std::string(Logger::MAX_MESSAGE_SIZE, 'x') + "..."), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(LoggerTest, countsDroppedMessages) {
+    const int THREADS = 4;
+    const int MESSAGES = 5 * Logger::RING_SIZE;
+    std::string path = logPath();
+    std::remove(path.c_str());
+    std::uint64_t dropped = 0;
+    {
+        Logger logger(path);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) {
+            threads.emplace_back([&logger] {
+                for (int i = 0; i < MESSAGES; ++i) {
+                    logger.log(LogLevel::Info, "message ", i);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        logger.flush();
+        dropped = logger.getDroppedCount();
+    }
+    // Every message is either written or counted as dropped
+    std::size_t written = 0;
+    for (const auto &line : readLines(path)) {
+        written += line.find("INFO") != std::string::npos;
+    }
+    EXPECT_EQ(written + dropped, static_cast<std::uint64_t>(THREADS) * MESSAGES);
+    std::remove(path.c_str());
+}
+
+TEST(LoggerTest, threadKeepsItsRingPerLogger) {
+    std::string path = logPath();
+    std::string otherPath = path + ".other";
+    std::remove(path.c_str());
+    std::remove(otherPath.c_str());
+    {
+        Logger logger(path, LogLevel::Info);
+        Logger other(otherPath, LogLevel::Info);
+        for (int i = 0; i < 3; ++i) {
+            logger.log(LogLevel::Info, "first ", i);
+            other.log(LogLevel::Info, "second ", i);
+        }
+    }
+    // Switching loggers reuses the thread's ring in each, a new one would get a new thread number
+    for (const std::string &file : {path, otherPath}) {
+        auto lines = readLines(file);
+        ASSERT_EQ(lines.size(), 3u);
+        for (const std::string &line : lines) {
+            EXPECT_NE(line.find("[t1]"), std::string::npos) << line;
+        }
+        std::remove(file.c_str());
+    }
+}
@@ -0,0 +1,78 @@
+#include "gtest/gtest.h"
+#include "metrics.h"
+
+#include <thread>
+#include <vector>
+
+TEST(LatencyHistogramTest, bucketsKeepRelativePrecision) {
+    for (std::uint64_t value : {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456ull, 987654321ull, 1ull << 40}) {
+        std::size_t bucket = LatencyHistogram::bucketFor(value);
+        ASSERT_LT(bucket, LatencyHistogram::BUCKET_COUNT);
+        std::uint64_t upper = LatencyHistogram::bucketUpperBound(bucket);
+        EXPECT_GE(upper, value);
+        EXPECT_LE(upper - value, value / LatencyHistogram::SUB_BUCKETS);
+        if (bucket > 0) {
+            EXPECT_LT(LatencyHistogram::bucketUpperBound(bucket - 1), value);
+        }
+    }
+    EXPECT_EQ(LatencyHistogram::bucketFor(~0ull), LatencyHistogram::BUCKET_COUNT - 1);
+}
+
+TEST(LatencyHistogramTest, quantiles) {
+    LatencyHistogram histogram;
+    for (std::uint64_t value = 1; value <= 1000; ++value) {
+        histogram.record(value * 1000);
+    }
+    std::vector<std::uint64_t> counts(LatencyHistogram::BUCKET_COUNT, 0);
+    histogram.addTo(counts);
+    EXPECT_NEAR(static_cast<double>(LatencyHistogram::valueAtQuantile(counts, 0.5)), 500000.0, 500000.0 / 16);
+    EXPECT_NEAR(static_cast<double>(LatencyHistogram::valueAtQuantile(counts, 0.99)), 990000.0, 990000.0 / 16);
+    EXPECT_GE(LatencyHistogram::valueAtQuantile(counts, 1.0), 1000000u);
+    EXPECT_EQ(LatencyHistogram::valueAtQuantile(std::vector<std::uint64_t>(LatencyHistogram::BUCKET_COUNT, 0), 0.5), 0u);
+}
+
+TEST(MetricsTest, mergesThreads) {
+    const int THREADS = 4;
+    const int REQUESTS = 1000;
+    Metrics metrics;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&metrics] {
+            metrics.sessionOpened();
+            for (int i = 0; i < REQUESTS; ++i) {
+                metrics.recordRequest(Metrics::Route::Seats, 1000, i % 10 == 0);
+                metrics.recordBooking(i % 2 == 0);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    metrics.sessionClosed(); // Closed on another thread than it was opened
+
+    Metrics::Totals totals = metrics.collect();
+    std::size_t seats = static_cast<std::size_t>(Metrics::Route::Seats);
+    EXPECT_EQ(totals.requests[seats], static_cast<std::uint64_t>(THREADS * REQUESTS));
+    EXPECT_EQ(totals.errors[seats], static_cast<std::uint64_t>(THREADS * REQUESTS / 10));
+    EXPECT_EQ(totals.requests[static_cast<std::size_t>(Metrics::Route::Movies)], 0u);
+    EXPECT_EQ(totals.bookingSuccesses, static_cast<std::uint64_t>(THREADS * REQUESTS / 2));
+    EXPECT_EQ(totals.bookingConflicts, static_cast<std::uint64_t>(THREADS * REQUESTS / 2));
+    EXPECT_EQ(totals.openSessions, THREADS - 1);
+}
+
+TEST(MetricsTest, rendersPrometheusText) {
+    Metrics metrics;
+    metrics.recordRequest(Metrics::routeFor("/movies"), 2000000, false);
+    metrics.recordRejection(Metrics::Rejection::Overload);
+    EXPECT_EQ(Metrics::routeFor("/seats/auto"), Metrics::Route::SeatsAuto);
+    EXPECT_EQ(Metrics::routeFor("/unknown"), Metrics::Route::Other);
+
+    std::string out;
+    metrics.render(out);
+    EXPECT_NE(out.find("reservation_requests_total{route=\"/movies\"} 1\n"), std::string::npos);
+    EXPECT_NE(out.find("reservation_request_duration_seconds_count{route=\"/movies\"} 1\n"), std::string::npos);
+    EXPECT_NE(out.find("reservation_sessions_open 0\n"), std::string::npos);
+    EXPECT_NE(out.find("reservation_rejections_total{reason=\"overload\"} 1\n"), std::string::npos);
+    EXPECT_NE(out.find("reservation_rejections_total{reason=\"timeout\"} 0\n"), std::string::npos);
+    EXPECT_EQ(Metrics::label("room", "a\"b\\c"), "room=\"a\\\"b\\\\c\"");
+}
@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+#include "mpsc_queue.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(MpscQueueTest, keepsOrder) {
+    MpscQueue<std::unique_ptr<int>> queue;
+    std::unique_ptr<int> value;
+    EXPECT_FALSE(queue.pop(value));
+    for (int i = 0; i < 3; ++i) {
+        queue.push(std::unique_ptr<int>(new int(i)));
+    }
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(queue.pop(value));
+        EXPECT_EQ(*value, i);
+    }
+    EXPECT_FALSE(queue.pop(value));
+    queue.push(std::unique_ptr<int>(new int(7))); // Left behind for the destructor
+}
+
+TEST(MpscQueueTest, concurrentProducers) {
+    const int PRODUCERS = 4;
+    const int ITEMS = 20000;
+    MpscQueue<int> queue;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < ITEMS; ++i) {
+                queue.push(p * ITEMS + i);
+            }
+        });
+    }
+
+    // Every item arrives once and each producer's items stay in order
+    std::vector<int> next(PRODUCERS, 0);
+    int received = 0;
+    int value;
+    while (received < PRODUCERS * ITEMS) {
+        if (queue.pop(value)) {
+            int producer = value / ITEMS;
+            ASSERT_EQ(value % ITEMS, next[producer]);
+            ++next[producer];
+            ++received;
+        }
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    EXPECT_FALSE(queue.pop(value));
+}
@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+#include "rcu_pointer.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(RcuPointerTest, readersKeepTheirObject) {
+    RcuPointer<int> pointer(std::make_shared<int>(1));
+    std::weak_ptr<int> first = pointer.current();
+    {
+        auto guard = pointer.read();
+        EXPECT_EQ(*guard, 1);
+        EXPECT_EQ(*pointer.publish(std::make_shared<int>(2)), 1);
+        EXPECT_EQ(*pointer.read(), 2); // New read sections see the new object
+        EXPECT_EQ(*guard, 1);
+        EXPECT_EQ(pointer.reclaim(), 1u);
+        EXPECT_FALSE(first.expired());
+    }
+    EXPECT_EQ(pointer.reclaim(), 0u);
+    EXPECT_TRUE(first.expired());
+}
+
+TEST(RcuPointerTest, nestingLimit) {
+    RcuPointer<int> pointer(std::make_shared<int>(1));
+    std::vector<RcuPointer<int>::ReadGuard> guards;
+    for (int i = 0; i < rcu::MAX_NESTING; ++i) {
+        guards.push_back(pointer.read());
+    }
+    EXPECT_THROW(pointer.read(), std::runtime_error);
+    guards.pop_back();
+    EXPECT_EQ(*pointer.read(), 1);
+}
+
+TEST(RcuPointerTest, concurrentPublish) {
+    // Each object holds its own generation, readers must never see a freed one
+    struct Generation {
+        explicit Generation(int value) : value(value) {}
+        ~Generation() { value = -1; }
+        int value;
+    };
+    RcuPointer<Generation> pointer(std::make_shared<Generation>(0));
+    std::atomic<bool> stop{false};
+    std::atomic<int> torn{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            int last = 0;
+            while (!stop.load()) {
+                auto guard = pointer.read();
+                int value = guard->value;
+                std::this_thread::yield();
+                if (value < last || guard->value != value) {
+                    ++torn;
+                }
+                last = value;
+            }
+        });
+    }
+    for (int generation = 1; generation <= 2000; ++generation) {
+        pointer.publish(std::make_shared<Generation>(generation));
+        pointer.reclaim();
+    }
+    stop = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(pointer.reclaim(), 0u);
+}
@@ -0,0 +1,135 @@
+#include "gtest/gtest.h"
+#include "replication_log.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+    BookingLog::Record makeRecord(const std::string &room, std::vector<int> seats) {
+        BookingLog::Record record;
+        record.theater = "Theater A";
+        record.room = room;
+        record.seats = std::move(seats);
+        return record;
+    }
+}
+
+TEST(ReplicationLogTest, framesRoundTrip) {
+    BookingLog::Record record = makeRecord("Room 1", {3, 70});
+    record.showtimeStart = 1792263600;
+    std::string stream;
+    ReplicationLog::writeRecord(stream, 7, 1234, record);
+    ReplicationLog::writeMarker(stream, ReplicationLog::MessageType::Synced, 7, 5678);
+
+    ReplicationLog::Message message;
+    ASSERT_EQ(ReplicationLog::parseMessage(stream.data(), stream.size(), message), ReplicationLog::Result::Complete);
+    EXPECT_EQ(message.type, ReplicationLog::MessageType::Record);
+    EXPECT_EQ(message.sequence, 7u);
+    EXPECT_EQ(message.primaryMicros, 1234);
+    BookingLog::Record decoded;
+    ASSERT_TRUE(ReplicationLog::readRecord(message, decoded));
+    EXPECT_EQ(decoded.theater, "Theater A");
+    EXPECT_EQ(decoded.room, "Room 1");
+    EXPECT_EQ(decoded.seats, std::vector<int>({3, 70}));
+    EXPECT_EQ(decoded.showtimeStart, 1792263600);
+
+    std::size_t offset = message.size;
+    ASSERT_EQ(ReplicationLog::parseMessage(stream.data() + offset, stream.size() - offset, message), ReplicationLog::Result::Complete);
+    EXPECT_EQ(message.type, ReplicationLog::MessageType::Synced);
+    EXPECT_EQ(message.primaryMicros, 5678);
+    EXPECT_FALSE(ReplicationLog::readRecord(message, decoded));
+    EXPECT_EQ(offset + message.size, stream.size());
+}
+
+TEST(ReplicationLogTest, partialAndInvalidFrames) {
+    std::string stream;
+    ReplicationLog::writeRecord(stream, 1, 0, makeRecord("Room 1", {1}));
+    ReplicationLog::Message message;
+    for (std::size_t size = 0; size < stream.size(); ++size) {
+        EXPECT_EQ(ReplicationLog::parseMessage(stream.data(), size, message), ReplicationLog::Result::Incomplete);
+    }
+
+    std::string unknownType = stream;
+    unknownType[ReplicationLog::LENGTH_SIZE] = 9;
+    EXPECT_EQ(ReplicationLog::parseMessage(unknownType.data(), unknownType.size(), message), ReplicationLog::Result::Invalid);
+
+    std::string tooShort(ReplicationLog::LENGTH_SIZE, '\0');
+    EXPECT_EQ(ReplicationLog::parseMessage(tooShort.data(), tooShort.size(), message), ReplicationLog::Result::Invalid);
+
+    std::string damaged = stream;
+    damaged.back() ^= 0x55; // Breaks the booking log checksum
+    ASSERT_EQ(ReplicationLog::parseMessage(damaged.data(), damaged.size(), message), ReplicationLog::Result::Complete);
+    BookingLog::Record record;
+    EXPECT_FALSE(ReplicationLog::readRecord(message, record));
+}
+
+TEST(ReplicationLogTest, readSinceInOrder) {
+    ReplicationLog log;
+    EXPECT_EQ(log.getSequence(), 0u);
+    log.append(makeRecord("Room 1", {1}));
+    log.append(makeRecord("Room 2", {2}));
+    log.append(makeRecord("Room 1", {3}));
+    EXPECT_EQ(log.getSequence(), 3u);
+
+    std::uint64_t since = 1;
+    std::string out;
+    ASSERT_TRUE(log.readSince(since, out, 1 << 20));
+    EXPECT_EQ(since, 3u);
+    std::vector<std::uint64_t> sequences;
+    ReplicationLog::Message message;
+    for (std::size_t offset = 0; offset < out.size(); offset += message.size) {
+        ASSERT_EQ(ReplicationLog::parseMessage(out.data() + offset, out.size() - offset, message), ReplicationLog::Result::Complete);
+        sequences.push_back(message.sequence);
+    }
+    EXPECT_EQ(sequences, std::vector<std::uint64_t>({2, 3}));
+
+    // At least one frame however small the limit
+    since = 0;
+    out.clear();
+    ASSERT_TRUE(log.readSince(since, out, 1));
+    EXPECT_EQ(since, 1u);
+
+    out.clear();
+    since = 3;
+    ASSERT_TRUE(log.readSince(since, out, 1 << 20));
+    EXPECT_TRUE(out.empty());
+    since = 4; // Not appended yet
+    EXPECT_FALSE(log.readSince(since, out, 1 << 20));
+}
+
+TEST(ReplicationLogTest, droppedFramesNeedAFullCopy) {
+    std::string frame;
+    ReplicationLog::writeRecord(frame, 1, 0, makeRecord("Room 1", {1}));
+    ReplicationLog log(frame.size() * 2); // Keeps the last two bookings
+    for (int i = 0; i < 5; ++i) {
+        log.append(makeRecord("Room 1", {i}));
+    }
+    std::string out;
+    std::uint64_t since = 2;
+    EXPECT_FALSE(log.readSince(since, out, 1 << 20));
+    since = 3;
+    ASSERT_TRUE(log.readSince(since, out, 1 << 20));
+    EXPECT_EQ(since, 5u);
+}
+
+TEST(ReplicationLogTest, waitAfterWakesOnAppend) {
+    ReplicationLog log;
+    log.append(makeRecord("Room 1", {1}));
+    int woken = 0;
+    EXPECT_EQ(log.waitAfter(0, [&woken] { ++woken; }), 0u); // Already there
+    std::uint64_t ticket = log.waitAfter(1, [&woken] { ++woken; });
+    ASSERT_NE(ticket, 0u);
+    std::uint64_t cancelled = log.waitAfter(1, [&woken] { woken += 100; });
+    log.cancelWait(cancelled);
+    log.append(makeRecord("Room 1", {2}));
+    log.append(makeRecord("Room 1", {3}));
+    EXPECT_EQ(woken, 1);
+}
+
+TEST(ReplicationLogTest, replicaLag) {
+    ReplicaStatus status;
+    EXPECT_LT(status.getLagSeconds(), 0);
+    status.primaryMicros = ReplicationLog::nowMicros() - 2000000;
+    EXPECT_GE(status.getLagSeconds(), 2.0);
+    EXPECT_LT(status.getLagSeconds(), 60.0);
+}
@@ -0,0 +1,729 @@
+#include "gtest/gtest.h"
+#include "reservation_system.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+/// @brief Writes a small catalog to a temporary file and loads it
+class ReservationSystemTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        filename = ::testing::TempDir() + "catalog_" +
+                   ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".json";
+        std::ofstream out(filename);
+        out << R"({
+            "theaters": [
+                { "name": "Theater A", "rooms": [
+                    { "name": "Room 1", "movie": { "title": "Movie X" }, "showtimes": [
+                        { "start": "2026-10-17T21:00" },
+                        { "start": "2026-10-17T18:30" } ] },
+                    { "name": "Room 2", "movie": { "title": "Movie Y" } } ] },
+                { "name": "Theater B", "rooms": [
+                    { "name": "Room 1", "movie": { "title": "Movie X" } },
+                    { "name": "Room 2", "movie": { "title": "Movie X" } } ] },
+                { "name": "Arena", "rooms": [
+                    { "name": "Main", "capacity": 2000, "movie": { "title": "Movie Z" } },
+                    { "name": "Small", "rows": 4, "columns": 10, "movie": { "title": "Movie Y" } } ] }
+            ]
+        })";
+        out.close();
+        system.reset(new ReservationSystem(filename));
+    }
+
+    void TearDown() override {
+        std::remove(filename.c_str());
+    }
+
+    std::string filename;
+    std::unique_ptr<ReservationSystem> system;
+};
+
+TEST_F(ReservationSystemTest, getAllPlayingMovies) {
+    Json::Value movies = system->getAllPlayingMoviesJson();
+    ASSERT_EQ(movies.size(), 6);
+    EXPECT_EQ(movies[0].asString(), "Movie X");
+    EXPECT_EQ(movies[1].asString(), "Movie Y");
+}
+
+TEST_F(ReservationSystemTest, getTheatersShowingMovie) {
+    Json::Value theaters = system->getTheatersShowingMovieJson("Movie X");
+    ASSERT_EQ(theaters.size(), 2); // Theater B listed once despite two rooms
+    EXPECT_EQ(theaters[0].asString(), "Theater A");
+    EXPECT_EQ(theaters[1].asString(), "Theater B");
+    EXPECT_EQ(system->getTheatersShowingMovieJson("Movie Y").size(), 2);
+    EXPECT_EQ(system->getTheatersShowingMovieJson("Unknown").size(), 0);
+}
+
+TEST_F(ReservationSystemTest, bookSeats) {
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie Y", {1, 2, 2}));
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie Y", {2, 3})); // Seat 2 already taken
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie Y", {3}));
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie Z", {1}));
+    EXPECT_FALSE(system->bookSeats("Theater C", "Movie X", {1}));
+
+    Json::Value bookings = system->getBookings("Theater A", "Movie Y");
+    ASSERT_EQ(bookings.size(), 1);
+    EXPECT_EQ(bookings[0][0].asInt(), 0);
+    EXPECT_EQ(bookings[0][1].asInt(), 1);
+    EXPECT_EQ(bookings[0][2].asInt(), 1);
+    EXPECT_EQ(bookings[0][3].asInt(), 1);
+    EXPECT_EQ(system->getBookings("Theater B", "Movie X").size(), 2);
+}
+
+TEST_F(ReservationSystemTest, roomCapacityFromCatalog) {
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Z", {1999}));
+    Json::Value bookings = system->getBookings("Arena", "Movie Z");
+    ASSERT_EQ(bookings[0].size(), 2000);
+    EXPECT_EQ(bookings[0][1999].asInt(), 1);
+    EXPECT_EQ(system->getBookings("Arena", "Movie Y")[0].size(), 40);
+    EXPECT_EQ(system->getBookings("Theater A", "Movie X")[0].size(), NUMBER_OF_AVAILABLE_SEATS);
+}
+
+TEST_F(ReservationSystemTest, writeBookingsJson) {
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Z", {0, 2, 63, 64, 1999}));
+    std::string text;
+    system->writeBookingsJson(text, "Arena", "Movie Z");
+    Json::Value parsed;
+    std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+    ASSERT_TRUE(reader->parse(text.data(), text.data() + text.size(), &parsed, nullptr)) << text;
+    EXPECT_EQ(parsed, system->getBookings("Arena", "Movie Z"));
+    EXPECT_EQ(text.compare(0, 9, "[[1,0,1,0"), 0);
+
+    text = "x";
+    system->writeBookingsJson(text, "Theater B", "Movie Y");
+    EXPECT_EQ(text, "x[]");
+    text.clear();
+    system->writeBookingsJson(text, "Theater A", "Movie X", 1);
+    ASSERT_TRUE(reader->parse(text.data(), text.data() + text.size(), &parsed, nullptr));
+    EXPECT_EQ(parsed, system->getBookings("Theater A", "Movie X", 1));
+}
+
+TEST_F(ReservationSystemTest, bookBestAvailable) {
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Y", {2}));
+    EXPECT_EQ(system->bookBestAvailable("Arena", "Movie Y", 3, true), std::vector<int>({3, 4, 5}));
+    EXPECT_EQ(system->bookBestAvailable("Arena", "Movie Y", 2, false), std::vector<int>({0, 1}));
+    EXPECT_TRUE(system->bookBestAvailable("Arena", "Movie Y", 11, true).empty());
+    EXPECT_TRUE(system->bookBestAvailable("Nowhere", "Movie Y", 1, true).empty());
+}
+
+TEST_F(ReservationSystemTest, bookSeatsBatch) {
+    std::vector<BookingRequest> requests = {
+        {"Theater A", "Movie X", {1, 2}},
+        {"Theater A", "Movie Y", {1, 2}},
+        {"Theater A", "Movie X", {2}},
+        {"Theater C", "Movie X", {3}},
+        {"Theater A", "Movie X", {3}},
+    };
+    std::vector<bool> booked = system->bookSeatsBatch(requests);
+    EXPECT_EQ(booked, std::vector<bool>({true, true, false, false, true}));
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie X", {3}));
+}
+
+TEST_F(ReservationSystemTest, bookingsVersion) {
+    std::uint64_t catalog = system->getCatalogVersion();
+    std::uint64_t before = system->getBookingsVersion("Theater B", "Movie X");
+    EXPECT_TRUE(system->bookSeats("Theater B", "Movie X", {1}));
+    std::uint64_t after = system->getBookingsVersion("Theater B", "Movie X");
+    EXPECT_NE(before, after);
+    EXPECT_FALSE(system->bookSeats("Theater B", "Movie X", {1})); // Failed bookings change nothing
+    EXPECT_EQ(system->getBookingsVersion("Theater B", "Movie X"), after);
+    EXPECT_EQ(system->getBookingsVersion("Theater A", "Movie Y"), system->getBookingsVersion("Arena", "Movie Z"));
+    EXPECT_EQ(system->getCatalogVersion(), catalog);
+}
+
+TEST_F(ReservationSystemTest, bookingLogSurvivesRestart) {
+    std::string walPath = filename + ".wal";
+    {
+        ReservationSystem first(filename);
+        EXPECT_EQ(first.enableBookingLog(walPath), 0u);
+        EXPECT_TRUE(first.bookSeats("Theater A", "Movie Y", {4, 5}));
+        EXPECT_EQ(first.bookBestAvailable("Arena", "Movie Y", 2, true), std::vector<int>({0, 1}));
+        std::vector<BookingRequest> batch = {{"Theater B", "Movie X", {9}}};
+        EXPECT_EQ(first.bookSeatsBatch(batch), std::vector<bool>({true}));
+    }
+    ReservationSystem second(filename);
+    EXPECT_EQ(second.enableBookingLog(walPath), 3u);
+    EXPECT_FALSE(second.bookSeats("Theater A", "Movie Y", {5}));
+    EXPECT_FALSE(second.bookSeats("Arena", "Movie Y", {1}));
+    EXPECT_FALSE(second.bookSeats("Theater B", "Movie X", {9}));
+    EXPECT_TRUE(second.bookSeats("Theater A", "Movie Y", {6}));
+    for (const auto &entry : std::filesystem::directory_iterator(::testing::TempDir())) {
+        if (entry.path().filename().string().rfind(std::filesystem::path(walPath).filename().string(), 0) == 0) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+}
+
+TEST_F(ReservationSystemTest, replicaFollowsPrimary) {
+    ShowtimeId late = system->getShowtimesJson("Theater A", "Movie X")[1]["id"].asUInt();
+    ReservationSystem primary(filename);
+    primary.enableReplicationLog();
+    EXPECT_TRUE(primary.bookSeats("Theater A", "Movie Y", {4, 5}));
+    std::uint64_t copied = primary.getReplicationLog()->getSequence();
+    std::uint64_t hold = primary.holdSeats("Theater A", "Movie Y", {6}, std::chrono::seconds(10));
+    ASSERT_NE(hold, 0u);
+
+    // Full copy: held seats are left out
+    ReservationSystem replica(filename);
+    replica.enableReplica();
+    ASSERT_NE(replica.getReplicaStatus(), nullptr);
+    EXPECT_EQ(primary.getReplicaStatus(), nullptr);
+    EXPECT_EQ(replica.getReplicationLog(), nullptr);
+    primary.visitBookings([&replica](const BookingLog::Record &record) { replica.applyReplicatedBooking(record); });
+    EXPECT_FALSE(replica.bookSeats("Theater A", "Movie Y", {4}));
+    EXPECT_FALSE(replica.bookSeats("Theater A", "Movie Y", {5}));
+    EXPECT_EQ(replica.getBookings("Theater A", "Movie Y")[0][6].asInt(), 0);
+
+    // Then the stream, overlapping the copy
+    EXPECT_TRUE(primary.bookSeats("Theater A", "Movie X", {3}, late));
+    EXPECT_TRUE(primary.confirmHold(hold));
+    std::uint64_t since = copied - 1;
+    std::string stream;
+    ASSERT_TRUE(primary.getReplicationLog()->readSince(since, stream, 1 << 20));
+    EXPECT_EQ(since, 3u);
+    ReplicationLog::Message message;
+    BookingLog::Record record;
+    for (std::size_t offset = 0; offset < stream.size(); offset += message.size) {
+        ASSERT_EQ(ReplicationLog::parseMessage(stream.data() + offset, stream.size() - offset, message), ReplicationLog::Result::Complete);
+        ASSERT_TRUE(ReplicationLog::readRecord(message, record));
+        replica.applyReplicatedBooking(record);
+    }
+    EXPECT_FALSE(replica.bookSeats("Theater A", "Movie X", {3}, late));
+    EXPECT_TRUE(replica.bookSeats("Theater A", "Movie X", {3}));
+    EXPECT_EQ(replica.getBookings("Theater A", "Movie Y")[0][6].asInt(), 1);
+}
+
+TEST_F(ReservationSystemTest, replicaFollowsResets) {
+    ReservationSystem primary(filename);
+    primary.enableReplicationLog();
+    EXPECT_TRUE(primary.bookSeats("Theater A", "Movie Y", {4, 5}));
+    EXPECT_TRUE(primary.bookSeats("Arena", "Movie Y", {6, 35}));
+
+    // A full copy replaces what the replica had, seats the primary never booked included
+    ReservationSystem replica(filename);
+    replica.enableReplica();
+    EXPECT_TRUE(replica.bookSeats("Theater A", "Movie Y", {7}));
+    primary.visitBookings([&replica](const BookingLog::Record &record) { replica.applyReplicatedReset(record); }, true);
+    Json::Value bookings = replica.getBookings("Theater A", "Movie Y");
+    EXPECT_EQ(bookings[0][4].asInt(), 1);
+    EXPECT_EQ(bookings[0][7].asInt(), 0);
+
+    // Room 2 of Theater A changes movie and the Arena shrinks, the reload resets both on the replica
+    std::uint64_t since = primary.getReplicationLog()->getSequence();
+    std::ofstream out(filename);
+    out << R"({ "theaters": [
+        { "name": "Theater A", "rooms": [
+            { "name": "Room 1", "movie": { "title": "Movie X" } },
+            { "name": "Room 2", "movie": { "title": "Movie W" } } ] },
+        { "name": "Arena", "rooms": [
+            { "name": "Small", "rows": 2, "columns": 10, "movie": { "title": "Movie Y" } } ] } ] })";
+    out.close();
+    primary.reloadCatalog(filename);
+    std::string stream;
+    ASSERT_TRUE(primary.getReplicationLog()->readSince(since, stream, 1 << 20));
+    ReplicationLog::Message message;
+    BookingLog::Record record;
+    std::int64_t lastMicros = 0;
+    for (std::size_t offset = 0; offset < stream.size(); offset += message.size) {
+        ASSERT_EQ(ReplicationLog::parseMessage(stream.data() + offset, stream.size() - offset, message), ReplicationLog::Result::Complete);
+        EXPECT_EQ(message.type, ReplicationLog::MessageType::Reset);
+        EXPECT_GE(message.primaryMicros, lastMicros);
+        lastMicros = message.primaryMicros;
+        ASSERT_TRUE(ReplicationLog::readRecord(message, record));
+        replica.applyReplicatedReset(record);
+    }
+    bookings = replica.getBookings("Theater A", "Movie Y");
+    EXPECT_EQ(bookings[0][4].asInt(), 0);
+    EXPECT_EQ(bookings[0][5].asInt(), 0);
+    bookings = replica.getBookings("Arena", "Movie Y");
+    EXPECT_EQ(bookings[0][6].asInt(), 1);
+    EXPECT_EQ(bookings[3][5].asInt(), 0);
+}
+
+TEST_F(ReservationSystemTest, holdSeats) {
+    auto now = std::chrono::steady_clock::now();
+    std::uint64_t first = system->holdSeats("Theater A", "Movie Y", {1, 2}, std::chrono::seconds(10), NO_SHOWTIME, now);
+    ASSERT_NE(first, 0u);
+    EXPECT_EQ(system->holdSeats("Theater A", "Movie Y", {2, 3}, std::chrono::seconds(10), NO_SHOWTIME, now), 0u);
+    EXPECT_EQ(system->holdSeats("Theater A", "Movie Z", {5}, std::chrono::seconds(10), NO_SHOWTIME, now), 0u);
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie Y", {1}));
+    std::uint64_t second = system->holdSeats("Theater A", "Movie Y", {3}, std::chrono::seconds(10), NO_SHOWTIME, now);
+    ASSERT_NE(second, 0u);
+    EXPECT_EQ(system->getHoldCount(), 2u);
+    EXPECT_EQ(system->getHoldRoomOrdinal(first), system->getRoomOrdinal("Theater A", "Movie Y"));
+
+    EXPECT_TRUE(system->confirmHold(first));
+    EXPECT_EQ(system->getHoldRoomOrdinal(first), -1);
+    EXPECT_FALSE(system->confirmHold(first));
+    EXPECT_FALSE(system->releaseHold(first));
+    EXPECT_TRUE(system->releaseHold(second));
+    EXPECT_EQ(system->getHoldCount(), 0u);
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie Y", {1}));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie Y", {3}));
+}
+
+TEST_F(ReservationSystemTest, holdsExpire) {
+    auto now = std::chrono::steady_clock::now();
+    std::uint64_t shortHold = system->holdSeats("Arena", "Movie Z", {10}, std::chrono::milliseconds(50), NO_SHOWTIME, now);
+    std::uint64_t longHold = system->holdSeats("Arena", "Movie Z", {11}, std::chrono::seconds(60), NO_SHOWTIME, now);
+    ASSERT_NE(shortHold, 0u);
+    ASSERT_NE(longHold, 0u);
+
+    EXPECT_EQ(system->expireHolds(now + std::chrono::milliseconds(40)), 0u);
+    // Never before the ttl, at most one tick after it
+    EXPECT_EQ(system->expireHolds(now + std::chrono::milliseconds(50) + ReservationSystem::HOLD_TICK), 1u);
+    EXPECT_FALSE(system->confirmHold(shortHold));
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Z", {10}));
+    EXPECT_EQ(system->expireHolds(now + std::chrono::minutes(2)), 1u);
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Z", {11}));
+}
+
+TEST_F(ReservationSystemTest, expiredHoldsHandedOutToTheirRoom) {
+    auto now = std::chrono::steady_clock::now();
+    std::uint64_t hold = system->holdSeats("Arena", "Movie Z", {10}, std::chrono::milliseconds(50), NO_SHOWTIME, now);
+    ASSERT_NE(hold, 0u);
+
+    std::vector<std::pair<std::uint64_t, long>> expired;
+    auto later = now + std::chrono::seconds(1);
+    EXPECT_EQ(system->expireHolds(later, [&expired](std::uint64_t holdId, long roomOrdinal)
+                                  { expired.emplace_back(holdId, roomOrdinal); }),
+              1u);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0].first, hold);
+    EXPECT_EQ(expired[0].second, system->getRoomOrdinal("Arena", "Movie Z"));
+    // Handed out, not released yet
+    EXPECT_FALSE(system->bookSeats("Arena", "Movie Z", {10}));
+    EXPECT_TRUE(system->expireHold(hold, later));
+    EXPECT_FALSE(system->expireHold(hold, later));
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Z", {10}));
+}
+
+TEST_F(ReservationSystemTest, holdShowtimeSeats) {
+    ShowtimeId late = 0, early = 1; // 21:00 and 18:30 of Theater A, Movie X
+    auto now = std::chrono::steady_clock::now();
+    std::uint64_t first = system->holdSeats("Theater A", "Movie X", {1, 2}, std::chrono::seconds(10), late, now);
+    ASSERT_NE(first, 0u);
+    EXPECT_EQ(system->holdSeats("Theater A", "Movie X", {2}, std::chrono::seconds(10), late, now), 0u);
+    EXPECT_EQ(system->holdSeats("Theater B", "Movie X", {3}, std::chrono::seconds(10), late, now), 0u); // Not a showtime there
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie X", {1}, late));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {1}, early)); // Other showtimes and the room are apart
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {1}));
+    EXPECT_EQ(system->getHoldRoomOrdinal(first), system->getRoomOrdinal("Theater A", "Movie X", late));
+
+    // Checkpoints and replicas get the showtime bookings without the held seats
+    std::vector<std::vector<int>> showtimeRecords;
+    system->visitBookings([&showtimeRecords](const BookingLog::Record &record) {
+        if (record.showtimeStart != BookingLog::Record::NO_START) {
+            showtimeRecords.push_back(record.seats);
+        }
+    });
+    EXPECT_EQ(showtimeRecords, std::vector<std::vector<int>>({{1}})); // The early showtime only
+
+    std::uint64_t second = system->holdSeats("Theater A", "Movie X", {3}, std::chrono::seconds(10), late, now);
+    std::uint64_t third = system->holdSeats("Theater A", "Movie X", {4}, std::chrono::milliseconds(50), late, now);
+    ASSERT_NE(second, 0u);
+    ASSERT_NE(third, 0u);
+    EXPECT_TRUE(system->confirmHold(first));
+    EXPECT_TRUE(system->releaseHold(second));
+    EXPECT_EQ(system->expireHolds(now + std::chrono::seconds(1)), 1u);
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie X", {2}, late));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {3}, late));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {4}, late));
+}
+
+TEST_F(ReservationSystemTest, unconfirmedHoldsAreNotLogged) {
+    std::string walPath = filename + ".wal";
+    {
+        // Checkpoint after every record, so the checkpoint sees the held seats too
+        ReservationSystem first(filename);
+        first.enableBookingLog(walPath, 1);
+        std::uint64_t confirmed = first.holdSeats("Theater A", "Movie Y", {1}, std::chrono::seconds(10));
+        EXPECT_NE(first.holdSeats("Theater A", "Movie Y", {2}, std::chrono::seconds(10)), 0u);
+        EXPECT_TRUE(first.confirmHold(confirmed));
+        std::uint64_t confirmedShowtime = first.holdSeats("Theater A", "Movie X", {1}, std::chrono::seconds(10), 0);
+        EXPECT_NE(first.holdSeats("Theater A", "Movie X", {2}, std::chrono::seconds(10), 0), 0u);
+        EXPECT_TRUE(first.confirmHold(confirmedShowtime));
+        EXPECT_TRUE(first.bookSeats("Theater A", "Movie Y", {3}));
+    }
+    ReservationSystem second(filename);
+    second.enableBookingLog(walPath);
+    EXPECT_FALSE(second.bookSeats("Theater A", "Movie Y", {1}));
+    EXPECT_TRUE(second.bookSeats("Theater A", "Movie Y", {2}));
+    EXPECT_FALSE(second.bookSeats("Theater A", "Movie Y", {3}));
+    EXPECT_FALSE(second.bookSeats("Theater A", "Movie X", {1}, 0));
+    EXPECT_TRUE(second.bookSeats("Theater A", "Movie X", {2}, 0));
+    for (const auto &entry : std::filesystem::directory_iterator(::testing::TempDir())) {
+        if (entry.path().filename().string().rfind(std::filesystem::path(walPath).filename().string(), 0) == 0) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+}
+
+TEST_F(ReservationSystemTest, catalogSnapshotRoundTrip) {
+    std::string snapshotPath = filename + ".snapshot";
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie Y", {3, 4}));
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Z", {1999}));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {7}, 0));
+    system->saveSnapshot(snapshotPath);
+    EXPECT_FALSE(ReservationSystem::isCatalogSnapshot(filename));
+    ASSERT_TRUE(ReservationSystem::isCatalogSnapshot(snapshotPath));
+
+    {
+        ReservationSystem mapped(snapshotPath);
+        EXPECT_EQ(mapped.getAllPlayingMoviesJson(), system->getAllPlayingMoviesJson());
+        EXPECT_EQ(mapped.getTheatersShowingMovieJson("Movie X"), system->getTheatersShowingMovieJson("Movie X"));
+        EXPECT_EQ(mapped.getBookings("Arena", "Movie Y"), system->getBookings("Arena", "Movie Y"));
+        EXPECT_FALSE(mapped.bookSeats("Theater A", "Movie Y", {4}));
+        EXPECT_FALSE(mapped.bookSeats("Arena", "Movie Z", {1999, 2000}));
+        EXPECT_TRUE(mapped.bookSeats("Arena", "Movie Z", {1998}));
+        EXPECT_EQ(mapped.bookBestAvailable("Arena", "Movie Y", 10, true).size(), 10u);
+        ASSERT_EQ(mapped.getShowtimesJson("Theater A", "Movie X"), system->getShowtimesJson("Theater A", "Movie X"));
+        EXPECT_FALSE(mapped.bookSeats("Theater A", "Movie X", {7}, 0));
+        EXPECT_TRUE(mapped.bookSeats("Theater A", "Movie X", {7}, 1));
+    }
+
+    // Bookings on a mapped snapshot stay private to the process
+    ReservationSystem reloaded(snapshotPath);
+    EXPECT_TRUE(reloaded.bookSeats("Arena", "Movie Z", {1998}));
+    EXPECT_FALSE(reloaded.bookSeats("Theater A", "Movie Y", {3}));
+    std::remove(snapshotPath.c_str());
+}
+
+TEST_F(ReservationSystemTest, invalidCatalogSnapshot) {
+    std::string snapshotPath = filename + ".snapshot";
+    system->saveSnapshot(snapshotPath);
+    std::filesystem::resize_file(snapshotPath, std::filesystem::file_size(snapshotPath) - 8);
+    EXPECT_THROW(ReservationSystem truncated(snapshotPath), std::runtime_error);
+    std::remove(snapshotPath.c_str());
+}
+
+TEST_F(ReservationSystemTest, showtimes) {
+    Json::Value showtimes = system->getShowtimesJson("Theater A", "Movie X");
+    ASSERT_EQ(showtimes.size(), 2u);
+    EXPECT_EQ(showtimes[0]["start"].asString(), "2026-10-17T18:30"); // Earliest first
+    EXPECT_EQ(showtimes[0]["room"].asString(), "Room 1");
+    EXPECT_EQ(showtimes[1]["start"].asString(), "2026-10-17T21:00");
+    EXPECT_EQ(system->getShowtimesJson("Theater B", "Movie X").size(), 0u);
+    EXPECT_EQ(system->getShowtimeCount(), 2u);
+
+    ShowtimeId early = showtimes[0]["id"].asUInt();
+    ShowtimeId late = showtimes[1]["id"].asUInt();
+    std::uint64_t version = system->getBookingsVersion("Theater A", "Movie X", early);
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {5, 6}, early));
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie X", {6}, early));
+    EXPECT_NE(system->getBookingsVersion("Theater A", "Movie X", early), version);
+
+    // Each showtime and the room itself have their own seats
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {6}, late));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {6}));
+    EXPECT_EQ(system->getBookings("Theater A", "Movie X", early)[0][5].asInt(), 1);
+    EXPECT_EQ(system->getBookings("Theater A", "Movie X", late)[0][5].asInt(), 0);
+    EXPECT_EQ(system->bookBestAvailable("Theater A", "Movie X", 2, true, early), std::vector<int>({0, 1}));
+
+    // A showtime only answers for its own theater and movie
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie Y", {7}, early));
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie X", {7}, 99));
+    EXPECT_EQ(system->getBookings("Theater B", "Movie X", early).size(), 0u);
+    EXPECT_EQ(system->getRoomOrdinal("Theater A", "Movie X", late), 0);
+    EXPECT_EQ(system->getRoomOrdinal("Theater B", "Movie X", late), -1);
+
+    std::vector<BookingRequest> batch = {{"Theater A", "Movie X", {8}, late}, {"Theater A", "Movie X", {8}, late},
+                                         {"Theater A", "Movie X", {8}}};
+    EXPECT_EQ(system->bookSeatsBatch(batch), std::vector<bool>({true, false, true}));
+}
+
+TEST_F(ReservationSystemTest, showtimeBookingsSurviveRestart) {
+    std::string walPath = filename + ".showtimes.wal";
+    ShowtimeId late = system->getShowtimesJson("Theater A", "Movie X")[1]["id"].asUInt();
+    {
+        ReservationSystem first(filename);
+        first.enableBookingLog(walPath, 2);
+        EXPECT_TRUE(first.bookSeats("Theater A", "Movie X", {3}, late));
+        EXPECT_TRUE(first.bookSeats("Theater A", "Movie X", {4}));
+        EXPECT_TRUE(first.bookSeats("Theater A", "Movie X", {5}, late)); // Checkpoints after this one
+    }
+    ReservationSystem second(filename);
+    second.enableBookingLog(walPath);
+    EXPECT_FALSE(second.bookSeats("Theater A", "Movie X", {3}, late));
+    EXPECT_FALSE(second.bookSeats("Theater A", "Movie X", {5}, late));
+    EXPECT_TRUE(second.bookSeats("Theater A", "Movie X", {4}, late));
+    EXPECT_FALSE(second.bookSeats("Theater A", "Movie X", {4}));
+    EXPECT_TRUE(second.bookSeats("Theater A", "Movie X", {3}));
+    for (const auto &entry : std::filesystem::directory_iterator(::testing::TempDir())) {
+        if (entry.path().filename().string().rfind(std::filesystem::path(walPath).filename().string(), 0) == 0) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+}
+
+TEST_F(ReservationSystemTest, showtimeOnlyTheater) {
+    std::string path = filename + ".extra.json";
+    std::ofstream out(path);
+    out << R"({ "theaters": [
+        { "name": "Drive-in", "rooms": [
+            { "name": "Lot", "capacity": 10, "movie": { "title": "Movie X" }, "showtimes": [
+                { "start": "2026-10-17 20:00", "movie": { "title": "Movie Q" } } ] } ] } ] })";
+    out.close();
+    ReservationSystem extra(path);
+    EXPECT_EQ(extra.getTheatersShowingMovieJson("Movie Q").size(), 1u);
+    ASSERT_EQ(extra.getShowtimesJson("Drive-in", "Movie Q").size(), 1u);
+    EXPECT_FALSE(extra.bookSeats("Drive-in", "Movie Q", {1})); // No room plays it outside the showtime
+    EXPECT_TRUE(extra.bookSeats("Drive-in", "Movie Q", {1}, 0));
+    EXPECT_FALSE(extra.bookSeats("Drive-in", "Movie Q", {10}, 0));
+
+    std::ofstream bad(path);
+    bad << R"({ "theaters": [ { "name": "T", "rooms": [ { "name": "R", "movie": { "title": "M" }, "showtimes": [
+        { "start": "2026-02-30T20:00" } ] } ] } ] })";
+    bad.close();
+    EXPECT_THROW(ReservationSystem invalid(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST_F(ReservationSystemTest, roomOrdinal) {
+    EXPECT_EQ(system->getRoomOrdinal("Theater A", "Movie X"), 0);
+    EXPECT_EQ(system->getRoomOrdinal("Theater A", "Movie Y"), 1);
+    EXPECT_EQ(system->getRoomOrdinal("Theater B", "Movie X"), 2); // First of the two rooms showing it
+    EXPECT_EQ(system->getRoomOrdinal("Arena", "Movie Y"), 5);
+    EXPECT_EQ(system->getRoomOrdinal("Arena", "Movie X"), -1);
+    EXPECT_EQ(system->getRoomOrdinal("Nowhere", "Movie X"), -1);
+}
+
+TEST_F(ReservationSystemTest, bookRoomSeatsByOrdinal) {
+    ShowtimeId late = system->getShowtimesJson("Theater A", "Movie X")[1]["id"].asUInt();
+    std::uint64_t catalogVersion = system->getCatalogVersion();
+    EXPECT_EQ(system->bookRoomSeats(catalogVersion, 1, NO_SHOWTIME, {2, 3}), RoomBooking::Booked);
+    EXPECT_EQ(system->bookRoomSeats(catalogVersion, 1, NO_SHOWTIME, {3, 4}), RoomBooking::Unavailable);
+    EXPECT_EQ(system->bookRoomSeats(catalogVersion, 0, late, {3}), RoomBooking::Booked);
+    EXPECT_EQ(system->bookRoomSeats(catalogVersion, 1, late, {3}), RoomBooking::UnknownRoom); // Not a showtime of room 1
+    EXPECT_EQ(system->bookRoomSeats(catalogVersion, 6, NO_SHOWTIME, {0}), RoomBooking::UnknownRoom);
+    EXPECT_EQ(system->getBookings("Theater A", "Movie Y")[0][2].asInt(), 1);
+    EXPECT_EQ(system->getBookings("Theater A", "Movie X", late)[0][3].asInt(), 1);
+
+    std::vector<std::uint64_t> words;
+    int capacity = 0;
+    std::uint64_t version = 0;
+    ASSERT_EQ(system->snapshotRoomSeats(catalogVersion, 1, NO_SHOWTIME, words, capacity, version), RoomSnapshot::Copied);
+    EXPECT_EQ(capacity, 20);
+    ASSERT_GE(words.size(), 1u); // Padded to whole cache lines
+    EXPECT_EQ(words[0], 0xcull);
+    ASSERT_EQ(system->snapshotRoomSeats(catalogVersion, 0, late, words, capacity, version), RoomSnapshot::Copied);
+    EXPECT_EQ(words[0], 0x8ull);
+
+    std::uint64_t before = version;
+    EXPECT_EQ(system->bookRoomSeats(catalogVersion, 0, late, {9}), RoomBooking::Booked);
+    ASSERT_EQ(system->snapshotRoomSeats(catalogVersion, 0, late, words, capacity, version), RoomSnapshot::Copied);
+    EXPECT_NE(version, before);
+    EXPECT_EQ(system->snapshotRoomSeats(catalogVersion, 1, late, words, capacity, version), RoomSnapshot::UnknownRoom);
+    EXPECT_EQ(system->snapshotRoomSeats(catalogVersion, 6, NO_SHOWTIME, words, capacity, version), RoomSnapshot::UnknownRoom);
+    EXPECT_EQ(system->getCatalog()->roomTable.size(), 6u);
+
+    // Numbers from another catalog version are not looked up at all
+    EXPECT_EQ(system->bookRoomSeats(catalogVersion + 1, 1, NO_SHOWTIME, {10}), RoomBooking::StaleCatalog);
+    EXPECT_EQ(system->snapshotRoomSeats(catalogVersion - 1, 1, NO_SHOWTIME, words, capacity, version), RoomSnapshot::StaleCatalog);
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie Y", {10}));
+}
+
+TEST_F(ReservationSystemTest, seatChangeFeed) {
+    SeatFeed feed;
+    EXPECT_FALSE(system->followSeats("Theater A", "Movie Z", NO_SHOWTIME, feed));
+    ASSERT_TRUE(system->followSeats("Theater A", "Movie X", NO_SHOWTIME, feed));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {1, 2}));
+
+    // An unknown version starts over from every booked seat
+    SeatChanges changes;
+    system->readSeatChanges(feed, 0, changes);
+    EXPECT_TRUE(changes.full);
+    EXPECT_EQ(changes.booked, std::vector<int>({1, 2}));
+    std::uint64_t version = changes.version;
+
+    std::uint64_t hold = system->holdSeats("Theater A", "Movie X", {5, 6}, std::chrono::seconds(10));
+    ASSERT_NE(hold, 0u);
+    EXPECT_EQ(system->bookSeatsBatch({{"Theater A", "Movie X", {7}}, {"Theater A", "Movie X", {7}}}), std::vector<bool>({true, false}));
+    EXPECT_TRUE(system->releaseHold(hold));
+    system->readSeatChanges(feed, version, changes);
+    EXPECT_FALSE(changes.full);
+    EXPECT_EQ(changes.booked, std::vector<int>({7}));
+    EXPECT_EQ(changes.freed, std::vector<int>({5, 6}));
+    EXPECT_EQ(changes.version, version + 3);
+
+    // Showtimes have rings of their own
+    ShowtimeId late = system->getShowtimesJson("Theater A", "Movie X")[1]["id"].asUInt();
+    SeatFeed showtimeFeed;
+    ASSERT_TRUE(system->followSeats("Theater A", "Movie X", late, showtimeFeed));
+    EXPECT_NE(showtimeFeed.ring, feed.ring);
+    std::uint64_t showtimeVersion = showtimeFeed.ring->getVersion();
+    EXPECT_EQ(system->bookRoomSeats(system->getCatalogVersion(), 0, late, {4}), RoomBooking::Booked);
+    system->readSeatChanges(showtimeFeed, showtimeVersion, changes);
+    EXPECT_EQ(changes.booked, std::vector<int>({4}));
+
+    // A reload keeps the rings of the seats it carries over
+    system->reloadCatalog(filename);
+    SeatFeed reloaded;
+    ASSERT_TRUE(system->followSeats("Theater A", "Movie X", NO_SHOWTIME, reloaded));
+    EXPECT_EQ(reloaded.ring, feed.ring);
+}
+
+TEST_F(ReservationSystemTest, reloadCatalogKeepsSeats) {
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie Y", {1}));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {2}, 0)); // The 21:00 showtime
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Y", {3}));
+    std::uint64_t hold = system->holdSeats("Theater B", "Movie X", {4}, std::chrono::seconds(10));
+    ASSERT_NE(hold, 0u);
+    std::uint64_t resizedHold = system->holdSeats("Arena", "Movie Y", {5}, std::chrono::seconds(10));
+    std::uint64_t cutHold = system->holdSeats("Arena", "Movie Y", {30}, std::chrono::seconds(10));
+    std::uint64_t recastHold = system->holdSeats("Theater A", "Movie Y", {6}, std::chrono::seconds(10));
+    std::uint64_t showtimeHold = system->holdSeats("Theater A", "Movie X", {7}, std::chrono::seconds(10), 0);
+    std::uint64_t movedShowtimeHold = system->holdSeats("Theater A", "Movie X", {7}, std::chrono::seconds(10), 1);
+    ASSERT_NE(showtimeHold, 0u);
+    ASSERT_NE(movedShowtimeHold, 0u);
+    ASSERT_NE(resizedHold, 0u);
+    ASSERT_NE(cutHold, 0u);
+    ASSERT_NE(recastHold, 0u);
+    std::uint64_t versionBefore = system->getBookingsVersion("Theater A", "Movie Y");
+
+    // Room 2 of Theater A changes movie, the 18:30 showtime moves to 19:00, the Arena shrinks
+    std::ofstream out(filename);
+    out << R"({ "theaters": [
+        { "name": "Theater A", "rooms": [
+            { "name": "Room 1", "movie": { "title": "Movie X" }, "showtimes": [
+                { "start": "2026-10-17T21:00" },
+                { "start": "2026-10-17T19:00" } ] },
+            { "name": "Room 2", "movie": { "title": "Movie W" } } ] },
+        { "name": "Theater B", "rooms": [
+            { "name": "Room 1", "movie": { "title": "Movie X" } } ] },
+        { "name": "Arena", "rooms": [
+            { "name": "Small", "rows": 2, "columns": 10, "movie": { "title": "Movie Y" } } ] },
+        { "name": "Theater C", "rooms": [
+            { "name": "Room 1", "movie": { "title": "Movie X" } } ] } ] })";
+    out.close();
+    EXPECT_EQ(system->reloadCatalog(filename), 2u);
+    EXPECT_EQ(system->getCatalogVersion(), 2u);
+    EXPECT_NE(system->getBookingsVersion("Theater A", "Movie W"), versionBefore);
+
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie W", {1})); // Same room, new movie: starts empty
+    EXPECT_FALSE(system->bookSeats("Arena", "Movie Y", {3}));     // Resized, kept what fits
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Y", {4}));
+    EXPECT_TRUE(system->bookSeats("Theater C", "Movie X", {1}));
+    EXPECT_EQ(system->getTheatersShowingMovieJson("Movie Y").size(), 1u);
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie Y", {5}));
+
+    Json::Value showtimes = system->getShowtimesJson("Theater A", "Movie X");
+    ASSERT_EQ(showtimes.size(), 2u);
+    EXPECT_EQ(showtimes[0]["start"].asString(), "2026-10-17T19:00");
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {2}, showtimes[0]["id"].asUInt()));
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie X", {2}, showtimes[1]["id"].asUInt()));
+
+    // The hold survives on the seats it took, confirmed or not
+    EXPECT_FALSE(system->bookSeats("Theater B", "Movie X", {4}));
+    EXPECT_TRUE(system->confirmHold(hold));
+    EXPECT_FALSE(system->bookSeats("Theater B", "Movie X", {4}));
+
+    // Holds follow a resized room if their seats still fit, and end with the movie
+    EXPECT_FALSE(system->bookSeats("Arena", "Movie Y", {5}));
+    EXPECT_EQ(system->getHoldRoomOrdinal(resizedHold), system->getRoomOrdinal("Arena", "Movie Y"));
+    EXPECT_TRUE(system->confirmHold(resizedHold));
+    EXPECT_FALSE(system->bookSeats("Arena", "Movie Y", {5}));
+    EXPECT_FALSE(system->confirmHold(cutHold));
+    EXPECT_FALSE(system->confirmHold(recastHold));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie W", {6}));
+
+    // Showtime holds follow their showtime, the one that moved to 19:00 is another showtime
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie X", {7}, showtimes[1]["id"].asUInt()));
+    EXPECT_TRUE(system->confirmHold(showtimeHold));
+    EXPECT_FALSE(system->confirmHold(movedShowtimeHold));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie X", {7}, showtimes[0]["id"].asUInt()));
+}
+
+TEST_F(ReservationSystemTest, reloadResizingShowtimeMovesHolds) {
+    std::ofstream(filename) << R"({ "theaters": [ { "name": "Arena", "rooms": [
+        { "name": "Small", "rows": 4, "columns": 10, "movie": { "title": "Movie Y" }, "showtimes": [
+            { "start": "2026-10-17T21:00" } ] } ] } ] })";
+    system.reset(new ReservationSystem(filename));
+    std::uint64_t kept = system->holdSeats("Arena", "Movie Y", {5}, std::chrono::seconds(10), 0);
+    std::uint64_t cut = system->holdSeats("Arena", "Movie Y", {6, 30}, std::chrono::seconds(10), 0);
+    ASSERT_NE(kept, 0u);
+    ASSERT_NE(cut, 0u);
+
+    std::ofstream(filename) << R"({ "theaters": [ { "name": "Arena", "rooms": [
+        { "name": "Small", "rows": 2, "columns": 10, "movie": { "title": "Movie Y" }, "showtimes": [
+            { "start": "2026-10-17T21:00" } ] } ] } ] })";
+    system->reloadCatalog(filename);
+    EXPECT_FALSE(system->bookSeats("Arena", "Movie Y", {5}, 0));
+    EXPECT_TRUE(system->confirmHold(kept));
+    EXPECT_FALSE(system->confirmHold(cut));
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Y", {6}, 0)); // The part of the dropped hold that fit is free again
+}
+
+TEST_F(ReservationSystemTest, reloadResizingRoomKeepsRacingBookings) {
+    // The Arena's main room switches between 2000 and 1000 seats on every reload
+    std::string resized = filename + ".resized.json";
+    std::ofstream out(resized);
+    out << R"({ "theaters": [
+        { "name": "Arena", "rooms": [
+            { "name": "Main", "capacity": 1000, "movie": { "title": "Movie Z" } } ] } ] })";
+    out.close();
+
+    const int THREADS = 4;
+    const int SEATS = 1000;
+    std::atomic<int> running{THREADS};
+    std::vector<std::thread> bookers;
+    for (int t = 0; t < THREADS; ++t) {
+        bookers.emplace_back([&, t] {
+            for (int seat = t; seat < SEATS; seat += THREADS) {
+                // Fails only while the old room is sealed for a copy, never once it succeeded
+                while (!system->bookSeats("Arena", "Movie Z", {seat})) {
+                    std::this_thread::yield();
+                }
+            }
+            --running;
+        });
+    }
+    for (int reload = 0; running > 0 || reload < 2; ++reload) {
+        system->reloadCatalog(reload % 2 == 0 ? resized : filename);
+    }
+    for (std::thread &booker : bookers) {
+        booker.join();
+    }
+    std::remove(resized.c_str());
+
+    for (int seat = 0; seat < SEATS; ++seat) {
+        EXPECT_FALSE(system->bookSeats("Arena", "Movie Z", {seat})) << "seat " << seat << " was lost";
+    }
+}
+
+TEST_F(ReservationSystemTest, invalidReloadKeepsCatalog) {
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie Y", {1}));
+    std::ofstream out(filename);
+    out << R"({ "theaters": [ { "name": "T", "rooms": [ { "name": "R", "movie": { "title": "M" }, "showtimes": [
+        { "start": "not a time" } ] } ] } ] })";
+    out.close();
+    EXPECT_THROW(system->reloadCatalog(filename), std::runtime_error);
+    EXPECT_THROW(system->reloadCatalog(filename + ".missing"), std::runtime_error);
+    EXPECT_EQ(system->getCatalogVersion(), 1u);
+    EXPECT_FALSE(system->bookSeats("Theater A", "Movie Y", {1}));
+    EXPECT_TRUE(system->bookSeats("Theater A", "Movie Y", {2}));
+}
+
+TEST_F(ReservationSystemTest, reloadCatalogAsync) {
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+    std::string error = "not called";
+    ASSERT_TRUE(system->reloadCatalogAsync(system->getCatalogPath(), [&](const std::string &reloadError) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = reloadError;
+        done = true;
+        finished.notify_one();
+    }));
+    // Bookings carry on while the reload runs
+    EXPECT_TRUE(system->bookSeats("Arena", "Movie Z", {7}));
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(finished.wait_for(lock, std::chrono::seconds(10), [&] { return done; }));
+    EXPECT_EQ(error, "");
+    EXPECT_FALSE(system->bookSeats("Arena", "Movie Z", {7}));
+}
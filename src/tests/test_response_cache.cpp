@@ -0,0 +1,28 @@
+#include "gtest/gtest.h"
+#include "response_cache.h"
+
+TEST(ResponseCacheTest, hitOnlyAtSameVersion) {
+    ResponseCache cache;
+    std::string key = ResponseCache::makeKey("/find", "Dune");
+    EXPECT_EQ(cache.find(key, 1), nullptr);
+    cache.store(key, 1, std::make_shared<const std::string>("response"));
+    ASSERT_NE(cache.find(key, 1), nullptr);
+    EXPECT_EQ(*cache.find(key, 1), "response");
+    EXPECT_EQ(cache.find(key, 2), nullptr);
+    cache.store(key, 2, std::make_shared<const std::string>("newer"));
+    EXPECT_EQ(*cache.find(key, 2), "newer");
+    EXPECT_EQ(cache.find(ResponseCache::makeKey("/find", "Dune", "x"), 2), nullptr);
+}
+
+TEST(ResponseCacheTest, boundedSize) {
+    ResponseCache cache(32);
+    for (int i = 0; i < 1000; ++i) {
+        cache.store(ResponseCache::makeKey("/find", std::to_string(i)), 1, std::make_shared<const std::string>("r"));
+    }
+    int hits = 0;
+    for (int i = 0; i < 1000; ++i) {
+        hits += cache.find(ResponseCache::makeKey("/find", std::to_string(i)), 1) ? 1 : 0;
+    }
+    EXPECT_LE(hits, 32 + 16);
+    EXPECT_GT(hits, 0);
+}
@@ -0,0 +1,207 @@
+#include "gtest/gtest.h"
+#include "seat_map.h"
+
+#include <atomic>
+#include <thread>
+
+TEST(SeatMapTest, reserveSingleSeat) {
+    SeatMap seats(100);
+    EXPECT_EQ(seats.getCapacity(), 100);
+    EXPECT_TRUE(seats.isAvailable(70));
+    EXPECT_TRUE(seats.reserve(70));
+    EXPECT_FALSE(seats.isAvailable(70));
+    EXPECT_FALSE(seats.reserve(70));
+    EXPECT_FALSE(seats.reserve(100)); // Out of range
+    EXPECT_FALSE(seats.isAvailable(-1));
+}
+
+TEST(SeatMapTest, reserveAllOrNothing) {
+    SeatMap seats(130);
+    EXPECT_TRUE(seats.reserve(std::vector<int>{65}));
+    // Spans three words, the second one holds a booked seat
+    EXPECT_FALSE(seats.reserve(std::vector<int>{1, 65, 129}));
+    EXPECT_TRUE(seats.isAvailable(1));
+    EXPECT_TRUE(seats.isAvailable(129));
+    EXPECT_FALSE(seats.reserve(std::vector<int>{1, 130}));
+    EXPECT_TRUE(seats.isAvailable(1));
+    EXPECT_TRUE(seats.reserve(std::vector<int>{1, 1, 64, 129}));
+    EXPECT_FALSE(seats.isAvailable(64));
+}
+
+TEST(SeatMapTest, release) {
+    SeatMap seats(100);
+    EXPECT_TRUE(seats.reserve(std::vector<int>{1, 70}));
+    std::uint64_t version = seats.getVersion();
+    EXPECT_FALSE(seats.release({1, 100})); // Out of range, nothing freed
+    EXPECT_FALSE(seats.isAvailable(1));
+    EXPECT_TRUE(seats.release({1, 70, 71}));
+    EXPECT_TRUE(seats.isAvailable(1));
+    EXPECT_TRUE(seats.isAvailable(70));
+    EXPECT_GT(seats.getVersion(), version);
+}
+
+TEST(SeatMapTest, copyKeepsOccupancy) {
+    SeatMap seats(20);
+    seats.reserve(3);
+    SeatMap copy(seats);
+    EXPECT_FALSE(copy.isAvailable(3));
+    EXPECT_TRUE(copy.isAvailable(4));
+}
+
+TEST(SeatMapTest, concurrentBookersNeverShareASeat) {
+    SeatMap seats(256);
+    std::atomic<int> booked(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&seats, &booked] {
+            for (int seat = 0; seat < 255; ++seat) {
+                if (seats.reserve(std::vector<int>{seat, seat + 1})) {
+                    booked += 2;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    int reserved = 0;
+    for (int seat = 0; seat < 256; ++seat) {
+        reserved += seats.isAvailable(seat) ? 0 : 1;
+    }
+    EXPECT_EQ(booked.load(), reserved);
+}
+
+TEST(SeatMapTest, snapshotsNeverSeeHalfABooking) {
+    // Every booking takes two seats in different words and is released again, so a copy
+    // of the map always holds an even number of seats unless it caught one half done.
+    // Overlapping pairs make bookings roll back, which a copy must not catch either.
+    SeatMap seats(128);
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 3; ++t) {
+        writers.emplace_back([&seats, &stop, t] {
+            for (int i = 0; !stop.load(); i = (i + 1) % 64) {
+                std::vector<int> pair{i, 64 + (i + t) % 64};
+                if (seats.reserve(pair)) {
+                    seats.release(pair);
+                }
+            }
+        });
+    }
+    std::vector<std::uint64_t> words(seats.getWordCount());
+    std::uint64_t lastVersion = 0;
+    for (int read = 0; read < 20000; ++read) {
+        std::uint64_t version = seats.snapshot(words.data());
+        int booked = __builtin_popcountll(words[0]) + __builtin_popcountll(words[1]);
+        ASSERT_EQ(booked % 2, 0) << "read " << read;
+        ASSERT_GE(version, lastVersion);
+        lastVersion = version;
+    }
+    stop = true;
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    EXPECT_EQ(seats.snapshot(words.data()), seats.getVersion());
+    EXPECT_EQ(seats.countAvailable(), 128);
+}
+
+TEST(SeatMapTest, countAndFindAvailable) {
+    SeatMap seats(2000);
+    EXPECT_EQ(seats.countAvailable(), 2000);
+    EXPECT_EQ(seats.getWordCount() % 8, 0u); // Padded to whole cache lines
+    std::vector<int> firstRows;
+    for (int seat = 0; seat < 1500; ++seat) {
+        firstRows.push_back(seat);
+    }
+    EXPECT_TRUE(seats.reserve(firstRows));
+    EXPECT_EQ(seats.countAvailable(), 500);
+    EXPECT_EQ(seats.findAvailable(), 1500);
+    EXPECT_EQ(seats.findAvailable(1700), 1700);
+    EXPECT_TRUE(seats.reserve(1999));
+    EXPECT_EQ(seats.findAvailable(1999), -1);
+    EXPECT_EQ(seats.findAvailable(2000), -1);
+}
+
+TEST(SeatMapTest, reserveAvailable) {
+    SeatMap seats(30);
+    EXPECT_TRUE(seats.reserve(std::vector<int>{0, 3, 12}));
+    // Rows of 10: the first run of 4 free seats is 4-7
+    EXPECT_EQ(seats.reserveAvailable(4, true, 10), std::vector<int>({4, 5, 6, 7}));
+    // Row 0 has 1, 2, 8, 9 left, none adjacent to each other by 3
+    EXPECT_EQ(seats.reserveAvailable(3, true, 10), std::vector<int>({13, 14, 15}));
+    EXPECT_EQ(seats.reserveAvailable(3, false, 10), std::vector<int>({1, 2, 8}));
+    EXPECT_TRUE(seats.reserveAvailable(11, true, 10).empty()); // Longer than a row
+    EXPECT_TRUE(seats.reserveAvailable(31, false, 10).empty());
+    EXPECT_EQ(seats.countAvailable(), 30 - 3 - 4 - 3 - 3);
+}
+
+TEST(SeatMapTest, reserveAvailableAcrossWords) {
+    SeatMap seats(200);
+    std::vector<int> booked;
+    for (int seat = 0; seat < 62; ++seat) {
+        booked.push_back(seat);
+    }
+    EXPECT_TRUE(seats.reserve(booked));
+    EXPECT_EQ(seats.reserveAvailable(5, true, 0), std::vector<int>({62, 63, 64, 65, 66}));
+}
+
+TEST(SeatMapTest, rolledBackClaimsAreNoConflict) {
+    // 'failing' always fails on its last word, the claim it rolls back must not fail 'booker'
+    SeatMap seats(256);
+    ASSERT_TRUE(seats.reserve(200));
+    std::atomic<bool> started{false}, done{false};
+    std::thread failing([&] {
+        const std::vector<int> request{5, 70, 200};
+        started = true;
+        while (!done) {
+            EXPECT_FALSE(seats.reserve(request));
+        }
+    });
+    while (!started) {
+        std::this_thread::yield();
+    }
+    int conflicts = 0;
+    for (int i = 0; i < 100000; ++i) {
+        if (!seats.reserve(std::vector<int>{5, 70, 140})) {
+            ++conflicts;
+            continue;
+        }
+        EXPECT_TRUE(seats.release({5, 70, 140}));
+    }
+    done = true;
+    failing.join();
+    EXPECT_EQ(conflicts, 0);
+
+    // Sets that really overlap still conflict
+    EXPECT_TRUE(seats.reserve(std::vector<int>{6, 71}));
+    EXPECT_FALSE(seats.reserve(std::vector<int>{1, 71}));
+    EXPECT_TRUE(seats.isAvailable(1));
+}
+
+TEST(SeatMapTest, sealRefusesChanges) {
+    SeatMap seats(100);
+    EXPECT_TRUE(seats.reserve(std::vector<int>{1, 70}));
+    std::uint64_t version = seats.getVersion();
+    seats.seal();
+    EXPECT_TRUE(seats.isSealed());
+    EXPECT_FALSE(seats.reserve(2));
+    EXPECT_FALSE(seats.reserve(std::vector<int>{3, 4}));
+    EXPECT_FALSE(seats.release({1}));
+    EXPECT_TRUE(seats.reserveAvailable(2, false, 0).empty());
+    std::vector<int> a{5};
+    EXPECT_EQ(seats.reserveBatch({&a}), std::vector<bool>({false}));
+    EXPECT_EQ(seats.getBookedSeats(), std::vector<int>({1, 70}));
+    EXPECT_EQ(seats.getVersion(), version);
+}
+
+TEST(SeatMapTest, reserveBatch) {
+    SeatMap seats(100);
+    EXPECT_TRUE(seats.reserve(5));
+    std::vector<int> a{1, 2}, b{2, 3}, c{5}, d{70, 99}, e{100};
+    std::vector<bool> booked = seats.reserveBatch({&a, &b, &c, &d, &e});
+    EXPECT_EQ(booked, std::vector<bool>({true, false, false, true, false}));
+    EXPECT_FALSE(seats.isAvailable(2));
+    EXPECT_TRUE(seats.isAvailable(3));
+    EXPECT_FALSE(seats.isAvailable(99));
+    EXPECT_EQ(seats.countAvailable(), 100 - 5);
+}
@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+#include "seat_request_decoder.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+    bool decode(const std::string &body, SeatRequestBody &request) {
+        return SeatRequestDecoder(body).decode(request);
+    }
+
+    std::vector<int> seatsOf(const SeatRequestBody &request) {
+        return std::vector<int>(request.seats, request.seats + request.seatCount);
+    }
+}
+
+TEST(SeatRequestDecoderTest, fields) {
+    std::string body = R"( { "movie": "Movie X", "theater" : "Theater A", "seats": [1, 2, -3], "showtime": 7 } )";
+    SeatRequestBody request;
+    ASSERT_TRUE(decode(body, request));
+    EXPECT_TRUE(request.hasMovie);
+    EXPECT_TRUE(request.hasTheater);
+    EXPECT_TRUE(request.hasSeats);
+    EXPECT_EQ(request.movie, "Movie X");
+    EXPECT_EQ(request.theater, "Theater A");
+    EXPECT_EQ(request.movie.data(), body.data() + body.find("Movie X")); // No copy without escapes
+    EXPECT_EQ(seatsOf(request), std::vector<int>({1, 2, -3}));
+    EXPECT_EQ(request.showtime, 7u);
+}
+
+TEST(SeatRequestDecoderTest, optionalFields) {
+    SeatRequestBody empty;
+    ASSERT_TRUE(decode("", empty));
+    EXPECT_FALSE(empty.hasMovie);
+
+    SeatRequestBody request;
+    ASSERT_TRUE(decode(R"({"movie":"M"})", request));
+    EXPECT_TRUE(request.hasMovie);
+    EXPECT_FALSE(request.hasTheater);
+    EXPECT_FALSE(request.hasSeats);
+    EXPECT_EQ(request.showtime, NO_SHOWTIME);
+}
+
+TEST(SeatRequestDecoderTest, escapes) {
+    SeatRequestBody request;
+    ASSERT_TRUE(decode(R"({"movie": "Caf\u00e9 \"Noir\" \ud83c\udfac", "theater": "A\/B\\C\n"})", request));
+    EXPECT_EQ(request.movie, "Caf\xc3\xa9 \"Noir\" \xf0\x9f\x8e\xac");
+    EXPECT_EQ(request.theater, "A/B\\C\n");
+}
+
+TEST(SeatRequestDecoderTest, unknownMembersAreSkipped) {
+    SeatRequestBody request;
+    ASSERT_TRUE(decode(R"({"client": {"id": [1, 2.5e3, true, null, "x\"y"], "ok": false}, "movie": "M", "movie": "N",
+                           "seats": [1, "2", 3.5, 4, {"a": []}]})", request));
+    EXPECT_EQ(request.movie, "N"); // Last one wins
+    EXPECT_EQ(seatsOf(request), std::vector<int>({1, 4}));
+    EXPECT_EQ(request.skippedSeats, 3u);
+}
+
+TEST(SeatRequestDecoderTest, malformed) {
+    const char *bodies[] = {
+        "[]",
+        "{",
+        "{\"movie\": \"M\"",
+        "{\"movie\": \"M\"} x",
+        "{\"movie\": \"M\",}",
+        "{\"movie\" \"M\"}",
+        "{movie: \"M\"}",
+        "{\"movie\": 5}",
+        "{\"theater\": null}",
+        "{\"seats\": 5}",
+        "{\"seats\": [1 2]}",
+        "{\"seats\": [01]}",
+        "{\"showtime\": -1}",
+        "{\"showtime\": 1.5}",
+        "{\"showtime\": 4294967295}",
+        "{\"movie\": \"a\\x\"}",
+        "{\"movie\": \"\\ud83c\"}",
+        "{\"movie\": \"tab\there\"}",
+        "{\"other\": tru}",
+        "{\"other\": [1,]}",
+        "{\"other\": {1: 2}}",
+    };
+    for (const char *body : bodies) {
+        SeatRequestBody request;
+        EXPECT_FALSE(decode(body, request)) << body;
+    }
+}
+
+TEST(SeatRequestDecoderTest, limits) {
+    std::string seats;
+    for (std::size_t i = 0; i < SeatRequestBody::MAX_SEATS; ++i) {
+        seats += (i ? "," : "") + std::to_string(i);
+    }
+    SeatRequestBody full;
+    ASSERT_TRUE(decode("{\"seats\": [" + seats + "]}", full));
+    EXPECT_EQ(full.seatCount, SeatRequestBody::MAX_SEATS);
+    SeatRequestBody tooMany;
+    EXPECT_FALSE(decode("{\"seats\": [" + seats + ",1]}", tooMany));
+
+    std::string nested(SeatRequestDecoder::MAX_DEPTH + 2, '[');
+    nested += std::string(SeatRequestDecoder::MAX_DEPTH + 2, ']');
+    SeatRequestBody deep;
+    EXPECT_FALSE(decode("{\"other\": " + nested + "}", deep));
+
+    std::string escaped;
+    for (std::size_t i = 0; i <= SeatRequestBody::MAX_TEXT_SIZE; ++i) {
+        escaped += "\\n";
+    }
+    SeatRequestBody longText;
+    EXPECT_FALSE(decode("{\"movie\": \"" + escaped + "\"}", longText));
+}
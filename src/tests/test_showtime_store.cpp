@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+#include "showtime_store.h"
+
+#include <cstdint>
+#include <vector>
+
+TEST(ShowtimeStoreTest, layout) {
+    ShowtimeStore store;
+    EXPECT_EQ(store.add(3, 1, 100, 200, 20), 0u);
+    EXPECT_EQ(store.add(4, 2, 50, 10, 0), 1u);
+    store.allocate();
+
+    EXPECT_EQ(store.size(), 2u);
+    EXPECT_EQ(store.getWordCount(), 5u); // Packed word by word, not padded to cache lines
+    EXPECT_EQ(store.getRoom(1), 4u);
+    EXPECT_EQ(store.getMovie(1), 2u);
+    EXPECT_EQ(store.getStart(0), 100);
+    EXPECT_EQ(store.getCapacity(0), 200);
+    EXPECT_EQ(store.getSeatsPerRow(1), 10); // Whole room is one row when none is given
+}
+
+TEST(ShowtimeStoreTest, shareSeats) {
+    ShowtimeStore previous;
+    previous.add(0, 0, 0, 100, 10);
+    previous.add(0, 0, 60, 100, 10);
+    previous.allocate();
+    ASSERT_TRUE(previous.reserve(1, {5}));
+
+    ShowtimeStore next;
+    next.add(2, 0, 60, 100, 10);
+    next.add(2, 0, 120, 50, 10);
+    next.allocate();
+    ASSERT_TRUE(next.shareSeats(0, previous, 1));
+    EXPECT_FALSE(next.shareSeats(1, previous, 0)); // Capacity differs
+
+    EXPECT_FALSE(next.isAvailable(0, 5));
+    EXPECT_TRUE(next.reserve(0, {6}));
+    EXPECT_FALSE(previous.reserve(1, {6}));
+    EXPECT_EQ(previous.getVersion(1), next.getVersion(0));
+    EXPECT_TRUE(next.reserve(1, {5}));
+}
+
+TEST(ShowtimeStoreTest, seatsAreSeparate) {
+    ShowtimeStore store;
+    store.add(0, 0, 0, 100, 10);
+    store.add(0, 0, 60, 100, 10);
+    store.allocate();
+
+    EXPECT_TRUE(store.reserve(0, {1, 2, 99}));
+    EXPECT_FALSE(store.reserve(0, {2, 3}));
+    EXPECT_FALSE(store.reserve(0, {100}));
+    EXPECT_TRUE(store.isAvailable(0, 3));
+    EXPECT_TRUE(store.reserve(1, {2}));
+    EXPECT_EQ(store.getBookedSeats(0), std::vector<int>({1, 2, 99}));
+    EXPECT_EQ(store.getBookedSeats(1), std::vector<int>({2}));
+    EXPECT_EQ(store.getVersion(0), 1u);
+
+    EXPECT_EQ(store.reserveAvailable(1, 3, true), std::vector<int>({3, 4, 5}));
+    std::vector<int> first = {7}, second = {7, 8};
+    EXPECT_EQ(store.reserveBatch(0, {&first, &second}), std::vector<bool>({true, false}));
+    EXPECT_EQ(store.getVersion(0), 2u);
+    EXPECT_EQ(store.getVersion(1), 2u);
+}
+
+TEST(ShowtimeStoreTest, packedNeighboursStayApart) {
+    ShowtimeStore store;
+    for (int i = 0; i < 3; ++i) {
+        store.add(0, 0, i * 60, 20, 10);
+    }
+    store.allocate();
+    ASSERT_EQ(store.getWordCount(), 3u);
+
+    // Filling the middle showtime leaves the words next to it alone
+    EXPECT_EQ(store.reserveAvailable(1, 20, false).size(), 20u);
+    EXPECT_TRUE(store.reserveAvailable(1, 1, false).empty());
+    EXPECT_TRUE(store.getBookedSeats(0).empty());
+    EXPECT_TRUE(store.getBookedSeats(2).empty());
+    EXPECT_EQ(store.reserveAvailable(2, 20, false).size(), 20u);
+
+    std::uint64_t copy[1] = {0};
+    store.snapshot(1, copy);
+    EXPECT_EQ(copy[0], (std::uint64_t(1) << 20) - 1);
+}
+
+TEST(ShowtimeStoreTest, externalWords) {
+    ShowtimeStore store;
+    store.add(0, 0, 0, 70, 10);
+    alignas(SeatMap::CACHE_LINE_SIZE) std::uint64_t words[2] = {1, 2};
+    ASSERT_EQ(store.getWordCount(), sizeof(words) / sizeof(words[0]));
+    store.allocate(words);
+
+    EXPECT_FALSE(store.isAvailable(0, 0));
+    EXPECT_FALSE(store.isAvailable(0, 65));
+    EXPECT_TRUE(store.reserve(0, {1}));
+    EXPECT_EQ(words[0], 3u);
+
+    std::vector<std::uint64_t> copy(store.getWordCount());
+    store.copyWords(copy.data());
+    EXPECT_EQ(copy[1], 2u);
+}
+
+TEST(ShowtimeStoreTest, startTimes) {
+    std::int64_t start = 0;
+    ASSERT_TRUE(ShowtimeStore::parseStart("1970-01-02T01:05", start));
+    EXPECT_EQ(start, 24 * 60 + 65);
+    ASSERT_TRUE(ShowtimeStore::parseStart("2024-02-29 23:59", start));
+    EXPECT_EQ(ShowtimeStore::formatStart(start), "2024-02-29T23:59");
+    ASSERT_TRUE(ShowtimeStore::parseStart("1969-12-31T23:00", start));
+    EXPECT_EQ(start, -60);
+    EXPECT_EQ(ShowtimeStore::formatStart(start), "1969-12-31T23:00");
+
+    EXPECT_FALSE(ShowtimeStore::parseStart("2023-02-29T10:00", start));
+    EXPECT_FALSE(ShowtimeStore::parseStart("2024-01-01T24:00", start));
+    EXPECT_FALSE(ShowtimeStore::parseStart("2024-01-01T10:00Z", start));
+    EXPECT_FALSE(ShowtimeStore::parseStart("tonight", start));
+}
@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "timer_wheel.h"
+
+#include <random>
+#include <vector>
+
+TEST(TimerWheelTest, firesAtDeadline) {
+    TimerWheel wheel;
+    std::vector<std::uint64_t> fired;
+    auto collect = [&fired](std::uint64_t id) { fired.push_back(id); };
+
+    wheel.schedule(1, 5);
+    wheel.schedule(2, 3);
+    wheel.schedule(3, 0); // Already due, fires on the next tick
+    EXPECT_EQ(wheel.size(), 3u);
+
+    EXPECT_EQ(wheel.advance(2, collect), 1u);
+    EXPECT_EQ(fired, std::vector<std::uint64_t>({3}));
+    EXPECT_EQ(wheel.advance(4, collect), 1u);
+    EXPECT_EQ(fired, std::vector<std::uint64_t>({3, 2}));
+    EXPECT_EQ(wheel.advance(5, collect), 1u);
+    EXPECT_EQ(fired, std::vector<std::uint64_t>({3, 2, 1}));
+    EXPECT_EQ(wheel.size(), 0u);
+    EXPECT_EQ(wheel.getCurrentTick(), 5u);
+}
+
+TEST(TimerWheelTest, cascadesThroughLevels) {
+    // Deadlines on every level, across level boundaries and past the span of the wheel
+    const std::uint64_t start = (1u << 24) - 100;
+    const std::uint64_t span = std::uint64_t(1) << (TimerWheel::SLOT_BITS * TimerWheel::LEVELS);
+    std::vector<std::uint64_t> deadlines = {start + 1, start + 63, start + 64, start + 100, start + 4097,
+                                            start + 300000, start + span - 1, start + span + 12345, start + 3 * span};
+    TimerWheel wheel(start);
+    for (std::size_t i = 0; i < deadlines.size(); ++i) {
+        wheel.schedule(i, deadlines[i]);
+    }
+
+    std::uint64_t now = start;
+    std::vector<std::uint64_t> firedAt(deadlines.size(), 0);
+    // Turn in uneven steps, recording the tick each timer fired by
+    std::mt19937_64 random(7);
+    while (wheel.size() > 0) {
+        now += 1 + random() % 5000;
+        wheel.advance(now, [&firedAt, &wheel](std::uint64_t id) { firedAt[id] = wheel.getCurrentTick(); });
+    }
+    for (std::size_t i = 0; i < deadlines.size(); ++i) {
+        EXPECT_EQ(firedAt[i], deadlines[i]) << "timer " << i;
+    }
+}
+
+TEST(TimerWheelTest, manyTimers) {
+    TimerWheel wheel;
+    std::mt19937_64 random(42);
+    std::vector<std::uint64_t> deadlines(100000);
+    for (std::size_t i = 0; i < deadlines.size(); ++i) {
+        deadlines[i] = 1 + random() % 200000;
+        wheel.schedule(i, deadlines[i]);
+    }
+    std::size_t late = 0;
+    std::size_t fired = wheel.advance(200000, [&](std::uint64_t id) {
+        late += wheel.getCurrentTick() != deadlines[id];
+    });
+    EXPECT_EQ(fired, deadlines.size());
+    EXPECT_EQ(late, 0u);
+}